@@ -1,26 +1,493 @@
 #include "MTS4x.h"
 #include <string.h>
+#if MTS4X_THREAD_SAFE
+#if defined(ESP32)
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#else
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#endif
+#endif
+#ifndef MTS4X_NO_FLOAT
 #include <math.h>
+#endif
 
 // -----------------------------------------------------------------------------
 // CRC8: Dallas/Maxim style (x^8 + x^5 + x^4 + 1, poly 0x31, LSB-first, init 0x00)
 // Это тот же полином, что в даташите, но реализованный в "дәлласовском" порядке
 // бит (как у DS18B20). Именно такой вариант, скорее всего, использует MTS4.
+//
+// Backend is chosen at compile time with MTS4X_CRC_IMPL (see MTS4x.h).
+// Both lookup tables are generated by the compiler from the bitwise step.
 // -----------------------------------------------------------------------------
-static uint8_t mts4x_crc8(const uint8_t *data, size_t len) {
-    uint8_t crc = 0x00;
+
+// One bit of the reflected CRC (отражённый полином 0x31 -> 0x8C)
+static constexpr uint8_t mts4x_crc8_bit(uint8_t c) {
+    return (c & 0x01) ? (uint8_t)((c >> 1) ^ 0x8C) : (uint8_t)(c >> 1);
+}
+
+static constexpr uint8_t mts4x_crc8_nib(uint8_t c) {
+    return mts4x_crc8_bit(mts4x_crc8_bit(mts4x_crc8_bit(mts4x_crc8_bit(c))));
+}
+
+static constexpr uint8_t mts4x_crc8_byte(uint8_t c) {
+    return mts4x_crc8_nib(mts4x_crc8_nib(c));
+}
+
+#if MTS4X_CRC_IMPL == MTS4X_CRC_TABLE
+
+#define MTS4X_CRC_T4(n)   mts4x_crc8_byte(n), mts4x_crc8_byte(n + 1), \
+                          mts4x_crc8_byte(n + 2), mts4x_crc8_byte(n + 3)
+#define MTS4X_CRC_T16(n)  MTS4X_CRC_T4(n), MTS4X_CRC_T4(n + 4), \
+                          MTS4X_CRC_T4(n + 8), MTS4X_CRC_T4(n + 12)
+#define MTS4X_CRC_T64(n)  MTS4X_CRC_T16(n), MTS4X_CRC_T16(n + 16), \
+                          MTS4X_CRC_T16(n + 32), MTS4X_CRC_T16(n + 48)
+
+static const uint8_t mts4x_crc8_table[256] PROGMEM = {
+    MTS4X_CRC_T64(0), MTS4X_CRC_T64(64), MTS4X_CRC_T64(128), MTS4X_CRC_T64(192)
+};
+
+#undef MTS4X_CRC_T64
+#undef MTS4X_CRC_T16
+#undef MTS4X_CRC_T4
+
+#elif MTS4X_CRC_IMPL == MTS4X_CRC_NIBBLE
+
+static const uint8_t mts4x_crc8_table[16] PROGMEM = {
+    mts4x_crc8_nib(0),  mts4x_crc8_nib(1),  mts4x_crc8_nib(2),  mts4x_crc8_nib(3),
+    mts4x_crc8_nib(4),  mts4x_crc8_nib(5),  mts4x_crc8_nib(6),  mts4x_crc8_nib(7),
+    mts4x_crc8_nib(8),  mts4x_crc8_nib(9),  mts4x_crc8_nib(10), mts4x_crc8_nib(11),
+    mts4x_crc8_nib(12), mts4x_crc8_nib(13), mts4x_crc8_nib(14), mts4x_crc8_nib(15)
+};
+
+#endif
+
+static inline uint8_t mts4x_crc8_step(uint8_t crc, uint8_t in) {
+#if MTS4X_CRC_IMPL == MTS4X_CRC_TABLE
+    return pgm_read_byte(&mts4x_crc8_table[crc ^ in]);
+#elif MTS4X_CRC_IMPL == MTS4X_CRC_NIBBLE
+    crc ^= in;
+    crc = (uint8_t)((crc >> 4) ^ pgm_read_byte(&mts4x_crc8_table[crc & 0x0F]));
+    crc = (uint8_t)((crc >> 4) ^ pgm_read_byte(&mts4x_crc8_table[crc & 0x0F]));
+    return crc;
+#else
+    for (uint8_t i = 0; i < 8; ++i) {
+        uint8_t mix = (crc ^ in) & 0x01;
+        crc >>= 1;
+        if (mix) {
+            crc ^= 0x8C;
+        }
+        in >>= 1;
+    }
+    return crc;
+#endif
+}
+
+void MTS4xCrc8::update(uint8_t in) {
+    _crc = mts4x_crc8_step(_crc, in);
+}
+
+void MTS4xCrc8::update(const uint8_t *data, size_t len) {
+    uint8_t crc = _crc;
     while (len--) {
-        uint8_t in = *data++;
-        for (uint8_t i = 0; i < 8; ++i) {
-            uint8_t mix = (crc ^ in) & 0x01;
-            crc >>= 1;
-            if (mix) {
-                crc ^= 0x8C;    // отражённый полином 0x31
+        crc = mts4x_crc8_step(crc, *data++);
+    }
+    _crc = crc;
+}
+
+uint8_t MTS4xCrc8::compute(const uint8_t *data, size_t len) {
+    MTS4xCrc8 crc;
+    crc.update(data, len);
+    return crc.value();
+}
+
+static uint8_t mts4x_crc8(const uint8_t *data, size_t len) {
+    return MTS4xCrc8::compute(data, len);
+}
+
+// -----------------------------------------------------------------------------
+// Per-bus locking (MTS4X_THREAD_SAFE)
+//
+// One recursive lock per TwoWire, found by pointer in a small registry and
+// created on first use. Recursive so that a read-modify-write can hold the
+// lock around the helpers that take it again per transaction.
+// -----------------------------------------------------------------------------
+
+#if MTS4X_THREAD_SAFE
+
+#ifndef MTS4X_MAX_BUSES
+#define MTS4X_MAX_BUSES 4
+#endif
+
+#if defined(ESP32)
+
+typedef SemaphoreHandle_t mts4x_lock_t;
+
+static mts4x_lock_t mts4x_lock_create() {
+    return xSemaphoreCreateRecursiveMutex();
+}
+static void mts4x_lock_take(mts4x_lock_t l) {
+    xSemaphoreTakeRecursive(l, portMAX_DELAY);
+}
+static void mts4x_lock_give(mts4x_lock_t l) {
+    xSemaphoreGiveRecursive(l);
+}
+
+// Registry lock, created race-free on first use
+static mts4x_lock_t mts4x_registry_lock() {
+    static mts4x_lock_t s_lock = NULL;
+    mts4x_lock_t l = __atomic_load_n(&s_lock, __ATOMIC_ACQUIRE);
+    if (l) {
+        return l;
+    }
+    mts4x_lock_t fresh    = xSemaphoreCreateMutex();
+    mts4x_lock_t expected = NULL;
+    if (!__atomic_compare_exchange_n(&s_lock, &expected, fresh, false,
+                                     __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+        vSemaphoreDelete(fresh);
+        return expected;
+    }
+    return fresh;
+}
+#define MTS4X_REGISTRY_LOCK()   xSemaphoreTake(mts4x_registry_lock(), portMAX_DELAY)
+#define MTS4X_REGISTRY_UNLOCK() xSemaphoreGive(mts4x_registry_lock())
+
+#else
+
+// Recursive and first come, first served: a task that gives the bus up
+// and asks for it again right away queues behind the tasks already
+// waiting, instead of winning the race for an unfair mutex
+struct mts4x_host_lock {
+    std::mutex              mutex;
+    std::condition_variable turn;
+    std::thread::id         owner;
+    uint32_t                depth;
+    uint32_t                next;      // next ticket handed out
+    uint32_t                serving;   // ticket that holds the lock
+
+    mts4x_host_lock() : depth(0), next(0), serving(0) {}
+};
+
+typedef mts4x_host_lock *mts4x_lock_t;
+
+static mts4x_lock_t mts4x_lock_create() {
+    return new mts4x_host_lock();
+}
+static void mts4x_lock_take(mts4x_lock_t l) {
+    std::unique_lock<std::mutex> g(l->mutex);
+    if (l->depth && l->owner == std::this_thread::get_id()) {
+        ++l->depth;
+        return;
+    }
+    uint32_t ticket = l->next++;
+    while (l->serving != ticket) {
+        l->turn.wait(g);
+    }
+    l->owner = std::this_thread::get_id();
+    l->depth = 1;
+}
+static void mts4x_lock_give(mts4x_lock_t l) {
+    std::lock_guard<std::mutex> g(l->mutex);
+    if (--l->depth) {
+        return;
+    }
+    l->owner = std::thread::id();
+    ++l->serving;
+    l->turn.notify_all();
+}
+
+static std::mutex &mts4x_registry_mutex() {
+    static std::mutex s_mutex;
+    return s_mutex;
+}
+#define MTS4X_REGISTRY_LOCK()   mts4x_registry_mutex().lock()
+#define MTS4X_REGISTRY_UNLOCK() mts4x_registry_mutex().unlock()
+
+#endif
+
+static struct {
+    const void  *bus;
+    mts4x_lock_t lock;
+} s_mts4xBusLocks[MTS4X_MAX_BUSES];
+
+static mts4x_lock_t mts4x_bus_lock(const void *bus) {
+    mts4x_lock_t found = NULL;
+    MTS4X_REGISTRY_LOCK();
+    for (uint8_t i = 0; i < MTS4X_MAX_BUSES; ++i) {
+        if (s_mts4xBusLocks[i].bus == bus) {
+            found = s_mts4xBusLocks[i].lock;
+            break;
+        }
+        if (!s_mts4xBusLocks[i].bus) {
+            s_mts4xBusLocks[i].bus  = bus;
+            s_mts4xBusLocks[i].lock = mts4x_lock_create();
+            found = s_mts4xBusLocks[i].lock;
+            break;
+        }
+    }
+    MTS4X_REGISTRY_UNLOCK();
+    return found;   // NULL: registry full, bus left unlocked
+}
+
+MTS4xBusGuard::MTS4xBusGuard(const void *bus)
+: _lock((void *)mts4x_bus_lock(bus)) {
+    if (_lock) {
+        mts4x_lock_take((mts4x_lock_t)_lock);
+    }
+}
+
+MTS4xBusGuard::~MTS4xBusGuard() {
+    if (_lock) {
+        mts4x_lock_give((mts4x_lock_t)_lock);
+    }
+}
+
+// Error of the last call made by this task/thread
+static thread_local int8_t t_mts4xLastError = MTS4X_ERR_OK;
+
+#endif // MTS4X_THREAD_SAFE
+
+// -----------------------------------------------------------------------------
+// Integer temperature conversion (no float on the path)
+//
+// T[m°C] = 25000 + raw * 1000 / 256 = (800000 + raw * 125) / 32
+// Both directions round half away from zero, like lroundf() in the float API.
+// -----------------------------------------------------------------------------
+
+int32_t mts4x_raw_to_milli(int16_t raw) {
+    int32_t n = 800000L + (int32_t)raw * 125;
+    return (n >= 0) ? (n + 16) / 32 : -((16 - n) / 32);
+}
+
+int16_t mts4x_milli_to_raw(int32_t mC) {
+    // Clamp first so the scaling below cannot overflow
+    if (mC > 160000L)  mC = 160000L;
+    if (mC < -110000L) mC = -110000L;
+    int32_t n   = (mC - 25000L) * 32;
+    int32_t raw = (n >= 0) ? (n + 62) / 125 : -((62 - n) / 125);
+    if (raw > 32767L)  raw = 32767L;
+    if (raw < -32768L) raw = -32768L;
+    return (int16_t)raw;
+}
+
+int32_t mts4x_raw_to_q8_8(int16_t raw) {
+    return (int32_t)raw + (25L << 8);
+}
+
+size_t mts4x_format_milli(char *buf, size_t size, int32_t mC, uint8_t decimals) {
+    if (!buf || !size) {
+        return 0;
+    }
+    if (decimals > 3) {
+        decimals = 3;
+    }
+
+    bool     neg = (mC < 0);
+    uint32_t mag = neg ? (uint32_t)(-(mC + 1)) + 1U : (uint32_t)mC;
+
+    // Round away the dropped digits (half away from zero)
+    static const uint16_t kDiv[4] = { 1000, 100, 10, 1 };
+    uint32_t div = kDiv[decimals];
+    mag = (mag + div / 2) / div;
+
+    // Digits are produced right to left
+    char     tmp[16];
+    uint8_t  n = 0;
+    for (uint8_t i = 0; i < decimals; ++i) {
+        tmp[n++] = (char)('0' + mag % 10);
+        mag /= 10;
+    }
+    if (decimals) {
+        tmp[n++] = '.';
+    }
+    do {
+        tmp[n++] = (char)('0' + mag % 10);
+        mag /= 10;
+    } while (mag);
+    if (neg) {
+        // Skip the sign if everything rounded to zero
+        bool zero = true;
+        for (uint8_t i = 0; i < n; ++i) {
+            if (tmp[i] != '0' && tmp[i] != '.') {
+                zero = false;
+                break;
             }
-            in >>= 1;
+        }
+        if (!zero) {
+            tmp[n++] = '-';
         }
     }
-    return crc;
+
+    if ((size_t)n + 1 > size) {
+        buf[0] = '\0';
+        return 0;
+    }
+    for (uint8_t i = 0; i < n; ++i) {
+        buf[i] = tmp[n - 1 - i];
+    }
+    buf[n] = '\0';
+    return n;
+}
+
+// Non-blocking conversion phases (MTS4X::_convState)
+enum {
+    MTS4X_CONV_IDLE = 0,
+    MTS4X_CONV_WAIT,      // waiting for expected conversion time / BUSY == 0
+    MTS4X_CONV_READY,
+    MTS4X_CONV_ERROR
+};
+
+// Max time a conversion may take before poll() reports a timeout
+#define MTS4X_CONV_TIMEOUT_US 200000UL
+
+uint32_t mts4x_avg_time_us(TempCfgAVG avg) {
+    switch (avg) {
+        case AVG_1:  return 2200UL;
+        case AVG_8:  return 5200UL;
+        case AVG_16: return 8500UL;
+        case AVG_32:
+        default:     return 15300UL;
+    }
+}
+
+static uint32_t mts4x_conv_time_us(uint8_t tempCfg) {
+    if (tempCfg == 0xFF) {
+        return 15300UL; // config unknown -> worst case
+    }
+    return mts4x_avg_time_us((TempCfgAVG)(tempCfg & 0x18));
+}
+
+// Statistics update: one seqlock write section, gone without MTS4X_ENABLE_STATS
+#if MTS4X_ENABLE_STATS
+#define MTS4X_STAT(...) do {                        \
+        MTS4xBusGuard statGuard(_bus->lockKey());   \
+        statsBegin();                               \
+        __VA_ARGS__;                                \
+        statsEnd();                                 \
+    } while (0)
+#else
+#define MTS4X_STAT(...) do { } while (0)
+#endif
+
+// -----------------------------------------------------------------------------
+// Transports
+// -----------------------------------------------------------------------------
+
+uint32_t MTS4xBus::millis() {
+    return ::millis();
+}
+
+uint32_t MTS4xBus::micros() {
+    return ::micros();
+}
+
+void MTS4xBus::delay(uint32_t ms) {
+    ::delay(ms);
+}
+
+bool MTS4xWireBus::begin(int32_t sda, int32_t scl) {
+#if defined(ESP8266) || defined(ESP32)
+    _wire->begin(sda, scl);
+#else
+    _wire->begin();
+#if defined(SDA) && defined(SCL)
+    sda = SDA;
+    scl = SCL;
+#endif
+#endif
+    _sda = sda;
+    _scl = scl;
+    return true;
+}
+
+#if MTS4X_BUS_RECOVERY
+
+// Open-drain by hand: drive low, or release to the pull-up
+static void mts4x_line(int32_t pin, bool high) {
+    if (high) {
+        pinMode((uint8_t)pin, INPUT_PULLUP);
+    } else {
+        digitalWrite((uint8_t)pin, LOW);
+        pinMode((uint8_t)pin, OUTPUT);
+    }
+    delayMicroseconds(5);
+}
+
+bool MTS4xWireBus::recover(uint32_t hz) {
+    if (_sda < 0 || _scl < 0) {
+        return false;
+    }
+#if defined(ESP32) || defined(__AVR__)
+    _wire->end();
+#endif
+    mts4x_line(_sda, true);
+    mts4x_line(_scl, true);
+
+    // A slave cut off mid-byte holds SDA low until it has clocked out the
+    // rest of the byte and the ACK slot: at most 9 pulses
+    for (uint8_t i = 0; i < 9 && digitalRead((uint8_t)_sda) == LOW; ++i) {
+        mts4x_line(_scl, false);
+        mts4x_line(_scl, true);
+        // Clock stretching, bounded
+        for (uint8_t t = 0; t < 20 && digitalRead((uint8_t)_scl) == LOW; ++t) {
+            delayMicroseconds(5);
+        }
+    }
+
+    // STOP: SDA rises while SCL is high
+    mts4x_line(_scl, false);
+    mts4x_line(_sda, false);
+    mts4x_line(_scl, true);
+    mts4x_line(_sda, true);
+    bool released = digitalRead((uint8_t)_sda) == HIGH &&
+                    digitalRead((uint8_t)_scl) == HIGH;
+
+    begin(_sda, _scl);
+    setClock(hz);
+    return released;
+}
+
+#endif // MTS4X_BUS_RECOVERY
+
+void MTS4xWireBus::setClock(uint32_t hz) {
+    _wire->setClock(hz);
+}
+
+bool MTS4xWireBus::writeRegs(uint8_t addr, uint8_t reg,
+                             const uint8_t *data, size_t len) {
+    _wire->beginTransmission(addr);
+    _wire->write(reg);
+    for (size_t i = 0; i < len; ++i) {
+        _wire->write(data[i]);
+    }
+    return _wire->endTransmission() == 0;
+}
+
+bool MTS4xWireBus::readRegs(uint8_t addr, uint8_t reg,
+                            uint8_t *data, size_t len) {
+    _wire->beginTransmission(addr);
+    _wire->write(reg);
+    if (_wire->endTransmission(false) != 0) {
+        return false;
+    }
+
+    size_t toRead = len;
+    size_t offset = 0;
+    while (toRead > 0) {
+        uint8_t chunk = (toRead > 32) ? 32 : (uint8_t)toRead;
+        uint8_t got   = _wire->requestFrom((int)addr, (int)chunk);
+        if (got != chunk) {
+            return false;
+        }
+        for (uint8_t i = 0; i < chunk; ++i) {
+            data[offset + i] = (uint8_t)_wire->read();
+        }
+        offset += chunk;
+        toRead -= chunk;
+    }
+    return true;
 }
 
 // -----------------------------------------------------------------------------
@@ -28,45 +495,208 @@ static uint8_t mts4x_crc8(const uint8_t *data, size_t len) {
 // -----------------------------------------------------------------------------
 
 MTS4X::MTS4X(uint8_t address, TwoWire &wire)
-: _wire(&wire),
+: _wireBus(wire),
+  _bus(&_wireBus),
+  _addr(address),
+  _lastError(MTS4X_ERR_OK),
+  _busClock(400000UL),
+  _useCrc(true),
+  _tempCfg(0xFF),
+  _recoveryUs(0),
+  _convState(MTS4X_CONV_IDLE),
+  _convAttempts(0),
+  _convCrcOk(false),
+  _convRaw(0),
+  _convStartUs(0),
+  _transactions(0),
+#if MTS4X_ENABLE_STATS
+  _statsSeq(0),
+#endif
+  _shadowEnabled(false),
+  _shadowDeferred(false),
+  _shadowValid(0),
+  _shadowDirty(0) {
+    memset(_shadow, 0, sizeof(_shadow));
+#if MTS4X_ENABLE_STATS
+    memset(&_stats, 0, sizeof(_stats));
+#endif
+}
+
+MTS4X::MTS4X(MTS4xBus &bus, uint8_t address)
+: _wireBus(Wire),
+  _bus(&bus),
   _addr(address),
   _lastError(MTS4X_ERR_OK),
   _busClock(400000UL),
-  _useCrc(true) {
+  _useCrc(true),
+  _tempCfg(0xFF),
+  _recoveryUs(0),
+  _convState(MTS4X_CONV_IDLE),
+  _convAttempts(0),
+  _convCrcOk(false),
+  _convRaw(0),
+  _convStartUs(0),
+  _transactions(0),
+#if MTS4X_ENABLE_STATS
+  _statsSeq(0),
+#endif
+  _shadowEnabled(false),
+  _shadowDeferred(false),
+  _shadowValid(0),
+  _shadowDirty(0) {
+    memset(_shadow, 0, sizeof(_shadow));
+#if MTS4X_ENABLE_STATS
+    memset(&_stats, 0, sizeof(_stats));
+#endif
+}
+
+MTS4xBus &MTS4X::bus() const {
+    return *_bus;
 }
 
 void MTS4X::setError(int8_t err) {
+    switch (err) {
+        case MTS4X_ERR_WIRE:    MTS4X_STAT(++_stats.errWire);    break;
+        case MTS4X_ERR_TIMEOUT: MTS4X_STAT(++_stats.errTimeout); break;
+        case MTS4X_ERR_PARAM:   MTS4X_STAT(++_stats.errParam);   break;
+        case MTS4X_ERR_CRC:     MTS4X_STAT(++_stats.errCrc);     break;
+        case MTS4X_ERR_VERIFY:  MTS4X_STAT(++_stats.errVerify);  break;
+        default:                break;
+    }
+#if MTS4X_THREAD_SAFE
+    t_mts4xLastError = err;
+#else
     _lastError = err;
+#endif
 }
 
 int8_t MTS4X::lastError() const {
+#if MTS4X_THREAD_SAFE
+    return t_mts4xLastError;
+#else
     return _lastError;
+#endif
 }
 
 uint32_t MTS4X::busClock() const {
     return _busClock;
 }
 
+void MTS4X::setRecoveryDeadline(uint32_t deadlineUs) {
+    _recoveryUs = deadlineUs;
+}
+
+uint32_t MTS4X::recoveryDeadline() const {
+    return _recoveryUs;
+}
+
 void MTS4X::setBusClock(uint32_t hz) {
     _busClock = hz;
-    if (_wire) {
-        _wire->setClock(hz);
+    _bus->setClock(hz);
+}
+
+uint32_t MTS4X::transactionCount() const {
+    return _transactions;
+}
+
+void MTS4X::resetTransactionCount() {
+    _transactions = 0;
+}
+
+// -----------------------------------------------------------------------------
+// Driver statistics (MTS4X_ENABLE_STATS)
+//
+// Writers bump _statsSeq to odd, update, bump it back to even; stats()
+// copies the block and retries if the sequence was odd or moved meanwhile.
+// The hot path never waits for a reader. Concurrent writers on one object
+// are serialised by the bus guard (MTS4X_THREAD_SAFE).
+// -----------------------------------------------------------------------------
+
+#if MTS4X_ENABLE_STATS
+
+// AVR has no 32-bit atomics and no second core; the driver never runs in
+// an ISR there, so compiler barriers are enough
+#if defined(__AVR__)
+#define MTS4X_SEQ_LOAD_ACQ(x)     (__extension__({ uint32_t v_ = (x); \
+                                   __asm__ __volatile__("" ::: "memory"); v_; }))
+#define MTS4X_SEQ_LOAD_RLX(x)     (x)
+#define MTS4X_SEQ_STORE_RLX(x, v) ((x) = (v))
+#define MTS4X_SEQ_STORE_REL(x, v) do { __asm__ __volatile__("" ::: "memory"); \
+                                       (x) = (v); } while (0)
+#define MTS4X_SEQ_FENCE_REL()     __asm__ __volatile__("" ::: "memory")
+#define MTS4X_SEQ_FENCE_ACQ()     __asm__ __volatile__("" ::: "memory")
+#else
+#define MTS4X_SEQ_LOAD_ACQ(x)     __atomic_load_n(&(x), __ATOMIC_ACQUIRE)
+#define MTS4X_SEQ_LOAD_RLX(x)     __atomic_load_n(&(x), __ATOMIC_RELAXED)
+#define MTS4X_SEQ_STORE_RLX(x, v) __atomic_store_n(&(x), (v), __ATOMIC_RELAXED)
+#define MTS4X_SEQ_STORE_REL(x, v) __atomic_store_n(&(x), (v), __ATOMIC_RELEASE)
+#define MTS4X_SEQ_FENCE_REL()     __atomic_thread_fence(__ATOMIC_RELEASE)
+#define MTS4X_SEQ_FENCE_ACQ()     __atomic_thread_fence(__ATOMIC_ACQUIRE)
+#endif
+
+void MTS4X::statsBegin() {
+    MTS4X_SEQ_STORE_RLX(_statsSeq, _statsSeq + 1);
+    MTS4X_SEQ_FENCE_REL();
+}
+
+void MTS4X::statsEnd() {
+    MTS4X_SEQ_STORE_REL(_statsSeq, _statsSeq + 1);
+}
+
+void MTS4X::statsLatency(uint32_t us) {
+    uint8_t  bucket = 0;
+    uint32_t v      = us;
+    while ((v >>= 1) && bucket < MTS4X_STATS_BUCKETS - 1) {
+        ++bucket;
+    }
+    MTS4X_STAT(
+        ++_stats.reads;
+        ++_stats.latencyHist[bucket];
+        if (us > _stats.latencyMaxUs) _stats.latencyMaxUs = us
+    );
+}
+
+bool MTS4X::stats(MTS4xDriverStats &out) const {
+    for (uint8_t attempt = 0; attempt < 8; ++attempt) {
+        uint32_t seq = MTS4X_SEQ_LOAD_ACQ(_statsSeq);
+        if (seq & 1) {
+            continue;
+        }
+        memcpy(&out, (const void *)&_stats, sizeof(out));
+        MTS4X_SEQ_FENCE_ACQ();
+        if (MTS4X_SEQ_LOAD_RLX(_statsSeq) == seq) {
+            return true;
+        }
     }
+    return false;
+}
+
+void MTS4X::resetStats() {
+    MTS4X_STAT(memset(&_stats, 0, sizeof(_stats)));
+}
+
+#else
+
+bool MTS4X::stats(MTS4xDriverStats &out) const {
+    memset(&out, 0, sizeof(out));
+    return false;
 }
 
+void MTS4X::resetStats() {
+}
+
+#endif // MTS4X_ENABLE_STATS
+
 void MTS4X::setUseCrc(bool enable) {
     _useCrc = enable;
 }
 
 bool MTS4X::begin(int32_t sda, int32_t scl) {
-#if defined(ESP8266) || defined(ESP32)
-    _wire->begin(sda, scl);
-#else
-    (void)sda;
-    (void)scl;
-    _wire->begin();
-#endif
-    _wire->setClock(_busClock);
+    if (!_bus->begin(sda, scl)) {
+        setError(MTS4X_ERR_WIRE);
+        return false;
+    }
+    _bus->setClock(_busClock);
     setError(MTS4X_ERR_OK);
     return true;
 }
@@ -85,97 +715,407 @@ bool MTS4X::begin(int32_t sda, int32_t scl, MeasurementMode mode) {
     return true;
 }
 
-// -----------------------------------------------------------------------------
-// Low level I2C helpers
-// -----------------------------------------------------------------------------
+// Temp_Cmd as read back vs as written: a finished single shot reads back
+// as stop, so both count as the same idle mode, and continuous-readback
+// (10) reads back as continuous (00)
+static bool mts4x_cmd_matches(uint8_t chip, uint8_t want) {
+    if ((want & 0xC0) == 0x80) {
+        want = (uint8_t)(want & 0x3F);
+    }
+    if ((want & 0xC0) == 0xC0) {
+        want = (uint8_t)((want & 0x3F) | 0x40);
+    }
+    if ((chip & 0xC0) == 0xC0) {
+        chip = (uint8_t)((chip & 0x3F) | 0x40);
+    }
+    return chip == want;
+}
 
-bool MTS4X::writeRegister(uint8_t reg, uint8_t value) {
-    if (!_wire) {
-        setError(MTS4X_ERR_WIRE);
+bool MTS4X::warmBegin(int32_t sda, int32_t scl, const MTS4xDriverState &state) {
+    int16_t raw;
+    bool    fresh;
+    return warmBegin(sda, scl, state, raw, fresh);
+}
+
+bool MTS4X::warmBegin(int32_t sda, int32_t scl, const MTS4xDriverState &state,
+                      int16_t &raw, bool &fresh) {
+    raw   = 0;
+    fresh = false;
+    if (!(state.flags & MTS4X_STATE_CONFIG)) {
+        setError(MTS4X_ERR_PARAM);
         return false;
     }
-    _wire->beginTransmission(_addr);
-    _wire->write(reg);
-    _wire->write(value);
-    uint8_t res = _wire->endTransmission();
-    if (res != 0) {
-        setError(MTS4X_ERR_WIRE);
+    if (!begin(sda, scl)) {
         return false;
     }
-    setError(MTS4X_ERR_OK);
-    return true;
-}
+    MTS4xBusGuard guard(_bus->lockKey());
+    _useCrc    = !(state.flags & MTS4X_STATE_NO_CRC);
+    _convState = MTS4X_CONV_IDLE;
+    if (!_shadowEnabled) {
+        _shadowEnabled  = true;
+        _shadowDeferred = false;
+    }
+    invalidateShadow();
 
-bool MTS4X::writeRegisterRaw(uint8_t reg, const uint8_t *data, size_t len) {
-    if (!_wire) {
-        setError(MTS4X_ERR_WIRE);
+    // Temperature, Crc_temp, Status, 0x04..0x0A and Crc_Scratch in one read
+    uint8_t buf[12];
+    if (!readRegisterRaw(MTS4X_TEMP_LSB, buf, sizeof(buf))) {
         return false;
     }
-    _wire->beginTransmission(_addr);
-    _wire->write(reg);
-    for (size_t i = 0; i < len; ++i) {
-        _wire->write(data[i]);
+    const uint8_t *chip      = buf + 4;
+    bool           scratchOk = (mts4x_crc8(buf + 3, 8) == buf[11]);
+    if (scratchOk) {
+        shadowFill(MTS4X_TEMP_CMD, chip, 7);
     }
-    uint8_t res = _wire->endTransmission();
-    if (res != 0) {
-        setError(MTS4X_ERR_WIRE);
+
+    // Temp_Cfg..TL_Msb: one burst over the differing span
+    int8_t first = -1;
+    int8_t last  = -1;
+    for (int8_t i = 1; i < 7; ++i) {
+        if (!scratchOk || chip[i] != state.config[i]) {
+            if (first < 0) {
+                first = i;
+            }
+            last = i;
+        }
+    }
+    bool cmdSame = scratchOk && mts4x_cmd_matches(chip[0], state.config[0]);
+    if (first >= 0 &&
+        !writeConfigRaw((uint8_t)(MTS4X_TEMP_CMD + first), state.config + first,
+                        (size_t)(last - first + 1))) {
         return false;
     }
+    _tempCfg = state.config[1];
+    if (!cmdSame && !writeConfig(MTS4X_TEMP_CMD, state.config[0])) {
+        return false;
+    }
+
+    if (cmdSame && (state.config[0] & 0xC0) == 0x80) {
+        // Continuous-readback reads as 00: keep the mode as saved
+        shadowFill(MTS4X_TEMP_CMD, state.config, 1);
+    }
+
+    bool kept = scratchOk && first < 0 && cmdSame;
+    if (kept && (state.flags & MTS4X_STATE_USER)) {
+        shadowFill(MTS4X_USER_DEFINE_0, state.user, 10);
+    }
+
+    raw = (int16_t)(((uint16_t)buf[1] << 8) | (uint16_t)buf[0]);
+    bool crcOk = !_useCrc || (mts4x_crc8(buf, 2) == buf[2]);
+    fresh = kept && crcOk && !(buf[3] & MTS4X_STATUS_BUSY) &&
+            ((chip[0] & 0xC0) == 0x00 || (chip[0] & 0xC0) == 0x80);
     setError(MTS4X_ERR_OK);
     return true;
 }
 
-bool MTS4X::readRegister(uint8_t reg, uint8_t &value) {
-    if (!_wire) {
-        setError(MTS4X_ERR_WIRE);
+bool MTS4X::captureState(MTS4xDriverState &out, bool withUser) {
+    memset(&out, 0, sizeof(out));
+    if (!readConfigRaw(MTS4X_TEMP_CMD, out.config, sizeof(out.config))) {
         return false;
     }
-    _wire->beginTransmission(_addr);
-    _wire->write(reg);
-    if (_wire->endTransmission(false) != 0) {
-        setError(MTS4X_ERR_WIRE);
+    out.flags = MTS4X_STATE_CONFIG;
+    if (withUser) {
+        if (!readConfigRaw(MTS4X_USER_DEFINE_0, out.user, sizeof(out.user))) {
+            return false;
+        }
+        out.flags |= MTS4X_STATE_USER;
+    }
+    if (!_useCrc) {
+        out.flags |= MTS4X_STATE_NO_CRC;
+    }
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+// Low level I2C helpers
+// -----------------------------------------------------------------------------
+
+bool MTS4X::writeRegister(uint8_t reg, uint8_t value) {
+    return writeRegisterRaw(reg, &value, 1);
+}
+
+bool MTS4X::writeRegisterRaw(uint8_t reg, const uint8_t *data, size_t len) {
+    if (!data && len) {
+        setError(MTS4X_ERR_PARAM);
         return false;
     }
-    if (_wire->requestFrom((int)_addr, (int)1) != 1) {
+    if (!transfer(reg, data, NULL, len)) {
         setError(MTS4X_ERR_WIRE);
         return false;
     }
-    value = (uint8_t)_wire->read();
     setError(MTS4X_ERR_OK);
     return true;
 }
 
+bool MTS4X::readRegister(uint8_t reg, uint8_t &value) {
+    return readRegisterRaw(reg, &value, 1);
+}
+
 bool MTS4X::readRegisterRaw(uint8_t startReg, uint8_t *data, size_t len) {
-    if (!_wire || !data || !len) {
+    if (!data || !len) {
         setError(MTS4X_ERR_PARAM);
         return false;
     }
-    _wire->beginTransmission(_addr);
-    _wire->write(startReg);
-    if (_wire->endTransmission(false) != 0) {
+    if (!transfer(startReg, NULL, data, len)) {
         setError(MTS4X_ERR_WIRE);
         return false;
     }
+    setError(MTS4X_ERR_OK);
+    return true;
+}
 
-    size_t toRead = len;
-    size_t offset = 0;
-    while (toRead > 0) {
-        uint8_t chunk = (toRead > 32) ? 32 : (uint8_t)toRead;
-        uint8_t got   = _wire->requestFrom((int)_addr, (int)chunk);
-        if (got != chunk) {
-            setError(MTS4X_ERR_WIRE);
+// One bus transaction (read if in is set), replayed after a bus clear
+// while the recovery deadline allows. The bus lock is taken per attempt
+// and released during the backoff, so other devices on the bus get their
+// turn (a caller holding it around a read-modify-write keeps it). Every
+// attempt counts as a transaction. Register writes are safe to replay,
+// E2PROM_Cmd is not: the chip may already have run the copy or reset.
+bool MTS4X::transfer(uint8_t reg, const uint8_t *out, uint8_t *in, size_t len) {
+#if MTS4X_BUS_RECOVERY
+    uint32_t start   = 0;
+    uint32_t backoff = 0;
+    bool     retry   = false;
+#endif
+    while (true) {
+        {
+            MTS4xBusGuard guard(_bus->lockKey());
+            ++_transactions;
+            bool ok;
+            if (in) {
+                MTS4X_STAT(++_stats.transactions; ++_stats.bytesWritten; _stats.bytesRead += len);
+                ok = _bus->readRegs(_addr, reg, in, len);
+            } else {
+                MTS4X_STAT(++_stats.transactions; _stats.bytesWritten += 1 + len);
+                ok = _bus->writeRegs(_addr, reg, out, len);
+            }
+            if (ok) {
+#if MTS4X_ENABLE_STATS && MTS4X_BUS_RECOVERY
+                if (retry) {
+                    uint32_t us = _bus->micros() - start;
+                    MTS4X_STAT(++_stats.recovered;
+                               if (us > _stats.recoveryMaxUs) _stats.recoveryMaxUs = us);
+                }
+#endif
+                return true;
+            }
+#if MTS4X_BUS_RECOVERY
+            if (!_recoveryUs) {
+                return false;
+            }
+            if (!retry) {
+                retry = true;
+                start = _bus->micros();
+            } else if (_bus->micros() - start >= _recoveryUs) {
+                return false;
+            }
+            MTS4X_STAT(++_stats.busRecoveries);
+            _bus->recover(_busClock);
+            if (!in && reg <= MTS4X_E2PROM_CMD && reg + len > MTS4X_E2PROM_CMD) {
+                return false;   // bus left clean, command not repeated
+            }
+#else
             return false;
+#endif
         }
-        for (uint8_t i = 0; i < chunk; ++i) {
-            data[offset + i] = (uint8_t)_wire->read();
+
+#if MTS4X_BUS_RECOVERY
+        // Still failing after a replay: back off, but not past the deadline
+        if (backoff) {
+            uint32_t left = _recoveryUs - (_bus->micros() - start);
+            uint32_t ms   = (left + 999) / 1000;
+            _bus->delay(ms < backoff ? ms : backoff);
+            if (backoff < MTS4X_RECOVERY_BACKOFF_MS) {
+                backoff *= 2;
+            }
+        } else {
+            backoff = 1;
         }
-        offset += chunk;
-        toRead -= chunk;
+#endif
+    }
+}
+
+// -----------------------------------------------------------------------------
+// Configuration register shadow
+//
+// Slots 0..17 mirror 0x04..0x15 (slot 7 = Crc_Scratch, never cached),
+// slot 18 mirrors PPM_Cfg. Register addresses are contiguous only inside
+// 0x04..0x0A and 0x0C..0x15, which bounds every burst write.
+// -----------------------------------------------------------------------------
+
+#define MTS4X_SHADOW_PPM_SLOT 18
+
+static int8_t mts4x_shadow_slot(uint8_t reg) {
+    if (reg >= MTS4X_TEMP_CMD && reg <= MTS4X_USER_DEFINE_9 &&
+        reg != MTS4X_CRC_SCRATCH) {
+        return (int8_t)(reg - MTS4X_TEMP_CMD);
+    }
+    if (reg == MTS4X_PPM_CFG) {
+        return MTS4X_SHADOW_PPM_SLOT;
+    }
+    return -1;
+}
+
+static uint8_t mts4x_shadow_reg(uint8_t slot) {
+    return (slot == MTS4X_SHADOW_PPM_SLOT) ? (uint8_t)MTS4X_PPM_CFG
+                                           : (uint8_t)(MTS4X_TEMP_CMD + slot);
+}
+
+bool MTS4X::setShadowCache(bool enable, bool deferWrites) {
+    MTS4xBusGuard guard(_bus->lockKey());
+    bool ok = true;
+    if (!enable || !deferWrites) {
+        ok = flushShadow();
+    }
+    _shadowEnabled  = enable;
+    _shadowDeferred = enable && deferWrites;
+    if (!enable) {
+        invalidateShadow();
+    }
+    return ok;
+}
+
+void MTS4X::invalidateShadow() {
+    MTS4xBusGuard guard(_bus->lockKey());
+    _shadowValid = 0;
+    _shadowDirty = 0;
+}
+
+bool MTS4X::flushShadow() {
+    MTS4xBusGuard guard(_bus->lockKey());
+    uint8_t slot = 0;
+    while (_shadowDirty && slot <= MTS4X_SHADOW_PPM_SLOT) {
+        if (!(_shadowDirty & (1UL << slot))) {
+            ++slot;
+            continue;
+        }
+        // Extend the run over adjacent dirty registers
+        uint8_t end = slot + 1;
+        while (end <= MTS4X_SHADOW_PPM_SLOT && (_shadowDirty & (1UL << end)) &&
+               mts4x_shadow_reg(end) == mts4x_shadow_reg(end - 1) + 1) {
+            ++end;
+        }
+        if (!writeRegisterRaw(mts4x_shadow_reg(slot), &_shadow[slot], end - slot)) {
+            return false;
+        }
+        for (uint8_t i = slot; i < end; ++i) {
+            _shadowDirty &= ~(1UL << i);
+        }
+        slot = end;
     }
-    setError(MTS4X_ERR_OK);
     return true;
 }
 
+void MTS4X::shadowFill(uint8_t startReg, const uint8_t *data, size_t len) {
+    MTS4xBusGuard guard(_bus->lockKey());
+    if (!_shadowEnabled) {
+        return;
+    }
+    for (size_t i = 0; i < len; ++i) {
+        int8_t slot = mts4x_shadow_slot((uint8_t)(startReg + i));
+        if (slot < 0 || (_shadowDirty & (1UL << slot))) {
+            continue;
+        }
+        _shadow[slot]  = data[i];
+        _shadowValid  |= (1UL << slot);
+    }
+}
+
+bool MTS4X::readConfig(uint8_t reg, uint8_t &value) {
+    return readConfigRaw(reg, &value, 1);
+}
+
+bool MTS4X::readConfigRaw(uint8_t startReg, uint8_t *data, size_t len) {
+    MTS4xBusGuard guard(_bus->lockKey());
+    if (_shadowEnabled) {
+        bool hit = true;
+        for (size_t i = 0; i < len && hit; ++i) {
+            int8_t slot = mts4x_shadow_slot((uint8_t)(startReg + i));
+            hit = (slot >= 0) && (_shadowValid & (1UL << slot));
+        }
+        if (hit) {
+            for (size_t i = 0; i < len; ++i) {
+                data[i] = _shadow[mts4x_shadow_slot((uint8_t)(startReg + i))];
+            }
+            setError(MTS4X_ERR_OK);
+            return true;
+        }
+    }
+
+    bool ok = (len == 1) ? readRegister(startReg, data[0])
+                         : readRegisterRaw(startReg, data, len);
+    if (!ok) {
+        return false;
+    }
+    shadowFill(startReg, data, len);
+    if (_shadowDirty) {
+        // Deferred writes not flushed yet are newer than the chip contents
+        for (size_t i = 0; i < len; ++i) {
+            int8_t slot = mts4x_shadow_slot((uint8_t)(startReg + i));
+            if (slot >= 0 && (_shadowDirty & (1UL << slot))) {
+                data[i] = _shadow[slot];
+            }
+        }
+    }
+    return true;
+}
+
+bool MTS4X::writeConfig(uint8_t reg, uint8_t value) {
+    return writeConfigRaw(reg, &value, 1);
+}
+
+bool MTS4X::writeConfigRaw(uint8_t startReg, const uint8_t *data, size_t len) {
+    MTS4xBusGuard guard(_bus->lockKey());
+    if (!_shadowEnabled) {
+        return (len == 1) ? writeRegister(startReg, data[0])
+                          : writeRegisterRaw(startReg, data, len);
+    }
+
+    // Temp_Cmd is a command register: never deferred, and a single-shot
+    // command reads back differently once the conversion is done
+    bool command = (startReg == MTS4X_TEMP_CMD);
+
+    if (_shadowDeferred && !command) {
+        // The whole burst must be cacheable before any slot turns dirty
+        for (size_t i = 0; i < len; ++i) {
+            if (mts4x_shadow_slot((uint8_t)(startReg + i)) < 0) {
+                setError(MTS4X_ERR_PARAM);
+                return false;
+            }
+        }
+        for (size_t i = 0; i < len; ++i) {
+            int8_t slot = mts4x_shadow_slot((uint8_t)(startReg + i));
+            _shadow[slot]  = data[i];
+            _shadowValid  |= (1UL << slot);
+            _shadowDirty  |= (1UL << slot);
+        }
+        setError(MTS4X_ERR_OK);
+        return true;
+    }
+
+    // A command acts on the config the driver already reports (_tempCfg,
+    // limits, alert mode): deferred writes reach the chip before it
+    if (command && _shadowDirty && !flushShadow()) {
+        return false;
+    }
+
+    bool ok = (len == 1) ? writeRegister(startReg, data[0])
+                         : writeRegisterRaw(startReg, data, len);
+    for (size_t i = 0; i < len; ++i) {
+        int8_t slot = mts4x_shadow_slot((uint8_t)(startReg + i));
+        if (slot < 0) {
+            continue;
+        }
+        _shadow[slot]  = data[i];
+        _shadowDirty  &= ~(1UL << slot);
+        if (ok && !(command && (data[i] & 0xC0) == 0xC0)) {
+            _shadowValid |= (1UL << slot);
+        } else {
+            _shadowValid &= ~(1UL << slot);
+        }
+    }
+    return ok;
+}
+
 // -----------------------------------------------------------------------------
 // Status / busy helpers
 // -----------------------------------------------------------------------------
@@ -211,7 +1151,7 @@ bool MTS4X::inProgress() {
 // Measurement mode / configuration
 // -----------------------------------------------------------------------------
 
-bool MTS4X::setMode(MeasurementMode mode, bool heater) {
+static uint8_t mts4x_mode_cmd(MeasurementMode mode, bool heater) {
     uint8_t cmd = 0;
 
     switch (mode) {
@@ -235,7 +1175,11 @@ bool MTS4X::setMode(MeasurementMode mode, bool heater) {
         cmd |= 0x0A;
     }
 
-    return writeRegister(MTS4X_TEMP_CMD, cmd);
+    return cmd;
+}
+
+bool MTS4X::setMode(MeasurementMode mode, bool heater) {
+    return writeConfig(MTS4X_TEMP_CMD, mts4x_mode_cmd(mode, heater));
 }
 
 bool MTS4X::startSingleMessurement() {
@@ -243,65 +1187,80 @@ bool MTS4X::startSingleMessurement() {
     return setMode(MEASURE_SINGLE, false);
 }
 
-bool MTS4X::setConfig(TempCfgMPS mps, TempCfgAVG avg, bool sleep) {
+static uint8_t mts4x_cfg_byte(TempCfgMPS mps, TempCfgAVG avg, bool sleep) {
     // Temp_Cfg[7:5] = MPS, [4:3] = AVG, [0] = Sleep_en
     uint8_t cfg = 0;
     cfg |= ((uint8_t)mps & 0xE0);
     cfg |= ((uint8_t)avg & 0x18);
     if (sleep) cfg |= 0x01;
-    return writeRegister(MTS4X_TEMP_CFG, cfg);
+    return cfg;
+}
+
+bool MTS4X::setConfig(TempCfgMPS mps, TempCfgAVG avg, bool sleep) {
+    uint8_t cfg = mts4x_cfg_byte(mps, avg, sleep);
+    if (!writeConfig(MTS4X_TEMP_CFG, cfg)) {
+        return false;
+    }
+    _tempCfg = cfg;
+    return true;
 }
 
 // -----------------------------------------------------------------------------
 // Temperature reading helpers
 // -----------------------------------------------------------------------------
 
+bool MTS4X::readTemperatureFrame(int16_t &raw, bool &crcOk, uint8_t &status) {
+    // Temp_Lsb, Temp_Msb, Crc_temp and Status are contiguous (0x00..0x03):
+    // one repeated-start read yields the sample, its CRC and the BUSY flag
+    uint8_t buf[4];
+    if (!readRegisterRaw(MTS4X_TEMP_LSB, buf, 4)) {
+        return false;
+    }
+    raw    = (int16_t)(((uint16_t)buf[1] << 8) | (uint16_t)buf[0]);
+    crcOk  = !_useCrc || (mts4x_crc8(buf, 2) == buf[2]);   // CRC по Temp_lsb, Temp_msb
+    status = buf[3];
+    return true;
+}
+
 bool MTS4X::readTemperatureRawWithCrc(int16_t &raw, bool &crcOk,
                                       bool waitOnNewVal) {
     raw   = 0;
     crcOk = false;
 
-    if (waitOnNewVal) {
-        // Wait until conversion is complete (Status bit5 == 0)
-        unsigned long start = millis();
-        while (true) {
-            uint8_t st = 0;
-            if (!readStatus(st)) {
-                return false;
-            }
-            if ((st & MTS4X_STATUS_BUSY) == 0) {
-                break;
-            }
-            if (millis() - start > 200UL) {
-                setError(MTS4X_ERR_TIMEOUT);
-                return false;
-            }
-            delay(1);
-        }
-    }
-
-    uint8_t buf[3];
-    for (uint8_t attempt = 0; attempt < 3; ++attempt) {
-        if (!readRegisterRaw(MTS4X_TEMP_LSB, buf, 3)) {
+#if MTS4X_ENABLE_STATS
+    uint32_t startUs = _bus->micros();
+#endif
+    unsigned long start   = _bus->millis();
+    uint8_t       attempt = 0;
+    while (true) {
+        uint8_t st = 0;
+        if (!readTemperatureFrame(raw, crcOk, st)) {
             return false;
         }
 
-        raw = (int16_t)(((uint16_t)buf[1] << 8) | (uint16_t)buf[0]);
-
-        if (!_useCrc) {
-            crcOk = true;
-            setError(MTS4X_ERR_OK);
-            return true;
+        if (waitOnNewVal && (st & MTS4X_STATUS_BUSY)) {
+            // Conversion still running (Status bit5 == 1)
+            MTS4X_STAT(++_stats.busyPolls);
+            if (_bus->millis() - start > 200UL) {
+                setError(MTS4X_ERR_TIMEOUT);
+                return false;
+            }
+            _bus->delay(1);
+            continue;
         }
 
-        uint8_t calc = mts4x_crc8(buf, 2);   // CRC по Temp_lsb, Temp_msb
-        crcOk = (calc == buf[2]);
-
         if (crcOk) {
+#if MTS4X_ENABLE_STATS
+            statsLatency(_bus->micros() - startUs);
+#endif
             setError(MTS4X_ERR_OK);
             return true;
         }
-        delay(2);
+        if (++attempt >= 3) {
+            break;
+        }
+        MTS4X_STAT(++_stats.crcRetries);
+        _bus->delay(2);
     }
 
     setError(MTS4X_ERR_CRC);
@@ -313,6 +1272,55 @@ bool MTS4X::readTemperatureRaw(int16_t &raw, bool waitOnNewVal) {
     return readTemperatureRawWithCrc(raw, dummyCrc, waitOnNewVal);
 }
 
+bool MTS4X::readTemperatureMilli(int32_t &mC, bool &crcOk,
+                                 bool waitOnNewVal) {
+    int16_t raw = 0;
+    if (!readTemperatureRawWithCrc(raw, crcOk, waitOnNewVal)) {
+        return false;
+    }
+    mC = mts4x_raw_to_milli(raw);
+    return true;
+}
+
+bool MTS4X::readTemperatureMilli(int32_t &mC, bool waitOnNewVal) {
+    bool crcOk = false;
+    return readTemperatureMilli(mC, crcOk, waitOnNewVal);
+}
+
+// Blocking single shots sit out the expected conversion time without
+// touching the bus: whole milliseconds in delay(), the rest on micros().
+// The first fused read then normally finds the sample ready instead of
+// paying a 4-byte frame per BUSY poll.
+void MTS4X::waitConversion(uint32_t startUs) {
+    uint32_t wait    = mts4x_conv_time_us(_tempCfg);
+    uint32_t elapsed = _bus->micros() - startUs;
+    if (elapsed < wait) {
+        _bus->delay((wait - elapsed) / 1000UL);
+    }
+    // The sub-ms rest on micros(), bounded for a time base that does not
+    // move between calls: the read after it still polls BUSY
+    for (uint16_t spin = 0; spin < MTS4X_WAIT_SPIN_MAX && _bus->micros() - startUs < wait; ++spin) {
+    }
+}
+
+bool MTS4X::singleShotMilli(int32_t &mC) {
+    if (!startSingleMessurement()) {
+        return false;
+    }
+    waitConversion(_bus->micros());
+    bool crcOk = false;
+    if (!readTemperatureMilli(mC, crcOk, true)) {
+        return false;
+    }
+    if (!crcOk) {
+        setError(MTS4X_ERR_CRC);
+        return false;
+    }
+    return true;
+}
+
+#ifndef MTS4X_NO_FLOAT
+
 bool MTS4X::readTemperatureCrc(float &tC, bool &crcOk,
                                bool waitOnNewVal) {
     int16_t raw = 0;
@@ -344,6 +1352,7 @@ bool MTS4X::singleShot(float &tC) {
         tC = NAN;
         return false;
     }
+    waitConversion(_bus->micros());
     bool crcOk = false;
     if (!readTemperatureCrc(tC, crcOk, true)) {
         return false;
@@ -355,27 +1364,124 @@ bool MTS4X::singleShot(float &tC) {
     return true;
 }
 
+#endif // MTS4X_NO_FLOAT
+
+// -----------------------------------------------------------------------------
+// Non-blocking measurement
+// -----------------------------------------------------------------------------
+
+uint32_t MTS4X::conversionTimeUs() const {
+    return mts4x_conv_time_us(_tempCfg);
+}
+
+bool MTS4X::startConversion() {
+    _convAttempts = 0;
+    _convCrcOk    = false;
+    _convRaw      = 0;
+    if (!startSingleMessurement()) {
+        _convState = MTS4X_CONV_ERROR;
+        return false;
+    }
+    _convStartUs = _bus->micros();
+    _convState   = MTS4X_CONV_WAIT;
+    return true;
+}
+
+MTS4xPollResult MTS4X::poll() {
+    switch (_convState) {
+        case MTS4X_CONV_IDLE:
+            return MTS4X_POLL_IDLE;
+        case MTS4X_CONV_READY:
+            return MTS4X_POLL_READY;
+        case MTS4X_CONV_ERROR:
+            return MTS4X_POLL_ERROR;
+        default:
+            break;
+    }
+
+    // Do not touch the bus before the chip can possibly be done
+    uint32_t elapsed = _bus->micros() - _convStartUs;
+    if (elapsed < mts4x_conv_time_us(_tempCfg)) {
+        return MTS4X_POLL_PENDING;
+    }
+
+    // One fused read per poll: BUSY and the sample come in the same frame,
+    // CRC retries are spread over subsequent calls instead of delay()
+    uint8_t st = 0;
+    if (!readTemperatureFrame(_convRaw, _convCrcOk, st)) {
+        _convState = MTS4X_CONV_ERROR;
+        return MTS4X_POLL_ERROR;
+    }
+    if (st & MTS4X_STATUS_BUSY) {
+        MTS4X_STAT(++_stats.busyPolls);
+        if (elapsed > MTS4X_CONV_TIMEOUT_US) {
+            setError(MTS4X_ERR_TIMEOUT);
+            _convState = MTS4X_CONV_ERROR;
+            return MTS4X_POLL_ERROR;
+        }
+        return MTS4X_POLL_PENDING;
+    }
+    if (_convCrcOk) {
+#if MTS4X_ENABLE_STATS
+        statsLatency(elapsed);
+#endif
+        setError(MTS4X_ERR_OK);
+        _convState = MTS4X_CONV_READY;
+        return MTS4X_POLL_READY;
+    }
+    if (++_convAttempts >= 3) {
+        setError(MTS4X_ERR_CRC);
+        _convState = MTS4X_CONV_ERROR;
+        return MTS4X_POLL_ERROR;
+    }
+    MTS4X_STAT(++_stats.crcRetries);
+    return MTS4X_POLL_PENDING;
+}
+
+bool MTS4X::result(int16_t &raw, bool &crcOk) const {
+    if (_convState != MTS4X_CONV_READY) {
+        return false;
+    }
+    raw   = _convRaw;
+    crcOk = _convCrcOk;
+    return true;
+}
+
+#ifndef MTS4X_NO_FLOAT
+bool MTS4X::result(float &tC) const {
+    if (_convState != MTS4X_CONV_READY) {
+        tC = NAN;
+        return false;
+    }
+    tC = MTS4X_RAW_TO_CELSIUS(_convRaw);
+    return true;
+}
+#endif
+
 // -----------------------------------------------------------------------------
 // Heater control
 // -----------------------------------------------------------------------------
 
 bool MTS4X::heaterOn() {
+    // Read-modify-write of Temp_Cmd must not interleave with other tasks
+    MTS4xBusGuard guard(_bus->lockKey());
     uint8_t cmd = 0;
-    if (!readRegister(MTS4X_TEMP_CMD, cmd)) {
+    if (!readConfig(MTS4X_TEMP_CMD, cmd)) {
         return false;
     }
     cmd &= 0xF0;
     cmd |= 0x0A;
-    return writeRegister(MTS4X_TEMP_CMD, cmd);
+    return writeConfig(MTS4X_TEMP_CMD, cmd);
 }
 
 bool MTS4X::heaterOff() {
+    MTS4xBusGuard guard(_bus->lockKey());
     uint8_t cmd = 0;
-    if (!readRegister(MTS4X_TEMP_CMD, cmd)) {
+    if (!readConfig(MTS4X_TEMP_CMD, cmd)) {
         return false;
     }
     cmd &= 0xF0;
-    return writeRegister(MTS4X_TEMP_CMD, cmd);
+    return writeConfig(MTS4X_TEMP_CMD, cmd);
 }
 
 bool MTS4X::isHeaterOn(bool &on) {
@@ -391,7 +1497,7 @@ bool MTS4X::isHeaterOn(bool &on) {
 // Alert configuration and limits
 // -----------------------------------------------------------------------------
 
-bool MTS4X::setAlertMode(bool enable, MTS4xAlertMode mode) {
+static uint8_t mts4x_alert_byte(bool enable, MTS4xAlertMode mode) {
     uint8_t reg = 0;
     if (enable) {
         reg |= 0x80;
@@ -399,12 +1505,16 @@ bool MTS4X::setAlertMode(bool enable, MTS4xAlertMode mode) {
     if (mode == ALERT_MODE_HIGH_TH_LOW_ALARM) {
         reg |= 0x40;
     }
-    return writeRegister(MTS4X_ALERT_MODE, reg);
+    return reg;
+}
+
+bool MTS4X::setAlertMode(bool enable, MTS4xAlertMode mode) {
+    return writeConfig(MTS4X_ALERT_MODE, mts4x_alert_byte(enable, mode));
 }
 
 bool MTS4X::getAlertMode(bool &enable, MTS4xAlertMode &mode) {
     uint8_t reg = 0;
-    if (!readRegister(MTS4X_ALERT_MODE, reg)) {
+    if (!readConfig(MTS4X_ALERT_MODE, reg)) {
         return false;
     }
     enable = (reg & 0x80);
@@ -414,9 +1524,78 @@ bool MTS4X::getAlertMode(bool &enable, MTS4xAlertMode &mode) {
 }
 
 bool MTS4X::readAlertRegister(uint8_t &regValue) {
-    return readRegister(MTS4X_ALERT_MODE, regValue);
+    return readConfig(MTS4X_ALERT_MODE, regValue);
+}
+
+bool MTS4X::setHighLimitRaw(int16_t raw) {
+    uint8_t buf[2];
+    buf[0] = (uint8_t)(raw & 0xFF);
+    buf[1] = (uint8_t)((raw >> 8) & 0xFF);
+    return writeConfigRaw(MTS4X_TH_LSB, buf, 2);
+}
+
+bool MTS4X::setLowLimitRaw(int16_t raw) {
+    uint8_t buf[2];
+    buf[0] = (uint8_t)(raw & 0xFF);
+    buf[1] = (uint8_t)((raw >> 8) & 0xFF);
+    return writeConfigRaw(MTS4X_TL_LSB, buf, 2);
+}
+
+bool MTS4X::setLimitsRaw(int16_t thRaw, int16_t tlRaw) {
+    uint8_t buf[4];
+    buf[0] = (uint8_t)(thRaw & 0xFF);
+    buf[1] = (uint8_t)((thRaw >> 8) & 0xFF);
+    buf[2] = (uint8_t)(tlRaw & 0xFF);
+    buf[3] = (uint8_t)((tlRaw >> 8) & 0xFF);
+    return writeConfigRaw(MTS4X_TH_LSB, buf, 4);
+}
+
+bool MTS4X::getHighLimitRaw(int16_t &raw) {
+    uint8_t buf[2];
+    if (!readConfigRaw(MTS4X_TH_LSB, buf, 2)) {
+        return false;
+    }
+    raw = (int16_t)(((uint16_t)buf[1] << 8) | (uint16_t)buf[0]);
+    return true;
+}
+
+bool MTS4X::getLowLimitRaw(int16_t &raw) {
+    uint8_t buf[2];
+    if (!readConfigRaw(MTS4X_TL_LSB, buf, 2)) {
+        return false;
+    }
+    raw = (int16_t)(((uint16_t)buf[1] << 8) | (uint16_t)buf[0]);
+    return true;
+}
+
+bool MTS4X::setHighLimitMilli(int32_t mC) {
+    return setHighLimitRaw(mts4x_milli_to_raw(mC));
+}
+
+bool MTS4X::setLowLimitMilli(int32_t mC) {
+    return setLowLimitRaw(mts4x_milli_to_raw(mC));
+}
+
+bool MTS4X::getHighLimitMilli(int32_t &mC) {
+    int16_t raw = 0;
+    if (!getHighLimitRaw(raw)) {
+        return false;
+    }
+    mC = mts4x_raw_to_milli(raw);
+    return true;
+}
+
+bool MTS4X::getLowLimitMilli(int32_t &mC) {
+    int16_t raw = 0;
+    if (!getLowLimitRaw(raw)) {
+        return false;
+    }
+    mC = mts4x_raw_to_milli(raw);
+    return true;
 }
 
+#ifndef MTS4X_NO_FLOAT
+
 // Helpers for limit conversion
 static int16_t mts4x_c_to_raw(float tC) {
     float rawF = (tC - 25.0f) * 256.0f;
@@ -430,41 +1609,33 @@ static float mts4x_raw_to_c(int16_t raw) {
 }
 
 bool MTS4X::setHighLimit(float tHighC) {
-    int16_t raw = mts4x_c_to_raw(tHighC);
-    uint8_t buf[2];
-    buf[0] = (uint8_t)(raw & 0xFF);
-    buf[1] = (uint8_t)((raw >> 8) & 0xFF);
-    return writeRegisterRaw(MTS4X_TH_LSB, buf, 2);
+    return setHighLimitRaw(mts4x_c_to_raw(tHighC));
 }
 
 bool MTS4X::setLowLimit(float tLowC) {
-    int16_t raw = mts4x_c_to_raw(tLowC);
-    uint8_t buf[2];
-    buf[0] = (uint8_t)(raw & 0xFF);
-    buf[1] = (uint8_t)((raw >> 8) & 0xFF);
-    return writeRegisterRaw(MTS4X_TL_LSB, buf, 2);
+    return setLowLimitRaw(mts4x_c_to_raw(tLowC));
 }
 
 bool MTS4X::getHighLimit(float &tHighC) {
-    uint8_t buf[2];
-    if (!readRegisterRaw(MTS4X_TH_LSB, buf, 2)) {
+    int16_t raw = 0;
+    if (!getHighLimitRaw(raw)) {
         return false;
     }
-    int16_t raw = (int16_t)(((uint16_t)buf[1] << 8) | (uint16_t)buf[0]);
     tHighC = mts4x_raw_to_c(raw);
     return true;
 }
 
 bool MTS4X::getLowLimit(float &tLowC) {
-    uint8_t buf[2];
-    if (!readRegisterRaw(MTS4X_TL_LSB, buf, 2)) {
+    int16_t raw = 0;
+    if (!getLowLimitRaw(raw)) {
         return false;
     }
-    int16_t raw = (int16_t)(((uint16_t)buf[1] << 8) | (uint16_t)buf[0]);
     tLowC = mts4x_raw_to_c(raw);
     return true;
 }
 
+#endif // MTS4X_NO_FLOAT
+
 // -----------------------------------------------------------------------------
 // ID and ROM code
 // -----------------------------------------------------------------------------
@@ -496,7 +1667,7 @@ bool MTS4X::readUserRegister(uint8_t index, uint8_t &value) {
         return false;
     }
     uint8_t reg = (uint8_t)(MTS4X_USER_DEFINE_0 + index);
-    return readRegister(reg, value);
+    return readConfig(reg, value);
 }
 
 bool MTS4X::writeUserRegister(uint8_t index, uint8_t value) {
@@ -505,7 +1676,7 @@ bool MTS4X::writeUserRegister(uint8_t index, uint8_t value) {
         return false;
     }
     uint8_t reg = (uint8_t)(MTS4X_USER_DEFINE_0 + index);
-    return writeRegister(reg, value);
+    return writeConfig(reg, value);
 }
 
 // -----------------------------------------------------------------------------
@@ -524,6 +1695,9 @@ bool MTS4X::readScratch(uint8_t scratch[8], bool &crcOk) {
     memcpy(scratch, buf, 8);
     uint8_t calc = mts4x_crc8(buf, 8);
     crcOk = (calc == buf[8]);
+    if (crcOk) {
+        shadowFill(MTS4X_TEMP_CMD, buf + 1, 7);
+    }
     setError(crcOk ? MTS4X_ERR_OK : MTS4X_ERR_CRC);
     return true;
 }
@@ -540,16 +1714,217 @@ bool MTS4X::readScratchExt(uint8_t scratchExt[10], bool &crcOk) {
     memcpy(scratchExt, buf, 10);
     uint8_t calc = mts4x_crc8(buf, 10);
     crcOk = (calc == buf[10]);
+    if (crcOk) {
+        shadowFill(MTS4X_USER_DEFINE_0, buf, 10);
+    }
     setError(crcOk ? MTS4X_ERR_OK : MTS4X_ERR_CRC);
     return true;
 }
 
+// -----------------------------------------------------------------------------
+// Configuration profiles
+// -----------------------------------------------------------------------------
+
+MTS4xProfile::MTS4xProfile() {
+    memset(scratch, 0, sizeof(scratch));
+    memset(user, 0, sizeof(user));
+    // Same defaults as begin(): stopped, 1 Hz, AVG_8, sleep after commands
+    scratch[0] = mts4x_mode_cmd(MEASURE_STOP, false);
+    scratch[1] = mts4x_cfg_byte(MPS_1Hz, AVG_8, true);
+}
+
+void MTS4xProfile::setMode(MeasurementMode mode, bool heater) {
+    scratch[0] = mts4x_mode_cmd(mode, heater);
+}
+
+void MTS4xProfile::setConfig(TempCfgMPS mps, TempCfgAVG avg, bool sleep) {
+    scratch[1] = mts4x_cfg_byte(mps, avg, sleep);
+}
+
+void MTS4xProfile::setAlertMode(bool enable, MTS4xAlertMode mode) {
+    scratch[2] = mts4x_alert_byte(enable, mode);
+}
+
+void MTS4xProfile::setLimitsRaw(int16_t thRaw, int16_t tlRaw) {
+    scratch[3] = (uint8_t)(thRaw & 0xFF);
+    scratch[4] = (uint8_t)((thRaw >> 8) & 0xFF);
+    scratch[5] = (uint8_t)(tlRaw & 0xFF);
+    scratch[6] = (uint8_t)((tlRaw >> 8) & 0xFF);
+}
+
+void MTS4xProfile::setLimitsMilli(int32_t thMilli, int32_t tlMilli) {
+    setLimitsRaw(mts4x_milli_to_raw(thMilli), mts4x_milli_to_raw(tlMilli));
+}
+
+bool MTS4xProfile::setUser(uint8_t index, uint8_t value) {
+    if (index > 9) {
+        return false;
+    }
+    user[index] = value;
+    return true;
+}
+
+void MTS4xProfile::setUser(const uint8_t data[10]) {
+    memcpy(user, data, sizeof(user));
+}
+
+bool MTS4xProfile::matches(const MTS4xProfile &other) const {
+    return mts4x_cmd_matches(scratch[0], other.scratch[0]) &&
+           memcmp(scratch + 1, other.scratch + 1, sizeof(scratch) - 1) == 0 &&
+           memcmp(user, other.user, sizeof(user)) == 0;
+}
+
+// Smallest [first, first + len) covering every difference, len 0 if none
+static void mts4x_diff_span(const uint8_t *have, const uint8_t *want, uint8_t n,
+                            bool skipFirst, uint8_t &first, uint8_t &len) {
+    int8_t lo = -1;
+    int8_t hi = -1;
+    for (uint8_t i = skipFirst ? 1 : 0; i < n; ++i) {
+        if (have[i] != want[i]) {
+            if (lo < 0) {
+                lo = (int8_t)i;
+            }
+            hi = (int8_t)i;
+        }
+    }
+    first = (lo < 0) ? 0 : (uint8_t)lo;
+    len   = (lo < 0) ? 0 : (uint8_t)(hi - lo + 1);
+}
+
+bool MTS4X::readImage(MTS4xProfile &out, uint8_t &status) {
+    // Status..TL_Msb, Crc_Scratch, user registers, Crc_Scratch_Ext
+    uint8_t buf[20];
+    if (!readRegisterRaw(MTS4X_STATUS, buf, sizeof(buf))) {
+        return false;
+    }
+    if (mts4x_crc8(buf, 8) != buf[8] || mts4x_crc8(buf + 9, 10) != buf[19]) {
+        setError(MTS4X_ERR_CRC);
+        return false;
+    }
+    status = buf[0];
+    memcpy(out.scratch, buf + 1, sizeof(out.scratch));
+    memcpy(out.user, buf + 9, sizeof(out.user));
+    shadowFill(MTS4X_TEMP_CMD, out.scratch, sizeof(out.scratch));
+    shadowFill(MTS4X_USER_DEFINE_0, out.user, sizeof(out.user));
+    return true;
+}
+
+// readImage() until EE_BUSY is clear and both CRCs match
+bool MTS4X::readImageReady(MTS4xProfile &out, uint32_t timeoutMs) {
+    unsigned long start = _bus->millis();
+    while (true) {
+        uint8_t st = 0;
+        if (readImage(out, st)) {
+            if (!(st & MTS4X_STATUS_EE_BUSY)) {
+                return true;
+            }
+        } else if (lastError() != MTS4X_ERR_CRC) {
+            return false;
+        }
+        if (_bus->millis() - start > timeoutMs) {
+            setError(MTS4X_ERR_TIMEOUT);
+            return false;
+        }
+        _bus->delay(1);
+    }
+}
+
+bool MTS4X::readProfile(MTS4xProfile &out) {
+    MTS4xBusGuard guard(_bus->lockKey());
+    uint8_t st = 0;
+    if (!readImage(out, st)) {
+        return false;
+    }
+    if (_shadowDirty) {
+        // Deferred writes not flushed yet are newer than the chip contents
+        readConfigRaw(MTS4X_TEMP_CFG, out.scratch + 1, sizeof(out.scratch) - 1);
+        readConfigRaw(MTS4X_USER_DEFINE_0, out.user, sizeof(out.user));
+    }
+    return true;
+}
+
+bool MTS4X::applyProfile(const MTS4xProfile &profile, bool commit) {
+    bool written;
+    return applyProfile(profile, commit, written);
+}
+
+bool MTS4X::applyProfile(const MTS4xProfile &profile, bool commit,
+                         bool &eepromWritten) {
+    eepromWritten = false;
+    MTS4xBusGuard guard(_bus->lockKey());
+    if (!flushShadow()) {
+        return false;
+    }
+    // With commit the base is the EEPROM image, so an unchanged profile
+    // leaves the EEPROM alone
+    if (commit && !eepromRecallPage(true, 50)) {
+        return false;
+    }
+    MTS4xProfile have;
+    if (!readImageReady(have, 50)) {
+        return false;
+    }
+    if (have.matches(profile)) {
+        _tempCfg = profile.scratch[1];
+        setError(MTS4X_ERR_OK);
+        return true;
+    }
+
+    // One burst per contiguous block. Temp_Cmd is written only when its
+    // mode differs: in the same burst when it stops the chip or nothing
+    // else changes, else last, so a conversion never starts on the old
+    // Temp_Cfg
+    uint8_t first, len;
+    bool    cmd  = !mts4x_cmd_matches(have.scratch[0], profile.scratch[0]);
+    mts4x_diff_span(have.scratch, profile.scratch, sizeof(profile.scratch), true,
+                    first, len);
+    bool    join = cmd && (len == 0 || (profile.scratch[0] & 0xC0) == 0x40);
+    if (join) {
+        len   = len ? (uint8_t)(len + first) : 1;
+        first = 0;
+    }
+    if (len && !writeRegisterRaw((uint8_t)(MTS4X_TEMP_CMD + first),
+                                 profile.scratch + first, len)) {
+        invalidateShadow();
+        return false;
+    }
+    _tempCfg = profile.scratch[1];
+    mts4x_diff_span(have.user, profile.user, sizeof(profile.user), false, first, len);
+    if (len && !writeRegisterRaw((uint8_t)(MTS4X_USER_DEFINE_0 + first),
+                                 profile.user + first, len)) {
+        invalidateShadow();
+        return false;
+    }
+    if (cmd && !join && !writeRegister(MTS4X_TEMP_CMD, profile.scratch[0])) {
+        invalidateShadow();
+        return false;
+    }
+
+    // Verify both blocks (and their CRCs) in one read
+    invalidateShadow();
+    if (!readImageReady(have, 50)) {
+        return false;
+    }
+    if (!have.matches(profile)) {
+        setError(MTS4X_ERR_VERIFY);
+        return false;
+    }
+    if (commit) {
+        if (!eepromCopyPage(true, 50)) {
+            return false;
+        }
+        eepromWritten = true;
+    }
+    setError(MTS4X_ERR_OK);
+    return true;
+}
+
 // -----------------------------------------------------------------------------
 // EEPROM operations and reset
 // -----------------------------------------------------------------------------
 
 bool MTS4X::waitEepromReady(uint32_t timeoutMs) {
-    unsigned long start = millis();
+    unsigned long start = _bus->millis();
     while (true) {
         uint8_t st = 0;
         if (!readStatus(st)) {
@@ -558,15 +1933,19 @@ bool MTS4X::waitEepromReady(uint32_t timeoutMs) {
         if ((st & MTS4X_STATUS_EE_BUSY) == 0) {
             return true;
         }
-        if (millis() - start > timeoutMs) {
+        if (_bus->millis() - start > timeoutMs) {
             setError(MTS4X_ERR_TIMEOUT);
             return false;
         }
-        delay(1);
+        _bus->delay(1);
     }
 }
 
 bool MTS4X::eepromCopyPage(bool waitReady, uint32_t timeoutMs) {
+    // Deferred shadow writes must reach the scratch before it is copied
+    if (!flushShadow()) {
+        return false;
+    }
     // 0x08: copy scratch -> EEPROM
     if (!writeRegister(MTS4X_E2PROM_CMD, 0x08)) {
         return false;
@@ -578,6 +1957,13 @@ bool MTS4X::eepromCopyPage(bool waitReady, uint32_t timeoutMs) {
 }
 
 bool MTS4X::eepromRecallPage(bool waitReady, uint32_t timeoutMs) {
+    // Deferred writes go out first, then the scratch comes from EEPROM and
+    // Temp_Cfg is unknown until read again
+    if (!flushShadow()) {
+        return false;
+    }
+    invalidateShadow();
+    _tempCfg = 0xFF;
     // 0xB6: recall EEPROM -> scratch
     if (!writeRegister(MTS4X_E2PROM_CMD, 0xB6)) {
         return false;
@@ -599,6 +1985,13 @@ bool MTS4X::eepromWritePageRaw(bool waitReady, uint32_t timeoutMs) {
 }
 
 bool MTS4X::softReset(bool waitReady, uint32_t timeoutMs) {
+    // Deferred writes go out first, then the scratch comes from EEPROM and
+    // Temp_Cfg is unknown until read again
+    if (!flushShadow()) {
+        return false;
+    }
+    invalidateShadow();
+    _tempCfg = 0xFF;
     // 0x6A: soft reset + recall EEPROM to scratch
     if (!writeRegister(MTS4X_E2PROM_CMD, 0x6A)) {
         return false;
@@ -615,5 +2008,5 @@ bool MTS4X::softReset(bool waitReady, uint32_t timeoutMs) {
 
 bool MTS4X::setParasiticPower(bool enable) {
     uint8_t val = enable ? 0x0A : 0x00;
-    return writeRegister(MTS4X_PPM_CFG, val);
+    return writeConfig(MTS4X_PPM_CFG, val);
 }
@@ -1,6 +1,6 @@
 // MTS4x Arduino driver
 // Author: Denis (FedunovDenis)
-// Version: 2.0.1
+// Version: 2.1.0
 
 #ifndef __MTS4X_H__
 #define __MTS4X_H__
@@ -17,6 +17,18 @@
 // raw (signed 16-bit) -> °C
 #define MTS4X_RAW_TO_CELSIUS(S_T) (((S_T) / 256.0f) + 25.0f)
 
+// Integer-only conversion helpers (usable with MTS4X_NO_FLOAT).
+// raw -> m°C and back, rounded half away from zero; the m°C -> raw
+// direction saturates to the int16 raw range.
+int32_t mts4x_raw_to_milli(int16_t raw);
+int16_t mts4x_milli_to_raw(int32_t mC);
+// raw -> absolute °C in Q8.8 (LSB = 1/256 °C); int32 because the chip
+// range (-103..+153 °C) does not fit a signed Q8.8 int16
+int32_t mts4x_raw_to_q8_8(int16_t raw);
+// m°C -> "-12.345" with 0..3 decimals for Serial/JSON, returns length
+// (0 and an empty string if buf is too small)
+size_t  mts4x_format_milli(char *buf, size_t size, int32_t mC, uint8_t decimals);
+
 // Scratch / configuration / ID registers
 #define MTS4X_CRC_TEMP         0x02
 #define MTS4X_STATUS           0x03
@@ -69,6 +81,96 @@
 #define MTS4X_ERR_TIMEOUT   -2
 #define MTS4X_ERR_PARAM     -3
 #define MTS4X_ERR_CRC       -4
+#define MTS4X_ERR_VERIFY    -5   // read-back differs from what was written
+
+// Opt-in concurrency mode (define MTS4X_THREAD_SAFE=1 in the build flags).
+// Every MTS4X sharing one TwoWire then shares one recursive lock, held for
+// a single transaction (or one read-modify-write), never across a wait, and
+// lastError() reports the last call made by the calling task/thread.
+// The register shadow is guarded as well; the non-blocking conversion
+// (startConversion/poll/result) belongs to one task per MTS4X object.
+// Supported on ESP32 (FreeRTOS) and on hosts providing <mutex>.
+#ifndef MTS4X_THREAD_SAFE
+#define MTS4X_THREAD_SAFE 0
+#endif
+
+#if MTS4X_THREAD_SAFE && (defined(__AVR__) || defined(ESP8266))
+#error "MTS4X_THREAD_SAFE needs an RTOS (ESP32) or a host with <mutex>"
+#endif
+
+// Fault recovery (setRecoveryDeadline): replays and the bit-banged bus
+// clear of MTS4xWireBus. Off by default on AVR, where the pin-level code
+// would be linked into every sketch through the vtable; define
+// MTS4X_BUS_RECOVERY=1 to get it there, =0 to drop it anywhere. Without
+// it a failed transaction fails at once, whatever the deadline.
+#ifndef MTS4X_BUS_RECOVERY
+#if defined(__AVR__)
+#define MTS4X_BUS_RECOVERY 0
+#else
+#define MTS4X_BUS_RECOVERY 1
+#endif
+#endif
+
+// Most micros() calls spent on the sub-ms rest of a conversion wait: well
+// over 1 ms on every target, and a way out for a clock that stands still
+#ifndef MTS4X_WAIT_SPIN_MAX
+#define MTS4X_WAIT_SPIN_MAX 0xFFFFU
+#endif
+
+// Fault recovery: longest pause between two replays, in ms. The first
+// replay follows the bus clear at once, each further one waits twice as
+// long as the one before, up to this.
+#ifndef MTS4X_RECOVERY_BACKOFF_MS
+#define MTS4X_RECOVERY_BACKOFF_MS 8
+#endif
+
+// Scoped lock of the per-bus mutex; compiles to nothing when
+// MTS4X_THREAD_SAFE is off
+class MTS4xBusGuard {
+  public:
+#if MTS4X_THREAD_SAFE
+    explicit MTS4xBusGuard(const void *bus);
+    ~MTS4xBusGuard();
+#else
+    explicit MTS4xBusGuard(const void *) {}
+#endif
+
+  private:
+#if MTS4X_THREAD_SAFE
+    void *_lock;
+#endif
+    MTS4xBusGuard(const MTS4xBusGuard &);
+    MTS4xBusGuard &operator=(const MTS4xBusGuard &);
+};
+
+// CRC8 backend, selected at compile time via MTS4X_CRC_IMPL:
+//   MTS4X_CRC_TABLE   - 256-byte lookup table (PROGMEM), fastest
+//   MTS4X_CRC_NIBBLE  - 16-byte lookup table, for RAM/flash-starved parts
+//   MTS4X_CRC_BITWISE - no table, 8 shift/xor steps per byte
+#define MTS4X_CRC_BITWISE 0
+#define MTS4X_CRC_NIBBLE  1
+#define MTS4X_CRC_TABLE   2
+
+#ifndef MTS4X_CRC_IMPL
+#define MTS4X_CRC_IMPL MTS4X_CRC_TABLE
+#endif
+
+// Incremental CRC8 (same polynomial as the chip); feed data in any number
+// of update() calls, value() is the CRC of everything fed since reset()
+class MTS4xCrc8 {
+  public:
+    MTS4xCrc8() : _crc(0x00) {}
+
+    void    reset() { _crc = 0x00; }
+    void    update(uint8_t in);
+    void    update(const uint8_t *data, size_t len);
+    uint8_t value() const { return _crc; }
+
+    static uint8_t compute(const uint8_t *data, size_t len);
+
+  private:
+    uint8_t _crc;
+};
 
 // Measurement mode (Temp_Cmd[7:6])
 typedef enum {
@@ -98,26 +200,208 @@ typedef enum {
     AVG_32  = 0b11 << 3   // 32 samples, 15.3 ms
 } TempCfgAVG;
 
+// Conversion time for an AVG setting (datasheet: 2.2 / 5.2 / 8.5 / 15.3 ms)
+uint32_t mts4x_avg_time_us(TempCfgAVG avg);
+
 // Alert mode (Alert_Mode[6])
 typedef enum {
     ALERT_MODE_HIGH_TH_LOW_CLEAR = 0, // high > TH alarm, low < TL clears
     ALERT_MODE_HIGH_TH_LOW_ALARM = 1  // alarm outside TL..TH
 } MTS4xAlertMode;
 
+// State reported by the non-blocking measurement API (MTS4X::poll)
+typedef enum {
+    MTS4X_POLL_IDLE    = 0, // no conversion started
+    MTS4X_POLL_PENDING = 1, // conversion in flight, call poll() again later
+    MTS4X_POLL_READY   = 2, // result() holds a fresh sample
+    MTS4X_POLL_ERROR   = 3  // conversion failed, see lastError()
+} MTS4xPollResult;
+
+// Opt-in driver statistics (define MTS4X_ENABLE_STATS=1 in the build
+// flags). Off by default: the counters, their members and every update
+// compile out, and stats() just returns false.
+#ifndef MTS4X_ENABLE_STATS
+#define MTS4X_ENABLE_STATS 0
+#endif
+
+// Latency histogram: bucket i counts reads taking [2^i, 2^(i+1)) us,
+// bucket 0 also takes 0..1 us, the last one everything above
+#ifndef MTS4X_STATS_BUCKETS
+#define MTS4X_STATS_BUCKETS 18
+#endif
+
+// Snapshot returned by MTS4X::stats(). Bytes count the register pointer
+// and the data, not the address byte.
+struct MTS4xDriverStats {
+    // Failed calls per error code
+    uint32_t errWire;
+    uint32_t errTimeout;
+    uint32_t errParam;
+    uint32_t errCrc;
+    uint32_t errVerify;
+
+    uint32_t crcRetries;     // temperature frames re-read after a CRC mismatch
+    uint32_t busRecoveries;  // bus clears after a failed transaction
+    uint32_t recovered;      // transactions that succeeded on a replay
+    uint32_t recoveryMaxUs;  // first failure -> successful replay
+    uint32_t busyPolls;      // temperature frames that still showed BUSY
+    uint32_t transactions;
+    uint32_t bytesWritten;
+    uint32_t bytesRead;
+
+    // Temperature reads (readTemperature*, singleShot*, poll() to READY)
+    uint32_t reads;
+    uint32_t latencyMaxUs;
+    uint32_t latencyHist[MTS4X_STATS_BUCKETS];
+};
+
+// Chip configuration kept by the host over a deep sleep (see
+// MTS4xWarmStart.h for storage in RTC memory). Filled by captureState(),
+// consumed by warmBegin().
+#define MTS4X_STATE_CONFIG  0x01    // config[] is valid
+#define MTS4X_STATE_USER    0x02    // user[] is valid
+#define MTS4X_STATE_NO_CRC  0x04    // setUseCrc(false) was in effect
+
+struct MTS4xDriverState {
+    uint8_t config[7];      // Temp_Cmd..TL_Msb (0x04..0x0A)
+    uint8_t user[10];       // user registers 0x0C..0x15
+    uint8_t flags;
+};
+
+// Full scratch + scratch_ext image (Temp_Cmd..TL_Msb, user registers) as
+// one value. Built offline, then written by MTS4X::applyProfile() with
+// the fewest transactions and committed to EEPROM only on a difference.
+//
+//   MTS4xProfile p;
+//   p.setConfig(MPS_1Hz, AVG_8, true);
+//   p.setMode(MEASURE_STOP, false);
+//   p.setLimitsMilli(40000, 5000);
+//   mts.applyProfile(p);
+class MTS4xProfile {
+  public:
+    MTS4xProfile();
+
+    void setMode(MeasurementMode mode, bool heater);
+    void setConfig(TempCfgMPS mps, TempCfgAVG avg, bool sleep);
+    void setAlertMode(bool enable, MTS4xAlertMode mode);
+    void setLimitsRaw(int16_t thRaw, int16_t tlRaw);
+    void setLimitsMilli(int32_t thMilli, int32_t tlMilli);
+    bool setUser(uint8_t index, uint8_t value);
+    void setUser(const uint8_t user[10]);
+
+    // Same chip state; a single-shot Temp_Cmd matches a stopped chip
+    bool matches(const MTS4xProfile &other) const;
+
+    uint8_t scratch[7];     // 0x04..0x0A
+    uint8_t user[10];       // 0x0C..0x15
+};
+
+// Transport and time base the driver sits on. The default is the TwoWire
+// passed to the MTS4X constructor (MTS4xWireBus); host builds can plug in
+// MTS4xSimDevice (MTS4xSim.h) or any other register-level transport.
+class MTS4xBus {
+  public:
+    virtual ~MTS4xBus() {}
+
+    virtual bool begin(int32_t sda, int32_t scl) { (void)sda; (void)scl; return true; }
+    virtual void setClock(uint32_t hz) { (void)hz; }
+
+    // One transaction each: write len bytes from reg on, or set the
+    // register pointer and read len bytes after a repeated start
+    virtual bool writeRegs(uint8_t addr, uint8_t reg,
+                           const uint8_t *data, size_t len) = 0;
+    virtual bool readRegs(uint8_t addr, uint8_t reg,
+                          uint8_t *data, size_t len) = 0;
+
+    // Bus clear after a failed transaction (see MTS4X::setRecoveryDeadline):
+    // clock a stuck SDA free, STOP, begin again at hz. true when both
+    // lines are released afterwards; the default cannot recover.
+    virtual bool recover(uint32_t hz) { (void)hz; return false; }
+
+    // Time base (Arduino millis/micros/delay by default)
+    virtual uint32_t millis();
+    virtual uint32_t micros();
+    virtual void     delay(uint32_t ms);
+
+    // Identity used to share one lock between drivers on the same bus
+    virtual const void *lockKey() const { return this; }
+};
+
+// MTS4xBus on an Arduino TwoWire
+class MTS4xWireBus : public MTS4xBus {
+  public:
+    explicit MTS4xWireBus(TwoWire &wire) : _wire(&wire), _sda(-1), _scl(-1) {}
+
+    bool begin(int32_t sda, int32_t scl) override;
+    void setClock(uint32_t hz) override;
+    bool writeRegs(uint8_t addr, uint8_t reg,
+                   const uint8_t *data, size_t len) override;
+    bool readRegs(uint8_t addr, uint8_t reg,
+                  uint8_t *data, size_t len) override;
+#if MTS4X_BUS_RECOVERY
+    // Bit-banged on the pins given to begin() (SDA/SCL where ignored)
+    bool recover(uint32_t hz) override;
+#endif
+    const void *lockKey() const override { return _wire; }
+
+    TwoWire *wire() const { return _wire; }
+
+  private:
+    TwoWire *_wire;
+    int32_t  _sda;
+    int32_t  _scl;
+};
+
 class MTS4X {
   public:
     explicit MTS4X(uint8_t address = MTS4X_ADDRESS, TwoWire &wire = Wire);
+    explicit MTS4X(MTS4xBus &bus, uint8_t address = MTS4X_ADDRESS);
+
+    // Transport and time base in use
+    MTS4xBus &bus() const;
 
     // Initialization
     bool begin(int32_t sda, int32_t scl);
     bool begin(int32_t sda, int32_t scl, MeasurementMode mode);
     void setUseCrc(bool enable);
 
+    // Warm start after a host deep sleep. One read of 0x00..0x0B checks the
+    // chip against the saved state; only registers that differ are written
+    // (one burst) and the shadow cache is enabled and primed with the
+    // result. The user registers are primed only when the configuration
+    // matched, i.e. the sensor kept its power. The overload also returns
+    // the sample from the same read: fresh when the chip is converting
+    // continuously, not BUSY and its CRC is good.
+    bool warmBegin(int32_t sda, int32_t scl, const MTS4xDriverState &state);
+    bool warmBegin(int32_t sda, int32_t scl, const MTS4xDriverState &state,
+                   int16_t &raw, bool &fresh);
+    // Served from the shadow where possible; withUser adds the user registers
+    bool captureState(MTS4xDriverState &out, bool withUser = true);
+
     void     setBusClock(uint32_t hz);
     uint32_t busClock() const;
 
     int8_t lastError() const;
 
+    // Fault recovery: a failed transaction triggers a bus clear
+    // (MTS4xBus::recover) and is replayed until it succeeds or deadlineUs
+    // have passed since the first failure, with a growing pause (up to
+    // MTS4X_RECOVERY_BACKOFF_MS) from the second replay on. EEPROM
+    // commands (copy, recall, reset) are never replayed. 0 (default)
+    // fails at once, as does every deadline with MTS4X_BUS_RECOVERY=0.
+    void     setRecoveryDeadline(uint32_t deadlineUs);
+    uint32_t recoveryDeadline() const;
+
+    // Number of I2C transactions (address + data phases up to STOP) issued
+    uint32_t transactionCount() const;
+    void     resetTransactionCount();
+
+    // Copy of the driver statistics (MTS4X_ENABLE_STATS). Lock-free for the
+    // hot path: a concurrent update makes the copy retry, false if it could
+    // not get a consistent one (or stats are compiled out). Not for ISRs.
+    bool stats(MTS4xDriverStats &out) const;
+    void resetStats();
+
     // Measurement mode and configuration
     bool setMode(MeasurementMode mode, bool heater);
     bool startSingleMessurement(); // convenience for MEASURE_SINGLE
@@ -125,18 +409,45 @@ class MTS4X {
     bool setConfig(TempCfgMPS mps, TempCfgAVG avg, bool sleep);
 
     // Temperature reading (convenience)
+#ifndef MTS4X_NO_FLOAT
     float readTemperature(bool waitOnNewVal = true);
     float readTemperatureC(bool waitOnNewVal = true);
 
     bool readTemperature(float &tC, bool waitOnNewVal = true);
+#endif
     bool readTemperatureRaw(int16_t &raw, bool waitOnNewVal = true);
     bool readTemperatureRawWithCrc(int16_t &raw, bool &crcOk,
                                    bool waitOnNewVal = true);
+    // Sample, its CRC and the Status byte (BUSY) in one transaction, no wait
+    bool readTemperatureFrame(int16_t &raw, bool &crcOk, uint8_t &status);
+#ifndef MTS4X_NO_FLOAT
     bool readTemperatureCrc(float &tC, bool &crcOk,
                             bool waitOnNewVal = true);
+#endif
 
-    // Trigger one conversion and read it back
+    // Integer-only reading in m°C (no soft-float on FPU-less targets)
+    bool readTemperatureMilli(int32_t &mC, bool waitOnNewVal = true);
+    bool readTemperatureMilli(int32_t &mC, bool &crcOk,
+                              bool waitOnNewVal = true);
+
+    // Trigger one conversion and read it back: no bus traffic until the
+    // expected conversion time, then normally a single fused read
+#ifndef MTS4X_NO_FLOAT
     bool singleShot(float &tC);
+#endif
+    bool singleShotMilli(int32_t &mC);
+
+    // Non-blocking measurement: startConversion() triggers a single shot,
+    // poll() never waits and issues at most one I2C transaction per call.
+    // The bus is not touched until the expected conversion time for the
+    // configured TempCfgAVG has elapsed.
+    bool            startConversion();
+    MTS4xPollResult poll();
+    bool            result(int16_t &raw, bool &crcOk) const;
+#ifndef MTS4X_NO_FLOAT
+    bool            result(float &tC) const;
+#endif
+    uint32_t        conversionTimeUs() const;
 
     // Status / busy / heater
     bool readStatus(uint8_t &status);
@@ -152,10 +463,25 @@ class MTS4X {
     bool getAlertMode(bool &enable, MTS4xAlertMode &mode);
     bool readAlertRegister(uint8_t &regValue);
 
+#ifndef MTS4X_NO_FLOAT
     bool setHighLimit(float tHighC);
     bool setLowLimit(float tLowC);
     bool getHighLimit(float &tHighC);
     bool getLowLimit(float &tLowC);
+#endif
+
+    bool setHighLimitMilli(int32_t mC);
+    bool setLowLimitMilli(int32_t mC);
+    bool getHighLimitMilli(int32_t &mC);
+    bool getLowLimitMilli(int32_t &mC);
+
+    // Limits as raw chip values (same scale as readTemperatureRaw)
+    bool setHighLimitRaw(int16_t raw);
+    bool setLowLimitRaw(int16_t raw);
+    bool getHighLimitRaw(int16_t &raw);
+    bool getLowLimitRaw(int16_t &raw);
+    // TH and TL in one burst write of 0x07..0x0A
+    bool setLimitsRaw(int16_t thRaw, int16_t tlRaw);
 
     // ID and ROM code
     bool readDeviceId(uint16_t &id);
@@ -177,20 +503,88 @@ class MTS4X {
     bool softReset(bool waitReady = true, uint32_t timeoutMs = 50);
     bool waitEepromReady(uint32_t timeoutMs = 50);
 
+    // Configuration profile. readProfile() takes one read of 0x03..0x16
+    // (both scratch CRCs checked). applyProfile() diffs against the chip:
+    // with commit, against the EEPROM image (recalled first), the
+    // differing span of 0x04..0x0A and of 0x0C..0x15 is written as one
+    // burst each, verified with one more read and copied to EEPROM; an
+    // unchanged image costs no write and no EEPROM cycle. Without commit
+    // only the scratch is compared and written. A verify mismatch fails
+    // with MTS4X_ERR_VERIFY.
+    bool readProfile(MTS4xProfile &out);
+    bool applyProfile(const MTS4xProfile &profile, bool commit = true);
+    bool applyProfile(const MTS4xProfile &profile, bool commit,
+                      bool &eepromWritten);
+
     // Parasitic power configuration (PPM_Cfg at 0x63)
     bool setParasiticPower(bool enable);
 
+    // Configuration register shadow (0x04..0x0A, user registers, PPM_Cfg).
+    // When enabled, reads of known registers are served from RAM. Writes go
+    // through immediately, or with deferWrites=true are held as dirty and
+    // sent by flushShadow() as one burst per run of adjacent registers
+    // (Temp_Cmd is always written through). Until then the chip works with
+    // the old values: deferred limits, alert mode or config do not act on
+    // the alert logic or a running conversion yet. A Temp_Cmd write (mode,
+    // single shot, heater) flushes first, so the conversion it starts uses
+    // them. softReset()/eepromRecall*() and eepromCopyPage() flush first;
+    // reset and recall then drop the shadow. A deferred burst that touches a
+    // register without a slot fails with MTS4X_ERR_PARAM and changes nothing.
+    bool setShadowCache(bool enable, bool deferWrites = false);
+    bool flushShadow();
+    void invalidateShadow();
+
   private:
-    TwoWire   *_wire;
+    MTS4xWireBus _wireBus;    // used unless a custom MTS4xBus is given
+    MTS4xBus  *_bus;
     uint8_t    _addr;
-    int8_t     _lastError;
+    int8_t     _lastError;    // unused with MTS4X_THREAD_SAFE (per thread)
     uint32_t   _busClock;
     bool       _useCrc;
+    uint8_t    _tempCfg;      // last Temp_Cfg written, 0xFF = unknown
+    uint32_t   _recoveryUs;
+
+    // Non-blocking conversion state
+    uint8_t    _convState;
+    uint8_t    _convAttempts;
+    bool       _convCrcOk;
+    int16_t    _convRaw;
+    uint32_t   _convStartUs;
+
+    uint32_t   _transactions;
+
+#if MTS4X_ENABLE_STATS
+    // Seqlock: odd _statsSeq while an update is in progress
+    MTS4xDriverStats _stats;
+    uint32_t         _statsSeq;
+
+    void statsBegin();
+    void statsEnd();
+    void statsLatency(uint32_t us);
+#endif
+
+    // Configuration register shadow, see setShadowCache()
+    bool       _shadowEnabled;
+    bool       _shadowDeferred;
+    uint32_t   _shadowValid;
+    uint32_t   _shadowDirty;
+    uint8_t    _shadow[19];
+
+    void waitConversion(uint32_t startUs);
 
     bool writeRegister(uint8_t reg, uint8_t value);
     bool writeRegisterRaw(uint8_t reg, const uint8_t *data, size_t len);
     bool readRegister(uint8_t reg, uint8_t &value);
     bool readRegisterRaw(uint8_t startReg, uint8_t *data, size_t len);
+    bool transfer(uint8_t reg, const uint8_t *out, uint8_t *in, size_t len);
+
+    bool readConfig(uint8_t reg, uint8_t &value);
+    bool readConfigRaw(uint8_t startReg, uint8_t *data, size_t len);
+    bool writeConfig(uint8_t reg, uint8_t value);
+    bool writeConfigRaw(uint8_t startReg, const uint8_t *data, size_t len);
+    void shadowFill(uint8_t startReg, const uint8_t *data, size_t len);
+    bool readImage(MTS4xProfile &out, uint8_t &status);
+    bool readImageReady(MTS4xProfile &out, uint32_t timeoutMs);
 
     bool inProgress();
 
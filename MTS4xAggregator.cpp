@@ -0,0 +1,308 @@
+#include "MTS4xAggregator.h"
+#include <string.h>
+#ifndef MTS4X_NO_FLOAT
+#include <math.h>
+#endif
+
+// -----------------------------------------------------------------------------
+// Integer helpers
+// -----------------------------------------------------------------------------
+
+// n / d rounded half away from zero (d > 0)
+static int64_t mts4x_div_round(int64_t n, int64_t d) {
+    return (n >= 0) ? (n + d / 2) / d : -((d / 2 - n) / d);
+}
+
+// Rounded integer square root
+uint32_t mts4x_isqrt64(uint64_t x) {
+    uint64_t r   = 0;
+    uint64_t bit = (uint64_t)1 << 62;
+    while (bit > x) {
+        bit >>= 2;
+    }
+    while (bit) {
+        if (x >= r + bit) {
+            x -= r + bit;
+            r  = (r >> 1) + bit;
+        } else {
+            r >>= 1;
+        }
+        bit >>= 2;
+    }
+    // x now holds the remainder of the floor root; 2^32 does not fit
+    if (x > r && r < 0xFFFFFFFFULL) {
+        ++r;
+    }
+    return (uint32_t)r;
+}
+
+// Median of n values (n <= MTS4X_AGG_WINDOW); sorts v in place
+static int32_t mts4x_median(int32_t *v, uint8_t n) {
+    for (uint8_t i = 1; i < n; ++i) {
+        int32_t x = v[i];
+        int8_t  j = (int8_t)i - 1;
+        while (j >= 0 && v[j] > x) {
+            v[j + 1] = v[j];
+            --j;
+        }
+        v[j + 1] = x;
+    }
+    // Even n: lower middle, keeps the result an actual sample
+    return v[(n - 1) / 2];
+}
+
+// -----------------------------------------------------------------------------
+// MTS4xMoments
+// -----------------------------------------------------------------------------
+
+MTS4xMoments::MTS4xMoments() {
+    reset();
+}
+
+void MTS4xMoments::reset() {
+    _n     = 0;
+    _ref   = 0;
+    _min   = 0;
+    _max   = 0;
+    _sum   = 0;
+    _sumSq = 0;
+}
+
+void MTS4xMoments::add(int16_t raw) {
+    if (_n == 0) {
+        _ref = raw;
+        _min = raw;
+        _max = raw;
+    } else {
+        if (raw < _min) _min = raw;
+        if (raw > _max) _max = raw;
+    }
+    int32_t d = (int32_t)raw - _ref;
+    ++_n;
+    _sum   += d;
+    _sumSq += (uint64_t)((int64_t)d * d);
+}
+
+void MTS4xMoments::merge(const MTS4xMoments &other) {
+    if (other._n == 0) {
+        return;
+    }
+    if (_n == 0) {
+        *this = other;
+        return;
+    }
+    // Re-base the other sums onto our reference:
+    //   sum(d + s)   = sum + n*s
+    //   sum(d + s)^2 = sumSq + 2*s*sum + n*s^2
+    // The total is non-negative, so modular uint64 arithmetic is exact.
+    int64_t s = (int64_t)other._ref - _ref;
+    _sum   += other._sum + (int64_t)other._n * s;
+    _sumSq += other._sumSq + (uint64_t)(2 * s * other._sum)
+            + (uint64_t)other._n * (uint64_t)(s * s);
+    _n     += other._n;
+    if (other._min < _min) _min = other._min;
+    if (other._max > _max) _max = other._max;
+}
+
+uint32_t MTS4xMoments::count() const {
+    return _n;
+}
+
+int16_t MTS4xMoments::minRaw() const {
+    return _min;
+}
+
+int16_t MTS4xMoments::maxRaw() const {
+    return _max;
+}
+
+int16_t MTS4xMoments::meanRaw() const {
+    if (_n == 0) {
+        return 0;
+    }
+    return (int16_t)(_ref + mts4x_div_round(_sum, _n));
+}
+
+int32_t MTS4xMoments::meanMilli() const {
+    if (_n == 0) {
+        return mts4x_raw_to_milli(0);
+    }
+    // (800000 + mean * 125) / 32 with mean = ref + sum / n
+    int64_t num = 800000LL * _n + ((int64_t)_ref * _n + _sum) * 125;
+    return (int32_t)mts4x_div_round(num, 32LL * _n);
+}
+
+uint64_t MTS4xMoments::m2Raw() const {
+    if (_n < 2) {
+        return 0;
+    }
+    // Centre on q ~ mean first so the terms stay small:
+    //   M2 = sum(d - q)^2 - r^2 / n,  r = sum - n*q,  |r| < n
+    int64_t  q   = _sum / (int64_t)_n;
+    int64_t  r   = _sum - (int64_t)_n * q;
+    uint64_t s2q = _sumSq - (uint64_t)(2 * q * _sum) + (uint64_t)_n * (uint64_t)(q * q);
+    uint64_t r2n = ((uint64_t)(r * r) + _n - 1) / _n;   // ceil
+    return s2q - r2n;
+}
+
+uint32_t MTS4xMoments::stddevMilli() const {
+    if (_n < 2) {
+        return 0;
+    }
+    // sigma[m°C] = sqrt(M2 / (n - 1)) * 1000 / 256
+    //            = sqrt(M2 * 15625 / (1024 * (n - 1)))
+    uint64_t m2  = m2Raw();
+    uint64_t den = 1024ULL * (_n - 1);
+    uint64_t x;
+    if (m2 < (1ULL << 49)) {
+        x = (m2 * 15625ULL + den / 2) / den;
+    } else {
+        x = (m2 / (_n - 1)) * 15625ULL / 1024ULL;
+    }
+    return mts4x_isqrt64(x);
+}
+
+#ifndef MTS4X_NO_FLOAT
+
+float MTS4xMoments::mean() const {
+    if (_n == 0) {
+        return NAN;
+    }
+    float m = (float)_ref + (float)_sum / (float)_n;
+    return MTS4X_RAW_TO_CELSIUS(m);
+}
+
+float MTS4xMoments::variance() const {
+    if (_n < 2) {
+        return 0.0f;
+    }
+    return (float)m2Raw() / (float)(_n - 1) / 65536.0f;
+}
+
+float MTS4xMoments::stddev() const {
+    return sqrtf(variance());
+}
+
+#endif // MTS4X_NO_FLOAT
+
+// -----------------------------------------------------------------------------
+// MTS4xAggregator
+// -----------------------------------------------------------------------------
+
+MTS4xAggregator::MTS4xAggregator()
+: _tauMs(0),
+  _k(30),
+  _minDelta(8) {
+    reset();
+}
+
+void MTS4xAggregator::begin(uint32_t tauMs, uint8_t kTenths, uint16_t minDeltaRaw) {
+    _tauMs    = tauMs;
+    _k        = kTenths;
+    _minDelta = minDeltaRaw;
+    reset();
+}
+
+void MTS4xAggregator::reset() {
+    memset(_win, 0, sizeof(_win));
+    _winLen    = 0;
+    _winPos    = 0;
+    _median    = 0;
+    _emaValid  = false;
+    _ema       = 0;
+    _emaLastMs = 0;
+    _moments.reset();
+    _accepted  = 0;
+    _rejected  = 0;
+}
+
+bool MTS4xAggregator::add(int16_t raw, uint32_t nowMs) {
+    _win[_winPos] = raw;
+    _winPos = (uint8_t)((_winPos + 1) % MTS4X_AGG_WINDOW);
+    if (_winLen < MTS4X_AGG_WINDOW) {
+        ++_winLen;
+    }
+
+    int32_t v[MTS4X_AGG_WINDOW];
+    for (uint8_t i = 0; i < _winLen; ++i) {
+        v[i] = _win[i];
+    }
+    int32_t med = mts4x_median(v, _winLen);
+    _median = (int16_t)med;
+
+    // Hampel test once the window can outvote a single sample. The raw
+    // value stays in the window, so a real step is followed after
+    // (window + 1) / 2 samples.
+    if (_k && _winLen >= 3) {
+        for (uint8_t i = 0; i < _winLen; ++i) {
+            int32_t d = v[i] - med;
+            v[i] = (d < 0) ? -d : d;
+        }
+        uint32_t mad = (uint32_t)mts4x_median(v, _winLen);
+        // k * 1.4826 * MAD, k in tenths
+        uint32_t thr = (uint32_t)(((uint64_t)mad * _k * 14826UL + 50000UL) / 100000UL);
+        if (thr < _minDelta) {
+            thr = _minDelta;
+        }
+        int32_t dev = (int32_t)raw - med;
+        if ((uint32_t)((dev < 0) ? -dev : dev) > thr) {
+            ++_rejected;
+            return false;
+        }
+    }
+
+    ++_accepted;
+    _moments.add(raw);
+
+    // EMA with time constant tau over irregular steps:
+    //   alpha = dt / (tau + dt)
+    int32_t x = (int32_t)raw * 256;
+    if (!_emaValid || _tauMs == 0) {
+        _ema      = x;
+        _emaValid = true;
+    } else {
+        uint32_t dt = nowMs - _emaLastMs;
+        _ema += (int32_t)mts4x_div_round((int64_t)(x - _ema) * dt,
+                                         (int64_t)_tauMs + dt);
+    }
+    _emaLastMs = nowMs;
+    return true;
+}
+
+const MTS4xMoments &MTS4xAggregator::window() const {
+    return _moments;
+}
+
+void MTS4xAggregator::takeWindow(MTS4xMoments &out) {
+    out = _moments;
+    _moments.reset();
+}
+
+bool MTS4xAggregator::emaRaw(int16_t &raw) const {
+    if (!_emaValid) {
+        return false;
+    }
+    raw = (int16_t)mts4x_div_round(_ema, 256);
+    return true;
+}
+
+bool MTS4xAggregator::emaMilli(int32_t &mC) const {
+    if (!_emaValid) {
+        return false;
+    }
+    // (800000 + ema/256 * 125) / 32
+    mC = (int32_t)mts4x_div_round(800000LL * 256 + (int64_t)_ema * 125, 32LL * 256);
+    return true;
+}
+
+int16_t MTS4xAggregator::medianRaw() const {
+    return _median;
+}
+
+uint32_t MTS4xAggregator::accepted() const {
+    return _accepted;
+}
+
+uint32_t MTS4xAggregator::rejected() const {
+    return _rejected;
+}
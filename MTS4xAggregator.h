@@ -0,0 +1,113 @@
+// MTS4x Arduino driver - streaming sample statistics
+// Author: Denis (FedunovDenis)
+
+#ifndef __MTS4X_AGGREGATOR_H__
+#define __MTS4X_AGGREGATOR_H__
+
+#include "MTS4x.h"
+
+// Hampel filter window (odd, 3..15 samples)
+#ifndef MTS4X_AGG_WINDOW
+#define MTS4X_AGG_WINDOW 5
+#endif
+
+#if (MTS4X_AGG_WINDOW < 3) || (MTS4X_AGG_WINDOW > 15) || !(MTS4X_AGG_WINDOW & 1)
+#error "MTS4X_AGG_WINDOW must be odd and within 3..15"
+#endif
+
+// Square root of x rounded to the nearest integer (saturating at
+// 2^32 - 1), no float; shared with MTS4xOversampler
+uint32_t mts4x_isqrt64(uint64_t x);
+
+// Count, min/max, mean and variance of raw samples in constant memory.
+// Sums are kept exactly in integers, relative to the first sample, so
+// there is no rounding drift however long the window is (exact up to
+// 2^30 samples). Two partial aggregates merge exactly in O(1):
+//
+//   cycle.add(raw) ...; upload.merge(cycle); cycle.reset();
+class MTS4xMoments {
+  public:
+    MTS4xMoments();
+
+    void reset();
+    void add(int16_t raw);
+    void merge(const MTS4xMoments &other);
+
+    uint32_t count() const;
+    int16_t  minRaw() const;
+    int16_t  maxRaw() const;
+
+    // Mean rounded to the nearest LSB / m°C
+    int16_t  meanRaw() const;
+    int32_t  meanMilli() const;
+
+    // Sample standard deviation (n - 1), rounded, 0 below two samples
+    uint32_t stddevMilli() const;
+
+    // Sum of squared deviations from the mean, in raw LSB^2 (floor)
+    uint64_t m2Raw() const;
+
+#ifndef MTS4X_NO_FLOAT
+    float mean() const;       // °C
+    float variance() const;   // °C^2, sample variance
+    float stddev() const;     // °C
+#endif
+
+  private:
+    uint32_t _n;
+    int16_t  _ref;
+    int16_t  _min;
+    int16_t  _max;
+    int64_t  _sum;      // sum of (raw - _ref)
+    uint64_t _sumSq;    // sum of (raw - _ref)^2
+};
+
+// Sample conditioning for one sensor: a sliding-window Hampel test drops
+// single outliers that passed CRC, accepted samples feed an integer EMA
+// and the window moments. Constant memory, no float on the path.
+class MTS4xAggregator {
+  public:
+    MTS4xAggregator();
+
+    // tauMs: EMA time constant. An accepted sample is an outlier when it
+    // differs from the window median by more than kTenths/10 * 1.4826 * MAD
+    // and by more than minDeltaRaw (keeps a flat, quantised signal from
+    // rejecting every 1-LSB step). kTenths = 0 disables the filter.
+    void begin(uint32_t tauMs, uint8_t kTenths = 30, uint16_t minDeltaRaw = 8);
+    void reset();
+
+    // false if the sample was rejected as an outlier
+    bool add(int16_t raw, uint32_t nowMs);
+
+    // Samples accepted since the last takeWindow(); copies and restarts
+    const MTS4xMoments &window() const;
+    void               takeWindow(MTS4xMoments &out);
+
+    // EMA of accepted samples, false before the first one
+    bool    emaRaw(int16_t &raw) const;
+    bool    emaMilli(int32_t &mC) const;
+
+    int16_t  medianRaw() const;    // of the current filter window
+    uint32_t accepted() const;
+    uint32_t rejected() const;
+
+  private:
+    uint32_t     _tauMs;
+    uint8_t      _k;
+    uint16_t     _minDelta;
+
+    int16_t      _win[MTS4X_AGG_WINDOW];
+    uint8_t      _winLen;
+    uint8_t      _winPos;
+    int16_t      _median;
+
+    bool         _emaValid;
+    int32_t      _ema;         // Q8 raw
+    uint32_t     _emaLastMs;
+
+    MTS4xMoments _moments;
+    uint32_t     _accepted;
+    uint32_t     _rejected;
+};
+
+#endif // __MTS4X_AGGREGATOR_H__
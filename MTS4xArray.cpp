@@ -0,0 +1,190 @@
+#include "MTS4xArray.h"
+#include <string.h>
+
+MTS4XArray::MTS4XArray()
+: _count(0),
+  _done(0),
+  _running(false),
+  _roundStartUs(0),
+  _roundTimeUs(0),
+  _curSelect(NULL),
+  _curCtx(NULL),
+  _curChannel(0) {
+    memset(_slots, 0, sizeof(_slots));
+    memset(_samples, 0, sizeof(_samples));
+    memset(_order, 0, sizeof(_order));
+}
+
+int8_t MTS4XArray::add(MTS4X &sensor, MTS4xSelectFn select,
+                       void *ctx, uint8_t channel) {
+    if (_count >= MTS4X_ARRAY_MAX_SENSORS || _running) {
+        return -1;
+    }
+    Slot &s   = _slots[_count];
+    s.sensor  = &sensor;
+    s.select  = select;
+    s.ctx     = ctx;
+    s.channel = channel;
+    s.pending = false;
+    s.startUs = 0;
+    return (int8_t)_count++;
+}
+
+uint8_t MTS4XArray::count() const {
+    return _count;
+}
+
+bool MTS4XArray::busy() const {
+    return _running;
+}
+
+uint8_t MTS4XArray::completed() const {
+    return _done;
+}
+
+uint8_t MTS4XArray::completionOrder(uint8_t n) const {
+    return (n < _done) ? _order[n] : 0xFF;
+}
+
+uint32_t MTS4XArray::roundTimeUs() const {
+    return _roundTimeUs;
+}
+
+const MTS4xArraySample &MTS4XArray::sample(uint8_t index) const {
+    if (index >= _count) {
+        index = 0;
+    }
+    return _samples[index];
+}
+
+// Round timing follows the first sensor's time base
+uint32_t MTS4XArray::nowUs() const {
+    return _slots[0].sensor->bus().micros();
+}
+
+bool MTS4XArray::route(uint8_t index) {
+    const Slot &s = _slots[index];
+    if (!s.select) {
+        return true;
+    }
+    if (s.select == _curSelect && s.ctx == _curCtx && s.channel == _curChannel) {
+        return true;
+    }
+    if (!s.select(s.channel, s.ctx)) {
+        _curSelect = NULL;
+        return false;
+    }
+    _curSelect  = s.select;
+    _curCtx     = s.ctx;
+    _curChannel = s.channel;
+    return true;
+}
+
+void MTS4XArray::finish(uint8_t index, int8_t error) {
+    Slot             &s = _slots[index];
+    MTS4xArraySample &r = _samples[index];
+    s.pending     = false;
+    r.error       = error;
+    r.timestampUs = s.sensor->bus().micros();
+    if (error == MTS4X_ERR_OK) {
+        r.valid = s.sensor->result(r.raw, r.crcOk) && r.crcOk;
+    }
+    _order[_done++] = index;
+}
+
+bool MTS4XArray::start() {
+    if (!_count) {
+        return false;
+    }
+    _done         = 0;
+    _running      = true;
+    _roundStartUs = nowUs();
+
+    // Trigger everything back to back so the conversions overlap
+    bool any = false;
+    for (uint8_t i = 0; i < _count; ++i) {
+        Slot &s = _slots[i];
+        memset(&_samples[i], 0, sizeof(_samples[i]));
+        s.pending = false;
+        if (!route(i)) {
+            finish(i, MTS4X_ERR_WIRE);
+            continue;
+        }
+        if (!s.sensor->startConversion()) {
+            finish(i, s.sensor->lastError());
+            continue;
+        }
+        s.startUs = s.sensor->bus().micros();
+        s.pending = true;
+        any       = true;
+    }
+    // Closes the round right away if nothing could be triggered
+    poll();
+    return any;
+}
+
+bool MTS4XArray::poll() {
+    if (!_running) {
+        return true;
+    }
+
+    for (uint8_t i = 0; i < _count; ++i) {
+        Slot &s = _slots[i];
+        if (!s.pending) {
+            continue;
+        }
+        // Skip segment switching until this chip can possibly be done
+        if (s.sensor->bus().micros() - s.startUs < s.sensor->conversionTimeUs()) {
+            continue;
+        }
+        if (!route(i)) {
+            finish(i, MTS4X_ERR_WIRE);
+            continue;
+        }
+        switch (s.sensor->poll()) {
+            case MTS4X_POLL_READY:
+                finish(i, MTS4X_ERR_OK);
+                break;
+            case MTS4X_POLL_ERROR:
+            case MTS4X_POLL_IDLE:
+                finish(i, s.sensor->lastError());
+                break;
+            default:
+                break;
+        }
+    }
+
+    if (_done < _count) {
+        return false;
+    }
+    _running     = false;
+    _roundTimeUs = nowUs() - _roundStartUs;
+    return true;
+}
+
+bool MTS4XArray::sampleAll(uint32_t timeoutMs) {
+    if (!start()) {
+        return false;
+    }
+    MTS4xBus &bus = _slots[0].sensor->bus();
+    uint32_t  t0  = bus.millis();
+    while (!poll()) {
+        if (bus.millis() - t0 > timeoutMs) {
+            // Give up on the stragglers
+            for (uint8_t i = 0; i < _count; ++i) {
+                if (_slots[i].pending) {
+                    finish(i, MTS4X_ERR_TIMEOUT);
+                }
+            }
+            poll();
+            break;
+        }
+        yield();
+    }
+    for (uint8_t i = 0; i < _count; ++i) {
+        if (!_samples[i].valid) {
+            return false;
+        }
+    }
+    return true;
+}
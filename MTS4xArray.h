@@ -0,0 +1,88 @@
+// MTS4x Arduino driver - multi-sensor scheduler
+// Author: Denis (FedunovDenis)
+
+#ifndef __MTS4X_ARRAY_H__
+#define __MTS4X_ARRAY_H__
+
+#include "MTS4x.h"
+
+#ifndef MTS4X_ARRAY_MAX_SENSORS
+#define MTS4X_ARRAY_MAX_SENSORS 16
+#endif
+
+// Optional hook that routes the bus to a sensor's segment (e.g. writes the
+// channel register of a TCA9548A). Called only when the segment changes.
+typedef bool (*MTS4xSelectFn)(uint8_t channel, void *ctx);
+
+// Result of one sensor in the last round
+typedef struct {
+    int16_t  raw;
+    bool     crcOk;
+    bool     valid;        // raw holds a fresh, CRC-checked sample
+    int8_t   error;        // MTS4X_ERR_* of this sensor
+    uint32_t timestampUs;  // bus().micros() when the sample was read
+} MTS4xArraySample;
+
+// Staggered single-shot acquisition for several MTS4X on one or more buses:
+// all sensors are triggered back to back, then collected in completion
+// order, so a round of N sensors costs about one conversion time plus
+// N reads instead of N conversion times.
+class MTS4XArray {
+  public:
+    MTS4XArray();
+
+    // Register a sensor; returns its index or -1 if the array is full
+    int8_t add(MTS4X &sensor, MTS4xSelectFn select = NULL,
+               void *ctx = NULL, uint8_t channel = 0);
+    uint8_t count() const;
+
+    // Non-blocking round: start() triggers every sensor (false if none could
+    // be triggered), poll() collects whatever is ready and returns true once
+    // every sensor has finished
+    bool start();
+    bool poll();
+    bool busy() const;
+
+    // Blocking convenience: start() + poll() until done or timeout.
+    // Returns true if every sensor delivered a valid sample.
+    bool sampleAll(uint32_t timeoutMs = 250);
+
+    const MTS4xArraySample &sample(uint8_t index) const;
+
+    // Sensors finished in the current/last round and their order
+    uint8_t completed() const;
+    uint8_t completionOrder(uint8_t n) const;
+
+    // Duration of the last finished round
+    uint32_t roundTimeUs() const;
+
+  private:
+    struct Slot {
+        MTS4X        *sensor;
+        MTS4xSelectFn select;
+        void         *ctx;
+        uint8_t       channel;
+        bool          pending;
+        uint32_t      startUs;
+    };
+
+    Slot             _slots[MTS4X_ARRAY_MAX_SENSORS];
+    MTS4xArraySample _samples[MTS4X_ARRAY_MAX_SENSORS];
+    uint8_t          _order[MTS4X_ARRAY_MAX_SENSORS];
+    uint8_t          _count;
+    uint8_t          _done;
+    bool             _running;
+    uint32_t         _roundStartUs;
+    uint32_t         _roundTimeUs;
+
+    // Segment currently routed to the bus
+    MTS4xSelectFn    _curSelect;
+    void            *_curCtx;
+    uint8_t          _curChannel;
+
+    uint32_t nowUs() const;
+    bool     route(uint8_t index);
+    void finish(uint8_t index, int8_t error);
+};
+
+#endif // __MTS4X_ARRAY_H__
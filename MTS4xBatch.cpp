@@ -0,0 +1,485 @@
+#include "MTS4xBatch.h"
+
+#if MTS4X_BATCH_SIMD == MTS4X_BATCH_AVX2
+#include <immintrin.h>
+#elif MTS4X_BATCH_SIMD == MTS4X_BATCH_SSE2
+#include <emmintrin.h>
+#elif MTS4X_BATCH_SIMD == MTS4X_BATCH_NEON
+#include <arm_neon.h>
+#endif
+
+// -----------------------------------------------------------------------------
+// Scalar kernels: the reference, and the tail after the vector loop
+// -----------------------------------------------------------------------------
+
+static inline int16_t mts4x_sat16(int32_t v) {
+    if (v > 32767)  return 32767;
+    if (v < -32768) return -32768;
+    return (int16_t)v;
+}
+
+static inline uint8_t mts4x_popcount8(uint32_t bits) {
+    return (uint8_t)__builtin_popcount(bits);
+}
+
+#ifndef MTS4X_NO_FLOAT
+static void mts4x_to_celsius_scalar(const int16_t *raw, float *out, size_t i, size_t n) {
+    for (; i < n; ++i) {
+        out[i] = MTS4X_RAW_TO_CELSIUS(raw[i]);
+    }
+}
+#endif
+
+static void mts4x_to_milli_scalar(const int16_t *raw, int32_t *out, size_t i, size_t n) {
+    for (; i < n; ++i) {
+        out[i] = mts4x_raw_to_milli(raw[i]);
+    }
+}
+
+static void mts4x_scale_offset_scalar(const int16_t *raw, int16_t *out, size_t i, size_t n,
+                                      int16_t gainQ14, int16_t offsetRaw) {
+    for (; i < n; ++i) {
+        int32_t p = (((int32_t)raw[i] * gainQ14 + 8192) >> 14) + offsetRaw;
+        out[i]    = mts4x_sat16(p);
+    }
+}
+
+// i is a multiple of 8: the tail starts on a fresh mask byte
+static size_t mts4x_threshold_scalar(const int16_t *raw, size_t i, size_t n, int16_t thRaw,
+                                     int16_t tlRaw, uint8_t *mask) {
+    size_t count = 0;
+    for (; i < n; ++i) {
+        bool outside = (raw[i] > thRaw) || (raw[i] < tlRaw);
+        if (mask) {
+            if ((i & 7) == 0) {
+                mask[i >> 3] = 0;
+            }
+            if (outside) {
+                mask[i >> 3] |= (uint8_t)(1 << (i & 7));
+            }
+        }
+        count += outside;
+    }
+    return count;
+}
+
+static void mts4x_reduce_scalar(const int16_t *raw, size_t i, size_t n, int16_t &mn,
+                                int16_t &mx, int64_t &sum) {
+    int32_t part = 0;   // flushed every 2^15 samples, cannot overflow
+    for (; i < n; ++i) {
+        int16_t v = raw[i];
+        if (v < mn) mn = v;
+        if (v > mx) mx = v;
+        part += v;
+        if ((i & 0x7FFF) == 0x7FFF) {
+            sum += part;
+            part = 0;
+        }
+    }
+    sum += part;
+}
+
+// -----------------------------------------------------------------------------
+// Vector kernels; each returns how many leading samples it handled
+// -----------------------------------------------------------------------------
+
+#if MTS4X_BATCH_SIMD == MTS4X_BATCH_SSE2
+
+static inline __m128i mts4x_lo32(__m128i v) { return _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16); }
+static inline __m128i mts4x_hi32(__m128i v) { return _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16); }
+
+// n = 800000 + raw * 125 (SSE2 has no 32-bit multiply), then n / 32
+// rounded half away from zero
+static inline __m128i mts4x_milli_sse2(__m128i x) {
+    __m128i n = _mm_sub_epi32(_mm_slli_epi32(x, 7), _mm_add_epi32(_mm_slli_epi32(x, 1), x));
+    n         = _mm_add_epi32(n, _mm_set1_epi32(800000));
+    __m128i s = _mm_srai_epi32(n, 31);
+    __m128i a = _mm_sub_epi32(_mm_xor_si128(n, s), s);
+    __m128i q = _mm_srli_epi32(_mm_add_epi32(a, _mm_set1_epi32(16)), 5);
+    return _mm_sub_epi32(_mm_xor_si128(q, s), s);
+}
+
+#ifndef MTS4X_NO_FLOAT
+static size_t mts4x_to_celsius_simd(const int16_t *raw, float *out, size_t n) {
+    const __m128 k = _mm_set1_ps(1.0f / 256.0f), b = _mm_set1_ps(25.0f);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(raw + i));
+        _mm_storeu_ps(out + i,     _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(mts4x_lo32(v)), k), b));
+        _mm_storeu_ps(out + i + 4, _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(mts4x_hi32(v)), k), b));
+    }
+    return i;
+}
+#endif
+
+static size_t mts4x_to_milli_simd(const int16_t *raw, int32_t *out, size_t n) {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(raw + i));
+        _mm_storeu_si128((__m128i *)(out + i),     mts4x_milli_sse2(mts4x_lo32(v)));
+        _mm_storeu_si128((__m128i *)(out + i + 4), mts4x_milli_sse2(mts4x_hi32(v)));
+    }
+    return i;
+}
+
+static size_t mts4x_scale_offset_simd(const int16_t *raw, int16_t *out, size_t n,
+                                      int16_t gainQ14, int16_t offsetRaw) {
+    const __m128i g = _mm_set1_epi16(gainQ14);
+    const __m128i r = _mm_set1_epi32(8192);
+    const __m128i o = _mm_set1_epi32(offsetRaw);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m128i v  = _mm_loadu_si128((const __m128i *)(raw + i));
+        __m128i lo = _mm_mullo_epi16(v, g);
+        __m128i hi = _mm_mulhi_epi16(v, g);
+        __m128i p0 = _mm_add_epi32(_mm_srai_epi32(_mm_add_epi32(_mm_unpacklo_epi16(lo, hi), r), 14), o);
+        __m128i p1 = _mm_add_epi32(_mm_srai_epi32(_mm_add_epi32(_mm_unpackhi_epi16(lo, hi), r), 14), o);
+        _mm_storeu_si128((__m128i *)(out + i), _mm_packs_epi32(p0, p1));
+    }
+    return i;
+}
+
+static size_t mts4x_threshold_simd(const int16_t *raw, size_t n, int16_t thRaw,
+                                   int16_t tlRaw, uint8_t *mask, size_t &count) {
+    const __m128i th = _mm_set1_epi16(thRaw), tl = _mm_set1_epi16(tlRaw);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(raw + i));
+        __m128i m = _mm_or_si128(_mm_cmpgt_epi16(v, th), _mm_cmplt_epi16(v, tl));
+        uint32_t bits = (uint32_t)_mm_movemask_epi8(_mm_packs_epi16(m, m)) & 0xFF;
+        if (mask) {
+            mask[i >> 3] = (uint8_t)bits;
+        }
+        count += mts4x_popcount8(bits);
+    }
+    return i;
+}
+
+static size_t mts4x_reduce_simd(const int16_t *raw, size_t n, int16_t &mn, int16_t &mx,
+                                int64_t &sum) {
+    const __m128i one = _mm_set1_epi16(1);
+    __m128i vmn = _mm_set1_epi16(mn), vmx = _mm_set1_epi16(mx);
+    size_t i = 0;
+    while (i + 8 <= n) {
+        // Pair sums are within +-2^16: 2^13 steps per block fit int32 lanes
+        size_t  end = i + ((size_t)8 << 13);
+        __m128i acc = _mm_setzero_si128();
+        for (; i + 8 <= n && i < end; i += 8) {
+            __m128i v = _mm_loadu_si128((const __m128i *)(raw + i));
+            vmn = _mm_min_epi16(vmn, v);
+            vmx = _mm_max_epi16(vmx, v);
+            acc = _mm_add_epi32(acc, _mm_madd_epi16(v, one));
+        }
+        int32_t lanes[4];
+        _mm_storeu_si128((__m128i *)lanes, acc);
+        sum += (int64_t)lanes[0] + lanes[1] + lanes[2] + lanes[3];
+    }
+    int16_t a[8], b[8];
+    _mm_storeu_si128((__m128i *)a, vmn);
+    _mm_storeu_si128((__m128i *)b, vmx);
+    for (uint8_t k = 0; k < 8; ++k) {
+        if (a[k] < mn) mn = a[k];
+        if (b[k] > mx) mx = b[k];
+    }
+    return i;
+}
+
+#elif MTS4X_BATCH_SIMD == MTS4X_BATCH_AVX2
+
+#ifndef MTS4X_NO_FLOAT
+static size_t mts4x_to_celsius_simd(const int16_t *raw, float *out, size_t n) {
+    const __m256 k = _mm256_set1_ps(1.0f / 256.0f), b = _mm256_set1_ps(25.0f);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m256i lo = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *)(raw + i)));
+        __m256i hi = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *)(raw + i + 8)));
+        _mm256_storeu_ps(out + i,     _mm256_add_ps(_mm256_mul_ps(_mm256_cvtepi32_ps(lo), k), b));
+        _mm256_storeu_ps(out + i + 8, _mm256_add_ps(_mm256_mul_ps(_mm256_cvtepi32_ps(hi), k), b));
+    }
+    return i;
+}
+#endif
+
+static inline __m256i mts4x_milli_avx2(__m256i x) {
+    __m256i n = _mm256_add_epi32(_mm256_mullo_epi32(x, _mm256_set1_epi32(125)),
+                                 _mm256_set1_epi32(800000));
+    __m256i s = _mm256_srai_epi32(n, 31);
+    __m256i a = _mm256_abs_epi32(n);
+    __m256i q = _mm256_srli_epi32(_mm256_add_epi32(a, _mm256_set1_epi32(16)), 5);
+    return _mm256_sub_epi32(_mm256_xor_si256(q, s), s);
+}
+
+static size_t mts4x_to_milli_simd(const int16_t *raw, int32_t *out, size_t n) {
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m256i lo = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *)(raw + i)));
+        __m256i hi = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *)(raw + i + 8)));
+        _mm256_storeu_si256((__m256i *)(out + i),     mts4x_milli_avx2(lo));
+        _mm256_storeu_si256((__m256i *)(out + i + 8), mts4x_milli_avx2(hi));
+    }
+    return i;
+}
+
+static size_t mts4x_scale_offset_simd(const int16_t *raw, int16_t *out, size_t n,
+                                      int16_t gainQ14, int16_t offsetRaw) {
+    const __m256i g = _mm256_set1_epi16(gainQ14);
+    const __m256i r = _mm256_set1_epi32(8192);
+    const __m256i o = _mm256_set1_epi32(offsetRaw);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m256i v  = _mm256_loadu_si256((const __m256i *)(raw + i));
+        __m256i lo = _mm256_mullo_epi16(v, g);
+        __m256i hi = _mm256_mulhi_epi16(v, g);
+        // unpack and pack both work per 128-bit lane, so the order holds
+        __m256i p0 = _mm256_add_epi32(_mm256_srai_epi32(
+                         _mm256_add_epi32(_mm256_unpacklo_epi16(lo, hi), r), 14), o);
+        __m256i p1 = _mm256_add_epi32(_mm256_srai_epi32(
+                         _mm256_add_epi32(_mm256_unpackhi_epi16(lo, hi), r), 14), o);
+        _mm256_storeu_si256((__m256i *)(out + i), _mm256_packs_epi32(p0, p1));
+    }
+    return i;
+}
+
+static size_t mts4x_threshold_simd(const int16_t *raw, size_t n, int16_t thRaw,
+                                   int16_t tlRaw, uint8_t *mask, size_t &count) {
+    const __m256i th = _mm256_set1_epi16(thRaw), tl = _mm256_set1_epi16(tlRaw);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(raw + i));
+        __m256i m = _mm256_or_si256(_mm256_cmpgt_epi16(v, th), _mm256_cmpgt_epi16(tl, v));
+        __m128i b = _mm_packs_epi16(_mm256_castsi256_si128(m), _mm256_extracti128_si256(m, 1));
+        uint32_t bits = (uint32_t)_mm_movemask_epi8(b) & 0xFFFF;
+        if (mask) {
+            mask[i >> 3]       = (uint8_t)bits;
+            mask[(i >> 3) + 1] = (uint8_t)(bits >> 8);
+        }
+        count += (size_t)__builtin_popcount(bits);
+    }
+    return i;
+}
+
+static size_t mts4x_reduce_simd(const int16_t *raw, size_t n, int16_t &mn, int16_t &mx,
+                                int64_t &sum) {
+    const __m256i one = _mm256_set1_epi16(1);
+    __m256i vmn = _mm256_set1_epi16(mn), vmx = _mm256_set1_epi16(mx);
+    size_t i = 0;
+    while (i + 16 <= n) {
+        size_t  end = i + ((size_t)16 << 13);
+        __m256i acc = _mm256_setzero_si256();
+        for (; i + 16 <= n && i < end; i += 16) {
+            __m256i v = _mm256_loadu_si256((const __m256i *)(raw + i));
+            vmn = _mm256_min_epi16(vmn, v);
+            vmx = _mm256_max_epi16(vmx, v);
+            acc = _mm256_add_epi32(acc, _mm256_madd_epi16(v, one));
+        }
+        int32_t lanes[8];
+        _mm256_storeu_si256((__m256i *)lanes, acc);
+        for (uint8_t k = 0; k < 8; ++k) {
+            sum += lanes[k];
+        }
+    }
+    int16_t a[16], b[16];
+    _mm256_storeu_si256((__m256i *)a, vmn);
+    _mm256_storeu_si256((__m256i *)b, vmx);
+    for (uint8_t k = 0; k < 16; ++k) {
+        if (a[k] < mn) mn = a[k];
+        if (b[k] > mx) mx = b[k];
+    }
+    return i;
+}
+
+#elif MTS4X_BATCH_SIMD == MTS4X_BATCH_NEON
+
+#ifndef MTS4X_NO_FLOAT
+static size_t mts4x_to_celsius_simd(const int16_t *raw, float *out, size_t n) {
+    const float32x4_t b = vdupq_n_f32(25.0f);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        int16x8_t v = vld1q_s16(raw + i);
+        float32x4_t lo = vcvtq_f32_s32(vmovl_s16(vget_low_s16(v)));
+        float32x4_t hi = vcvtq_f32_s32(vmovl_s16(vget_high_s16(v)));
+        vst1q_f32(out + i,     vaddq_f32(vmulq_n_f32(lo, 1.0f / 256.0f), b));
+        vst1q_f32(out + i + 4, vaddq_f32(vmulq_n_f32(hi, 1.0f / 256.0f), b));
+    }
+    return i;
+}
+#endif
+
+static inline int32x4_t mts4x_milli_neon(int32x4_t x) {
+    int32x4_t n = vmlaq_n_s32(vdupq_n_s32(800000), x, 125);
+    int32x4_t s = vshrq_n_s32(n, 31);
+    int32x4_t a = vabsq_s32(n);
+    int32x4_t q = vreinterpretq_s32_u32(vshrq_n_u32(vreinterpretq_u32_s32(
+                      vaddq_s32(a, vdupq_n_s32(16))), 5));
+    return vsubq_s32(veorq_s32(q, s), s);
+}
+
+static size_t mts4x_to_milli_simd(const int16_t *raw, int32_t *out, size_t n) {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        int16x8_t v = vld1q_s16(raw + i);
+        vst1q_s32(out + i,     mts4x_milli_neon(vmovl_s16(vget_low_s16(v))));
+        vst1q_s32(out + i + 4, mts4x_milli_neon(vmovl_s16(vget_high_s16(v))));
+    }
+    return i;
+}
+
+static size_t mts4x_scale_offset_simd(const int16_t *raw, int16_t *out, size_t n,
+                                      int16_t gainQ14, int16_t offsetRaw) {
+    const int32x4_t r = vdupq_n_s32(8192);
+    const int32x4_t o = vdupq_n_s32(offsetRaw);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        int16x8_t v  = vld1q_s16(raw + i);
+        int32x4_t p0 = vaddq_s32(vshrq_n_s32(vaddq_s32(vmull_n_s16(vget_low_s16(v), gainQ14), r), 14), o);
+        int32x4_t p1 = vaddq_s32(vshrq_n_s32(vaddq_s32(vmull_n_s16(vget_high_s16(v), gainQ14), r), 14), o);
+        vst1q_s16(out + i, vcombine_s16(vqmovn_s32(p0), vqmovn_s32(p1)));
+    }
+    return i;
+}
+
+static size_t mts4x_threshold_simd(const int16_t *raw, size_t n, int16_t thRaw,
+                                   int16_t tlRaw, uint8_t *mask, size_t &count) {
+    static const uint8_t weights[8] = { 1, 2, 4, 8, 16, 32, 64, 128 };
+    const int16x8_t th = vdupq_n_s16(thRaw), tl = vdupq_n_s16(tlRaw);
+    const uint8x8_t w  = vld1_u8(weights);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        int16x8_t  v = vld1q_s16(raw + i);
+        uint16x8_t m = vorrq_u16(vcgtq_s16(v, th), vcltq_s16(v, tl));
+        uint8x8_t  b = vand_u8(vmovn_u16(m), w);
+        b = vpadd_u8(b, b);
+        b = vpadd_u8(b, b);
+        b = vpadd_u8(b, b);
+        uint32_t bits = vget_lane_u8(b, 0);
+        if (mask) {
+            mask[i >> 3] = (uint8_t)bits;
+        }
+        count += mts4x_popcount8(bits);
+    }
+    return i;
+}
+
+static size_t mts4x_reduce_simd(const int16_t *raw, size_t n, int16_t &mn, int16_t &mx,
+                                int64_t &sum) {
+    int16x8_t vmn = vdupq_n_s16(mn), vmx = vdupq_n_s16(mx);
+    size_t i = 0;
+    while (i + 8 <= n) {
+        size_t    end = i + ((size_t)8 << 13);
+        int32x4_t acc = vdupq_n_s32(0);
+        for (; i + 8 <= n && i < end; i += 8) {
+            int16x8_t v = vld1q_s16(raw + i);
+            vmn = vminq_s16(vmn, v);
+            vmx = vmaxq_s16(vmx, v);
+            acc = vpadalq_s16(acc, v);
+        }
+        int32_t lanes[4];
+        vst1q_s32(lanes, acc);
+        sum += (int64_t)lanes[0] + lanes[1] + lanes[2] + lanes[3];
+    }
+    int16_t a[8], b[8];
+    vst1q_s16(a, vmn);
+    vst1q_s16(b, vmx);
+    for (uint8_t k = 0; k < 8; ++k) {
+        if (a[k] < mn) mn = a[k];
+        if (b[k] > mx) mx = b[k];
+    }
+    return i;
+}
+
+#else
+
+#ifndef MTS4X_NO_FLOAT
+static size_t mts4x_to_celsius_simd(const int16_t *, float *, size_t) { return 0; }
+#endif
+static size_t mts4x_to_milli_simd(const int16_t *, int32_t *, size_t) { return 0; }
+static size_t mts4x_scale_offset_simd(const int16_t *, int16_t *, size_t, int16_t, int16_t) {
+    return 0;
+}
+static size_t mts4x_threshold_simd(const int16_t *, size_t, int16_t, int16_t, uint8_t *,
+                                   size_t &) {
+    return 0;
+}
+static size_t mts4x_reduce_simd(const int16_t *, size_t, int16_t &, int16_t &, int64_t &) {
+    return 0;
+}
+
+#endif
+
+// -----------------------------------------------------------------------------
+// Public API
+// -----------------------------------------------------------------------------
+
+const char *mts4x_batch_impl() {
+#if MTS4X_BATCH_SIMD == MTS4X_BATCH_AVX2
+    return "avx2";
+#elif MTS4X_BATCH_SIMD == MTS4X_BATCH_SSE2
+    return "sse2";
+#elif MTS4X_BATCH_SIMD == MTS4X_BATCH_NEON
+    return "neon";
+#else
+    return "scalar";
+#endif
+}
+
+void MTS4xBatchSummary::reset() {
+    count  = 0;
+    minRaw = 32767;
+    maxRaw = -32768;
+    sumRaw = 0;
+}
+
+int16_t MTS4xBatchSummary::meanRaw() const {
+    if (count == 0) {
+        return 0;
+    }
+    int64_t h = count / 2;
+    return (int16_t)((sumRaw >= 0) ? (sumRaw + h) / count : -((-sumRaw + h) / count));
+}
+
+int32_t MTS4xBatchSummary::meanMilli() const {
+    if (count == 0) {
+        return 0;
+    }
+    // Same scaling as mts4x_raw_to_milli on the exact sum: (800000 + 125 r) / 32
+    int64_t n = 800000LL * count + sumRaw * 125;
+    int64_t d = 32LL * count;
+    return (int32_t)((n >= 0) ? (n + d / 2) / d : -((-n + d / 2) / d));
+}
+
+#ifndef MTS4X_NO_FLOAT
+void mts4x_batch_to_celsius(const int16_t *raw, float *out, size_t n) {
+    mts4x_to_celsius_scalar(raw, out, mts4x_to_celsius_simd(raw, out, n), n);
+}
+#endif
+
+void mts4x_batch_to_milli(const int16_t *raw, int32_t *out, size_t n) {
+    mts4x_to_milli_scalar(raw, out, mts4x_to_milli_simd(raw, out, n), n);
+}
+
+void mts4x_batch_scale_offset(const int16_t *raw, int16_t *out, size_t n,
+                              int16_t gainQ14, int16_t offsetRaw) {
+    size_t i = mts4x_scale_offset_simd(raw, out, n, gainQ14, offsetRaw);
+    mts4x_scale_offset_scalar(raw, out, i, n, gainQ14, offsetRaw);
+}
+
+size_t mts4x_batch_threshold(const int16_t *raw, size_t n, int16_t thRaw, int16_t tlRaw,
+                             uint8_t *mask) {
+    size_t count = 0;
+    size_t i     = mts4x_threshold_simd(raw, n, thRaw, tlRaw, mask, count);
+    return count + mts4x_threshold_scalar(raw, i, n, thRaw, tlRaw, mask);
+}
+
+void mts4x_batch_reduce(const int16_t *raw, size_t n, MTS4xBatchSummary &sum) {
+    if (n == 0) {
+        return;
+    }
+    int16_t mn = sum.minRaw, mx = sum.maxRaw;
+    int64_t s  = 0;
+    size_t  i  = mts4x_reduce_simd(raw, n, mn, mx, s);
+    mts4x_reduce_scalar(raw, i, n, mn, mx, s);
+    sum.count  += (uint32_t)n;
+    sum.minRaw  = mn;
+    sum.maxRaw  = mx;
+    sum.sumRaw += s;
+}
@@ -0,0 +1,69 @@
+// MTS4x Arduino driver - batch conversion and reduction kernels
+// Author: Denis (FedunovDenis)
+
+#ifndef __MTS4X_BATCH_H__
+#define __MTS4X_BATCH_H__
+
+#include "MTS4x.h"
+
+// Kernel implementation, picked at build time from the target flags
+// (-msse2 / -mavx2 / NEON); define MTS4X_BATCH_SIMD to force one.
+// Every path gives bit-identical results to the scalar one.
+//   MTS4X_BATCH_SCALAR - portable C, the only choice on AVR/ESP8266/ESP32
+//   MTS4X_BATCH_SSE2   - 8 samples per step
+//   MTS4X_BATCH_AVX2   - 16 samples per step
+//   MTS4X_BATCH_NEON   - 8 samples per step (ARMv7 NEON / AArch64)
+#define MTS4X_BATCH_SCALAR 0
+#define MTS4X_BATCH_SSE2   1
+#define MTS4X_BATCH_AVX2   2
+#define MTS4X_BATCH_NEON   3
+
+#ifndef MTS4X_BATCH_SIMD
+#if defined(__AVX2__)
+#define MTS4X_BATCH_SIMD MTS4X_BATCH_AVX2
+#elif defined(__SSE2__) || defined(_M_X64)
+#define MTS4X_BATCH_SIMD MTS4X_BATCH_SSE2
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define MTS4X_BATCH_SIMD MTS4X_BATCH_NEON
+#else
+#define MTS4X_BATCH_SIMD MTS4X_BATCH_SCALAR
+#endif
+#endif
+
+// Name of the compiled-in path, for logs and benchmarks
+const char *mts4x_batch_impl();
+
+// Min/max/sum of a span; merge partial results with mts4x_batch_reduce
+// on the next span (the struct accumulates, reset() starts over)
+struct MTS4xBatchSummary {
+    uint32_t count;
+    int16_t  minRaw;
+    int16_t  maxRaw;
+    int64_t  sumRaw;
+
+    MTS4xBatchSummary() { reset(); }
+    void    reset();
+    int16_t meanRaw() const;        // rounded, 0 when empty
+    int32_t meanMilli() const;      // rounded like mts4x_raw_to_milli
+};
+
+#ifndef MTS4X_NO_FLOAT
+// out[i] = MTS4X_RAW_TO_CELSIUS(raw[i]), bit for bit
+void     mts4x_batch_to_celsius(const int16_t *raw, float *out, size_t n);
+#endif
+// out[i] = mts4x_raw_to_milli(raw[i])
+void     mts4x_batch_to_milli(const int16_t *raw, int32_t *out, size_t n);
+// out[i] = sat16(((raw[i] * gainQ14 + 8192) >> 14) + offsetRaw); gain 16384
+// is 1.0, in place (out == raw) is fine. For a gain/offset in °C terms use
+// the raw domain: T' = T * g + o  ->  gain = g, offset = (o + 25 (g - 1)) * 256
+void     mts4x_batch_scale_offset(const int16_t *raw, int16_t *out, size_t n,
+                                  int16_t gainQ14, int16_t offsetRaw);
+// Alarm test like the chip's TH/TL: bit i of mask (LSB first, n/8 rounded
+// up bytes, may be NULL) is set when raw[i] > thRaw or raw[i] < tlRaw.
+// Returns the number of samples outside the limits.
+size_t   mts4x_batch_threshold(const int16_t *raw, size_t n, int16_t thRaw,
+                               int16_t tlRaw, uint8_t *mask);
+// Adds the span to sum (count, min, max, sum)
+void     mts4x_batch_reduce(const int16_t *raw, size_t n, MTS4xBatchSummary &sum);
+
+#endif // __MTS4X_BATCH_H__
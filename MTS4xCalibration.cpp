@@ -0,0 +1,153 @@
+#include "MTS4xCalibration.h"
+#include <string.h>
+
+// Slope fraction bits: |correction span| < 2^9 raw, so slope * (raw - x)
+// stays below 2^31 within a segment
+#define MTS4X_CAL_Q 22
+
+// a / b rounded half away from zero, b > 0
+static int32_t mts4x_cal_div(int32_t a, int32_t b) {
+    return (a >= 0) ? (a + b / 2) / b : -((-a + b / 2) / b);
+}
+
+MTS4xCalibration::MTS4xCalibration() {
+    clear();
+}
+
+void MTS4xCalibration::clear() {
+    expand(NULL, NULL, 0);
+}
+
+bool MTS4xCalibration::setPoints(const int32_t *tMilli, const int32_t *corrMilli,
+                                 uint8_t count) {
+    if (!tMilli || !corrMilli || count == 0 || count > MTS4X_CAL_MAX_POINTS) {
+        return false;
+    }
+    int8_t knot[MTS4X_CAL_MAX_POINTS] = { 0 };
+    int8_t corr[MTS4X_CAL_MAX_POINTS] = { 0 };
+    for (uint8_t i = 0; i < count; ++i) {
+        if (corrMilli[i] < -1000000L || corrMilli[i] > 1000000L) {
+            return false;
+        }
+        int32_t t = mts4x_cal_div(tMilli[i] - 25000, 1000);
+        int32_t c = mts4x_cal_div(corrMilli[i] * (256 / MTS4X_CAL_STEP_RAW), 1000);
+        if (t < -128 || t > 127 || c < -127 || c > 127) {
+            return false;
+        }
+        if (i > 0 && t <= knot[i - 1]) {
+            return false;
+        }
+        knot[i] = (int8_t)t;
+        corr[i] = (int8_t)c;
+    }
+    expand(knot, corr, count);
+    return true;
+}
+
+bool MTS4xCalibration::setOffsetMilli(int32_t corrMilli) {
+    int32_t t = 25000;
+    return setPoints(&t, &corrMilli, 1);
+}
+
+uint8_t MTS4xCalibration::points() const {
+    return _count;
+}
+
+bool MTS4xCalibration::point(uint8_t index, int32_t &tMilli, int32_t &corrMilli) const {
+    if (index >= _count) {
+        return false;
+    }
+    tMilli    = 25000 + (int32_t)(_x[index] / 256) * 1000;
+    corrMilli = mts4x_raw_to_milli((int16_t)_y[index]) - 25000;
+    return true;
+}
+
+void MTS4xCalibration::encode(uint8_t user[10]) const {
+    memset(user, 0, 10);
+    if (_count == 0) {
+        return;
+    }
+    user[0] = (uint8_t)(MTS4X_CAL_MAGIC | _count);
+    for (uint8_t i = 0; i < _count; ++i) {
+        user[1 + 2 * i] = (uint8_t)(int8_t)(_x[i] / 256);
+        user[2 + 2 * i] = (uint8_t)(int8_t)(_y[i] / MTS4X_CAL_STEP_RAW);
+    }
+    user[9] = MTS4xCrc8::compute(user, 9);
+}
+
+bool MTS4xCalibration::decode(const uint8_t user[10]) {
+    uint8_t count = user[0] & 0x0F;
+    if ((user[0] & 0xF0) != MTS4X_CAL_MAGIC || count == 0 ||
+        count > MTS4X_CAL_MAX_POINTS || MTS4xCrc8::compute(user, 9) != user[9]) {
+        return false;
+    }
+    int8_t knot[MTS4X_CAL_MAX_POINTS] = { 0 };
+    int8_t corr[MTS4X_CAL_MAX_POINTS] = { 0 };
+    for (uint8_t i = 0; i < count; ++i) {
+        knot[i] = (int8_t)user[1 + 2 * i];
+        corr[i] = (int8_t)user[2 + 2 * i];
+        if ((i > 0 && knot[i] <= knot[i - 1]) || corr[i] == -128) {
+            return false;
+        }
+    }
+    expand(knot, corr, count);
+    return true;
+}
+
+void MTS4xCalibration::expand(const int8_t *knot, const int8_t *corr, uint8_t count) {
+    _count = count;
+    memset(_x, 0, sizeof(_x));
+    memset(_y, 0, sizeof(_y));
+    memset(_slope, 0, sizeof(_slope));
+    for (uint8_t i = 0; i < _count; ++i) {
+        // Knot byte is °C - 25, i.e. exactly the high byte of the raw code
+        _x[i] = (int16_t)((int32_t)knot[i] * 256);
+        _y[i] = (int16_t)(corr[i] * MTS4X_CAL_STEP_RAW);
+    }
+    for (uint8_t i = 0; i + 1 < _count; ++i) {
+        int32_t dx = (int32_t)_x[i + 1] - _x[i];
+        int32_t dy = (int32_t)_y[i + 1] - _y[i];
+        _slope[i]  = mts4x_cal_div(dy * (1L << MTS4X_CAL_Q), dx);
+    }
+}
+
+int16_t MTS4xCalibration::apply(int16_t raw) const {
+    if (_count == 0) {
+        return raw;
+    }
+    int32_t c;
+    if (raw <= _x[0]) {
+        c = _y[0];
+    } else if (raw >= _x[_count - 1]) {
+        c = _y[_count - 1];
+    } else {
+        uint8_t i = 0;
+        while (raw >= _x[i + 1]) {
+            ++i;
+        }
+        c = _y[i] + ((_slope[i] * (int32_t)(raw - _x[i]) + (1L << (MTS4X_CAL_Q - 1)))
+                     >> MTS4X_CAL_Q);
+    }
+    int32_t out = (int32_t)raw + c;
+    if (out > 32767)  return 32767;
+    if (out < -32768) return -32768;
+    return (int16_t)out;
+}
+
+bool MTS4xCalibration::load(MTS4X &sensor) {
+    uint8_t user[10];
+    bool    crcOk = false;
+    if (!sensor.readScratchExt(user, crcOk) || !crcOk) {
+        return false;
+    }
+    return decode(user);
+}
+
+bool MTS4xCalibration::store(MTS4X &sensor, bool commit) {
+    MTS4xProfile profile;
+    if (!sensor.readProfile(profile)) {
+        return false;
+    }
+    encode(profile.user);
+    return sensor.applyProfile(profile, commit);
+}
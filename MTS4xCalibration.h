@@ -0,0 +1,73 @@
+// MTS4x Arduino driver - multi-point calibration in the user registers
+// Author: Denis (FedunovDenis)
+
+#ifndef __MTS4X_CALIBRATION_H__
+#define __MTS4X_CALIBRATION_H__
+
+#include "MTS4x.h"
+
+#define MTS4X_CAL_MAX_POINTS 4
+// User register 0: magic in the high nibble, number of knots in the low one
+#define MTS4X_CAL_MAGIC      0xA0
+// Correction LSB in raw codes (2/256 °C = 7.8 m°C, range ±0.99 °C)
+#define MTS4X_CAL_STEP_RAW   2
+
+// Piecewise-linear correction (reference - sensor) through up to four
+// knots, packed into the 10 user registers so it travels with the sensor
+// (eepromCopyPage):
+//
+//   [0]    MTS4X_CAL_MAGIC | count
+//   [1..8] count pairs of int8: knot in °C - 25 (= raw >> 8),
+//          correction in MTS4X_CAL_STEP_RAW units; unused pairs 0
+//   [9]    CRC8 of [0..8]
+//
+// decode() expands the knots into per-segment start, offset and Q22 slope,
+// so apply() is a couple of compares, one 32-bit multiply and a shift.
+// Outside the first/last knot the end correction is held, not extrapolated.
+// The whole object is the table: 29 bytes on AVR, 32 on ESP.
+//
+//   MTS4xCalibration cal;
+//   int32_t t[] = { 0, 25000, 60000 }, c[] = { 120, -40, -310 };
+//   cal.setPoints(t, c, 3); cal.store(mts);       // bench, once
+//   cal.load(mts); ... raw = cal.apply(raw);      // every boot / sample
+class MTS4xCalibration {
+  public:
+    MTS4xCalibration();
+
+    void clear();                   // identity, encodes as "no calibration"
+
+    // Knots at sensor temperatures tMilli (rounded to whole °C, strictly
+    // ascending after rounding, -103..+152 °C) with the correction to add
+    // there (m°C, rounded to 7.8 m°C, |corr| <= 992). false leaves the
+    // calibration unchanged.
+    bool setPoints(const int32_t *tMilli, const int32_t *corrMilli, uint8_t count);
+    // Single knot: a constant offset
+    bool setOffsetMilli(int32_t corrMilli);
+
+    uint8_t points() const;
+    bool    point(uint8_t index, int32_t &tMilli, int32_t &corrMilli) const;
+
+    void encode(uint8_t user[10]) const;
+    bool decode(const uint8_t user[10]);    // false: no valid calibration
+
+    // Corrected raw sample, saturated to int16
+    int16_t apply(int16_t raw) const;
+
+    // Read / write the user registers. load() checks the extended scratch
+    // CRC as well as the layout; store() keeps the rest of the chip
+    // configuration and, with commit, copies the page to EEPROM only if
+    // something changed (MTS4X::applyProfile).
+    bool load(MTS4X &sensor);
+    bool store(MTS4X &sensor, bool commit = true);
+
+  private:
+    // Lookup table; the stored bytes are _x >> 8 and _y / MTS4X_CAL_STEP_RAW
+    uint8_t _count;
+    int16_t _x[MTS4X_CAL_MAX_POINTS];       // knot, raw
+    int16_t _y[MTS4X_CAL_MAX_POINTS];       // correction at the knot, raw
+    int32_t _slope[MTS4X_CAL_MAX_POINTS - 1];   // Q22 raw per raw
+
+    void expand(const int8_t *knot, const int8_t *corr, uint8_t count);
+};
+
+#endif // __MTS4X_CALIBRATION_H__
@@ -0,0 +1,114 @@
+#include "MTS4xChangeMonitor.h"
+
+MTS4XChangeMonitor::MTS4XChangeMonitor(MTS4X &sensor)
+: _sensor(sensor),
+  _delta(0),
+  _last(0),
+  _statusPolling(true),
+  _alert(false),
+  _events(0) {
+}
+
+bool MTS4XChangeMonitor::begin(int16_t deltaRaw, TempCfgMPS mps, TempCfgAVG avg) {
+    if (deltaRaw <= 0) {
+        return false;
+    }
+    _delta  = deltaRaw;
+    _alert  = false;
+    _events = 0;
+
+    if (!_sensor.setConfig(mps, avg, false)) {
+        return false;
+    }
+    if (!_sensor.setMode(MEASURE_CONTINUOUS, false)) {
+        return false;
+    }
+    // Alarm outside TL..TH, so both directions trip
+    if (!_sensor.setAlertMode(true, ALERT_MODE_HIGH_TH_LOW_ALARM)) {
+        return false;
+    }
+    // The window must be live on the chip even with deferred shadow writes
+    if (!_sensor.flushShadow()) {
+        return false;
+    }
+    int16_t raw = 0;
+    if (!_sensor.readTemperatureRaw(raw, true)) {
+        return false;
+    }
+    return arm(raw);
+}
+
+bool MTS4XChangeMonitor::beginMilli(int32_t deltaMilliC, TempCfgMPS mps,
+                                    TempCfgAVG avg) {
+    // 1 LSB = 1000/256 m°C; round to nearest, at least one LSB
+    int32_t lsb = (deltaMilliC * 32 + 62) / 125;
+    if (lsb < 1)     lsb = 1;
+    if (lsb > 32767) lsb = 32767;
+    return begin((int16_t)lsb, mps, avg);
+}
+
+void MTS4XChangeMonitor::notifyAlert() {
+    _alert = true;
+}
+
+void MTS4XChangeMonitor::useStatusPolling(bool enable) {
+    _statusPolling = enable;
+}
+
+int16_t MTS4XChangeMonitor::lastRaw() const {
+    return _last;
+}
+
+uint32_t MTS4XChangeMonitor::events() const {
+    return _events;
+}
+
+bool MTS4XChangeMonitor::arm(int16_t center) {
+    int32_t th = (int32_t)center + _delta;
+    int32_t tl = (int32_t)center - _delta;
+    if (th > 32767)  th = 32767;
+    if (tl < -32768) tl = -32768;
+    if (!_sensor.setLimitsRaw((int16_t)th, (int16_t)tl) || !_sensor.flushShadow()) {
+        return false;
+    }
+    _last = center;
+    return true;
+}
+
+bool MTS4XChangeMonitor::poll(int16_t &raw) {
+    if (!_alert) {
+        if (!_statusPolling) {
+            return false;
+        }
+        uint8_t st = 0;
+        if (!_sensor.readStatus(st)) {
+            return false;
+        }
+        if (!(st & (MTS4X_STATUS_ALERT_HIGH | MTS4X_STATUS_ALERT_LOW))) {
+            return false;
+        }
+    }
+
+    // The flag stays set until the window is re-centred: in alarm mode the
+    // ALERT pin holds its level while outside, so no second edge comes and
+    // a failed read or write is retried by the next poll()
+    bool crcOk = false;
+    if (!_sensor.readTemperatureRawWithCrc(raw, crcOk, true) || !crcOk) {
+        return false;
+    }
+    // The alert may come from a sample that has since drifted back
+    int32_t diff = (int32_t)raw - _last;
+    if (diff < 0) diff = -diff;
+    if (diff <= _delta) {
+        _alert = false;
+        return false;
+    }
+    // Cleared before the write so an edge of the new window is not lost
+    _alert = false;
+    if (!arm(raw)) {
+        _alert = true;
+        return false;
+    }
+    ++_events;
+    return true;
+}
@@ -0,0 +1,51 @@
+// MTS4x Arduino driver - report-on-change monitor
+// Author: Denis (FedunovDenis)
+
+#ifndef __MTS4X_CHANGE_MONITOR_H__
+#define __MTS4X_CHANGE_MONITOR_H__
+
+#include "MTS4x.h"
+
+// Event-driven acquisition on top of the chip's alert logic: a TH/TL window
+// of +-delta is kept around the last reported value while the chip runs in
+// continuous mode. Nothing is read until the window trips (ALERT pin or one
+// status byte), then the value is read and the window re-centred with a
+// single burst write of 0x07..0x0A.
+class MTS4XChangeMonitor {
+  public:
+    explicit MTS4XChangeMonitor(MTS4X &sensor);
+
+    // deltaRaw in chip LSB (1/256 °C); mps is the chip's own sample rate.
+    // Reads the current value and arms the first window.
+    bool begin(int16_t deltaRaw, TempCfgMPS mps = MPS_1Hz,
+               TempCfgAVG avg = AVG_8);
+    bool beginMilli(int32_t deltaMilliC, TempCfgMPS mps = MPS_1Hz,
+                    TempCfgAVG avg = AVG_8);
+
+    // Call from the ALERT pin ISR; only sets a flag
+    void notifyAlert();
+
+    // Without an ALERT pin (default), poll() spends one status read per
+    // call. With the pin wired to notifyAlert(), disable it and poll()
+    // stays off the bus until the window trips.
+    void useStatusPolling(bool enable);
+
+    // Returns true and the new value when the window tripped. Costs no bus
+    // traffic while stable when the ALERT pin is used.
+    bool poll(int16_t &raw);
+
+    int16_t  lastRaw() const;
+    uint32_t events() const;
+
+  private:
+    MTS4X           &_sensor;
+    int16_t          _delta;
+    int16_t          _last;
+    bool             _statusPolling;
+    volatile bool    _alert;
+    uint32_t         _events;
+
+    bool arm(int16_t center);
+};
+
+#endif // __MTS4X_CHANGE_MONITOR_H__
@@ -0,0 +1,279 @@
+#include "MTS4xContinuousReader.h"
+#include <string.h>
+
+// Early step = K late steps, so about 1 in K+1 locked reads sees BUSY
+#define MTS4X_CR_K          15
+// The period follows phase corrections scaled down by this gain
+#define MTS4X_CR_IGAIN      64
+// Shortest read spacing while searching (µs)
+#define MTS4X_CR_MIN_STEP   200UL
+// Oscillator tolerance assumed before the period is measured (3%)
+#define MTS4X_CR_TOL_PPM    30000UL
+// Locked reads without a single early one before the lock is doubted
+#define MTS4X_CR_MAX_LATE   (16 * (MTS4X_CR_K + 1))
+// Late step doubles every (K+1)/2 late reads in a row, up to this shift
+#define MTS4X_CR_MAX_BOOST  4
+// Early reads in a row before the lock is dropped
+#define MTS4X_CR_MAX_EARLY  3
+
+enum {
+    MTS4X_CR_IDLE = 0,
+    MTS4X_CR_SEARCH,      // reading every _coarseUs until BUSY shows up
+    MTS4X_CR_FINE,        // BUSY seen, reading every _fineUs until it falls
+    MTS4X_CR_LOCKED
+};
+
+MTS4XContinuousReader::MTS4XContinuousReader(MTS4X &sensor)
+: _sensor(sensor),
+  _state(MTS4X_CR_IDLE),
+  _nominalUs(0),
+  _convUs(0),
+  _fineUs(0),
+  _coarseUs(0),
+  _stepQ8(0),
+  _clock(0),
+  _lastMicros(0),
+  _nextRead(0),
+  _busyAt(0),
+  _edgeQ8(0),
+  _periodQ8(0),
+  _firstEdgeQ8(0),
+  _lastEdgeQ8(0),
+  _periods(0),
+  _haveEdge(false),
+  _earlyRun(0),
+  _lateRun(0),
+  _ageSum(0) {
+    resetStats();
+}
+
+bool MTS4XContinuousReader::begin(TempCfgMPS mps, TempCfgAVG avg) {
+    _state     = MTS4X_CR_IDLE;
+    _nominalUs = 125000UL << ((mps >> 5) & 0x07);
+    _convUs    = mts4x_avg_time_us(avg);
+    _fineUs    = _convUs / 8;
+    _coarseUs  = _convUs / 2;
+    if (_fineUs < MTS4X_CR_MIN_STEP)   _fineUs   = MTS4X_CR_MIN_STEP;
+    if (_coarseUs < MTS4X_CR_MIN_STEP) _coarseUs = MTS4X_CR_MIN_STEP;
+    // K steps span one fine step: locked reads stay within ~_fineUs of the edge
+    _stepQ8    = (_fineUs << 8) / MTS4X_CR_K;
+
+    if (!_sensor.setConfig(mps, avg, false)) {
+        return false;
+    }
+    if (!_sensor.setMode(MEASURE_CONTINUOUS, false)) {
+        return false;
+    }
+    _lastMicros = _sensor.bus().micros();
+    _clock      = 0;
+    _periodQ8   = (uint64_t)_nominalUs << 8;
+    _periods    = 0;
+    _haveEdge   = false;
+    resetStats();
+    search(tick());
+    return true;
+}
+
+void MTS4XContinuousReader::stop() {
+    _state        = MTS4X_CR_IDLE;
+    _stats.locked = false;
+    _sensor.setMode(MEASURE_STOP, false);
+}
+
+uint64_t MTS4XContinuousReader::tick() {
+    uint32_t m = _sensor.bus().micros();
+    _clock     += (uint32_t)(m - _lastMicros);
+    _lastMicros = m;
+    return _clock;
+}
+
+void MTS4XContinuousReader::search(uint64_t at) {
+    _state        = MTS4X_CR_SEARCH;
+    _nextRead     = at;
+    _stats.locked = false;
+}
+
+void MTS4XContinuousReader::onEdge(uint64_t edgeQ8) {
+    if (!_haveEdge) {
+        // Second edge: one nominal period on, within the oscillator tolerance
+        _haveEdge    = true;
+        _firstEdgeQ8 = edgeQ8;
+        _lastEdgeQ8  = edgeQ8;
+        _edgeQ8      = edgeQ8 + _periodQ8;
+        uint64_t window = _convUs + (uint64_t)_nominalUs * MTS4X_CR_TOL_PPM / 1000000UL;
+        search((_edgeQ8 >> 8) - window);
+        return;
+    }
+    if (!fitPeriod(edgeQ8)) {
+        return;
+    }
+    _edgeQ8      = edgeQ8 + _periodQ8;
+    _nextRead    = (_edgeQ8 + 255) >> 8;
+    _earlyRun    = 0;
+    _lateRun     = 0;
+    _state       = MTS4X_CR_LOCKED;
+    _stats.locked = true;
+}
+
+bool MTS4XContinuousReader::fitPeriod(uint64_t edgeQ8) {
+    // Period from the whole baseline: edge uncertainty / number of periods
+    uint32_t n = (uint32_t)(((edgeQ8 - _lastEdgeQ8) + _periodQ8 / 2) / _periodQ8);
+    if (n == 0) {
+        return false;
+    }
+    _periods    += n;
+    _periodQ8    = (edgeQ8 - _firstEdgeQ8) / _periods;
+    _lastEdgeQ8  = edgeQ8;
+    return true;
+}
+
+void MTS4XContinuousReader::deliverAge(uint64_t now, uint64_t edgeQ8) {
+    uint64_t nowQ8 = now << 8;
+    uint32_t age   = (nowQ8 > edgeQ8) ? (uint32_t)((nowQ8 - edgeQ8) >> 8) : 0;
+    _ageSum += age;
+    if (age > _stats.ageMaxUs) {
+        _stats.ageMaxUs = age;
+    }
+    ++_stats.samples;
+}
+
+bool MTS4XContinuousReader::poll(int16_t &raw) {
+    if (_state == MTS4X_CR_IDLE) {
+        return false;
+    }
+    uint64_t now = tick();
+    if (now < _nextRead) {
+        return false;
+    }
+
+    // Came too late: the predicted conversion was already overwritten
+    bool missed = false;
+    if (_state == MTS4X_CR_LOCKED && (now << 8) >= _edgeQ8 + _periodQ8) {
+        uint32_t m = (uint32_t)(((now << 8) - _edgeQ8) / _periodQ8);
+        _stats.missed += m;
+        _edgeQ8       += (uint64_t)m * _periodQ8;
+        missed         = true;
+    }
+
+    bool    crcOk = false;
+    uint8_t st    = 0;
+    uint32_t t0   = _sensor.bus().micros();
+    bool    ok    = _sensor.readTemperatureFrame(raw, crcOk, st);
+    _stats.busUs += _sensor.bus().micros() - t0;
+    ++_stats.reads;
+    now = tick();
+    if (!ok) {
+        _nextRead = now + _fineUs;
+        return false;
+    }
+    bool busy = (st & MTS4X_STATUS_BUSY) != 0;
+
+    switch (_state) {
+        case MTS4X_CR_SEARCH:
+            if (busy) {
+                _state  = MTS4X_CR_FINE;
+                _busyAt = now;
+                _nextRead = now + _fineUs;
+            } else {
+                _nextRead = now + _coarseUs;
+            }
+            return false;
+
+        case MTS4X_CR_FINE:
+            if (busy) {
+                _busyAt   = now;
+                _nextRead = now + _fineUs;
+                return false;
+            }
+            if (!crcOk) {
+                _nextRead = now + MTS4X_CR_MIN_STEP;
+                return false;
+            }
+            // BUSY fell between the last two reads
+            deliverAge(now, (_busyAt + now) << 7);
+            onEdge((_busyAt + now) << 7);
+            return true;
+
+        default:
+            break;
+    }
+
+    // Locked
+    if (busy) {
+        if (missed || ++_earlyRun > MTS4X_CR_MAX_EARLY) {
+            // Phase lost: find the edge of this conversion again
+            ++_stats.relocks;
+            _state        = MTS4X_CR_FINE;
+            _stats.locked = false;
+            _busyAt       = now;
+            _nextRead     = now + _fineUs;
+            return false;
+        }
+        ++_stats.earlyReads;
+        _busyAt    = now;
+        _edgeQ8   += (uint64_t)_stepQ8 * MTS4X_CR_K;
+        _periodQ8 += (uint64_t)_stepQ8 * MTS4X_CR_K / MTS4X_CR_IGAIN;
+        _lateRun   = 0;
+        _nextRead  = now + _fineUs;
+        return false;
+    }
+    if (!crcOk) {
+        // Same sample again shortly, no phase decision on a bad frame
+        _nextRead = now + MTS4X_CR_MIN_STEP;
+        return false;
+    }
+
+    deliverAge(now, _edgeQ8);
+    if (_earlyRun && !missed) {
+        // Early then late read: the edge is bracketed like in FINE
+        fitPeriod((_busyAt + now) << 7);
+    }
+    _earlyRun = 0;
+    if (missed || ++_lateRun > MTS4X_CR_MAX_LATE) {
+        // The newest sample is in hand; look for the next edge again
+        ++_stats.relocks;
+        uint64_t next = (_edgeQ8 + _periodQ8) >> 8;
+        search(next - 2 * (uint64_t)_convUs);
+        _edgeQ8 = (uint64_t)next << 8;
+        return true;
+    }
+    // A long late run means the period is still too long (the first
+    // estimate is only good to a fine step): speed the correction up
+    uint8_t boost = (uint8_t)(_lateRun / ((MTS4X_CR_K + 1) / 2));
+    if (boost > MTS4X_CR_MAX_BOOST) {
+        boost = MTS4X_CR_MAX_BOOST;
+    }
+    _edgeQ8   -= (uint64_t)_stepQ8 << boost;
+    _periodQ8 -= _stepQ8 / MTS4X_CR_IGAIN;
+    _edgeQ8   += _periodQ8;
+    _nextRead  = (_edgeQ8 + 255) >> 8;
+    return true;
+}
+
+uint32_t MTS4XContinuousReader::nextReadInUs() {
+    uint64_t now = tick();
+    if (_state == MTS4X_CR_IDLE || _nextRead <= now) {
+        return 0;
+    }
+    uint64_t d = _nextRead - now;
+    return (d > 0xFFFFFFFFULL) ? 0xFFFFFFFFUL : (uint32_t)d;
+}
+
+bool MTS4XContinuousReader::locked() const {
+    return _state == MTS4X_CR_LOCKED;
+}
+
+void MTS4XContinuousReader::lockStats(MTS4xLockStats &out) const {
+    out           = _stats;
+    out.periodUs  = (uint32_t)((_periodQ8 + 128) >> 8);
+    out.driftPpm  = _nominalUs ? (int32_t)(((int64_t)_periodQ8 - ((int64_t)_nominalUs << 8)) *
+                                           1000000LL / ((int64_t)_nominalUs << 8)) : 0;
+    out.ageAvgUs  = _stats.samples ? (uint32_t)(_ageSum / _stats.samples) : 0;
+}
+
+void MTS4XContinuousReader::resetStats() {
+    bool locked = (_state == MTS4X_CR_LOCKED);
+    memset(&_stats, 0, sizeof(_stats));
+    _stats.locked = locked;
+    _ageSum       = 0;
+}
@@ -0,0 +1,95 @@
+// MTS4x Arduino driver - phase-locked continuous-mode reader
+// Author: Denis (FedunovDenis)
+
+#ifndef __MTS4X_CONTINUOUS_READER_H__
+#define __MTS4X_CONTINUOUS_READER_H__
+
+#include "MTS4x.h"
+
+// Lock quality since begin() / resetStats()
+struct MTS4xLockStats {
+    bool     locked;
+    uint32_t periodUs;      // learned conversion period
+    int32_t  driftPpm;      // learned period vs nominal TempCfgMPS period
+    uint32_t samples;       // new samples delivered
+    uint32_t reads;         // frame reads issued (acquisition included)
+    uint32_t earlyReads;    // locked reads that still saw BUSY
+    uint32_t missed;        // conversions that were never read
+    uint32_t relocks;
+    uint32_t ageAvgUs;      // read time - estimated end of conversion
+    uint32_t ageMaxUs;
+    uint32_t busUs;         // time spent in frame reads
+};
+
+// Continuous mode without BUSY polling: the conversion period and phase
+// are learned from BUSY falling edges, then one frame read (sample, CRC,
+// Status) is scheduled right after each predicted end of conversion.
+//
+// The Status byte of that read is a one-bit phase detector: BUSY still set
+// means early (retry shortly, shift the prediction later by K steps),
+// clear means late (shift earlier by one step). The reads settle just past
+// the edge with about 1/(K+1) early reads. An early read followed by a
+// late one brackets the edge, which refits the period over the whole
+// baseline, so oscillator drift is learned to a few ppm.
+//
+//   MTS4XContinuousReader rd(mts);
+//   rd.begin(MPS_4Hz, AVG_8);
+//   loop: if (rd.poll(raw)) { ... }      // sleep rd.nextReadInUs() between
+//
+// When poll() comes too late and a conversion was overwritten, the newest
+// sample is still delivered, the miss is counted and the phase is searched
+// again around the expected edge (keeping the learned period).
+class MTS4XContinuousReader {
+  public:
+    explicit MTS4XContinuousReader(MTS4X &sensor);
+
+    // Configures the chip and starts continuous conversion
+    bool begin(TempCfgMPS mps, TempCfgAVG avg);
+    void stop();
+
+    // Never waits. Reads the bus only when a read is due; true with a new
+    // sample (CRC checked) in raw.
+    bool poll(int16_t &raw);
+
+    // Time until poll() will touch the bus, for sleeping in between
+    uint32_t nextReadInUs();
+
+    bool locked() const;
+    void lockStats(MTS4xLockStats &out) const;
+    void resetStats();
+
+  private:
+    MTS4X   &_sensor;
+    uint8_t  _state;
+    uint32_t _nominalUs;
+    uint32_t _convUs;
+    uint32_t _fineUs;       // step while BUSY is expected to fall
+    uint32_t _coarseUs;     // step while looking for BUSY
+    uint32_t _stepQ8;       // phase step when locked
+
+    // Extended time base (µs), wrap of micros() handled
+    uint64_t _clock;
+    uint32_t _lastMicros;
+
+    uint64_t _nextRead;
+    uint64_t _busyAt;
+    uint64_t _edgeQ8;       // predicted end of the next conversion, µs Q8
+    uint64_t _periodQ8;
+    uint64_t _firstEdgeQ8;  // long-baseline period fit
+    uint64_t _lastEdgeQ8;
+    uint32_t _periods;
+    bool     _haveEdge;
+    uint8_t  _earlyRun;
+    uint16_t _lateRun;
+
+    MTS4xLockStats _stats;
+    uint64_t       _ageSum;
+
+    uint64_t tick();
+    void     search(uint64_t at);
+    void     onEdge(uint64_t edgeQ8);
+    bool     fitPeriod(uint64_t edgeQ8);
+    void     deliverAge(uint64_t now, uint64_t edgeQ8);
+};
+
+#endif // __MTS4X_CONTINUOUS_READER_H__
@@ -0,0 +1,373 @@
+#include "MTS4xHistory.h"
+#include <string.h>
+
+// -----------------------------------------------------------------------------
+// Block header and code tables
+// -----------------------------------------------------------------------------
+
+#define MTS4X_HB_T0     0
+#define MTS4X_HB_TLAST  4
+#define MTS4X_HB_V0     8
+#define MTS4X_HB_COUNT  10
+#define MTS4X_HB_SHIFT  12
+
+// Payload widths behind the prefixes 0 / 10 / 110 / 1110 / 1111
+static const uint8_t kTimeBits[5]  = { 0, 6, 9, 12, 32 };
+static const uint8_t kValueBits[5] = { 0, 2, 4, 8, 18 };
+
+static void mts4x_put16(uint8_t *p, uint16_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static void mts4x_put32(uint8_t *p, uint32_t v) {
+    mts4x_put16(p, (uint16_t)v);
+    mts4x_put16(p + 2, (uint16_t)(v >> 16));
+}
+
+static uint16_t mts4x_get16(const uint8_t *p) {
+    return (uint16_t)(p[0] | ((uint16_t)p[1] << 8));
+}
+
+static uint32_t mts4x_get32(const uint8_t *p) {
+    return (uint32_t)mts4x_get16(p) | ((uint32_t)mts4x_get16(p + 2) << 16);
+}
+
+static uint32_t mts4x_zigzag(int32_t v) {
+    return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+}
+
+static int32_t mts4x_unzigzag(uint32_t z) {
+    return (int32_t)(z >> 1) ^ -(int32_t)(z & 1);
+}
+
+// Bucket for zz: smallest one whose payload holds it (0 only for zz == 0)
+static uint8_t mts4x_bucket(const uint8_t *bits, uint32_t zz) {
+    if (zz == 0) {
+        return 0;
+    }
+    for (uint8_t b = 1; b < 4; ++b) {
+        if (zz < (1UL << bits[b])) {
+            return b;
+        }
+    }
+    return 4;
+}
+
+// Prefix length: 1, 2, 3, 4, 4
+static uint8_t mts4x_prefix_len(uint8_t bucket) {
+    return (bucket < 4) ? (uint8_t)(bucket + 1) : 4;
+}
+
+static uint32_t mts4x_prefix(uint8_t bucket) {
+    static const uint8_t kPrefix[5] = { 0x0, 0x2, 0x6, 0xE, 0xF };
+    return kPrefix[bucket];
+}
+
+// MSB-first bit reader over one block
+struct MTS4xBitReader {
+    const uint8_t *data;
+    uint32_t       pos;
+    uint32_t       end;
+
+    bool bit(uint8_t &b) {
+        if (pos >= end) {
+            return false;
+        }
+        b = (data[pos >> 3] >> (7 - (pos & 7))) & 1;
+        ++pos;
+        return true;
+    }
+
+    bool bits(uint8_t n, uint32_t &v) {
+        v = 0;
+        for (uint8_t i = 0; i < n; ++i) {
+            uint8_t b;
+            if (!bit(b)) {
+                return false;
+            }
+            v = (v << 1) | b;
+        }
+        return true;
+    }
+
+    bool code(const uint8_t *widths, uint32_t &zz) {
+        uint8_t bucket = 0;
+        uint8_t b      = 1;
+        while (bucket < 4) {
+            if (!bit(b)) {
+                return false;
+            }
+            if (!b) {
+                break;
+            }
+            ++bucket;
+        }
+        return bits(widths[bucket], zz);
+    }
+};
+
+// -----------------------------------------------------------------------------
+// MTS4xHistory
+// -----------------------------------------------------------------------------
+
+MTS4xHistory::MTS4xHistory()
+: _buf(NULL),
+  _blockSize(0),
+  _nBlocks(0),
+  _first(0),
+  _count(0),
+  _shift(0),
+  _spill(NULL),
+  _spillCtx(NULL),
+  _bitPos(0),
+  _lastT(0),
+  _lastDelta(0),
+  _lastQ(0),
+  _samples(0) {
+}
+
+bool MTS4xHistory::begin(uint8_t *buffer, size_t size,
+                         uint16_t blockSize, uint8_t quantShift) {
+    // A block must hold its header and one worst-case sample (4+32+4+18 bits)
+    if (!buffer || blockSize < MTS4X_HISTORY_HEADER + 8 ||
+        size < blockSize || quantShift > 8) {
+        return false;
+    }
+    _buf       = buffer;
+    _blockSize = blockSize;
+    _nBlocks   = (uint16_t)((size / blockSize > 0xFFFF) ? 0xFFFF : size / blockSize);
+    _shift     = quantShift;
+    clear();
+    return true;
+}
+
+void MTS4xHistory::onSpill(MTS4xHistorySpillFn fn, void *ctx) {
+    _spill    = fn;
+    _spillCtx = ctx;
+}
+
+void MTS4xHistory::clear() {
+    _first     = 0;
+    _count     = 0;
+    _bitPos    = 0;
+    _lastT     = 0;
+    _lastDelta = 0;
+    _lastQ     = 0;
+    _samples   = 0;
+}
+
+uint8_t *MTS4xHistory::block(uint16_t i) const {
+    return _buf + (size_t)((_first + i) % _nBlocks) * _blockSize;
+}
+
+void MTS4xHistory::putBits(uint8_t *blk, uint32_t value, uint8_t bits) {
+    uint8_t *stream = blk + MTS4X_HISTORY_HEADER;
+    while (bits--) {
+        uint8_t  b    = (uint8_t)((value >> bits) & 1);
+        uint32_t byte = _bitPos >> 3;
+        uint8_t  mask = (uint8_t)(0x80 >> (_bitPos & 7));
+        if (b) {
+            stream[byte] |= mask;
+        } else {
+            stream[byte] &= (uint8_t)~mask;
+        }
+        ++_bitPos;
+    }
+}
+
+bool MTS4xHistory::openBlock(uint32_t t, int16_t q) {
+    if (_count == _nBlocks) {
+        // Ring full: hand the oldest block out, then reuse it
+        uint8_t *old = block(0);
+        if (_spill) {
+            _spill(old, _blockSize, _spillCtx);
+        }
+        _samples -= mts4x_get16(old + MTS4X_HB_COUNT);
+        _first = (uint16_t)((_first + 1) % _nBlocks);
+        --_count;
+    }
+    uint8_t *blk = block(_count);
+    ++_count;
+
+    mts4x_put32(blk + MTS4X_HB_T0, t);
+    mts4x_put32(blk + MTS4X_HB_TLAST, t);
+    mts4x_put16(blk + MTS4X_HB_V0, (uint16_t)q);
+    mts4x_put16(blk + MTS4X_HB_COUNT, 1);
+    blk[MTS4X_HB_SHIFT] = _shift;
+
+    _bitPos    = 0;
+    _lastT     = t;
+    _lastDelta = 0;
+    _lastQ     = q;
+    ++_samples;
+    return true;
+}
+
+bool MTS4xHistory::append(uint32_t t, int16_t raw) {
+    if (!_buf) {
+        return false;
+    }
+    int16_t q = raw;
+    if (_shift) {
+        q = (int16_t)(((int32_t)raw + (1L << (_shift - 1))) >> _shift);
+    }
+    if (_count == 0) {
+        return openBlock(t, q);
+    }
+    if (t < _lastT) {
+        return false;
+    }
+
+    uint8_t *blk   = block(_count - 1);
+    uint16_t n     = mts4x_get16(blk + MTS4X_HB_COUNT);
+    uint32_t delta = t - _lastT;
+    int64_t  dod   = (int64_t)delta - _lastDelta;
+
+    // Start over in a fresh block when the gap does not fit the code, the
+    // count would wrap or the block is out of room
+    if (delta > 0x7FFFFFFFUL || dod > 0x7FFFFFFFLL || dod < -0x7FFFFFFFLL ||
+        n == 0xFFFF) {
+        return openBlock(t, q);
+    }
+    uint32_t tz = mts4x_zigzag((int32_t)dod);
+    uint32_t vz = mts4x_zigzag((int32_t)q - _lastQ);
+    uint8_t  tb = mts4x_bucket(kTimeBits, tz);
+    uint8_t  vb = mts4x_bucket(kValueBits, vz);
+    uint32_t need = mts4x_prefix_len(tb) + kTimeBits[tb] +
+                    mts4x_prefix_len(vb) + kValueBits[vb];
+    if (_bitPos + need > (uint32_t)(_blockSize - MTS4X_HISTORY_HEADER) * 8) {
+        return openBlock(t, q);
+    }
+
+    putBits(blk, mts4x_prefix(tb), mts4x_prefix_len(tb));
+    putBits(blk, tz, kTimeBits[tb]);
+    putBits(blk, mts4x_prefix(vb), mts4x_prefix_len(vb));
+    putBits(blk, vz, kValueBits[vb]);
+
+    mts4x_put32(blk + MTS4X_HB_TLAST, t);
+    mts4x_put16(blk + MTS4X_HB_COUNT, (uint16_t)(n + 1));
+    _lastT     = t;
+    _lastDelta = (int32_t)delta;
+    _lastQ     = q;
+    ++_samples;
+    return true;
+}
+
+size_t MTS4xHistory::decodeBlock(const uint8_t *blk, size_t len,
+                                 uint32_t from, uint32_t to,
+                                 MTS4xHistorySink sink, void *ctx) {
+    if (!blk || len < MTS4X_HISTORY_HEADER || !sink) {
+        return 0;
+    }
+    uint32_t t     = mts4x_get32(blk + MTS4X_HB_T0);
+    uint32_t tLast = mts4x_get32(blk + MTS4X_HB_TLAST);
+    uint16_t n     = mts4x_get16(blk + MTS4X_HB_COUNT);
+    uint8_t  shift = blk[MTS4X_HB_SHIFT];
+    if (n == 0 || tLast < from || t > to || shift > 8) {
+        return 0;
+    }
+
+    MTS4xBitReader rd;
+    rd.data = blk + MTS4X_HISTORY_HEADER;
+    rd.pos  = 0;
+    rd.end  = (uint32_t)(len - MTS4X_HISTORY_HEADER) * 8;
+
+    int32_t q     = (int16_t)mts4x_get16(blk + MTS4X_HB_V0);
+    int32_t delta = 0;
+    size_t  out   = 0;
+    for (uint16_t i = 0; i < n; ++i) {
+        if (i) {
+            uint32_t tz, vz;
+            if (!rd.code(kTimeBits, tz) || !rd.code(kValueBits, vz)) {
+                break;   // truncated block
+            }
+            delta += mts4x_unzigzag(tz);
+            t     += (uint32_t)delta;
+            q     += mts4x_unzigzag(vz);
+        }
+        if (t > to) {
+            break;
+        }
+        if (t >= from) {
+            // Rounding up at the top of the range can step past int16
+            int32_t raw = q * (1L << shift);
+            if (raw > 32767) {
+                raw = 32767;
+            } else if (raw < -32768) {
+                raw = -32768;
+            }
+            ++out;
+            if (!sink(t, (int16_t)raw, ctx)) {
+                break;
+            }
+        }
+    }
+    return out;
+}
+
+// Stop flag carried through decodeBlock() for read()
+struct MTS4xHistoryRelay {
+    MTS4xHistorySink sink;
+    void            *ctx;
+    bool             stopped;
+};
+
+static bool mts4x_history_relay(uint32_t t, int16_t raw, void *ctx) {
+    MTS4xHistoryRelay *r = (MTS4xHistoryRelay *)ctx;
+    if (!r->sink(t, raw, r->ctx)) {
+        r->stopped = true;
+        return false;
+    }
+    return true;
+}
+
+size_t MTS4xHistory::read(uint32_t from, uint32_t to,
+                          MTS4xHistorySink sink, void *ctx) const {
+    if (!_buf || !sink) {
+        return 0;
+    }
+    MTS4xHistoryRelay relay = { sink, ctx, false };
+    size_t out = 0;
+    for (uint16_t i = 0; i < _count && !relay.stopped; ++i) {
+        out += decodeBlock(block(i), _blockSize, from, to,
+                           mts4x_history_relay, &relay);
+    }
+    return out;
+}
+
+uint32_t MTS4xHistory::samples() const {
+    return _samples;
+}
+
+size_t MTS4xHistory::bytesUsed() const {
+    if (_count == 0) {
+        return 0;
+    }
+    return (size_t)(_count - 1) * _blockSize + MTS4X_HISTORY_HEADER +
+           (_bitPos + 7) / 8;
+}
+
+uint16_t MTS4xHistory::blocks() const {
+    return _count;
+}
+
+uint16_t MTS4xHistory::blockSize() const {
+    return _blockSize;
+}
+
+bool MTS4xHistory::oldest(uint32_t &t) const {
+    if (_count == 0) {
+        return false;
+    }
+    t = mts4x_get32(block(0) + MTS4X_HB_T0);
+    return true;
+}
+
+bool MTS4xHistory::newest(uint32_t &t) const {
+    if (_count == 0) {
+        return false;
+    }
+    t = _lastT;
+    return true;
+}
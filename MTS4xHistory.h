@@ -0,0 +1,88 @@
+// MTS4x Arduino driver - compressed temperature history
+// Author: Denis (FedunovDenis)
+
+#ifndef __MTS4X_HISTORY_H__
+#define __MTS4X_HISTORY_H__
+
+#include "MTS4x.h"
+
+// Default block size in bytes (header included)
+#ifndef MTS4X_HISTORY_BLOCK
+#define MTS4X_HISTORY_BLOCK 256
+#endif
+
+#define MTS4X_HISTORY_HEADER 13
+
+// Decoded sample callback; return false to stop the stream
+typedef bool (*MTS4xHistorySink)(uint32_t t, int16_t raw, void *ctx);
+
+// Called with the oldest block right before it is overwritten
+typedef void (*MTS4xHistorySpillFn)(const uint8_t *block, size_t len, void *ctx);
+
+// Time series of raw samples in a caller-provided RAM buffer, split into
+// fixed-size blocks used as a ring (oldest block dropped or spilled first).
+//
+// Block layout (little endian):
+//   t0 u32 | tLast u32 | v0 i16 | count u16 | quantShift u8 | bit stream
+// Each further sample is two MSB-first codes:
+//   timestamp: zigzag delta-of-delta  0 | 10+6 | 110+9 | 1110+12 | 1111+32 bits
+//   value:     zigzag delta           0 | 10+2 | 110+4 | 1110+8  | 1111+18 bits
+// so a sample at a steady period whose value did not move costs 2 bits.
+// Values change slowly but carry sensor noise, where a first difference
+// is smaller than a second one; timestamps are regular, hence the dod.
+//
+// Timestamps are caller units (seconds since boot, unix time ...) and must
+// not go backwards. quantShift > 0 stores raw >> quantShift (rounded),
+// trading 2^quantShift LSB of resolution for density; 0 is lossless.
+class MTS4xHistory {
+  public:
+    MTS4xHistory();
+
+    bool begin(uint8_t *buffer, size_t size,
+               uint16_t blockSize = MTS4X_HISTORY_BLOCK, uint8_t quantShift = 0);
+    void onSpill(MTS4xHistorySpillFn fn, void *ctx = NULL);
+    void clear();
+
+    // O(1); false if t goes backwards or begin() was not called
+    bool append(uint32_t t, int16_t raw);
+
+    // Streams samples with from <= t <= to, oldest first; returns the
+    // number delivered. Blocks outside the range are skipped unread.
+    size_t read(uint32_t from, uint32_t to, MTS4xHistorySink sink, void *ctx) const;
+
+    // Same for one stand-alone block (e.g. spilled to flash)
+    static size_t decodeBlock(const uint8_t *block, size_t len,
+                              uint32_t from, uint32_t to,
+                              MTS4xHistorySink sink, void *ctx);
+
+    uint32_t samples() const;
+    size_t   bytesUsed() const;     // headers + bit streams in RAM
+    uint16_t blocks() const;
+    uint16_t blockSize() const;
+    bool     oldest(uint32_t &t) const;
+    bool     newest(uint32_t &t) const;
+
+  private:
+    uint8_t            *_buf;
+    uint16_t            _blockSize;
+    uint16_t            _nBlocks;
+    uint16_t            _first;
+    uint16_t            _count;
+    uint8_t             _shift;
+
+    MTS4xHistorySpillFn _spill;
+    void               *_spillCtx;
+
+    // Writer state of the newest block
+    uint32_t            _bitPos;
+    uint32_t            _lastT;
+    int32_t             _lastDelta;
+    int16_t             _lastQ;
+    uint32_t            _samples;
+
+    uint8_t *block(uint16_t i) const;
+    bool     openBlock(uint32_t t, int16_t q);
+    void     putBits(uint8_t *blk, uint32_t value, uint8_t bits);
+};
+
+#endif // __MTS4X_HISTORY_H__
@@ -0,0 +1,278 @@
+#include "MTS4xOversampler.h"
+
+// Quantisation noise of one conversion: 1/12 LSB^2 in Q8
+#define MTS4X_OS_QUANT_Q8 21
+
+static const TempCfgAVG kAvg[4]     = { AVG_1, AVG_8, AVG_16, AVG_32 };
+static const uint8_t    kAvgN[4]    = { 1, 8, 16, 32 };
+
+static uint8_t mts4x_os_index(uint8_t avg) {
+    return (uint8_t)((avg >> 3) & 0x03);
+}
+
+// Standard error in m°C for a per-sample variance (LSB^2 Q8) over n samples:
+//   se^2 = v / 256 / n * (1000 / 256)^2
+static uint32_t mts4x_os_se_milli(uint64_t varQ8, uint32_t n) {
+    return mts4x_isqrt64(varQ8 * 1000000ULL / ((uint64_t)n * 16777216ULL));
+}
+
+MTS4XOversampler::MTS4XOversampler(MTS4X &sensor)
+: _sensor(sensor),
+  _targetQ8(0),
+  _budgetUs(0),
+  _overheadUs(600),
+  _minSamples(2),
+  _maxSamples(32),
+  _mps(MPS_1Hz),
+  _sleep(true),
+  _sigma1Q8(0),
+  _dof(0),
+  _memory(32),
+  _appliedAvg(0xFF),
+  _changes(0),
+  _lastSeMilli(0),
+  _n(0),
+  _prev(0),
+  _sumSqDiff(0),
+  _cycleAvg(AVG_32) {
+    _plan.avg       = AVG_32;
+    _plan.samples   = 2;
+    _plan.costUs    = 0;
+    _plan.seMilli   = 0;
+    _plan.targetMet = false;
+}
+
+bool MTS4XOversampler::begin(uint16_t targetSeMilli, uint32_t budgetUs,
+                             uint8_t minSamples, uint8_t maxSamples) {
+    if (targetSeMilli == 0 || minSamples == 0 || maxSamples < minSamples ||
+        maxSamples > MTS4X_OS_MAX_SAMPLES) {
+        return false;
+    }
+    // (t * 256 / 1000)^2 * 256
+    uint64_t q8 = ((uint64_t)targetSeMilli * targetSeMilli * 16777216ULL + 500000ULL) / 1000000ULL;
+    _targetQ8   = (q8 > 0xFFFFFFFFULL) ? 0xFFFFFFFFUL : (uint32_t)q8;
+    _budgetUs   = budgetUs;
+    _minSamples = minSamples;
+    _maxSamples = maxSamples;
+    _appliedAvg = 0xFF;
+    _changes    = 0;
+    reset();
+    return true;
+}
+
+void MTS4XOversampler::setChipConfig(TempCfgMPS mps, bool sleep) {
+    _mps        = mps;
+    _sleep      = sleep;
+    _appliedAvg = 0xFF;
+}
+
+void MTS4XOversampler::setOverheadUs(uint32_t us) {
+    _overheadUs = us;
+    if (_dof) {
+        replan();
+    }
+}
+
+void MTS4XOversampler::setNoiseMemory(uint16_t dof) {
+    _memory = dof ? dof : 1;
+    if (_dof > _memory) {
+        _dof = _memory;
+    }
+}
+
+void MTS4XOversampler::reset() {
+    _sigma1Q8    = 0;
+    _dof         = 0;
+    _lastSeMilli = 0;
+    _n           = 0;
+    _sumSqDiff   = 0;
+
+    // No estimate yet: the most averaging per sample
+    _plan.avg       = AVG_32;
+    _plan.samples   = _minSamples;
+    _plan.costUs    = _minSamples * (mts4x_avg_time_us(AVG_32) + _overheadUs);
+    _plan.seMilli   = 0;
+    _plan.targetMet = false;
+}
+
+bool MTS4XOversampler::apply() {
+    _n         = 0;
+    _sumSqDiff = 0;
+    _cycleAvg  = (uint8_t)_plan.avg;
+    if (_appliedAvg == (uint8_t)_plan.avg) {
+        return true;
+    }
+    if (!_sensor.setConfig(_mps, _plan.avg, _sleep)) {
+        return false;
+    }
+    _appliedAvg = (uint8_t)_plan.avg;
+    return true;
+}
+
+void MTS4XOversampler::add(int16_t raw) {
+    if (_n) {
+        int32_t d = (int32_t)raw - _prev;
+        _sumSqDiff += (uint64_t)((int64_t)d * d);
+    }
+    _prev = raw;
+    if (_n < 0xFF) {
+        ++_n;
+    }
+}
+
+bool MTS4XOversampler::endCycle() {
+    if (_n < 2) {
+        return false;
+    }
+    uint8_t  i   = mts4x_os_index(_cycleAvg);
+    uint16_t dof = (uint16_t)(_n - 1);
+
+    // Per-sample variance from successive differences: E[d^2] = 2 * var
+    uint64_t v = (_sumSqDiff * 256ULL + dof) / (2ULL * dof);
+    _lastSeMilli = mts4x_os_se_milli(v, _n);
+
+    // Back to one AVG_1 conversion, quantisation removed
+    uint64_t s1 = (v > MTS4X_OS_QUANT_Q8) ? (v - MTS4X_OS_QUANT_Q8) * kAvgN[i] : 0;
+    if (s1 > 0xFFFFFFFFULL) {
+        s1 = 0xFFFFFFFFULL;
+    }
+    // Degrees-of-freedom weighted running estimate, horizon _memory
+    uint32_t total = (uint32_t)_dof + dof;
+    _sigma1Q8 = (uint32_t)(((uint64_t)_sigma1Q8 * _dof + s1 * dof + total / 2) / total);
+    _dof      = (uint16_t)((total > _memory) ? _memory : total);
+
+    MTS4xOversamplePlan old = _plan;
+    replan();
+    return old.avg != _plan.avg || old.samples != _plan.samples;
+}
+
+// Candidate for one AVG setting: smallest n meeting the target
+// (fits = within the budget) or, when it cannot, as many as the budget allows
+static void mts4x_os_candidate(uint32_t sigma1Q8, uint8_t i, uint32_t targetQ8,
+                               uint32_t budgetUs, uint32_t overheadUs,
+                               uint8_t minN, uint8_t maxN,
+                               uint32_t &n, uint32_t &cost, uint64_t &va,
+                               bool &meets, bool &fits) {
+    uint32_t shotUs = mts4x_avg_time_us(kAvg[i]) + overheadUs;
+    va = (uint64_t)sigma1Q8 / kAvgN[i] + MTS4X_OS_QUANT_Q8;
+    uint64_t need = (va + targetQ8 - 1) / targetQ8;
+    uint32_t room = budgetUs / shotUs;
+    if (room > maxN) {
+        room = maxN;
+    }
+    if (need < minN) {
+        need = minN;
+    }
+    meets = need <= room;
+    n     = meets ? (uint32_t)need : room;
+    if (n < minN) {
+        n = minN;
+    }
+    fits = (uint64_t)n * shotUs <= budgetUs;
+    cost = n * shotUs;
+}
+
+void MTS4XOversampler::replan() {
+    // Ranking: meets the target and fits the budget, cheapest first; else
+    // fits the budget, lowest error first; else cheapest
+    int8_t   best     = -1;
+    uint8_t  bestRank = 0;
+    uint32_t bestN    = 0;
+    uint32_t bestCost = 0;
+    uint64_t bestVarN = 0;   // variance of the mean << 16
+    uint64_t bestVa   = 0;
+
+    for (uint8_t i = 0; i < 4; ++i) {
+        uint32_t n, cost;
+        uint64_t va;
+        bool     meets, fits;
+        mts4x_os_candidate(_sigma1Q8, i, _targetQ8, _budgetUs, _overheadUs,
+                           _minSamples, _maxSamples, n, cost, va, meets, fits);
+        uint8_t  rank = (meets && fits) ? 2 : (fits ? 1 : 0);
+        uint64_t varN = (va << 16) / n;
+        bool better;
+        if (best < 0 || rank > bestRank) {
+            better = true;
+        } else if (rank < bestRank) {
+            better = false;
+        } else if (rank == 1) {
+            better = varN < bestVarN || (varN == bestVarN && cost < bestCost);
+        } else {
+            better = cost < bestCost || (cost == bestCost && varN < bestVarN);
+        }
+        if (better) {
+            best     = (int8_t)i;
+            bestRank = rank;
+            bestN    = n;
+            bestCost = cost;
+            bestVarN = varN;
+            bestVa   = va;
+        }
+    }
+
+    // Hysteresis, downwards only: a plan that still meets the target is
+    // left for a cheaper one only if that is 20% cheaper and meets the
+    // target with 20% of variance to spare. Failing plans switch at once.
+    uint8_t  cur     = mts4x_os_index((uint8_t)_plan.avg);
+    uint32_t curCost = _plan.samples * (mts4x_avg_time_us(kAvg[cur]) + _overheadUs);
+    uint64_t curVa   = (uint64_t)_sigma1Q8 / kAvgN[cur] + MTS4X_OS_QUANT_Q8;
+    if (bestRank == 2 && _plan.samples >= _minSamples && _plan.samples <= _maxSamples &&
+        curCost <= _budgetUs && curVa <= (uint64_t)_targetQ8 * _plan.samples &&
+        ((uint64_t)bestCost * 5 > (uint64_t)curCost * 4 ||
+         bestVa * 5 > (uint64_t)_targetQ8 * 4 * bestN)) {
+        best     = (int8_t)cur;
+        bestN    = _plan.samples;
+        bestCost = curCost;
+        bestVa   = curVa;
+    }
+
+    if (kAvg[best] != _plan.avg || bestN != _plan.samples) {
+        ++_changes;
+    }
+    _plan.avg       = kAvg[best];
+    _plan.samples   = (uint8_t)bestN;
+    _plan.costUs    = bestCost;
+    _plan.seMilli   = mts4x_os_se_milli(bestVa, bestN);
+    _plan.targetMet = (bestVa <= (uint64_t)_targetQ8 * bestN) && bestCost <= _budgetUs;
+}
+
+bool MTS4XOversampler::read(MTS4xMoments &out) {
+    out.reset();
+    if (!apply()) {
+        return false;
+    }
+    for (uint8_t i = 0; i < _plan.samples; ++i) {
+        if (!_sensor.startSingleMessurement()) {
+            continue;
+        }
+        int16_t raw   = 0;
+        bool    crcOk = false;
+        if (!_sensor.readTemperatureRawWithCrc(raw, crcOk, true) || !crcOk) {
+            continue;
+        }
+        add(raw);
+        out.add(raw);
+    }
+    endCycle();
+    return out.count() > 0;
+}
+
+const MTS4xOversamplePlan &MTS4XOversampler::plan() const {
+    return _plan;
+}
+
+bool MTS4XOversampler::hasEstimate() const {
+    return _dof > 0;
+}
+
+uint32_t MTS4XOversampler::noiseMilli() const {
+    return mts4x_os_se_milli(_sigma1Q8, 1);
+}
+
+uint32_t MTS4XOversampler::achievedSeMilli() const {
+    return _lastSeMilli;
+}
+
+uint32_t MTS4XOversampler::planChanges() const {
+    return _changes;
+}
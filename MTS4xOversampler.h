@@ -0,0 +1,92 @@
+// MTS4x Arduino driver - adaptive oversampling
+// Author: Denis (FedunovDenis)
+
+#ifndef __MTS4X_OVERSAMPLER_H__
+#define __MTS4X_OVERSAMPLER_H__
+
+#include "MTS4x.h"
+#include "MTS4xAggregator.h"
+
+// Upper bound for host-side single shots per reading
+#ifndef MTS4X_OS_MAX_SAMPLES
+#define MTS4X_OS_MAX_SAMPLES 64
+#endif
+
+// One reading: samples single shots at the given TempCfgAVG
+struct MTS4xOversamplePlan {
+    TempCfgAVG avg;
+    uint8_t    samples;
+    uint32_t   costUs;      // conversions + bus overhead for one reading
+    uint32_t   seMilli;     // expected standard error of the reading mean
+    bool       targetMet;   // false: best effort within the latency budget
+};
+
+// Picks the cheapest TempCfgAVG x sample count whose standard error meets
+// a target, within a time budget per reading. The noise of one AVG_1
+// conversion is estimated online from successive differences inside each
+// reading (insensitive to a slow trend) and scaled by 1/sqrt(N) for the
+// on-chip average; 1/12 LSB^2 of quantisation noise is part of the model.
+//
+//   MTS4XOversampler os(mts);
+//   os.begin(10, 100000);           // 0.01 °C within 100 ms
+//   os.read(m);                     // plan -> setConfig -> single shots
+//
+// Before the first estimate the plan is AVG_32 x minSamples. minSamples
+// below 2 leaves the estimate frozen while the plan takes one sample.
+// MPS only matters in continuous mode and is passed through unchanged.
+class MTS4XOversampler {
+  public:
+    explicit MTS4XOversampler(MTS4X &sensor);
+
+    bool begin(uint16_t targetSeMilli, uint32_t budgetUs,
+               uint8_t minSamples = 2, uint8_t maxSamples = 32);
+    void setChipConfig(TempCfgMPS mps, bool sleep);
+    void setOverheadUs(uint32_t us);         // bus time per single shot, default 600
+    void setNoiseMemory(uint16_t dof);       // estimate horizon, default 32
+    void reset();                            // forget the noise estimate
+
+    // One reading with the current plan; CRC failures are skipped.
+    // Updates the estimate and the plan for the next call.
+    bool read(MTS4xMoments &out);
+
+    // Same steps for custom acquisition: apply() writes TempCfgAVG when
+    // the plan changed it, then plan().samples x add(), then endCycle().
+    bool apply();
+    void add(int16_t raw);
+    bool endCycle();                         // true if the plan changed
+
+    const MTS4xOversamplePlan &plan() const;
+    bool     hasEstimate() const;
+    uint32_t noiseMilli() const;             // sigma of one AVG_1 conversion
+    uint32_t achievedSeMilli() const;        // sigma / sqrt(n) of the last reading
+    uint32_t planChanges() const;
+
+  private:
+    MTS4X              &_sensor;
+    uint32_t            _targetQ8;      // target variance of the mean, LSB^2 Q8
+    uint32_t            _budgetUs;
+    uint32_t            _overheadUs;
+    uint8_t             _minSamples;
+    uint8_t             _maxSamples;
+    TempCfgMPS          _mps;
+    bool                _sleep;
+
+    uint32_t            _sigma1Q8;      // AVG_1 variance estimate, LSB^2 Q8
+    uint16_t            _dof;
+    uint16_t            _memory;
+
+    MTS4xOversamplePlan _plan;
+    uint8_t             _appliedAvg;    // 0xFF = not written yet
+    uint32_t            _changes;
+    uint32_t            _lastSeMilli;
+
+    // Current reading
+    uint8_t             _n;
+    int16_t             _prev;
+    uint64_t            _sumSqDiff;
+    uint8_t             _cycleAvg;
+
+    void replan();
+};
+
+#endif // __MTS4X_OVERSAMPLER_H__
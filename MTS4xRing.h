@@ -0,0 +1,163 @@
+// MTS4x Arduino driver - lock-free sample ring
+// Author: Denis (FedunovDenis)
+
+#ifndef __MTS4X_RING_H__
+#define __MTS4X_RING_H__
+
+#include <Arduino.h>
+
+// One timestamped reading as pushed by the acquisition side
+typedef struct {
+    uint32_t timestampUs;  // micros() at read time
+    int16_t  raw;          // chip raw value, see MTS4X_RAW_TO_CELSIUS
+    uint8_t  status;       // Status register (0x03) from the same frame
+    bool     crcOk;
+} MTS4xSample;
+
+// What push() does when the consumer falls behind
+typedef enum {
+    MTS4X_RING_DROP_NEWEST      = 0, // keep old samples, count the new one as dropped
+    MTS4X_RING_OVERWRITE_OLDEST = 1  // always accept, consumer skips what was overwritten
+} MTS4xRingPolicy;
+
+// Indices run free over 32 bits on every target, so a consumer lapped any
+// number of times still finds out by how much. AVR has no 32-bit atomic
+// access and the other side may be an ISR: index accesses briefly mask
+// interrupts there, and being single core, fences are compiler barriers.
+typedef uint32_t mts4x_ring_index_t;
+#if defined(__AVR__)
+static inline mts4x_ring_index_t mts4x_ring_load(const volatile mts4x_ring_index_t *p) {
+    uint8_t sreg = SREG;
+    cli();
+    mts4x_ring_index_t v = *p;
+    SREG = sreg;
+    __asm__ __volatile__("" ::: "memory");
+    return v;
+}
+static inline void mts4x_ring_store(volatile mts4x_ring_index_t *p, mts4x_ring_index_t v) {
+    __asm__ __volatile__("" ::: "memory");
+    uint8_t sreg = SREG;
+    cli();
+    *p = v;
+    SREG = sreg;
+}
+#define MTS4X_RING_LOAD_ACQ(x)     mts4x_ring_load(&(x))
+#define MTS4X_RING_LOAD_RLX(x)     mts4x_ring_load(&(x))
+#define MTS4X_RING_STORE_RLX(x, v) mts4x_ring_store(&(x), (v))
+#define MTS4X_RING_STORE_REL(x, v) mts4x_ring_store(&(x), (v))
+#define MTS4X_RING_FENCE_REL()     __asm__ __volatile__("" ::: "memory")
+#define MTS4X_RING_FENCE_ACQ()     __asm__ __volatile__("" ::: "memory")
+#else
+#define MTS4X_RING_LOAD_ACQ(x)     __atomic_load_n(&(x), __ATOMIC_ACQUIRE)
+#define MTS4X_RING_LOAD_RLX(x)     __atomic_load_n(&(x), __ATOMIC_RELAXED)
+#define MTS4X_RING_STORE_RLX(x, v) __atomic_store_n(&(x), (v), __ATOMIC_RELAXED)
+#define MTS4X_RING_STORE_REL(x, v) __atomic_store_n(&(x), (v), __ATOMIC_RELEASE)
+#define MTS4X_RING_FENCE_REL()     __atomic_thread_fence(__ATOMIC_RELEASE)
+#define MTS4X_RING_FENCE_ACQ()     __atomic_thread_fence(__ATOMIC_ACQUIRE)
+#endif
+
+// Single-producer / single-consumer ring of MTS4xSample, no locks and no
+// allocation. push() is for exactly one producer (task or ISR), pop() and
+// popBatch() for exactly one consumer. N must be a power of two.
+//
+// With MTS4X_RING_OVERWRITE_OLDEST the producer never waits: the consumer
+// detects that it was lapped, skips the lost samples (overwritten()) and
+// discards a copy the producer may have torn. Like a seqlock, the producer
+// claims a slot before writing it and the consumer checks the claim after
+// its copy. Up to N-1 unread samples are
+// kept in that mode, N with MTS4X_RING_DROP_NEWEST.
+template <uint16_t N>
+class MTS4xSampleRing {
+    static_assert(N >= 2 && (N & (N - 1)) == 0, "N must be a power of two");
+
+  public:
+    explicit MTS4xSampleRing(MTS4xRingPolicy policy = MTS4X_RING_DROP_NEWEST)
+    : _head(0), _claim(0), _tail(0), _dropped(0), _overwritten(0), _policy(policy) {}
+
+    // Producer side. Returns false if the sample was dropped.
+    bool push(const MTS4xSample &s) {
+        mts4x_ring_index_t h = MTS4X_RING_LOAD_RLX(_head);
+        if (_policy == MTS4X_RING_DROP_NEWEST) {
+            mts4x_ring_index_t t = MTS4X_RING_LOAD_ACQ(_tail);
+            if ((mts4x_ring_index_t)(h - t) >= N) {
+                _dropped = _dropped + 1;
+                return false;
+            }
+        } else {
+            // Claim first: a consumer copying this slot sees the claim
+            // once it may have seen any byte of the new sample
+            MTS4X_RING_STORE_RLX(_claim, (mts4x_ring_index_t)(h + 1));
+            MTS4X_RING_FENCE_REL();
+        }
+        _buf[h & (N - 1)] = s;
+        MTS4X_RING_STORE_REL(_head, (mts4x_ring_index_t)(h + 1));
+        return true;
+    }
+
+    // Consumer side. Returns false if the ring is empty.
+    bool pop(MTS4xSample &out) {
+        return popBatch(&out, 1) == 1;
+    }
+
+    // Consumer side: drain up to max samples in order, returns the count
+    size_t popBatch(MTS4xSample *out, size_t max) {
+        mts4x_ring_index_t t = MTS4X_RING_LOAD_RLX(_tail);
+        size_t n = 0;
+
+        while (n < max) {
+            mts4x_ring_index_t h = MTS4X_RING_LOAD_ACQ(_head);
+            if (h == t) {
+                break;
+            }
+            if (_policy == MTS4X_RING_OVERWRITE_OLDEST &&
+                (mts4x_ring_index_t)(h - t) >= N) {
+                // Lapped: the slot at h - N may be under write right now
+                mts4x_ring_index_t skip = (mts4x_ring_index_t)(h - t - (N - 1));
+                _overwritten = _overwritten + skip;
+                t = (mts4x_ring_index_t)(t + skip);
+            }
+
+            out[n] = _buf[t & (N - 1)];
+
+            if (_policy == MTS4X_RING_OVERWRITE_OLDEST) {
+                // Valid only if the producer did not claim this slot meanwhile
+                MTS4X_RING_FENCE_ACQ();
+                mts4x_ring_index_t c = MTS4X_RING_LOAD_RLX(_claim);
+                if ((mts4x_ring_index_t)(c - t) > N) {
+                    continue;
+                }
+            }
+            t = (mts4x_ring_index_t)(t + 1);
+            ++n;
+        }
+
+        MTS4X_RING_STORE_REL(_tail, t);
+        return n;
+    }
+
+    // Approximate fill level (exact when called from either side at rest)
+    size_t size() const {
+        mts4x_ring_index_t d = (mts4x_ring_index_t)(MTS4X_RING_LOAD_ACQ(_head) -
+                                                    MTS4X_RING_LOAD_ACQ(_tail));
+        return (d > N) ? N : d;
+    }
+
+    static size_t capacity() { return N; }
+
+    MTS4xRingPolicy policy() const { return _policy; }
+
+    // Loss counters (statistics, not synchronised beyond word access)
+    uint32_t dropped() const     { return _dropped; }
+    uint32_t overwritten() const { return _overwritten; }
+
+  private:
+    MTS4xSample                 _buf[N];
+    volatile mts4x_ring_index_t _head;         // written by producer only
+    volatile mts4x_ring_index_t _claim;        // producer, slot being written + 1
+    volatile mts4x_ring_index_t _tail;         // written by consumer only
+    volatile uint32_t           _dropped;      // producer only
+    volatile uint32_t           _overwritten;  // consumer only
+    const MTS4xRingPolicy       _policy;
+};
+
+#endif // __MTS4X_RING_H__
@@ -0,0 +1,494 @@
+// Host builds only (see MTS4xSim.h); empty in a sketch
+#if defined(MTS4X_HOST) || !defined(ARDUINO)
+
+#include "MTS4xSim.h"
+#include <string.h>
+
+// Default EEPROM image for 0x04..0x15 (Crc_Scratch slot unused):
+// stop mode, 1 Hz / AVG_8, alert off, TH = max, TL = min, user = 0
+static const uint8_t kSimEepromDefault[18] = {
+    0x40, 0x68, 0x00, 0xFF, 0x7F, 0x00, 0x80, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
+};
+
+// Device ID and ROM code bytes (0x18..0x1E) reported by the model
+static const uint8_t kSimRomCode[7] = {
+    0x34, 0x4D, 0x11, 0x22, 0x33, 0x44, 0x55
+};
+
+MTS4xSimDevice::MTS4xSimDevice(uint8_t address)
+: _addr(address),
+  _ppm(0),
+  _now(0),
+  _callCost(1),
+  _clockHz(400000UL),
+  _tempRaw(0),
+  _noise(0),
+  _oscPpm(0),
+  _rng(0x12345678UL),
+  _converting(false),
+  _convEnd(0),
+  _lastConvEnd(0),
+  _continuous(false),
+  _nextConv(0),
+  _eeBusyUntil(0),
+  _alertHigh(false),
+  _alertLow(false),
+  _transactions(0),
+  _bytes(0),
+  _busTime(0),
+  _statusReads(0),
+  _conversions(0),
+  _eeWrites(0),
+  _busClears(0),
+  _nakLeft(0),
+  _stuckClocks(0) {
+    memcpy(_eeprom, kSimEepromDefault, sizeof(_eeprom));
+    powerOn();
+}
+
+// -----------------------------------------------------------------------------
+// MTS4xBus
+// -----------------------------------------------------------------------------
+
+bool MTS4xSimDevice::begin(int32_t sda, int32_t scl) {
+    (void)sda;
+    (void)scl;
+    return true;
+}
+
+void MTS4xSimDevice::setClock(uint32_t hz) {
+    _clockHz = hz ? hz : 100000UL;
+}
+
+// A failed transaction: the address byte is not acknowledged, or with SDA
+// held low no START can be made (the master gives up after one byte time)
+bool MTS4xSimDevice::faulted() {
+    if (_stuckClocks) {
+        busCycle(1, 1);
+        return true;
+    }
+    if (_nakLeft) {
+        --_nakLeft;
+        busCycle(1, 2);
+        return true;
+    }
+    return false;
+}
+
+bool MTS4xSimDevice::recover(uint32_t hz) {
+    // Same steps as MTS4xWireBus::recover(), 5 us per line change: release
+    // both lines, up to 9 pulses while SDA is low, STOP, begin again
+    uint8_t pulses = 0;
+    while (_stuckClocks && pulses < 9) {
+        --_stuckClocks;
+        ++pulses;
+    }
+    uint64_t us = 10 + (uint64_t)pulses * 10 + 20 + 20;
+    _now += us;
+    ++_busClears;
+    setClock(hz);
+    update();
+    return _stuckClocks == 0;
+}
+
+bool MTS4xSimDevice::writeRegs(uint8_t addr, uint8_t reg,
+                               const uint8_t *data, size_t len) {
+    update();
+    if (faulted()) {
+        return false;
+    }
+    if (addr != _addr) {
+        busCycle(1, 2);   // address NAK
+        return false;
+    }
+    for (size_t i = 0; i < len; ++i) {
+        writeReg((uint8_t)(reg + i), data[i]);
+    }
+    busCycle(2 + len, 2);
+    update();
+    return true;
+}
+
+bool MTS4xSimDevice::readRegs(uint8_t addr, uint8_t reg,
+                              uint8_t *data, size_t len) {
+    update();
+    if (faulted()) {
+        return false;
+    }
+    if (addr != _addr) {
+        busCycle(1, 2);
+        return false;
+    }
+    refreshDerived();
+    for (size_t i = 0; i < len; ++i) {
+        data[i] = readReg((uint8_t)(reg + i));
+    }
+    if (reg <= MTS4X_STATUS && reg + len > MTS4X_STATUS) {
+        ++_statusReads;
+    }
+    busCycle(3 + len, 3);
+    update();
+    return true;
+}
+
+uint32_t MTS4xSimDevice::millis() {
+    _now += _callCost;
+    return (uint32_t)(_now / 1000ULL);
+}
+
+uint32_t MTS4xSimDevice::micros() {
+    _now += _callCost;
+    return (uint32_t)_now;
+}
+
+void MTS4xSimDevice::delay(uint32_t ms) {
+    advanceUs(ms * 1000UL);
+}
+
+// -----------------------------------------------------------------------------
+// Clock and physical model
+// -----------------------------------------------------------------------------
+
+uint64_t MTS4xSimDevice::nowUs() const {
+    return _now;
+}
+
+void MTS4xSimDevice::advanceUs(uint32_t us) {
+    _now += us;
+    update();
+}
+
+void MTS4xSimDevice::setCallCostUs(uint32_t us) {
+    _callCost = us;
+}
+
+void MTS4xSimDevice::setTemperatureRaw(int32_t raw) {
+    _tempRaw = raw;
+}
+
+void MTS4xSimDevice::setTemperatureMilli(int32_t mC) {
+    _tempRaw = mts4x_milli_to_raw(mC);
+}
+
+void MTS4xSimDevice::setNoise(uint16_t sigmaRaw) {
+    _noise = sigmaRaw;
+}
+
+void MTS4xSimDevice::setOscillatorPpm(int32_t ppm) {
+    _oscPpm = ppm;
+}
+
+void MTS4xSimDevice::setSeed(uint32_t seed) {
+    _rng = seed ? seed : 1;
+}
+
+void MTS4xSimDevice::powerOn() {
+    memset(_regs, 0, sizeof(_regs));
+    memcpy(&_regs[MTS4X_DEVICE_ID_LSB], kSimRomCode, sizeof(kSimRomCode));
+    _ppm        = 0;
+    _converting = false;
+    _continuous = false;
+    _alertHigh  = false;
+    _alertLow   = false;
+    _regs[MTS4X_CRC_TEMP] = MTS4xCrc8::compute(_regs, 2);
+    recall();
+}
+
+uint32_t MTS4xSimDevice::convTimeUs() const {
+    uint32_t t;
+    switch (_regs[MTS4X_TEMP_CFG] & 0x18) {
+        case AVG_1:  t = 2200UL;  break;
+        case AVG_8:  t = 5200UL;  break;
+        case AVG_16: t = 8500UL;  break;
+        default:     t = 15300UL; break;
+    }
+    return (uint32_t)((int64_t)t * (1000000L + _oscPpm) / 1000000L);
+}
+
+uint32_t MTS4xSimDevice::periodUs() const {
+    uint32_t p = 125000UL << ((_regs[MTS4X_TEMP_CFG] >> 5) & 0x07);
+    return (uint32_t)((int64_t)p * (1000000L + _oscPpm) / 1000000L);
+}
+
+// Approximately normal, unit = 65536 (sum of 12 uniforms, Irwin-Hall)
+int32_t MTS4xSimDevice::gaussian() {
+    int32_t sum = 0;
+    for (uint8_t i = 0; i < 12; ++i) {
+        _rng ^= _rng << 13;
+        _rng ^= _rng >> 17;
+        _rng ^= _rng << 5;
+        sum += (int32_t)(_rng >> 16);
+    }
+    return sum - 12 * 32768;
+}
+
+// -----------------------------------------------------------------------------
+// Conversion engine
+// -----------------------------------------------------------------------------
+
+void MTS4xSimDevice::update() {
+    for (;;) {
+        if (_converting && _now >= _convEnd) {
+            finishConversion();
+            continue;
+        }
+        if (_continuous && !_converting && _now >= _nextConv) {
+            uint32_t period = periodUs();
+            // Long idle stretches: skip conversions nobody could observe
+            if (_now - _nextConv > 2ULL * period) {
+                _nextConv += ((_now - _nextConv) / period - 1) * period;
+            }
+            startConversion(_nextConv);
+            _nextConv += period;
+            continue;
+        }
+        break;
+    }
+}
+
+void MTS4xSimDevice::startConversion(uint64_t at) {
+    _converting = true;
+    _convEnd    = at + convTimeUs();
+}
+
+void MTS4xSimDevice::finishConversion() {
+    _converting  = false;
+    _lastConvEnd = _convEnd;
+    ++_conversions;
+
+    int32_t t = _tempRaw;
+    if (_noise) {
+        // On-chip averaging of N samples reduces noise by sqrt(N)
+        static const uint16_t kInvSqrtN[4] = { 65535, 23170, 16384, 11585 };
+        int64_t n = (int64_t)gaussian() * _noise;
+        n = n * kInvSqrtN[(_regs[MTS4X_TEMP_CFG] >> 3) & 0x03] / 65536 / 65536;
+        t += (int32_t)n;
+    }
+    if (t > 32767)  t = 32767;
+    if (t < -32768) t = -32768;
+
+    _regs[MTS4X_TEMP_LSB] = (uint8_t)(t & 0xFF);
+    _regs[MTS4X_TEMP_MSB] = (uint8_t)((t >> 8) & 0xFF);
+    _regs[MTS4X_CRC_TEMP] = MTS4xCrc8::compute(_regs, 2);
+    evalAlert((int16_t)t);
+
+    // Single shot falls back to stop once done
+    if ((_regs[MTS4X_TEMP_CMD] & 0xC0) == 0xC0) {
+        _regs[MTS4X_TEMP_CMD] = (uint8_t)((_regs[MTS4X_TEMP_CMD] & 0x3F) | 0x40);
+    }
+}
+
+void MTS4xSimDevice::evalAlert(int16_t t) {
+    uint8_t mode = _regs[MTS4X_ALERT_MODE];
+    if (!(mode & 0x80)) {
+        _alertHigh = false;
+        _alertLow  = false;
+        return;
+    }
+    int16_t th = (int16_t)(((uint16_t)_regs[MTS4X_TH_MSB] << 8) | _regs[MTS4X_TH_LSB]);
+    int16_t tl = (int16_t)(((uint16_t)_regs[MTS4X_TL_MSB] << 8) | _regs[MTS4X_TL_LSB]);
+    if (mode & 0x40) {
+        // Alarm outside TL..TH
+        _alertHigh = (t > th);
+        _alertLow  = (t < tl);
+    } else {
+        // Above TH sets, below TL clears
+        if (t > th) {
+            _alertHigh = true;
+        } else if (t < tl) {
+            _alertHigh = false;
+        }
+        _alertLow = false;
+    }
+}
+
+void MTS4xSimDevice::refreshDerived() {
+    int16_t th = (int16_t)(((uint16_t)_regs[MTS4X_TH_MSB] << 8) | _regs[MTS4X_TH_LSB]);
+    int16_t tl = (int16_t)(((uint16_t)_regs[MTS4X_TL_MSB] << 8) | _regs[MTS4X_TL_LSB]);
+
+    uint8_t st = 0;
+    if (_alertHigh)                                  st |= MTS4X_STATUS_ALERT_HIGH;
+    if (_alertLow)                                   st |= MTS4X_STATUS_ALERT_LOW;
+    if (_converting)                                 st |= MTS4X_STATUS_BUSY;
+    if (_now < _eeBusyUntil)                         st |= MTS4X_STATUS_EE_BUSY;
+    if ((_regs[MTS4X_TEMP_CMD] & 0x0F) == 0x0A)      st |= MTS4X_STATUS_HEATER_ON;
+    if (tl >= th)                                    st |= MTS4X_STATUS_TH_TL_ERR;
+    _regs[MTS4X_STATUS] = st;
+
+    _regs[MTS4X_CRC_SCRATCH]     = MTS4xCrc8::compute(&_regs[MTS4X_STATUS], 8);
+    _regs[MTS4X_CRC_SCRATCH_EXT] = MTS4xCrc8::compute(&_regs[MTS4X_USER_DEFINE_0], 10);
+    _regs[MTS4X_CRC_ROMCODE]     = MTS4xCrc8::compute(&_regs[MTS4X_DEVICE_ID_LSB], 7);
+}
+
+// -----------------------------------------------------------------------------
+// Register file
+// -----------------------------------------------------------------------------
+
+uint8_t MTS4xSimDevice::readReg(uint8_t reg) {
+    if (reg < sizeof(_regs)) {
+        return _regs[reg];
+    }
+    if (reg == MTS4X_PPM_CFG) {
+        return _ppm;
+    }
+    return 0xFF;
+}
+
+void MTS4xSimDevice::writeReg(uint8_t reg, uint8_t value) {
+    if (reg == MTS4X_TEMP_CMD) {
+        uint8_t mode = value >> 6;
+        // Mode 10 is continuous and reads back as 00
+        _regs[reg] = (uint8_t)((value & 0x3F) | ((mode == 2 ? 0 : mode) << 6));
+        if (mode == MEASURE_SINGLE) {
+            _continuous = false;
+            if (!_converting) {
+                startConversion(_now);
+            }
+        } else if (mode == MEASURE_STOP) {
+            _continuous = false;
+        } else if (!_continuous) {
+            _continuous = true;
+            _nextConv   = _now;
+        }
+        return;
+    }
+    if ((reg >= MTS4X_TEMP_CFG && reg <= MTS4X_TL_MSB) ||
+        (reg >= MTS4X_USER_DEFINE_0 && reg <= MTS4X_USER_DEFINE_9)) {
+        _regs[reg] = value;
+        return;
+    }
+    if (reg == MTS4X_E2PROM_CMD) {
+        command(value);
+        return;
+    }
+    if (reg == MTS4X_PPM_CFG) {
+        _ppm = value;
+    }
+    // Everything else is read-only
+}
+
+void MTS4xSimDevice::recall() {
+    for (uint8_t i = 0; i < sizeof(_eeprom); ++i) {
+        uint8_t reg = (uint8_t)(MTS4X_TEMP_CMD + i);
+        if (reg != MTS4X_CRC_SCRATCH) {
+            _regs[reg] = _eeprom[i];
+        }
+    }
+    uint8_t mode = _regs[MTS4X_TEMP_CMD] >> 6;
+    _continuous = (mode == MEASURE_CONTINUOUS);
+    _nextConv   = _now;
+}
+
+void MTS4xSimDevice::command(uint8_t cmd) {
+    switch (cmd) {
+        case 0x08:   // copy scratch -> EEPROM
+            for (uint8_t i = 0; i < sizeof(_eeprom); ++i) {
+                uint8_t reg = (uint8_t)(MTS4X_TEMP_CMD + i);
+                if (reg != MTS4X_CRC_SCRATCH) {
+                    _eeprom[i] = _regs[reg];
+                }
+            }
+            ++_eeWrites;
+            _eeBusyUntil = _now + MTS4X_SIM_EE_COPY_US;
+            break;
+        case 0xB6:   // recall EEPROM -> scratch
+            recall();
+            _eeBusyUntil = _now + MTS4X_SIM_EE_RECALL_US;
+            break;
+        case 0x6A:   // soft reset + recall
+            _converting = false;
+            _alertHigh  = false;
+            _alertLow   = false;
+            recall();
+            _eeBusyUntil = _now + MTS4X_SIM_EE_RECALL_US;
+            break;
+        default:
+            break;
+    }
+}
+
+void MTS4xSimDevice::busCycle(size_t bytes, uint8_t conditions) {
+    // 9 clocks per byte (8 data + ACK) plus START/Sr/STOP
+    uint64_t bits = (uint64_t)bytes * 9 + conditions;
+    uint64_t us   = (bits * 1000000ULL + _clockHz - 1) / _clockHz;
+    ++_transactions;
+    _bytes   += (uint32_t)bytes;
+    _busTime += us;
+    _now     += us;
+}
+
+// -----------------------------------------------------------------------------
+// Inspection and counters
+// -----------------------------------------------------------------------------
+
+uint8_t MTS4xSimDevice::peek(uint8_t reg) {
+    update();
+    refreshDerived();
+    return readReg(reg);
+}
+
+void MTS4xSimDevice::poke(uint8_t reg, uint8_t value) {
+    update();
+    writeReg(reg, value);
+}
+
+const uint8_t *MTS4xSimDevice::eeprom() const {
+    return _eeprom;
+}
+
+uint32_t MTS4xSimDevice::transactions() const {
+    return _transactions;
+}
+
+uint32_t MTS4xSimDevice::bytesOnWire() const {
+    return _bytes;
+}
+
+uint64_t MTS4xSimDevice::busTimeUs() const {
+    return _busTime;
+}
+
+uint32_t MTS4xSimDevice::statusReads() const {
+    return _statusReads;
+}
+
+uint32_t MTS4xSimDevice::conversions() const {
+    return _conversions;
+}
+
+uint64_t MTS4xSimDevice::lastConversionUs() const {
+    return _lastConvEnd;
+}
+
+uint32_t MTS4xSimDevice::eepromWrites() const {
+    return _eeWrites;
+}
+
+void MTS4xSimDevice::injectNak(uint32_t count) {
+    _nakLeft = count;
+}
+
+void MTS4xSimDevice::injectStuckSda(uint16_t clocks) {
+    _stuckClocks = clocks;
+}
+
+bool MTS4xSimDevice::sdaStuck() const {
+    return _stuckClocks != 0;
+}
+
+uint32_t MTS4xSimDevice::busClears() const {
+    return _busClears;
+}
+
+void MTS4xSimDevice::resetCounters() {
+    _busClears    = 0;
+    _transactions = 0;
+    _bytes        = 0;
+    _busTime      = 0;
+    _statusReads  = 0;
+    _conversions  = 0;
+    _eeWrites     = 0;
+}
+
+#endif // MTS4X_HOST || !ARDUINO
@@ -0,0 +1,146 @@
+// MTS4x Arduino driver - simulated MTS4 device
+// Author: Denis (FedunovDenis)
+
+#ifndef __MTS4X_SIM_H__
+#define __MTS4X_SIM_H__
+
+#include "MTS4x.h"
+
+// Host-only: MTS4xSim.cpp compiles to nothing in a board build, so the
+// model never reaches a sketch. Define MTS4X_HOST to run it on a board.
+#if defined(ARDUINO) && !defined(MTS4X_HOST)
+#error "MTS4xSim.h is for host builds (define MTS4X_HOST to use it in a sketch)"
+#endif
+
+// EEPROM timing of the model (not specified by the datasheet excerpt)
+#ifndef MTS4X_SIM_EE_COPY_US
+#define MTS4X_SIM_EE_COPY_US    10000UL
+#endif
+#ifndef MTS4X_SIM_EE_RECALL_US
+#define MTS4X_SIM_EE_RECALL_US  1000UL
+#endif
+
+// Register-level model of one MTS4 on a virtual I2C bus with a virtual
+// clock. It implements MTS4xBus, so an MTS4X constructed on it runs the
+// complete driver off-target:
+//
+//   MTS4xSimDevice sim;
+//   MTS4X          mts(sim);
+//   sim.setTemperatureMilli(21500);
+//   mts.singleShotMilli(mC);
+//
+// Modelled: register map with read-only/derived registers, conversion
+// time per TempCfgAVG and period per TempCfgMPS (with oscillator error),
+// single-shot / continuous / stop, BUSY and EE_BUSY, CRC of temperature,
+// scratch, scratch_ext and ROM code, alert logic for both alert modes,
+// heater flag, EEPROM copy/recall/reset, bus time per transaction at
+// the configured clock, and injected bus faults with a bus-clear model.
+// Time only moves through delay(), bus traffic and a small step per
+// micros()/millis() call (see setCallCostUs()).
+class MTS4xSimDevice : public MTS4xBus {
+  public:
+    explicit MTS4xSimDevice(uint8_t address = MTS4X_ADDRESS);
+
+    // MTS4xBus
+    bool     begin(int32_t sda, int32_t scl) override;
+    void     setClock(uint32_t hz) override;
+    bool     writeRegs(uint8_t addr, uint8_t reg,
+                       const uint8_t *data, size_t len) override;
+    bool     readRegs(uint8_t addr, uint8_t reg,
+                      uint8_t *data, size_t len) override;
+    bool     recover(uint32_t hz) override;
+    uint32_t millis() override;
+    uint32_t micros() override;
+    void     delay(uint32_t ms) override;
+
+    // Virtual clock
+    uint64_t nowUs() const;
+    void     advanceUs(uint32_t us);
+    void     setCallCostUs(uint32_t us);   // per micros()/millis() call, default 1
+
+    // Physical model
+    void setTemperatureRaw(int32_t raw);
+    void setTemperatureMilli(int32_t mC);
+    void setNoise(uint16_t sigmaRaw);      // std deviation at AVG_1, in LSB
+    void setOscillatorPpm(int32_t ppm);    // conversion clock error
+    void setSeed(uint32_t seed);
+
+    // Power-on state: registers and EEPROM back to defaults
+    void powerOn();
+
+    // Fault injection. injectNak(): the next count transactions are not
+    // acknowledged. injectStuckSda(): the device holds SDA low, as when
+    // cut off mid-byte, until bus clears have given it clocks pulses (9
+    // per recover()); every transaction fails meanwhile.
+    void     injectNak(uint32_t count);
+    void     injectStuckSda(uint16_t clocks);
+    bool     sdaStuck() const;
+
+    // Direct register access for checks (no bus time, no counters)
+    uint8_t peek(uint8_t reg);
+    void    poke(uint8_t reg, uint8_t value);
+    const uint8_t *eeprom() const;         // image of 0x04..0x15
+
+    // Instrumentation
+    uint32_t transactions() const;
+    uint32_t bytesOnWire() const;
+    uint64_t busTimeUs() const;
+    uint32_t statusReads() const;          // reads covering Status (0x03)
+    uint32_t conversions() const;
+    uint64_t lastConversionUs() const;     // virtual time the last one completed
+    uint32_t eepromWrites() const;
+    uint32_t busClears() const;            // recover() calls
+    void     resetCounters();
+
+  private:
+    uint8_t  _addr;
+    uint8_t  _regs[0x20];
+    uint8_t  _ppm;
+    uint8_t  _eeprom[18];
+
+    uint64_t _now;
+    uint32_t _callCost;
+    uint32_t _clockHz;
+
+    int32_t  _tempRaw;
+    uint16_t _noise;
+    int32_t  _oscPpm;
+    uint32_t _rng;
+
+    bool     _converting;
+    uint64_t _convEnd;
+    uint64_t _lastConvEnd;
+    bool     _continuous;
+    uint64_t _nextConv;
+    uint64_t _eeBusyUntil;
+    bool     _alertHigh;
+    bool     _alertLow;
+
+    uint32_t _transactions;
+    uint32_t _bytes;
+    uint64_t _busTime;
+    uint32_t _statusReads;
+    uint32_t _conversions;
+    uint32_t _eeWrites;
+    uint32_t _busClears;
+
+    uint32_t _nakLeft;
+    uint16_t _stuckClocks;
+
+    void     update();
+    void     startConversion(uint64_t at);
+    void     finishConversion();
+    void     evalAlert(int16_t t);
+    void     refreshDerived();
+    void     command(uint8_t cmd);
+    void     recall();
+    void     busCycle(size_t bytes, uint8_t conditions);
+    bool     faulted();
+    uint32_t convTimeUs() const;
+    uint32_t periodUs() const;
+    int32_t  gaussian();
+    uint8_t  readReg(uint8_t reg);
+    void     writeReg(uint8_t reg, uint8_t value);
+};
+
+#endif // __MTS4X_SIM_H__
@@ -0,0 +1,239 @@
+// MTS4x Arduino driver - compile-time sensor variant front end
+// Author: Denis (FedunovDenis)
+
+#ifndef __MTS4X_VARIANT_H__
+#define __MTS4X_VARIANT_H__
+
+#include "MTS4x.h"
+
+// Subsystems a MTS4XSensor may use. Calling a feature left out of the
+// mask fails to compile at the call site; CRC off also skips the Crc_temp
+// check at run time (setUseCrc(false)). The mask is an API contract, not
+// a size switch: the front end calls the same MTS4X methods either way.
+#define MTS4X_FEAT_CRC        0x01    // check Crc_temp on every sample
+#define MTS4X_FEAT_HEATER     0x02    // heaterOn/heaterOff, setMode(.., heater)
+#define MTS4X_FEAT_ALERT      0x04    // Alert_Mode and TH/TL limits
+#define MTS4X_FEAT_USER       0x08    // user registers 0x0C..0x15
+#define MTS4X_FEAT_EEPROM     0x10    // E2PROM copy/recall, profiles
+#define MTS4X_FEAT_PARASITIC  0x20    // PPM_Cfg
+#define MTS4X_FEAT_ALL        0x3F
+
+// Variant traits: high-accuracy window and accuracy inside/outside it (m°C,
+// README table), plus the features the part supports. All four parts share
+// the register map and the 0x41 address; a board with a tighter grade can
+// pass its own struct with the same members.
+struct MTS4xVariantMTS4 {
+    // Room-temperature window; conservative, check the datasheet of the grade
+    static constexpr int32_t  windowLowMilli  = 20000;
+    static constexpr int32_t  windowHighMilli = 30000;
+    static constexpr uint16_t accuracyMilli   = 100;
+    static constexpr uint16_t outsideMilli    = 1000;
+    static constexpr uint32_t features        = MTS4X_FEAT_ALL;
+};
+
+struct MTS4xVariantMTS4Z {
+    static constexpr int32_t  windowLowMilli  = 0;
+    static constexpr int32_t  windowHighMilli = 50000;
+    static constexpr uint16_t accuracyMilli   = 100;
+    static constexpr uint16_t outsideMilli    = 1000;
+    static constexpr uint32_t features        = MTS4X_FEAT_ALL;
+};
+
+struct MTS4xVariantMTS4P {
+    static constexpr int32_t  windowLowMilli  = -25000;
+    static constexpr int32_t  windowHighMilli = 25000;
+    static constexpr uint16_t accuracyMilli   = 100;
+    static constexpr uint16_t outsideMilli    = 1000;
+    static constexpr uint32_t features        = MTS4X_FEAT_ALL;
+};
+
+// Wide-range part: one accuracy over the whole operating range
+struct MTS4xVariantMTS4B {
+    static constexpr int32_t  windowLowMilli  = -40000;
+    static constexpr int32_t  windowHighMilli = 125000;
+    static constexpr uint16_t accuracyMilli   = 500;
+    static constexpr uint16_t outsideMilli    = 1000;
+    static constexpr uint32_t features        = MTS4X_FEAT_ALL;
+};
+
+// Thin front end over MTS4X with the variant and feature set fixed at
+// compile time. Every call goes to the MTS4X methods of the same name, so
+// reads, single shots and errors behave exactly like the full driver;
+// device() gives the whole API when needed.
+//
+//   MTS4XSensor<MTS4xVariantMTS4P, MTS4X_FEAT_CRC | MTS4X_FEAT_ALERT> mts;
+//   mts.begin(sda, scl, MEASURE_CONTINUOUS);
+//   mts.readMilli(mC);
+template <class Variant, uint32_t Features = MTS4X_FEAT_ALL>
+class MTS4XSensor {
+  public:
+    typedef Variant variant_type;
+
+    static constexpr uint32_t features  = Features & Variant::features;
+    static constexpr bool     hasCrc    = (features & MTS4X_FEAT_CRC) != 0;
+
+    static constexpr int32_t  windowLowMilli  = Variant::windowLowMilli;
+    static constexpr int32_t  windowHighMilli = Variant::windowHighMilli;
+
+    static_assert((Features & ~(uint32_t)MTS4X_FEAT_ALL) == 0, "unknown MTS4X_FEAT_* bit");
+    static_assert(Variant::windowLowMilli < Variant::windowHighMilli, "empty accuracy window");
+
+    explicit MTS4XSensor(uint8_t address = MTS4X_ADDRESS, TwoWire &wire = Wire)
+    : _dev(address, wire) {
+        _dev.setUseCrc(hasCrc);
+    }
+    explicit MTS4XSensor(MTS4xBus &bus, uint8_t address = MTS4X_ADDRESS)
+    : _dev(bus, address) {
+        _dev.setUseCrc(hasCrc);
+    }
+
+    // Full driver, for calls the front end does not wrap
+    MTS4X &device() { return _dev; }
+
+    // Window boundaries as raw codes, rounded inwards
+    static constexpr int16_t windowLowRaw() {
+        return (int16_t)(((windowLowMilli - 25000) * 256 + ((windowLowMilli >= 25000) ? 999 : 0)) / 1000);
+    }
+    static constexpr int16_t windowHighRaw() {
+        return (int16_t)(((windowHighMilli - 25000) * 256 - ((windowHighMilli < 25000) ? 999 : 0)) / 1000);
+    }
+    static constexpr bool inWindow(int16_t raw) {
+        return raw >= windowLowRaw() && raw <= windowHighRaw();
+    }
+    static constexpr bool inWindowMilli(int32_t mC) {
+        return mC >= windowLowMilli && mC <= windowHighMilli;
+    }
+    // Datasheet accuracy (± m°C) at a temperature
+    static constexpr uint16_t accuracyMilli(int32_t mC) {
+        return inWindowMilli(mC) ? (uint16_t)Variant::accuracyMilli
+                                 : (uint16_t)Variant::outsideMilli;
+    }
+
+    bool begin(int32_t sda, int32_t scl) { return _dev.begin(sda, scl); }
+    bool begin(int32_t sda, int32_t scl, MeasurementMode mode) {
+        return _dev.begin(sda, scl, mode);
+    }
+    int8_t    lastError() const { return _dev.lastError(); }
+    MTS4xBus &bus() const { return _dev.bus(); }
+    void      setBusClock(uint32_t hz) { _dev.setBusClock(hz); }
+    void      setRecoveryDeadline(uint32_t deadlineUs) { _dev.setRecoveryDeadline(deadlineUs); }
+
+    bool setMode(MeasurementMode mode) { return _dev.setMode(mode, false); }
+    bool setConfig(TempCfgMPS mps, TempCfgAVG avg, bool sleep) {
+        return _dev.setConfig(mps, avg, sleep);
+    }
+
+    // Sample read, BUSY polled and CRC retried by the driver
+    bool readRaw(int16_t &raw, bool waitOnNewVal = true) {
+        return _dev.readTemperatureRaw(raw, waitOnNewVal);
+    }
+
+    bool readMilli(int32_t &mC, bool waitOnNewVal = true) {
+        int16_t raw = 0;
+        if (!readRaw(raw, waitOnNewVal)) {
+            return false;
+        }
+        mC = mts4x_raw_to_milli(raw);
+        return true;
+    }
+
+    // Start, wait the conversion time of the config, read
+    bool singleShotMilli(int32_t &mC) { return _dev.singleShotMilli(mC); }
+
+#ifndef MTS4X_NO_FLOAT
+    float readTemperature(bool waitOnNewVal = true) {
+        int16_t raw = 0;
+        return readRaw(raw, waitOnNewVal) ? MTS4X_RAW_TO_CELSIUS(raw) : NAN;
+    }
+#endif
+
+    bool readDeviceId(uint16_t &id) { return _dev.readDeviceId(id); }
+
+    // Optional subsystems: a template parameter defers the check to the call
+
+    template <uint32_t F = features>
+    bool setMode(MeasurementMode mode, bool heater) {
+        static_assert(F & MTS4X_FEAT_HEATER, "MTS4X_FEAT_HEATER is not enabled");
+        return _dev.setMode(mode, heater);
+    }
+    template <uint32_t F = features>
+    bool heaterOn() {
+        static_assert(F & MTS4X_FEAT_HEATER, "MTS4X_FEAT_HEATER is not enabled");
+        return _dev.heaterOn();
+    }
+    template <uint32_t F = features>
+    bool heaterOff() {
+        static_assert(F & MTS4X_FEAT_HEATER, "MTS4X_FEAT_HEATER is not enabled");
+        return _dev.heaterOff();
+    }
+
+    template <uint32_t F = features>
+    bool setAlertMode(bool enable, MTS4xAlertMode mode) {
+        static_assert(F & MTS4X_FEAT_ALERT, "MTS4X_FEAT_ALERT is not enabled");
+        return _dev.setAlertMode(enable, mode);
+    }
+    template <uint32_t F = features>
+    bool setLimitsRaw(int16_t thRaw, int16_t tlRaw) {
+        static_assert(F & MTS4X_FEAT_ALERT, "MTS4X_FEAT_ALERT is not enabled");
+        return _dev.setLimitsRaw(thRaw, tlRaw);
+    }
+    template <uint32_t F = features>
+    bool setLimitsMilli(int32_t thMilli, int32_t tlMilli) {
+        static_assert(F & MTS4X_FEAT_ALERT, "MTS4X_FEAT_ALERT is not enabled");
+        return _dev.setLimitsRaw(mts4x_milli_to_raw(thMilli), mts4x_milli_to_raw(tlMilli));
+    }
+
+    template <uint32_t F = features>
+    bool readUserRegister(uint8_t index, uint8_t &value) {
+        static_assert(F & MTS4X_FEAT_USER, "MTS4X_FEAT_USER is not enabled");
+        return _dev.readUserRegister(index, value);
+    }
+    template <uint32_t F = features>
+    bool writeUserRegister(uint8_t index, uint8_t value) {
+        static_assert(F & MTS4X_FEAT_USER, "MTS4X_FEAT_USER is not enabled");
+        return _dev.writeUserRegister(index, value);
+    }
+
+    template <uint32_t F = features>
+    bool eepromCopyPage(bool waitReady = true, uint32_t timeoutMs = 50) {
+        static_assert(F & MTS4X_FEAT_EEPROM, "MTS4X_FEAT_EEPROM is not enabled");
+        return _dev.eepromCopyPage(waitReady, timeoutMs);
+    }
+    template <uint32_t F = features>
+    bool eepromRecallPage(bool waitReady = true, uint32_t timeoutMs = 50) {
+        static_assert(F & MTS4X_FEAT_EEPROM, "MTS4X_FEAT_EEPROM is not enabled");
+        return _dev.eepromRecallPage(waitReady, timeoutMs);
+    }
+    template <uint32_t F = features>
+    bool applyProfile(const MTS4xProfile &profile, bool commit = true) {
+        static_assert(F & MTS4X_FEAT_EEPROM, "MTS4X_FEAT_EEPROM is not enabled");
+        return _dev.applyProfile(profile, commit);
+    }
+
+    template <uint32_t F = features>
+    bool setParasiticPower(bool enable) {
+        static_assert(F & MTS4X_FEAT_PARASITIC, "MTS4X_FEAT_PARASITIC is not enabled");
+        return _dev.setParasiticPower(enable);
+    }
+
+  private:
+    MTS4X _dev;
+};
+
+// Out-of-class definitions of the constexpr members (C++11 ODR)
+template <class Variant, uint32_t Features>
+constexpr uint32_t MTS4XSensor<Variant, Features>::features;
+template <class Variant, uint32_t Features>
+constexpr bool MTS4XSensor<Variant, Features>::hasCrc;
+template <class Variant, uint32_t Features>
+constexpr int32_t MTS4XSensor<Variant, Features>::windowLowMilli;
+template <class Variant, uint32_t Features>
+constexpr int32_t MTS4XSensor<Variant, Features>::windowHighMilli;
+
+// Ready-made front ends; MTS4X remains the full driver
+typedef MTS4XSensor<MTS4xVariantMTS4>  MTS4XSensorMTS4;
+typedef MTS4XSensor<MTS4xVariantMTS4Z> MTS4XSensorMTS4Z;
+typedef MTS4XSensor<MTS4xVariantMTS4P> MTS4XSensorMTS4P;
+typedef MTS4XSensor<MTS4xVariantMTS4B> MTS4XSensorMTS4B;
+
+#endif // __MTS4X_VARIANT_H__
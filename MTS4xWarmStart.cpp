@@ -0,0 +1,70 @@
+#include "MTS4xWarmStart.h"
+#include <string.h>
+
+#define MTS4X_SNAPSHOT_WORDS ((sizeof(MTS4xSnapshot) + 3) / 4)
+
+#if defined(ESP8266)
+static_assert(MTS4X_RTC_OFFSET * 4 + MTS4X_SNAPSHOT_WORDS * 4 <= 512,
+              "MTS4xSnapshot does not fit the RTC user memory");
+#elif defined(ESP32)
+// Raw words: a C++ object here would be re-constructed on every wake
+RTC_DATA_ATTR static uint32_t mts4x_rtc_image[MTS4X_SNAPSHOT_WORDS];
+#else
+static uint32_t mts4x_rtc_image[MTS4X_SNAPSHOT_WORDS];
+#endif
+
+static uint32_t mts4x_snapshot_magic() {
+    return 0x4D340000UL | ((uint32_t)MTS4X_SNAPSHOT_VERSION << 12) |
+           (uint32_t)(sizeof(MTS4xSnapshot) & 0x0FFF);
+}
+
+// CRC8 of the image with the crc byte itself as 0
+static uint8_t mts4x_snapshot_crc(const MTS4xSnapshot &snap) {
+    MTS4xSnapshot tmp;
+    memcpy(&tmp, &snap, sizeof(tmp));
+    tmp.crc = 0;
+    return MTS4xCrc8::compute(reinterpret_cast<const uint8_t *>(&tmp), sizeof(tmp));
+}
+
+bool mts4x_snapshot_save(MTS4xSnapshot &snap) {
+    snap.magic = mts4x_snapshot_magic();
+    snap.crc   = mts4x_snapshot_crc(snap);
+
+    uint32_t words[MTS4X_SNAPSHOT_WORDS];
+    words[MTS4X_SNAPSHOT_WORDS - 1] = 0;
+    memcpy(words, &snap, sizeof(snap));
+#if defined(ESP8266)
+    return ESP.rtcUserMemoryWrite(MTS4X_RTC_OFFSET, words, sizeof(words));
+#else
+    memcpy(mts4x_rtc_image, words, sizeof(words));
+    return true;
+#endif
+}
+
+bool mts4x_snapshot_load(MTS4xSnapshot &snap) {
+    uint32_t words[MTS4X_SNAPSHOT_WORDS];
+#if defined(ESP8266)
+    if (!ESP.rtcUserMemoryRead(MTS4X_RTC_OFFSET, words, sizeof(words))) {
+        return false;
+    }
+#else
+    memcpy(words, mts4x_rtc_image, sizeof(words));
+#endif
+    MTS4xSnapshot tmp;
+    memcpy(&tmp, words, sizeof(tmp));
+    if (tmp.magic != mts4x_snapshot_magic() || tmp.crc != mts4x_snapshot_crc(tmp)) {
+        return false;
+    }
+    memcpy(&snap, &tmp, sizeof(snap));
+    return true;
+}
+
+void mts4x_snapshot_clear() {
+    uint32_t words[MTS4X_SNAPSHOT_WORDS];
+    memset(words, 0, sizeof(words));
+#if defined(ESP8266)
+    ESP.rtcUserMemoryWrite(MTS4X_RTC_OFFSET, words, sizeof(words));
+#else
+    memcpy(mts4x_rtc_image, words, sizeof(words));
+#endif
+}
@@ -0,0 +1,46 @@
+// MTS4x Arduino driver - deep-sleep snapshot in RTC memory
+// Author: Denis (FedunovDenis)
+
+#ifndef __MTS4X_WARM_START_H__
+#define __MTS4X_WARM_START_H__
+
+#include "MTS4x.h"
+#include "MTS4xAggregator.h"
+
+// ESP8266: offset into the RTC user memory, in 4-byte blocks
+#ifndef MTS4X_RTC_OFFSET
+#define MTS4X_RTC_OFFSET 0
+#endif
+
+// Bump when the snapshot layout changes: old snapshots then fail to load
+#define MTS4X_SNAPSHOT_VERSION 1
+
+#define MTS4X_SNAPSHOT_LAST_RAW 0x01    // lastRaw is valid
+
+// Everything a battery node needs to go from wake to the next sample
+// without a cold begin(): the chip configuration (limits, alert mode and
+// the user registers, which hold the calibration), the last reading and
+// the sample conditioning state.
+struct MTS4xSnapshot {
+    uint32_t         magic;       // version and size, set by save
+    MTS4xDriverState driver;
+    uint8_t          flags;       // MTS4X_SNAPSHOT_*
+    int16_t          lastRaw;
+    uint32_t         wakes;
+    MTS4xAggregator  aggregator;
+    uint8_t          crc;         // CRC8 of the bytes above, set by save
+};
+
+// RTC memory survives deep sleep but not a power cycle: ESP8266 RTC user
+// memory, ESP32 RTC slow memory (RTC_DATA_ATTR), plain RAM elsewhere.
+//
+//   MTS4xSnapshot snap;
+//   if (mts4x_snapshot_load(snap)) mts.warmBegin(sda, scl, snap.driver, raw, fresh);
+//   else                           mts.begin(sda, scl, MEASURE_CONTINUOUS); ...
+//   ...
+//   mts.captureState(snap.driver); mts4x_snapshot_save(snap); deep sleep
+bool mts4x_snapshot_save(MTS4xSnapshot &snap);
+bool mts4x_snapshot_load(MTS4xSnapshot &snap);   // false: no valid snapshot
+void mts4x_snapshot_clear();
+
+#endif // __MTS4X_WARM_START_H__
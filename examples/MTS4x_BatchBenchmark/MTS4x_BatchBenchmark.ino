@@ -0,0 +1,214 @@
+/*
+  MTS4x_BatchBenchmark.ino
+
+  Пакетная обработка сырых отсчётов (MTS4xBatch.h): скорость каждого ядра
+  в отсчётах в секунду против поштучного цикла и проверка точного
+  совпадения со скалярным путём на всех 65536 кодах. Датчик не нужен;
+  скетч одинаково запускается на плате и в host-сборке (-msse2/-mavx2,
+  NEON на ARM), где и работают векторные пути. Скорость - в тысячах
+  отсчётов в секунду; второй столбец - тот же расчёт циклом по одному
+  отсчёту.
+
+  Вывод в Serial - машиночитаемый CSV:
+    IMPL,<scalar|sse2|avx2|neon>
+    BATCH,<kernel>,<ksamples_per_s>,<loop_ksamples_per_s>
+    CHECK,<kernel>,OK|FAIL
+    RESULT,PASS|FAIL
+*/
+
+#include <Arduino.h>
+#include <string.h>
+#include "MTS4x.h"
+#include "MTS4xBatch.h"
+
+#if defined(__AVR__)
+static const size_t N = 128;     // 2 КБ RAM
+#else
+static const size_t N = 4096;
+#endif
+
+static int16_t  raw[N];
+static int16_t  raw2[N];
+static int32_t  milli[N];
+static uint8_t  mask[N / 8];
+#ifndef MTS4X_NO_FLOAT
+static float    celsius[N];
+#endif
+
+// Пороги и коэффициенты как на шлюзе: 5..40 °C, усиление 1.002, сдвиг +0.1 °C
+static const int16_t TH_RAW    = 3840;
+static const int16_t TL_RAW    = -5120;
+static const int16_t GAIN_Q14  = 16417;
+static const int16_t OFFSET    = 26;
+
+static volatile int32_t g_sink;   // чтобы компилятор не выбросил циклы
+static bool             g_pass = true;
+
+// ----------------------------- Поштучные эталоны ----------------------
+
+static int16_t refScale(int16_t r) {
+  int32_t p = (((int32_t)r * GAIN_Q14 + 8192) >> 14) + OFFSET;
+  if (p > 32767)  p = 32767;
+  if (p < -32768) p = -32768;
+  return (int16_t)p;
+}
+
+static void loopMilli(size_t n) {
+  for (size_t i = 0; i < n; ++i) milli[i] = mts4x_raw_to_milli(raw[i]);
+}
+static void loopScale(size_t n) {
+  for (size_t i = 0; i < n; ++i) raw2[i] = refScale(raw[i]);
+}
+static void loopThreshold(size_t n) {
+  size_t c = 0;
+  for (size_t i = 0; i < n; ++i) c += (raw[i] > TH_RAW || raw[i] < TL_RAW);
+  g_sink = (int32_t)c;
+}
+static void loopReduce(size_t n) {
+  int16_t mn = 32767, mx = -32768;
+  int32_t s  = 0;
+  for (size_t i = 0; i < n; ++i) {
+    if (raw[i] < mn) mn = raw[i];
+    if (raw[i] > mx) mx = raw[i];
+    s += raw[i];
+  }
+  g_sink = s + mn + mx;
+}
+#ifndef MTS4X_NO_FLOAT
+static void loopCelsius(size_t n) {
+  for (size_t i = 0; i < n; ++i) celsius[i] = MTS4X_RAW_TO_CELSIUS(raw[i]);
+}
+#endif
+
+// ----------------------------- Пакетные ядра --------------------------
+
+static void batchMilli(size_t n)     { mts4x_batch_to_milli(raw, milli, n); }
+static void batchScale(size_t n)     { mts4x_batch_scale_offset(raw, raw2, n, GAIN_Q14, OFFSET); }
+static void batchThreshold(size_t n) { g_sink = (int32_t)mts4x_batch_threshold(raw, n, TH_RAW, TL_RAW, mask); }
+static void batchReduce(size_t n) {
+  MTS4xBatchSummary s;
+  mts4x_batch_reduce(raw, n, s);
+  g_sink = (int32_t)s.sumRaw + s.minRaw + s.maxRaw;
+}
+#ifndef MTS4X_NO_FLOAT
+static void batchCelsius(size_t n)   { mts4x_batch_to_celsius(raw, celsius, n); }
+#endif
+
+typedef void (*KernelFn)(size_t n);
+
+struct KernelItem {
+  const char *name;
+  KernelFn    batch;
+  KernelFn    loop;
+};
+
+static const KernelItem ITEMS[] = {
+#ifndef MTS4X_NO_FLOAT
+  { "to_celsius",   batchCelsius,   loopCelsius   },
+#endif
+  { "to_milli",     batchMilli,     loopMilli     },
+  { "scale_offset", batchScale,     loopScale     },
+  { "threshold",    batchThreshold, loopThreshold },
+  { "reduce",       batchReduce,    loopReduce    },
+};
+
+// Тысяч отсчётов в секунду: повторы до ~200 мс
+static uint32_t rate(KernelFn fn) {
+  uint32_t reps = 0;
+  uint32_t t0   = micros();
+  uint32_t dt   = 0;
+  do {
+    fn(N);
+    ++reps;
+    dt = micros() - t0;
+  } while (dt < 200000UL);
+  return (uint32_t)((uint64_t)reps * N * 1000ULL / dt);
+}
+
+// ----------------------------- Проверка точности ----------------------
+
+static void check(const char *name, bool ok) {
+  Serial.print(F("CHECK,"));
+  Serial.print(name);
+  Serial.println(ok ? F(",OK") : F(",FAIL"));
+  if (!ok) g_pass = false;
+}
+
+// Все коды -32768..32767 порциями по n (n не кратно 8/16: проверяются хвосты)
+static void checkAll() {
+  bool okC = true, okM = true, okS = true, okT = true, okR = true;
+  const size_t n = N - 3;
+  MTS4xBatchSummary total;
+  int64_t refSum = 0;
+  for (int32_t base = -32768; base < 32768; base += (int32_t)n) {
+    size_t len = (size_t)((32768 - base) < (int32_t)n ? (32768 - base) : (int32_t)n);
+    for (size_t i = 0; i < len; ++i) {
+      raw[i] = (int16_t)(base + (int32_t)i);
+      refSum += raw[i];
+    }
+#ifndef MTS4X_NO_FLOAT
+    mts4x_batch_to_celsius(raw, celsius, len);
+    for (size_t i = 0; i < len; ++i) {
+      float ref = MTS4X_RAW_TO_CELSIUS(raw[i]);
+      if (memcmp(&ref, &celsius[i], sizeof(ref)) != 0) okC = false;
+    }
+#endif
+    mts4x_batch_to_milli(raw, milli, len);
+    mts4x_batch_scale_offset(raw, raw2, len, GAIN_Q14, OFFSET);
+    size_t cnt = mts4x_batch_threshold(raw, len, TH_RAW, TL_RAW, mask);
+    size_t ref = 0;
+    for (size_t i = 0; i < len; ++i) {
+      if (milli[i] != mts4x_raw_to_milli(raw[i])) okM = false;
+      if (raw2[i] != refScale(raw[i])) okS = false;
+      bool out = (raw[i] > TH_RAW || raw[i] < TL_RAW);
+      ref += out;
+      if (((mask[i >> 3] >> (i & 7)) & 1) != (out ? 1 : 0)) okT = false;
+    }
+    if (cnt != ref) okT = false;
+    mts4x_batch_reduce(raw, len, total);
+  }
+  okR = total.count == 65536UL && total.minRaw == -32768 && total.maxRaw == 32767 &&
+        total.sumRaw == refSum && total.meanRaw() == -1 &&
+        total.meanMilli() == 24998;   // среднее -0.5 LSB -> 25 - 0.00195 °C
+  // Насыщение и работа "на месте" (out == raw)
+  raw[0] = 32767; raw[1] = -32768; raw[2] = 32000;
+  mts4x_batch_scale_offset(raw, raw, 3, 32767, 1000);
+  okS = okS && raw[0] == 32767 && raw[1] == -32768 && raw[2] == 32767;
+#ifndef MTS4X_NO_FLOAT
+  check("to_celsius", okC);
+#endif
+  check("to_milli", okM);
+  check("scale_offset", okS);
+  check("threshold", okT);
+  check("reduce", okR);
+}
+
+void setup() {
+  Serial.begin(115200);
+  delay(200);
+  Serial.print(F("IMPL,"));
+  Serial.println(mts4x_batch_impl());
+
+  checkAll();
+
+  // Реалистичные данные для замеров: 10..35 °C с шумом
+  uint32_t x = 12345;
+  for (size_t i = 0; i < N; ++i) {
+    x = x * 1103515245UL + 12345UL;
+    raw[i] = (int16_t)(-3840 + (int32_t)((x >> 8) % 6400));
+  }
+  for (size_t k = 0; k < sizeof(ITEMS) / sizeof(ITEMS[0]); ++k) {
+    uint32_t b = rate(ITEMS[k].batch);
+    uint32_t l = rate(ITEMS[k].loop);
+    Serial.print(F("BATCH,"));
+    Serial.print(ITEMS[k].name);
+    Serial.print(',');
+    Serial.print(b);
+    Serial.print(',');
+    Serial.println(l);
+  }
+  Serial.println(g_pass ? F("RESULT,PASS") : F("RESULT,FAIL"));
+}
+
+void loop() {
+}
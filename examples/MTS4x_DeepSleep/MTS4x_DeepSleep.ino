@@ -0,0 +1,103 @@
+/*
+  MTS4x_DeepSleep.ino
+
+  Узел на батарейке: проснулся, снял температуру, уснул. Датчик остаётся
+  под питанием и меряет непрерывно (1 Гц, AVG_8), а состояние драйвера
+  между пробуждениями лежит в RTC-памяти (MTS4xWarmStart.h).
+
+  Холодный старт (первое включение или испорченный снимок): begin(),
+  setConfig, пороги, Alert_Mode и ожидание первого измерения.
+  Тёплый старт: warmBegin() - одно чтение 0x00..0x0B проверяет
+  конфигурацию и сразу даёт готовый отсчёт; запись только того, что
+  отличается (например, если датчик терял питание).
+
+  ESP8266: GPIO16 (D0) соединить с RST, иначе deep sleep не разбудит плату.
+*/
+
+#include <Arduino.h>
+#include <Wire.h>
+#include "MTS4x.h"
+#include "MTS4xWarmStart.h"
+
+#if defined(ESP8266)
+  #define I2C_SDA_PIN D2   // GPIO4
+  #define I2C_SCL_PIN D1   // GPIO5
+#elif defined(ESP32)
+  #define I2C_SDA_PIN 21
+  #define I2C_SCL_PIN 22
+#else
+  #error "Пример рассчитан на ESP8266/ESP32 (deep sleep + RTC-память)"
+#endif
+
+const uint32_t SLEEP_S       = 60;
+const int32_t  HIGH_LIMIT_MC = 40000;
+const int32_t  LOW_LIMIT_MC  = 5000;
+
+MTS4X           mts;
+MTS4xSnapshot   snap;
+MTS4xAggregator agg;
+
+static bool coldStart(int16_t &raw) {
+  if (!mts.begin(I2C_SDA_PIN, I2C_SCL_PIN)) return false;
+  mts.setShadowCache(true);
+  if (!mts.setConfig(MPS_1Hz, AVG_8, false)) return false;
+  if (!mts.setHighLimitMilli(HIGH_LIMIT_MC) || !mts.setLowLimitMilli(LOW_LIMIT_MC)) return false;
+  if (!mts.setAlertMode(true, ALERT_MODE_HIGH_TH_LOW_ALARM)) return false;
+  if (!mts.setMode(MEASURE_CONTINUOUS, false)) return false;
+  agg.begin(5UL * 60UL * 1000UL);
+  snap.wakes = 0;
+  return mts.readTemperatureRaw(raw, true);
+}
+
+static void sleepNow() {
+  Serial.flush();
+#if defined(ESP8266)
+  ESP.deepSleep((uint64_t)SLEEP_S * 1000000ULL);
+#else
+  esp_sleep_enable_timer_wakeup((uint64_t)SLEEP_S * 1000000ULL);
+  esp_deep_sleep_start();
+#endif
+}
+
+void setup() {
+  uint32_t t0 = micros();
+  Serial.begin(115200);
+
+  int16_t raw   = 0;
+  bool    fresh = false;
+  bool    warm  = mts4x_snapshot_load(snap);
+  bool    ok;
+  if (warm) {
+    ok = mts.warmBegin(I2C_SDA_PIN, I2C_SCL_PIN, snap.driver, raw, fresh);
+    // Датчик терял питание или меряет прямо сейчас: ждём новый отсчёт
+    if (ok && !fresh) ok = mts.readTemperatureRaw(raw, true);
+    agg = snap.aggregator;
+  } else {
+    ok = coldStart(raw);
+  }
+  uint32_t awakeUs = micros() - t0;
+
+  if (ok) {
+    uint32_t now = snap.wakes * SLEEP_S * 1000UL;   // ms по счётчику пробуждений
+    agg.add(raw, now);
+    int32_t ema = 0;
+    agg.emaMilli(ema);
+    Serial.printf("%s start, %lu us, T=%ld mC, EMA=%ld mC, wake %lu\n",
+                  warm ? "warm" : "cold", (unsigned long)awakeUs,
+                  (long)mts4x_raw_to_milli(raw), (long)ema, (unsigned long)snap.wakes);
+
+    mts.captureState(snap.driver);
+    snap.lastRaw    = raw;
+    snap.flags      = MTS4X_SNAPSHOT_LAST_RAW;
+    snap.aggregator = agg;
+    ++snap.wakes;
+    mts4x_snapshot_save(snap);
+  } else {
+    Serial.printf("MTS4x error %d, next wake starts cold\n", mts.lastError());
+    mts4x_snapshot_clear();
+  }
+  sleepNow();
+}
+
+void loop() {
+}
@@ -0,0 +1,208 @@
+/*
+  EventStream.h
+
+  Живые обновления страницы по Server-Sent Events (text/event-stream)
+  вместо перезагрузки всей страницы по meta refresh. Браузер держит одно
+  соединение GET /events (EventSource), станция дописывает в него
+  короткие сообщения "data: ...\n\n".
+
+  Кадр собирается один раз за цикл измерений и одним и тем же буфером
+  уходит всем подписчикам (publish); отдельный кадр нужен только новому
+  подписчику (send). Клиент, который закрыл соединение или не принимает
+  данные (на ESP8266 - места в TCP-буфере меньше кадра), отключается;
+  EventSource сам переподключится через EVENTS_RETRY_MS.
+
+    EventStream<WiFiClient> ev;
+    // обработчик /events:
+    int8_t slot = ev.subscribe(server.client());
+    if (slot >= 0) ev.send(slot, frame, len);   // полный снимок
+    ev.publish(frame, len);                     // изменения, раз за цикл
+    ev.loop(millis());                          // каждый loop()
+*/
+
+#ifndef METEO_EVENT_STREAM_H
+#define METEO_EVENT_STREAM_H
+
+#include <Arduino.h>
+#if defined(ESP8266)
+  #include <ESP8266WiFi.h>
+#else
+  #include <WiFi.h>
+#endif
+#include <string.h>
+
+#ifndef EVENTS_MAX_CLIENTS
+  #define EVENTS_MAX_CLIENTS 4
+#endif
+#ifndef EVENTS_RETRY_MS
+  #define EVENTS_RETRY_MS 5000            // пауза переподключения браузера
+#endif
+#ifndef EVENTS_PING_MS
+  #define EVENTS_PING_MS 15000            // комментарий-пинг в тишине
+#endif
+
+template <class Client, uint8_t MaxClients = EVENTS_MAX_CLIENTS>
+class EventStream {
+    static_assert(MaxClients >= 1 && MaxClients <= 8, "slot mask is one byte");
+
+  public:
+    EventStream()
+    : _used(0), _lastSendMs(0), _bytes(0), _frames(0), _evicted(0), _closed(0) {}
+
+    // Забирает соединение текущего запроса и отвечает заголовками потока.
+    // Номер слота или -1, если мест нет (ответ тогда за вызывающим).
+    int8_t subscribe(const Client &c) {
+      int8_t slot = -1;
+      for (uint8_t i = 0; i < MaxClients; ++i) {
+        if (!(_used & (1U << i))) {
+          slot = (int8_t)i;
+          break;
+        }
+      }
+      if (slot < 0) {
+        return -1;
+      }
+      Client &cl = _clients[slot];
+      cl = c;
+      cl.setNoDelay(true);
+      _used |= (uint8_t)(1U << slot);
+
+      char head[192];
+      size_t n = 0;
+      n += copy(head + n, sizeof(head) - n,
+                "HTTP/1.1 200 OK\r\n"
+                "Content-Type: text/event-stream\r\n"
+                "Cache-Control: no-cache\r\n"
+                "Connection: keep-alive\r\n"
+                "Access-Control-Allow-Origin: *\r\n\r\n"
+                "retry: ");
+      n += copyNumber(head + n, sizeof(head) - n, EVENTS_RETRY_MS);
+      n += copy(head + n, sizeof(head) - n, "\n\n");
+      if (!writeTo((uint8_t)slot, head, n)) {
+        return -1;
+      }
+      return slot;
+    }
+
+    // Готовый кадр ("data: ...\n\n") одному подписчику
+    bool send(int8_t slot, const char *frame, size_t len) {
+      if (slot < 0 || slot >= (int8_t)MaxClients || !(_used & (1U << slot))) {
+        return false;
+      }
+      if (!writeTo((uint8_t)slot, frame, len)) {
+        return false;
+      }
+      ++_frames;
+      return true;
+    }
+
+    // Тот же кадр всем подписчикам; число получивших
+    uint8_t publish(const char *frame, size_t len) {
+      uint8_t n = 0;
+      for (uint8_t i = 0; i < MaxClients; ++i) {
+        if ((_used & (1U << i)) && writeTo(i, frame, len)) {
+          ++n;
+        }
+      }
+      if (n) {
+        ++_frames;
+      }
+      return n;
+    }
+
+    // Убирает закрытые соединения, в тишине шлёт пинг - так обрыв без FIN
+    // обнаруживается и слот освобождается
+    void loop(uint32_t nowMs) {
+      for (uint8_t i = 0; i < MaxClients; ++i) {
+        if ((_used & (1U << i)) && !_clients[i].connected()) {
+          release(i);
+          ++_closed;
+        }
+      }
+      if (_used && (uint32_t)(nowMs - _lastSendMs) >= EVENTS_PING_MS) {
+        static const char ping[] = ": ping\n\n";
+        for (uint8_t i = 0; i < MaxClients; ++i) {
+          if (_used & (1U << i)) {
+            writeTo(i, ping, sizeof(ping) - 1);
+          }
+        }
+        _lastSendMs = nowMs;
+      }
+    }
+
+    uint8_t subscribers() const {
+      uint8_t n = 0;
+      for (uint8_t i = 0; i < MaxClients; ++i) {
+        if (_used & (1U << i)) ++n;
+      }
+      return n;
+    }
+
+    uint32_t bytesSent() const { return _bytes; }    // всем клиентам, с заголовками
+    uint32_t framesSent() const { return _frames; }  // сериализаций, не копий
+    uint32_t evicted() const { return _evicted; }    // не успевали принимать
+    uint32_t closed() const { return _closed; }      // закрыли соединение сами
+
+  private:
+    Client   _clients[MaxClients];
+    uint8_t  _used;                     // бит на слот
+    uint32_t _lastSendMs;
+    uint32_t _bytes;
+    uint32_t _frames;
+    uint32_t _evicted;
+    uint32_t _closed;
+
+    bool writeTo(uint8_t i, const char *data, size_t len) {
+      Client &cl = _clients[i];
+#if defined(ESP8266)
+      // write() ждал бы освобождения буфера - медленный клиент не должен
+      // задерживать цикл измерений
+      if (cl.availableForWrite() < len) {
+        evict(i);
+        return false;
+      }
+#endif
+      size_t n = cl.write((const uint8_t *)data, len);
+      _bytes += n;
+      if (n != len) {
+        evict(i);
+        return false;
+      }
+      _lastSendMs = millis();
+      return true;
+    }
+
+    void release(uint8_t i) {
+      _clients[i].stop();
+      _clients[i] = Client();
+      _used &= (uint8_t)~(1U << i);
+    }
+
+    // Отключение медленного клиента - отдельный счётчик, штатные
+    // закрытия его не трогают
+    void evict(uint8_t i) {
+      release(i);
+      ++_evicted;
+    }
+
+    static size_t copy(char *dst, size_t cap, const char *s) {
+      size_t n = strlen(s);
+      if (n >= cap) n = cap ? cap - 1 : 0;
+      memcpy(dst, s, n);
+      return n;
+    }
+
+    static size_t copyNumber(char *dst, size_t cap, uint32_t v) {
+      char tmp[11];
+      uint8_t n = 0;
+      do {
+        tmp[n++] = (char)('0' + v % 10);
+        v /= 10;
+      } while (v);
+      size_t out = 0;
+      while (n && out + 1 < cap) dst[out++] = tmp[--n];
+      return out;
+    }
+};
+
+#endif // METEO_EVENT_STREAM_H
@@ -3,40 +3,64 @@
   
   Метеостанция на ESP8266/ESP32 с датчиком MTS4P+T4.
   Версия с улучшенным Wi-Fi менеджером (Reconnection logic + Modem sleep disable).
+  Страница отдаётся один раз, дальше изменения приходят по /events (SSE).
 */
 
 #include <Arduino.h>
 #include <Wire.h>
 #include "MTS4x.h"
+#include "MTS4xAggregator.h"
+#include "MTS4xCalibration.h"
+#include "MTS4xHistory.h"
+#include "MTS4xOversampler.h"
+#include <LittleFS.h>
+#include <time.h>
 
 #if defined(ESP8266)
   #include <ESP8266WiFi.h>
   #include <ESP8266WebServer.h>
-  ESP8266WebServer server(80);
+  typedef ESP8266WebServer HttpServer;
+  HttpServer server(80);
   #define I2C_SDA_PIN D2
   #define I2C_SCL_PIN D1
 #elif defined(ESP32)
   #include <WiFi.h>
   #include <WebServer.h>
-  WebServer server(80);
+  typedef WebServer HttpServer;
+  HttpServer server(80);
   #define I2C_SDA_PIN 21
   #define I2C_SCL_PIN 22
 #else
   #error "This example is intended for ESP8266 / ESP32 only"
 #endif
 
+// Вкладки скетча - после заголовков веб-сервера (CONTENT_LENGTH_UNKNOWN)
+#include "ResponseWriter.h"
+#include "NarodMonUploader.h"
+#include "EventStream.h"
+
 // --------------------- Настройки пользователя ----------------------
 
 const char* WIFI_SSID     = "YOUR_SSID";      // <-- Впишите имя сети
 const char* WIFI_PASSWORD = "YOUR_PASSWORD";  // <-- Впишите пароль
 
-// Калибровка температуры
+// Калибровка температуры: многоточечная поправка хранится в пользовательских
+// регистрах датчика (MTS4xCalibration) и переезжает вместе с ним. Если её
+// там нет, действует постоянный сдвиг TEMP_OFFSET_C (до ±0.99 °C).
 const float TEMP_OFFSET_C = 0.0f;
 
-// Настройки усреднения UI
-static const uint8_t  UI_SAMPLES_PER_CYCLE   = 8;
+// Цикл измерений UI
 static const unsigned long UI_UPDATE_INTERVAL_MS = 2000UL;
 
+// Усреднение подбирается по измеренному шуму: самая дешёвая пара
+// TempCfgAVG x число замеров с ошибкой среднего не больше цели
+static const uint16_t OS_TARGET_SE_MILLI     = 5;         // 0.005 °C
+static const uint32_t OS_BUDGET_US           = 150000UL;  // на один цикл
+
+// Фильтрация: постоянная времени EMA и порог Hampel (k = 3.0)
+static const uint32_t EMA_TAU_MS             = 60000UL;
+static const uint8_t  HAMPEL_K_TENTHS        = 30;
+
 // Настройки NarodMon (интервал в минутах)
 #ifndef NARODMON_INTERVAL_MINUTES
   #define NARODMON_INTERVAL_MINUTES 5
@@ -45,6 +69,29 @@ static const unsigned long UI_UPDATE_INTERVAL_MS = 2000UL;
 static const unsigned long NARODMON_INTERVAL_MS =
     (unsigned long)NARODMON_INTERVAL_MINUTES * 60UL * 1000UL;
 
+// Сервер можно подменить локальной заглушкой для отладки
+#ifndef NARODMON_HOST
+  #define NARODMON_HOST "narodmon.ru"
+#endif
+#ifndef NARODMON_PORT
+  #define NARODMON_PORT 8283
+#endif
+// Неотправленные средние (переживают перезагрузку)
+static const char*  NARODMON_QUEUE_FILE = "/nm_queue.bin";
+// Метки времени NarodMon - unixtime через NTP
+static const char*  NTP_SERVER          = "pool.ntp.org";
+
+// История: сжатые блоки в RAM, вытесненные блоки дописываются в LittleFS
+// (/history.bin, при переполнении переименовывается в /history.old)
+#if defined(ESP8266)
+static const size_t HISTORY_RAM_BYTES = 16384;   // ~12 ч при цикле 2 с
+#else
+static const size_t HISTORY_RAM_BYTES = 65536;
+#endif
+static const size_t HISTORY_FILE_MAX  = 256UL * 1024UL;
+static const char*  HISTORY_FILE      = "/history.bin";
+static const char*  HISTORY_FILE_OLD  = "/history.old";
+
 // --------------------- Паспортные данные датчика -------------------
 static const char* SENSOR_NAME             = "MTS4P+T4";
 static const char* SENSOR_RANGE_C          = "-40..+85";
@@ -56,6 +103,7 @@ static const float SENSOR_RESOLUTION_C     = 0.004f;
 
 // ----------------------------- Глобальные переменные ----------------
 MTS4X   mts;
+MTS4XOversampler g_os(mts);
 
 // Данные измерений
 float   g_lastTempC        = NAN;
@@ -63,13 +111,27 @@ bool    g_lastTempCrcOk    = false;
 uint32_t g_crcOkTotal      = 0;
 uint32_t g_crcFailTotal    = 0;
 
-// Агрегатор NarodMon
-float    g_nmSumTemp       = 0.0f;
-uint32_t g_nmCount         = 0;
+// Поток отсчётов: отбраковка выбросов, EMA, моменты текущего цикла
+MTS4xAggregator g_agg;
+float    g_lastStdDevC     = NAN;
+
+// Поправка температуры (пользовательские регистры или TEMP_OFFSET_C)
+MTS4xCalibration g_cal;
+
+// Агрегатор NarodMon: моменты циклов сливаются за O(1), без повторного прохода
+MTS4xMoments g_nmWindow;
 uint32_t g_nmCrcSkipped    = 0;
 float    g_nmLastAvg       = NAN;
-bool     g_nmLastSendOk    = false;
-unsigned long g_nmLastSendMs = 0;
+unsigned long g_nmLastQueueMs = 0;
+NarodMonUploader<WiFiClient> g_nm;
+
+// Подписчики /events: кадр изменений собирается раз за цикл измерений
+EventStream<WiFiClient> g_events;
+
+// История измерений (метка времени - секунды с момента загрузки)
+static uint8_t g_historyBuf[HISTORY_RAM_BYTES];
+MTS4xHistory   g_history;
+bool           g_fsOk = false;
 
 // Wi-Fi состояние
 int32_t       g_lastRssiDbm     = -100;
@@ -87,189 +149,431 @@ static int wifiQuality(int32_t rssiDbm) {
   return 2 * (rssiDbm + 100);
 }
 
-static String getMacDashed() {
-  String mac = WiFi.macAddress();
-  mac.replace(":", "-");
-  return mac;
+// "AA-BB-CC-DD-EE-FF" - идентификатор устройства на NarodMon
+static void getMacDashed(char *out) {
+  static const char HEX_DIGITS[] = "0123456789ABCDEF";
+  uint8_t mac[6];
+  WiFi.macAddress(mac);
+  for (uint8_t i = 0; i < 6; ++i) {
+    *out++ = HEX_DIGITS[mac[i] >> 4];
+    *out++ = HEX_DIGITS[mac[i] & 0x0F];
+    if (i < 5) *out++ = '-';
+  }
+  *out = '\0';
 }
 
-static bool sendToNarodMon(float avgTempC) {
-  if (WiFi.status() != WL_CONNECTED) return false;
+// Unixtime или 0, пока NTP не ответил
+static uint32_t unixTimeNow() {
+  time_t t = time(NULL);
+  return (t > 1600000000L) ? (uint32_t)t : 0;
+}
 
-  WiFiClient client;
-  // Таймаут соединения 5 сек
-  client.setTimeout(5000);
-  
-  if (!client.connect("narodmon.ru", 8283)) {
-    return false;
+static uint8_t avgCount(TempCfgAVG avg) {
+  switch (avg) {
+    case AVG_1:  return 1;
+    case AVG_8:  return 8;
+    case AVG_16: return 16;
+    default:     return 32;
   }
+}
 
-  String payload;
-  payload.reserve(64);
-  payload  = "#";
-  payload += getMacDashed();
-  payload += "\n#T1#";
-  payload += String(avgTempC, 2);
-  payload += "\n##\n";
-
-  client.print(payload);
-  
-  // Ждем ответа (необязательно, но полезно для диагностики)
-  unsigned long timeout = millis();
-  while (client.available() == 0) {
-    if (millis() - timeout > 2000) {
-      client.stop();
-      return true; // Считаем, что отправили (UDP-style подход), или false если строг
-    }
+// Вытесненный из RAM блок истории -> LittleFS
+static void spillHistoryBlock(const uint8_t *block, size_t len, void *) {
+  if (!g_fsOk) return;
+  File f = LittleFS.open(HISTORY_FILE, "a");
+  if (!f) return;
+  f.write(block, len);
+  size_t size = f.size();
+  f.close();
+  if (size >= HISTORY_FILE_MAX) {
+    LittleFS.remove(HISTORY_FILE_OLD);
+    LittleFS.rename(HISTORY_FILE, HISTORY_FILE_OLD);
   }
-  client.stop();
-  return true;
 }
 
 static void performMeasurementCycle() {
-  uint8_t okCount = 0;
-  float   sum     = 0.0f;
-
-  for (uint8_t i = 0; i < UI_SAMPLES_PER_CYCLE; ++i) {
+  // AVG и число замеров - по текущему плану
+  if (!g_os.apply()) {
+    ++g_crcFailTotal;
+  }
+  uint8_t samples = g_os.plan().samples;
+  for (uint8_t i = 0; i < samples; ++i) {
     if (!mts.startSingleMessurement()) {
       ++g_crcFailTotal;
-      delay(5);
       continue;
     }
 
-    float tC    = NAN;
-    bool  crcOk = false;
-    // Чтение с проверкой CRC
-    if (!mts.readTemperatureCrc(tC, crcOk, true)) {
+    int16_t raw   = 0;
+    bool    crcOk = false;
+    // Чтение с проверкой CRC, сырой код без float
+    if (!mts.readTemperatureRawWithCrc(raw, crcOk, true)) {
       ++g_crcFailTotal;
-      delay(5);
       continue;
     }
 
     if (crcOk) {
-      tC += TEMP_OFFSET_C;
-      sum += tC;
-      ++okCount;
       ++g_crcOkTotal;
-      
-      // Копим для NarodMon
-      g_nmSumTemp += tC;
-      ++g_nmCount;
+      raw = g_cal.apply(raw);
+      g_os.add(raw);
+      // Выбросы, прошедшие CRC, отсекает фильтр Hampel
+      g_agg.add(raw, millis());
     } else {
       ++g_crcFailTotal;
       ++g_nmCrcSkipped;
     }
-    delay(5);
   }
+  if (g_os.endCycle()) {
+    Serial.print(F("[MTS4x] Plan: AVG_"));
+    Serial.print(avgCount(g_os.plan().avg));
+    Serial.print(F(" x "));
+    Serial.print(g_os.plan().samples);
+    Serial.print(F(", noise "));
+    Serial.print(g_os.noiseMilli());
+    Serial.println(F(" m°C"));
+  }
+
+  MTS4xMoments cycle;
+  g_agg.takeWindow(cycle);
 
-  if (okCount > 0) {
-    g_lastTempC     = sum / (float)okCount;
+  if (cycle.count() > 0) {
+    g_lastTempC     = cycle.mean();
+    g_lastStdDevC   = cycle.stddev();
     g_lastTempCrcOk = true;
+    // Копим для NarodMon
+    g_nmWindow.merge(cycle);
+    // В историю - среднее цикла, а не каждый отсчёт: отсчёты цикла
+    // снимаются пачкой за десятки миллисекунд и в секундной шкале
+    // совпали бы по времени; среднее к тому же без шума серии
+    g_history.append(millis() / 1000UL, cycle.meanRaw());
   } else {
     g_lastTempC     = NAN;
+    g_lastStdDevC   = NAN;
     g_lastTempCrcOk = false;
   }
 }
 
 // ----------------------------- HTTP / HTML ---------------------------
 
+// Ответы собираются ResponseWriter из шаблонов во flash, без String
+typedef ResponseWriter<HttpServer> Out;
+
+// Любой не-NULL ctx у fillField - значения для HTML
+static uint8_t g_htmlCtx;
+
+static const char PAGE_ROOT[] PROGMEM =
+  "<!DOCTYPE html><html lang='ru'><head><meta charset='UTF-8'>"
+  "<title>MTS4P+T4 Station</title>"
+  "<meta name='viewport' content='width=device-width,initial-scale=1'>"
+  "<style>"
+  "body{font-family:-apple-system,BlinkMacSystemFont,'Segoe UI',sans-serif;"
+  "background:#111;color:#eee;margin:0;padding:12px;}"
+  ".card{background:#1e1e1e;border-radius:10px;padding:10px 12px;margin-bottom:10px;}"
+  ".temp{font-size:2.6rem;font-weight:600;margin:0.4rem 0;}"
+  ".ok{color:#4caf50;}.fail{color:#ff5252;}.warn{color:#ff9800;}"
+  ".label{font-size:0.85rem;color:#aaa;margin-bottom:0.2rem;}"
+  ".small{font-size:0.78rem;color:#888;}"
+  ".value{font-family:monospace;font-size:0.9rem;}"
+  "</style></head><body>"
+  "<h1>MTS4P+T4 Station</h1>"
+  // Карточка: Температура
+  "<div class='card'>"
+  "<div class='label'>Текущая температура</div><div class='temp'>%TEMP% &deg;C</div>"
+  "<div class='small'>CRC: %CRC% | Всего OK/Fail: %CRC_OK% / %CRC_FAIL%"
+  "<br>EMA: %EMA% | &sigma;: %SIGMA% | Выбросы: %OUTLIERS%"
+  "<br>AVG_%OS_AVG% x %OS_N%, шум %OS_NOISE% m&deg;C, ошибка среднего %OS_SE% m&deg;C</div></div>"
+  // Карточка: Wi-Fi
+  "<div class='card'>"
+  "<div class='label'>Wi-Fi Status</div><div class='value'>"
+  "SSID: %SSID%<br>IP: %IP%<br>RSSI: %RSSI% dBm (%WIFI_Q%%%)%WEAK%"
+  "</div></div>"
+  // Карточка: NarodMon
+  "<div class='card'>"
+  "<div class='label'>NarodMon.ru</div><div class='small'>"
+  "Queue: %NM_COUNT% samples%NM_RANGE%<br>Last Avg: %NM_LAST%"
+  "<br>Unsent: %NM_PENDING% | Sent/Fail: %NM_SENT% / %NM_FAIL%"
+  "</div></div>"
+  "<div class='small'>JSON API: <a href='/json' style='color:#fff'>/json</a>"
+  " | История: <a href='/history' style='color:#fff'>/history</a>"
+  " (%HIST_N% точек, %HIST_BYTES% байт)</div>"
+  // Поля - <span id=ИМЯ>, /events присылает {"ИМЯ":"html",...} только
+  // с изменившимися значениями
+  "<script>if(window.EventSource)new EventSource('/events').onmessage=function(e){"
+  "var d=JSON.parse(e.data);for(var k in d){var el=document.getElementById(k);"
+  "if(el)el.innerHTML=d[k];}};</script>"
+  "</body></html>";
+
+static const char PAGE_JSON[] PROGMEM =
+  "{\"temperature_c\":%TEMP%,"
+  "\"crc_ok\":%CRC%,"
+  "\"stddev_c\":%SIGMA%,"
+  "\"ema_c\":%EMA%,"
+  "\"outliers\":%OUTLIERS%,"
+  "\"oversampling\":{\"avg\":%OS_AVG%,\"samples\":%OS_N%,"
+  "\"noise_mc\":%OS_NOISE%,\"se_mc\":%OS_SE%,\"target_met\":%OS_MET%},"
+  "\"narodmon_last_send_ok\":%NM_OK%,"
+  "\"narodmon_pending\":%NM_PENDING%,"
+  "\"events\":{\"clients\":%EV_CLIENTS%,\"frames\":%EV_FRAMES%,"
+  "\"bytes\":%EV_BYTES%,\"evicted\":%EV_EVICTED%,\"closed\":%EV_CLOSED%},"
+  "\"wifi_rssi\":%RSSI%}";
+
+static void printIp(TextWriter &w, const IPAddress &ip) {
+  for (uint8_t i = 0; i < 4; ++i) {
+    if (i) w.print('.');
+    w.print((uint32_t)ip[i]);
+  }
+}
+
+// Поля, общие для HTML и JSON; ctx != NULL - HTML
+static void fillField(TextWriter &w, const char *name, void *ctx) {
+  bool html = (ctx != NULL);
+  const char *none = html ? "--" : "null";
+
+  if (!strcmp(name, "TEMP")) {
+    w.printFixed(g_lastTempC, 3, html ? "--.-" : "null");
+  } else if (!strcmp(name, "CRC")) {
+    if (html) w.print(g_lastTempCrcOk ? F("<span class='ok'>OK</span>") : F("<span class='fail'>ERR</span>"));
+    else      w.print(g_lastTempCrcOk ? F("true") : F("false"));
+  } else if (!strcmp(name, "CRC_OK")) {
+    w.print(g_crcOkTotal);
+  } else if (!strcmp(name, "CRC_FAIL")) {
+    w.print(g_crcFailTotal);
+  } else if (!strcmp(name, "EMA")) {
+    int32_t emaMilli = 0;
+    if (g_agg.emaMilli(emaMilli)) {
+      w.printMilli(emaMilli, 3);
+      if (html) w.print(F(" &deg;C"));
+    } else {
+      w.print(none);
+    }
+  } else if (!strcmp(name, "SIGMA")) {
+    w.printFixed(g_lastStdDevC, html ? 3 : 4, none);
+  } else if (!strcmp(name, "OUTLIERS")) {
+    w.print(g_agg.rejected());
+  } else if (!strcmp(name, "OS_AVG")) {
+    w.print((uint32_t)avgCount(g_os.plan().avg));
+  } else if (!strcmp(name, "OS_N")) {
+    w.print((uint32_t)g_os.plan().samples);
+  } else if (!strcmp(name, "OS_NOISE")) {
+    w.print(g_os.noiseMilli());
+  } else if (!strcmp(name, "OS_SE")) {
+    w.print(g_os.achievedSeMilli());
+  } else if (!strcmp(name, "OS_MET")) {
+    w.print(g_os.plan().targetMet ? F("true") : F("false"));
+  } else if (!strcmp(name, "SSID")) {
+    w.print((WiFi.status() == WL_CONNECTED) ? WIFI_SSID : "Disconnected");
+  } else if (!strcmp(name, "IP")) {
+    printIp(w, WiFi.localIP());
+  } else if (!strcmp(name, "RSSI")) {
+    w.print(g_lastRssiDbm);
+  } else if (!strcmp(name, "WIFI_Q")) {
+    w.print(wifiQuality(g_lastRssiDbm));
+  } else if (!strcmp(name, "WEAK")) {
+    if (g_lastRssiDbm < -85 && g_lastRssiDbm > -100) {
+      w.print(F(" <span class='warn'>Weak!</span>"));
+    }
+  } else if (!strcmp(name, "NM_COUNT")) {
+    w.print(g_nmWindow.count());
+  } else if (!strcmp(name, "NM_RANGE")) {
+    if (g_nmWindow.count() > 1) {
+      w.print(F(" (min/max "));
+      w.printMilli(mts4x_raw_to_milli(g_nmWindow.minRaw()), 3);
+      w.print(F(" / "));
+      w.printMilli(mts4x_raw_to_milli(g_nmWindow.maxRaw()), 3);
+      w.print(')');
+    }
+  } else if (!strcmp(name, "NM_LAST")) {
+    if (!isnan(g_nmLastAvg)) {
+      w.printFixed(g_nmLastAvg, 3);
+      w.print(F(" &deg;C ("));
+      if (g_nm.lastResult() == NM_RESULT_NONE || g_nm.busy()) {
+        w.print(F("Pending"));
+      } else if (g_nm.lastOk()) {
+        w.print(F("<span class='ok'>Sent</span>"));
+      } else {
+        w.print(F("<span class='fail'>Fail: "));
+        w.print(NarodMonUploader<WiFiClient>::resultName(g_nm.lastResult()));
+        w.print(F("</span>"));
+      }
+      w.print(')');
+    } else {
+      w.print(F("Wait..."));
+    }
+  } else if (!strcmp(name, "NM_OK")) {
+    if (g_nm.lastResult() == NM_RESULT_NONE) w.print(F("null"));
+    else w.print(g_nm.lastOk() ? F("true") : F("false"));
+  } else if (!strcmp(name, "NM_PENDING")) {
+    w.print((uint32_t)g_nm.pending());
+  } else if (!strcmp(name, "NM_SENT")) {
+    w.print(g_nm.sentOk());
+  } else if (!strcmp(name, "NM_FAIL")) {
+    w.print(g_nm.sentFail());
+  } else if (!strcmp(name, "HIST_N")) {
+    w.print(g_history.samples());
+  } else if (!strcmp(name, "HIST_BYTES")) {
+    w.print((uint32_t)g_history.bytesUsed());
+  } else if (!strcmp(name, "EV_CLIENTS")) {
+    w.print((uint32_t)g_events.subscribers());
+  } else if (!strcmp(name, "EV_FRAMES")) {
+    w.print(g_events.framesSent());
+  } else if (!strcmp(name, "EV_BYTES")) {
+    w.print(g_events.bytesSent());
+  } else if (!strcmp(name, "EV_EVICTED")) {
+    w.print(g_events.evicted());
+  } else if (!strcmp(name, "EV_CLOSED")) {
+    w.print(g_events.closed());
+  }
+}
+
+// Поле страницы в <span id=ИМЯ> - его значение потом заменяет /events
+static void fillPage(TextWriter &w, const char *name, void *ctx) {
+  w.print(F("<span id='"));
+  w.print(name);
+  w.print(F("'>"));
+  fillField(w, name, ctx);
+  w.print(F("</span>"));
+}
+
 static void handleRoot() {
-  String page;
-  page.reserve(2048);
-
-  page += F("<!DOCTYPE html><html lang='ru'><head><meta charset='UTF-8'>");
-  page += F("<title>MTS4P+T4 Station</title>");
-  page += F("<meta name='viewport' content='width=device-width,initial-scale=1'>");
-  page += F("<meta http-equiv='refresh' content='5'>");
-  page += F("<style>"
-            "body{font-family:-apple-system,BlinkMacSystemFont,'Segoe UI',sans-serif;"
-            "background:#111;color:#eee;margin:0;padding:12px;}"
-            ".card{background:#1e1e1e;border-radius:10px;padding:10px 12px;margin-bottom:10px;}"
-            ".temp{font-size:2.6rem;font-weight:600;margin:0.4rem 0;}"
-            ".ok{color:#4caf50;}.fail{color:#ff5252;}.warn{color:#ff9800;}"
-            ".label{font-size:0.85rem;color:#aaa;margin-bottom:0.2rem;}"
-            ".small{font-size:0.78rem;color:#888;}"
-            ".value{font-family:monospace;font-size:0.9rem;}"
-            "</style></head><body>");
-
-  page += F("<h1>MTS4P+T4 Station</h1>");
+  Out out(server);
+  out.send(200, "text/html; charset=utf-8", PAGE_ROOT, fillPage, &g_htmlCtx);
+}
 
-  // Карточка: Температура
-  page += F("<div class='card'>");
-  page += F("<div class='label'>Текущая температура</div><div class='temp'>");
-  if (isnan(g_lastTempC)) {
-    page += F("--.- &deg;C");
+// ----------------------------- Живые обновления (SSE) ----------------
+
+// Все поля PAGE_ROOT
+static const char* const LIVE_FIELDS[] = {
+  "TEMP", "CRC", "CRC_OK", "CRC_FAIL", "EMA", "SIGMA", "OUTLIERS",
+  "OS_AVG", "OS_N", "OS_NOISE", "OS_SE",
+  "SSID", "IP", "RSSI", "WIFI_Q", "WEAK",
+  "NM_COUNT", "NM_RANGE", "NM_LAST", "NM_PENDING", "NM_SENT", "NM_FAIL",
+  "HIST_N", "HIST_BYTES"
+};
+static const uint8_t LIVE_COUNT = sizeof(LIVE_FIELDS) / sizeof(LIVE_FIELDS[0]);
+
+// Хэш значения, разосланного всем подписчикам: в кадр попадают только
+// изменившиеся поля
+static uint32_t g_liveHash[LIVE_COUNT];
+static char     g_liveFrame[1024];
+
+static uint32_t fnv1a(const char *s, size_t n) {
+  uint32_t h = 2166136261UL;
+  while (n--) {
+    h ^= (uint8_t)*s++;
+    h *= 16777619UL;
+  }
+  return h;
+}
+
+// Закрывает кадр "data: {...}\n\n" и отправляет; target < 0 - всем
+static void sendLiveFrame(BufferWriter &frame, int8_t target) {
+  frame.print(F("}\n\n"));
+  if (target < 0) {
+    g_events.publish(frame.data(), frame.length());
   } else {
-    page += String(g_lastTempC, 3);
-    page += F(" &deg;C");
+    g_events.send(target, frame.data(), frame.length());
   }
-  page += F("</div>");
-  page += F("<div class='small'>CRC: ");
-  page += g_lastTempCrcOk ? F("<span class='ok'>OK</span>") : F("<span class='fail'>ERR</span>");
-  page += F(" | Всего OK/Fail: ");
-  page += String(g_crcOkTotal) + " / " + String(g_crcFailTotal);
-  page += F("</div></div>");
+  frame.reset();
+}
 
-  // Карточка: Wi-Fi
-  page += F("<div class='card'>");
-  page += F("<div class='label'>Wi-Fi Status</div><div class='value'>");
-  page += F("SSID: ");
-  page += (WiFi.status() == WL_CONNECTED) ? WIFI_SSID : "Disconnected";
-  page += F("<br>IP: ");
-  page += WiFi.localIP().toString();
-  page += F("<br>RSSI: ");
-  page += String(g_lastRssiDbm);
-  page += F(" dBm (");
-  page += String(wifiQuality(g_lastRssiDbm));
-  page += F("%)");
-  if (g_lastRssiDbm < -85 && g_lastRssiDbm > -100) {
-     page += F(" <span class='warn'>Weak!</span>");
+// Кадр изменений всем подписчикам (target < 0) или полный снимок новому.
+// Поля, не влезшие в один кадр, уходят следующим.
+static void publishLive(int8_t target) {
+  if (g_events.subscribers() == 0) {
+    return;
   }
-  page += F("</div></div>");
+  BufferWriter frame(g_liveFrame, sizeof(g_liveFrame));
+  char         valueBuf[128];
+  BufferWriter value(valueBuf, sizeof(valueBuf));
+  bool         empty = true;
+
+  for (uint8_t i = 0; i < LIVE_COUNT; ++i) {
+    value.reset();
+    fillField(value, LIVE_FIELDS[i], &g_htmlCtx);
+    if (value.overflow()) {
+      continue;
+    }
+    if (target < 0) {
+      uint32_t h = fnv1a(value.data(), value.length());
+      if (h == g_liveHash[i]) {
+        continue;
+      }
+      g_liveHash[i] = h;
+    }
 
-  // Карточка: NarodMon
-  page += F("<div class='card'>");
-  page += F("<div class='label'>NarodMon.ru</div><div class='small'>");
-  page += F("Queue: ");
-  page += String(g_nmCount);
-  page += F(" samples<br>Last Avg: ");
-  if (!isnan(g_nmLastAvg)) {
-    page += String(g_nmLastAvg, 3);
-    page += F(" &deg;C (");
-    page += g_nmLastSendOk ? F("<span class='ok'>Sent</span>") : F("<span class='fail'>Fail</span>");
-    page += F(")");
-  } else {
-    page += F("Wait...");
+    // Худший случай: каждый символ экранирован, плюс ,"ИМЯ":"" и "}\n\n"
+    size_t need = strlen(LIVE_FIELDS[i]) + 2 * value.length() + 9;
+    if (!empty && frame.length() + need > sizeof(g_liveFrame)) {
+      sendLiveFrame(frame, target);
+      empty = true;
+    }
+    frame.print(empty ? F("data: {\"") : F(",\""));
+    frame.print(LIVE_FIELDS[i]);
+    frame.print(F("\":\""));
+    for (size_t k = 0; k < value.length(); ++k) {
+      char c = value.data()[k];
+      if (c == '"' || c == '\\') {
+        frame.print('\\');
+      } else if ((uint8_t)c < 0x20) {
+        continue;
+      }
+      frame.print(c);
+    }
+    frame.print('"');
+    empty = false;
+  }
+  if (!empty) {
+    sendLiveFrame(frame, target);
   }
-  page += F("</div></div>");
+}
 
-  page += F("<div class='small'>JSON API: <a href='/json' style='color:#fff'>/json</a></div>");
-  page += F("</body></html>");
-  
-  server.send(200, "text/html; charset=utf-8", page);
+// GET /events: соединение остаётся у g_events, новому подписчику - снимок
+static void handleEvents() {
+  int8_t slot = g_events.subscribe(server.client());
+  if (slot < 0) {
+    server.send(503, "text/plain", "Too many subscribers");
+    return;
+  }
+  publishLive(slot);
 }
 
 static void handleJson() {
-  String json;
-  json.reserve(512);
+  Out out(server);
+  out.send(200, "application/json", PAGE_JSON, fillField, NULL);
+}
 
-  json += F("{");
-  json += F("\"temperature_c\":");
-  if (isnan(g_lastTempC)) json += F("null,");
-  else { json += String(g_lastTempC, 3); json += F(","); }
+// CSV "t,temp_c" за интервал ?from=..&to=.. (секунды с загрузки),
+// отдаётся потоково: файлы LittleFS, затем блоки в RAM
+static bool historyRow(uint32_t t, int16_t raw, void *ctx) {
+  Out *out = (Out *)ctx;
+  out->print(t);
+  out->print(',');
+  out->printMilli(mts4x_raw_to_milli(raw), 3);
+  out->print('\n');
+  return true;
+}
 
-  json += F("\"crc_ok\":");
-  json += g_lastTempCrcOk ? F("true,") : F("false,");
-  
-  json += F("\"narodmon_last_send_ok\":");
-  if (g_nmLastSendMs == 0) json += F("null,");
-  else json += g_nmLastSendOk ? F("true,") : F("false,");
+static void historyFromFile(const char *path, uint32_t from, uint32_t to, Out &out) {
+  if (!g_fsOk) return;
+  File f = LittleFS.open(path, "r");
+  if (!f) return;
+  uint8_t block[MTS4X_HISTORY_BLOCK];
+  while (f.read(block, sizeof(block)) == sizeof(block)) {
+    MTS4xHistory::decodeBlock(block, sizeof(block), from, to, historyRow, &out);
+  }
+  f.close();
+}
 
-  json += F("\"wifi_rssi\":");
-  json += String(g_lastRssiDbm);
-  
-  json += F("}");
-  server.send(200, "application/json", json);
+static void handleHistory() {
+  uint32_t from = server.hasArg("from") ? strtoul(server.arg("from").c_str(), NULL, 10) : 0;
+  uint32_t to   = server.hasArg("to")   ? strtoul(server.arg("to").c_str(), NULL, 10)   : 0xFFFFFFFFUL;
+
+  Out out(server);
+  out.begin(200, "text/csv");
+  out.print(F("t,temp_c\n"));
+  historyFromFile(HISTORY_FILE_OLD, from, to, out);
+  historyFromFile(HISTORY_FILE, from, to, out);
+  g_history.read(from, to, historyRow, &out);
+  out.end();
 }
 
 // ----------------------------- Wi-Fi Logic (IMPROVED) --------------------
@@ -326,14 +630,58 @@ void setup() {
     Serial.println(F("[MTS4x] Error: I2C/Sensor init failed!"));
   } else {
     Serial.println(F("[MTS4x] Sensor found."));
-    // Конфигурация: 1 Гц, AVG 32, Sleep включен
-    mts.setConfig(MPS_1Hz, AVG_32, true);
+  }
+  // Зависшая шина (SDA прижат, NAK): очистка шины и повтор транзакции,
+  // не дольше 20 мс, вместо потери данных до перезагрузки
+  mts.setRecoveryDeadline(20000);
+  // Поправка из регистров датчика; отсчёты корректируются до усреднения,
+  // поэтому EMA, история и NarodMon получают уже исправленную температуру
+  if (g_cal.load(mts)) {
+    Serial.print(F("[MTS4x] Calibration: "));
+    Serial.print(g_cal.points());
+    Serial.println(F(" points"));
+  } else {
+    g_cal.setOffsetMilli((int32_t)lroundf(TEMP_OFFSET_C * 1000.0f));
+  }
+  // AVG выбирает контроллер (начинает с AVG_32), MPS 1 Гц, Sleep включен
+  g_os.setChipConfig(MPS_1Hz, true);
+  g_os.begin(OS_TARGET_SE_MILLI, OS_BUDGET_US);
+  g_agg.begin(EMA_TAU_MS, HAMPEL_K_TENTHS);
+
+  // История: метки времени отсчитываются от загрузки,
+  // поэтому файлы прошлого запуска удаляются
+  g_history.begin(g_historyBuf, sizeof(g_historyBuf), MTS4X_HISTORY_BLOCK);
+#if defined(ESP8266)
+  g_fsOk = LittleFS.begin();
+#else
+  g_fsOk = LittleFS.begin(true);   // форматировать при первом запуске
+#endif
+  if (g_fsOk) {
+    LittleFS.remove(HISTORY_FILE);
+    LittleFS.remove(HISTORY_FILE_OLD);
+    g_history.onSpill(spillHistoryBlock);
+  } else {
+    Serial.println(F("[FS] LittleFS mount failed, history is RAM-only"));
   }
 
   connectWifi();
+  configTime(0, 0, NTP_SERVER);
+
+  // Очередь NarodMon: файл прошлого запуска подхватывается
+  char macId[18];
+  getMacDashed(macId);
+  g_nm.begin(NARODMON_HOST, NARODMON_PORT, macId,
+             g_fsOk ? &LittleFS : NULL, NARODMON_QUEUE_FILE,
+             60000UL, NARODMON_INTERVAL_MS);
+  if (g_nm.pending()) {
+    Serial.print(F("[NarodMon] Restored unsent: "));
+    Serial.println(g_nm.pending());
+  }
 
   server.on("/", handleRoot);
   server.on("/json", handleJson);
+  server.on("/history", handleHistory);
+  server.on("/events", handleEvents);
   server.begin();
   
   g_lastUiUpdateMs  = millis();
@@ -371,27 +719,43 @@ void loop() {
   // 3. Цикл измерений (раз в 2 сек)
   if ((now - g_lastUiUpdateMs) >= UI_UPDATE_INTERVAL_MS) {
     performMeasurementCycle();
+    publishLive(-1);
     g_lastUiUpdateMs = now;
   }
+  g_events.loop(now);
 
-  // 4. Отправка на NarodMon
-  if ((now - g_nmLastSendMs) >= NARODMON_INTERVAL_MS && g_nmCount > 0) {
-    float avg = g_nmSumTemp / (float)g_nmCount;
-    
-    Serial.print(F("[NarodMon] Sending avg="));
-    Serial.print(avg, 2);
-    
-    bool ok = sendToNarodMon(avg);
-    
-    Serial.println(ok ? F(" -> OK") : F(" -> FAIL"));
+  // 4. Среднее за интервал -> очередь NarodMon
+  if ((now - g_nmLastQueueMs) >= NARODMON_INTERVAL_MS && g_nmWindow.count() > 0) {
+    int32_t avgMilli = g_nmWindow.meanMilli();
+    g_nm.enqueue(unixTimeNow(), avgMilli);
+
+    Serial.print(F("[NarodMon] Queued avg="));
+    Serial.print(avgMilli / 1000.0f, 2);
+    Serial.print(F(", unsent="));
+    Serial.println(g_nm.pending());
+
+    g_nmLastAvg     = avgMilli / 1000.0f;
+    g_nmLastQueueMs = now;
 
-    g_nmLastAvg    = avg;
-    g_nmLastSendOk = ok;
-    g_nmLastSendMs = now;
-    
     // Сброс
-    g_nmSumTemp    = 0.0f;
-    g_nmCount      = 0;
+    g_nmWindow.reset();
     g_nmCrcSkipped = 0;
   }
-}
\ No newline at end of file
+
+  // 5. Отправка: один шаг автомата за проход loop()
+  if (g_nm.loop(now)) {
+    Serial.print(F("[NarodMon] "));
+    Serial.print(NarodMonUploader<WiFiClient>::resultName(g_nm.lastResult()));
+    if (g_nm.lastOk()) {
+      Serial.print(F(", batch="));
+      Serial.print(g_nm.lastBatch());
+    } else if (g_nm.lastReply()[0]) {
+      Serial.print(F(": "));
+      Serial.print(g_nm.lastReply());
+    }
+    Serial.print(F(", "));
+    Serial.print(g_nm.lastLatencyMs());
+    Serial.print(F(" ms, unsent="));
+    Serial.println(g_nm.pending());
+  }
+}
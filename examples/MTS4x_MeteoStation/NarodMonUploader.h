@@ -0,0 +1,396 @@
+/*
+  NarodMonUploader.h
+
+  Неблокирующая отправка на narodmon.ru (TCP, порт 8283). Одна попытка -
+  конечный автомат CONNECT -> WRITE -> AWAIT_REPLY -> CLOSE, loop() делает
+  не больше одного шага за вызов и не крутится в ожидании ответа.
+
+  Средние за интервал сначала попадают в ограниченную очередь (кольцо на
+  NARODMON_QUEUE_LEN записей, при переполнении теряется самая старая),
+  очередь сохраняется в файл и переживает перезагрузку. Одно соединение
+  уносит до NARODMON_BATCH записей, каждая со своей меткой unixtime:
+
+    #AA-BB-CC-DD-EE-FF
+    #T1#21.50#1760680800
+    #T1#21.47#1760681100
+    ##
+
+  Записи покидают очередь только после ответа сервера "OK"; таймаут,
+  обрыв или ответ с ошибкой - неудача и повтор с растущей паузой.
+
+  Единственный блокирующий участок - сам connect() (DNS кэшируется):
+  он ограничен NARODMON_CONNECT_TIMEOUT_MS, на ESP8266 через setTimeout().
+
+    NarodMonUploader<WiFiClient> nm;
+    nm.begin("narodmon.ru", 8283, "AA-BB-CC-DD-EE-FF", &LittleFS, "/nm_queue.bin");
+    nm.enqueue(time(nullptr), 21500);   // по интервалу
+    if (nm.loop(millis())) { ... nm.lastResult() ... }   // каждый loop()
+*/
+
+#ifndef METEO_NARODMON_UPLOADER_H
+#define METEO_NARODMON_UPLOADER_H
+
+#include <Arduino.h>
+#include <FS.h>
+#if defined(ESP8266)
+  #include <ESP8266WiFi.h>
+#else
+  #include <WiFi.h>
+#endif
+#include <string.h>
+#include "MTS4x.h"
+
+#ifndef NARODMON_QUEUE_LEN
+  #define NARODMON_QUEUE_LEN 288          // 24 ч при интервале 5 мин
+#endif
+#ifndef NARODMON_BATCH
+  #define NARODMON_BATCH 12               // записей за одно соединение
+#endif
+#ifndef NARODMON_CONNECT_TIMEOUT_MS
+  #define NARODMON_CONNECT_TIMEOUT_MS 2000
+#endif
+#ifndef NARODMON_REPLY_TIMEOUT_MS
+  #define NARODMON_REPLY_TIMEOUT_MS 5000
+#endif
+
+// Итог последней попытки
+enum NarodMonResult {
+  NM_RESULT_NONE = 0,   // попыток ещё не было
+  NM_RESULT_OK,
+  NM_RESULT_NO_WIFI,
+  NM_RESULT_DNS,
+  NM_RESULT_CONNECT,
+  NM_RESULT_WRITE,
+  NM_RESULT_TIMEOUT,    // сервер не ответил за NARODMON_REPLY_TIMEOUT_MS
+  NM_RESULT_CLOSED,     // соединение закрыто без ответа
+  NM_RESULT_REJECTED    // ответ не "OK" (текст в lastReply())
+};
+
+struct NarodMonReading {
+  uint32_t time;        // unixtime, 0 - часы ещё не синхронизированы
+  int32_t  milliC;
+};
+
+template <class Client>
+class NarodMonUploader {
+  public:
+    NarodMonUploader()
+    : _host(NULL), _port(0), _fs(NULL), _path(NULL),
+      _head(0), _count(0), _dropped(0),
+      _state(IDLE), _result(NM_RESULT_NONE), _ipValid(false),
+      _batch(0), _len(0), _pos(0), _replyLen(0),
+      _startMs(0), _stateMs(0), _nextTryMs(0), _retryMs(0),
+      _retryMinMs(60000UL), _retryMaxMs(300000UL),
+      _latencyMs(0), _okCount(0), _failCount(0) {
+      _id[0]    = '\0';
+      _reply[0] = '\0';
+    }
+
+    // fs == NULL - очередь только в RAM
+    void begin(const char *host, uint16_t port, const char *deviceId,
+               fs::FS *fs = NULL, const char *path = NULL,
+               uint32_t retryMinMs = 60000UL, uint32_t retryMaxMs = 300000UL) {
+      _host       = host;
+      _port       = port;
+      _fs         = path ? fs : NULL;
+      _path       = path;
+      _retryMinMs = retryMinMs;
+      _retryMaxMs = (retryMaxMs < retryMinMs) ? retryMinMs : retryMaxMs;
+      _retryMs    = _retryMinMs;
+      _ipValid    = false;
+      strncpy(_id, deviceId ? deviceId : "", sizeof(_id) - 1);
+      _id[sizeof(_id) - 1] = '\0';
+      load();
+    }
+
+    // Новое среднее в конец очереди. Без синхронизированных часов (time == 0)
+    // хранится только одна, самая свежая запись без метки.
+    void enqueue(uint32_t unixTime, int32_t milliC) {
+      if (unixTime == 0 && _count && at(_count - 1).time == 0 && !inFlight(_count - 1)) {
+        at(_count - 1).milliC = milliC;
+      } else {
+        if (_count == NARODMON_QUEUE_LEN) {
+          dropOldest();
+        }
+        NarodMonReading &r = at(_count);
+        r.time   = unixTime;
+        r.milliC = milliC;
+        ++_count;
+      }
+      save();
+    }
+
+    // Один шаг автомата. true - попытка только что завершилась (см. lastResult()).
+    bool loop(uint32_t nowMs) {
+      switch (_state) {
+        case IDLE:
+          if (_count == 0 || (int32_t)(nowMs - _nextTryMs) < 0) {
+            return false;
+          }
+          _startMs = nowMs;
+          if (WiFi.status() != WL_CONNECTED) {
+            return finish(NM_RESULT_NO_WIFI, nowMs);
+          }
+          buildPayload();
+          _state   = CONNECT;
+          _stateMs = nowMs;
+          return false;
+
+        case CONNECT:
+          if (!_ipValid) {
+            _ipValid = WiFi.hostByName(_host, _ip) == 1;
+            if (!_ipValid) {
+              return finish(NM_RESULT_DNS, nowMs);
+            }
+          }
+#if defined(ESP32)
+          if (!_client.connect(_ip, _port, NARODMON_CONNECT_TIMEOUT_MS)) {
+#else
+          _client.setTimeout(NARODMON_CONNECT_TIMEOUT_MS);
+          if (!_client.connect(_ip, _port)) {
+#endif
+            _ipValid = false;   // адрес мог смениться
+            return finish(NM_RESULT_CONNECT, nowMs);
+          }
+          _state   = WRITE;
+          _stateMs = nowMs;
+          return false;
+
+        case WRITE: {
+          // Кусками, чтобы не держать loop() на медленном канале
+          size_t part = _len - _pos;
+          if (part > 128) part = 128;
+          size_t n = _client.write((const uint8_t *)_payload + _pos, part);
+          if (n == 0) {
+            return finish(NM_RESULT_WRITE, nowMs);
+          }
+          _pos += n;
+          if (_pos == _len) {
+            _state    = AWAIT_REPLY;
+            _stateMs  = nowMs;
+            _replyLen = 0;
+          }
+          return false;
+        }
+
+        case AWAIT_REPLY:
+          while (_client.available() > 0) {
+            int c = _client.read();
+            if (c < 0) break;
+            if (c == '\n' || c == '\r') {
+              if (_replyLen) return finishReply(nowMs);
+              continue;
+            }
+            if (_replyLen < sizeof(_reply) - 1) {
+              _reply[_replyLen++] = (char)c;
+            }
+          }
+          if (!_client.connected()) {
+            // Ответ без перевода строки тоже ответ
+            return _replyLen ? finishReply(nowMs) : finish(NM_RESULT_CLOSED, nowMs);
+          }
+          if (nowMs - _stateMs >= NARODMON_REPLY_TIMEOUT_MS) {
+            return finish(NM_RESULT_TIMEOUT, nowMs);
+          }
+          return false;
+      }
+      return false;
+    }
+
+    bool           busy() const        { return _state != IDLE; }
+    NarodMonResult lastResult() const  { return _result; }
+    bool           lastOk() const      { return _result == NM_RESULT_OK; }
+    const char    *lastReply() const   { return _reply; }
+    uint32_t       lastLatencyMs() const { return _latencyMs; }   // длительность попытки
+    uint32_t       lastBatch() const   { return _batch; }      // записей в удачной пачке
+    uint16_t       pending() const     { return _count; }
+    uint32_t       dropped() const     { return _dropped; }
+    uint32_t       sentOk() const      { return _okCount; }
+    uint32_t       sentFail() const    { return _failCount; }
+
+    static const char *resultName(NarodMonResult r) {
+      switch (r) {
+        case NM_RESULT_OK:       return "ok";
+        case NM_RESULT_NO_WIFI:  return "no wifi";
+        case NM_RESULT_DNS:      return "dns";
+        case NM_RESULT_CONNECT:  return "connect";
+        case NM_RESULT_WRITE:    return "write";
+        case NM_RESULT_TIMEOUT:  return "timeout";
+        case NM_RESULT_CLOSED:   return "closed";
+        case NM_RESULT_REJECTED: return "rejected";
+        default:                 return "none";
+      }
+    }
+
+  private:
+    enum State { IDLE, CONNECT, WRITE, AWAIT_REPLY };
+
+    static const uint32_t FILE_MAGIC = 0x31514D4EUL;   // "NMQ1"
+
+    const char      *_host;
+    uint16_t         _port;
+    fs::FS          *_fs;
+    const char      *_path;
+    char             _id[24];
+
+    NarodMonReading  _queue[NARODMON_QUEUE_LEN];
+    uint16_t         _head;
+    uint16_t         _count;
+    uint32_t         _dropped;
+
+    Client           _client;
+    State            _state;
+    NarodMonResult   _result;
+    IPAddress        _ip;
+    bool             _ipValid;
+
+    // "#" + id + строки "#T1#-123.45#4294967295\n" + "##\n"
+    char             _payload[sizeof(_id) + 3 + NARODMON_BATCH * 24 + 4];
+    uint16_t         _batch;
+    size_t           _len;
+    size_t           _pos;
+    char             _reply[48];
+    uint8_t          _replyLen;
+
+    uint32_t         _startMs;
+    uint32_t         _stateMs;
+    uint32_t         _nextTryMs;
+    uint32_t         _retryMs;
+    uint32_t         _retryMinMs;
+    uint32_t         _retryMaxMs;
+    uint32_t         _latencyMs;
+    uint32_t         _okCount;
+    uint32_t         _failCount;
+
+    NarodMonReading &at(uint16_t i) {
+      return _queue[(_head + i) % NARODMON_QUEUE_LEN];
+    }
+
+    bool inFlight(uint16_t i) const {
+      return _state != IDLE && i < _batch;
+    }
+
+    void dropOldest() {
+      _head = (uint16_t)((_head + 1) % NARODMON_QUEUE_LEN);
+      --_count;
+      ++_dropped;
+      // Отправляемая пачка сдвигается вместе с головой
+      if (_state != IDLE && _batch) {
+        --_batch;
+      }
+    }
+
+    void append(const char *s, size_t n) {
+      if (_len + n > sizeof(_payload)) n = sizeof(_payload) - _len;
+      memcpy(_payload + _len, s, n);
+      _len += n;
+    }
+
+    void appendU32(uint32_t v) {
+      char    tmp[10];
+      uint8_t n = 0;
+      do {
+        tmp[n++] = (char)('0' + v % 10);
+        v /= 10;
+      } while (v);
+      while (n) {
+        --n;
+        append(&tmp[n], 1);
+      }
+    }
+
+    // Самые старые записи первыми; запись без метки - только последней
+    void buildPayload() {
+      _len = 0;
+      _pos = 0;
+      append("#", 1);
+      append(_id, strlen(_id));
+      append("\n", 1);
+      _batch = 0;
+      while (_batch < _count && _batch < NARODMON_BATCH) {
+        const NarodMonReading &r = at(_batch);
+        char   val[16];
+        size_t n = mts4x_format_milli(val, sizeof(val), r.milliC, 2);
+        append("#T1#", 4);
+        append(val, n);
+        if (r.time) {
+          append("#", 1);
+          appendU32(r.time);
+        }
+        append("\n", 1);
+        ++_batch;
+        if (!r.time) break;
+      }
+      append("##\n", 3);
+    }
+
+    bool finishReply(uint32_t nowMs) {
+      _reply[_replyLen] = '\0';
+      return finish(strncmp(_reply, "OK", 2) == 0 ? NM_RESULT_OK : NM_RESULT_REJECTED, nowMs);
+    }
+
+    bool finish(NarodMonResult r, uint32_t nowMs) {
+      if (_state != IDLE) {
+        _client.stop();
+      }
+      if (r != NM_RESULT_REJECTED) {
+        _reply[_replyLen = 0] = '\0';
+      }
+      _latencyMs = nowMs - _startMs;
+      _result    = r;
+      _state     = IDLE;
+      if (r == NM_RESULT_OK) {
+        _head    = (uint16_t)((_head + _batch) % NARODMON_QUEUE_LEN);
+        _count   = (uint16_t)(_count - _batch);
+        _retryMs = _retryMinMs;
+        // Остаток очереди - следующим соединением, но не раньше паузы
+        _nextTryMs = nowMs + _retryMinMs;
+        ++_okCount;
+        save();
+      } else {
+        _batch     = 0;
+        _nextTryMs = nowMs + _retryMs;
+        _retryMs   = (_retryMs > _retryMaxMs / 2) ? _retryMaxMs : _retryMs * 2;
+        ++_failCount;
+      }
+      return true;
+    }
+
+    // Файл: magic u32 | count u16 | count * (time u32, milliC i32), старые первыми
+    void save() {
+      if (!_fs) return;
+      fs::File f = _fs->open(_path, "w");
+      if (!f) return;
+      uint32_t magic = FILE_MAGIC;
+      f.write((const uint8_t *)&magic, sizeof(magic));
+      f.write((const uint8_t *)&_count, sizeof(_count));
+      for (uint16_t i = 0; i < _count; ++i) {
+        f.write((const uint8_t *)&at(i), sizeof(NarodMonReading));
+      }
+      f.close();
+    }
+
+    // Записи без метки после перезагрузки теряют смысл и отбрасываются
+    void load() {
+      _head  = 0;
+      _count = 0;
+      if (!_fs) return;
+      fs::File f = _fs->open(_path, "r");
+      if (!f) return;
+      uint32_t magic = 0;
+      uint16_t n     = 0;
+      if (f.read((uint8_t *)&magic, sizeof(magic)) == sizeof(magic) && magic == FILE_MAGIC &&
+          f.read((uint8_t *)&n, sizeof(n)) == sizeof(n)) {
+        NarodMonReading r;
+        while (n-- && f.read((uint8_t *)&r, sizeof(r)) == sizeof(r)) {
+          if (r.time == 0) continue;
+          if (_count == NARODMON_QUEUE_LEN) dropOldest();
+          at(_count) = r;
+          ++_count;
+        }
+      }
+      f.close();
+    }
+};
+
+#endif // METEO_NARODMON_UPLOADER_H
@@ -0,0 +1,305 @@
+/*
+  ResponseWriter.h
+
+  Потоковая отдача HTTP-ответа из фиксированного буфера: текст шаблонов
+  читается прямо из PROGMEM, числа форматируются на месте, готовые куски
+  уходят клиенту через sendContent. Ни один запрос не создаёт String и не
+  выделяет память в куче.
+
+  Шаблон - обычная строка PROGMEM с полями %NAME% (имя до 15 символов),
+  "%%" выводит сам символ '%'. Значение поля пишет функция fill():
+
+    static void fill(TextWriter &w, const char *name, void *ctx) {
+      if (!strcmp(name, "TEMP")) w.printFixed(g_lastTempC, 3);
+    }
+    ResponseWriter<WebServer> out(server);
+    out.send(200, "text/html; charset=utf-8", PAGE_TEMPLATE, fill, NULL);
+
+  send() отдаёт тело с Content-Length, без chunked-обрамления: ответ,
+  поместившийся в буфер, - за один проход и одну запись в сокет; больший
+  шаблон проходится дважды (длина, затем тело по записи на буфер). Ответ
+  неизвестной длины (поток строк) - begin(), print/render, end() кусками
+  chunked transfer.
+
+  Те же print/render пишут и в память: BufferWriter собирает текст в
+  фиксированный буфер (события /events, значения отдельных полей).
+*/
+
+#ifndef METEO_RESPONSE_WRITER_H
+#define METEO_RESPONSE_WRITER_H
+
+#include <Arduino.h>
+#include <string.h>
+#include "MTS4x.h"
+
+#ifndef RESPONSE_CHUNK_SIZE
+  #define RESPONSE_CHUNK_SIZE 512
+#endif
+
+// Форматирование и шаблоны поверх буфера; куда уходит заполненный буфер,
+// решает наследник (emit). Без буфера (buf == NULL) только считает байты.
+class TextWriter {
+  public:
+    typedef void (*FieldFn)(TextWriter &w, const char *name, void *ctx);
+
+    TextWriter(char *buf, size_t size) : _buf(buf), _size(size), _len(0), _total(0) {}
+
+    void print(const __FlashStringHelper *s) {
+      PGM_P p = reinterpret_cast<PGM_P>(s);
+      write_P(p, strlen_P(p));
+    }
+
+    void print(const char *s) {
+      write(s, strlen(s));
+    }
+
+    void print(char c) {
+      if (_len == _size) flush();
+      if (!_buf) {
+        ++_total;
+        return;
+      }
+      _buf[_len++] = c;
+    }
+
+    void print(long v) {
+      if (v < 0) {
+        print('-');
+        print((unsigned long)(-(v + 1)) + 1UL);
+      } else {
+        print((unsigned long)v);
+      }
+    }
+
+    void print(unsigned long v) {
+      char tmp[20];
+      uint8_t n = 0;
+      do {
+        tmp[n++] = (char)('0' + v % 10);
+        v /= 10;
+      } while (v);
+      while (n) print(tmp[--n]);
+    }
+
+    // int32_t/uint32_t - это int или long в зависимости от платформы
+    void print(int v)          { print((long)v); }
+    void print(unsigned int v) { print((unsigned long)v); }
+
+    // m°C -> "21.500" (0..3 знака)
+    void printMilli(int32_t mC, uint8_t decimals = 3) {
+      char tmp[16];
+      size_t n = mts4x_format_milli(tmp, sizeof(tmp), mC, decimals);
+      write(tmp, n);
+    }
+
+    // Число с фиксированной точкой (0..6 знаков) без dtostrf/String;
+    // NaN и бесконечность выводятся как nanText
+    void printFixed(float v, uint8_t decimals, const char *nanText = "null") {
+      if (isnan(v) || isinf(v)) {
+        print(nanText);
+        return;
+      }
+      if (decimals > 6) decimals = 6;
+      uint32_t scale = 1;
+      for (uint8_t i = 0; i < decimals; ++i) scale *= 10;
+      bool neg = v < 0.0f;
+      float a = neg ? -v : v;
+      if (a * scale > 4.0e9f) {
+        print(nanText);
+        return;
+      }
+      uint32_t n = (uint32_t)lroundf(a * scale);
+      if (neg && n) print('-');
+      print(n / scale);
+      if (decimals) {
+        print('.');
+        uint32_t frac = n % scale;
+        for (uint32_t d = scale / 10; d; d /= 10) {
+          print((char)('0' + (frac / d) % 10));
+        }
+      }
+    }
+
+    // Выводит шаблон из PROGMEM, поля %NAME% заполняет fill()
+    void render(PGM_P tpl, FieldFn fill, void *ctx) {
+      while (true) {
+        // Литеральный участок до '%' копируется одним куском
+        PGM_P run = tpl;
+        char  c;
+        while ((c = (char)pgm_read_byte(tpl)) != '\0' && c != '%') {
+          ++tpl;
+        }
+        write_P(run, (size_t)(tpl - run));
+        if (c == '\0') {
+          return;
+        }
+        ++tpl;
+
+        char    name[16];
+        uint8_t n = 0;
+        while ((c = (char)pgm_read_byte(tpl)) != '\0' && c != '%' && n < sizeof(name) - 1) {
+          name[n++] = c;
+          ++tpl;
+        }
+        name[n] = '\0';
+        if (c != '%') {
+          // Не поле: выводим как есть
+          print('%');
+          print(name);
+          continue;
+        }
+        ++tpl;
+        if (n == 0) {
+          print('%');
+        } else if (fill) {
+          fill(*this, name, ctx);
+        }
+      }
+    }
+
+    // Байт тела, отправленных и в буфере
+    uint32_t total() const { return _total + _len; }
+
+    void write(const char *data, size_t n) {
+      while (n) {
+        if (_len == _size) flush();
+        if (!_buf) {
+          _total += n;
+          return;
+        }
+        size_t part = _size - _len;
+        if (part > n) part = n;
+        memcpy(_buf + _len, data, part);
+        _len += part;
+        data += part;
+        n    -= part;
+      }
+    }
+
+    void write_P(PGM_P data, size_t n) {
+      while (n) {
+        if (_len == _size) flush();
+        if (!_buf) {
+          _total += n;
+          return;
+        }
+        size_t part = _size - _len;
+        if (part > n) part = n;
+        memcpy_P(_buf + _len, data, part);
+        _len += part;
+        data += part;
+        n    -= part;
+      }
+    }
+
+  protected:
+    char    *_buf;
+    size_t   _size;
+    size_t   _len;
+    uint32_t _total;
+
+    virtual void emit(const char *data, size_t n) = 0;
+
+    void flush() {
+      if (_len) {
+        emit(_buf, _len);
+        _total += _len;
+        _len = 0;
+      }
+    }
+};
+
+// HTTP-ответ: шаблон целиком (send) или кусками chunked transfer
+template <class Server>
+class ResponseWriter : public TextWriter {
+  public:
+    explicit ResponseWriter(Server &server)
+    : TextWriter(_chunk, sizeof(_chunk)), _server(server), _left(0), _mode(STREAM) {}
+
+    // Ответ по шаблону с Content-Length. Первый проход пишет в буфер; если
+    // ответ не поместился, дальше только считает, и тело отдаёт второй
+    // проход. Поля между проходами не меняются (всё в одном вызове loop());
+    // если всё же разошлись, тело обрезается или добивается пробелами до
+    // объявленной длины.
+    void send(int code, const char *contentType, PGM_P tpl, FieldFn fill, void *ctx) {
+      _mode = PROBE;
+      render(tpl, fill, ctx);
+      uint32_t length = total();
+      _server.setContentLength(length);
+      _server.send(code, contentType, "");
+      if (_buf) {
+        _mode = STREAM;
+        flush();
+        return;
+      }
+      _buf   = _chunk;
+      _len   = 0;
+      _total = 0;
+      _left  = length;
+      _mode  = FIXED;
+      render(tpl, fill, ctx);
+      while (total() < length) print(' ');
+      flush();
+      _mode = STREAM;
+    }
+
+    // Заголовки без Content-Length: дальше идут только куски тела
+    void begin(int code, const char *contentType) {
+      _server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+      _server.send(code, contentType, "");
+    }
+
+    // Досылает буфер и пустой кусок - конец chunked-ответа
+    void end() {
+      flush();
+      _server.sendContent("");
+    }
+
+  private:
+    enum Mode { STREAM, PROBE, FIXED };
+
+    Server  &_server;
+    char     _chunk[RESPONSE_CHUNK_SIZE];
+    uint32_t _left;    // FIXED: сколько тела ещё можно отдать
+    Mode     _mode;
+
+    void emit(const char *data, size_t n) override {
+      if (_mode == PROBE) {
+        _buf = NULL;   // не поместилось: до конца прохода только счёт
+        return;
+      }
+      if (_mode == FIXED) {
+        if (n > _left) n = _left;
+        _left -= n;
+        if (!n) return;
+      }
+      _server.sendContent(data, n);
+    }
+};
+
+// Текст в буфере вызывающего; не поместилось - overflow(), текст неполный
+class BufferWriter : public TextWriter {
+  public:
+    BufferWriter(char *buf, size_t size) : TextWriter(buf, size), _overflow(false) {}
+
+    void reset() {
+      _len      = 0;
+      _total    = 0;
+      _overflow = false;
+    }
+
+    const char *data() const { return _buf; }
+    size_t      length() const { return _len; }
+    bool        overflow() const { return _overflow; }
+
+  private:
+    bool _overflow;
+
+    void emit(const char *data, size_t n) override {
+      (void)data;
+      (void)n;
+      _overflow = true;
+    }
+};
+
+#endif // METEO_RESPONSE_WRITER_H
@@ -0,0 +1,93 @@
+/*
+  MTS4x_SizeCheck.ino
+
+  Эталонный скетч для контроля размера прошивки: один и тот же сценарий
+  (begin, настройка, чтение в m°C раз в секунду) в разных конфигурациях
+  драйвера. Конфигурация выбирается флагом сборки -DMTS4X_SIZE_CONFIG=N,
+  размеры flash/RAM по всем конфигурациям собирает extras/size_report.sh.
+
+    0 - MTS4X (полный драйвер), CRC включён
+    1 - MTS4XSensor<MTS4P>, все функции
+    2 - MTS4XSensor<MTS4P, CRC>
+    3 - MTS4XSensor<MTS4P, без CRC>
+    4 - MTS4X + пороги Alert и нагреватель
+    5 - MTS4XSensor<MTS4P, CRC | ALERT | HEATER>, то же самое
+
+  Конфигурации 1..3 собираются в один и тот же код: маска функций
+  MTS4XSensor только запрещает вызовы при компиляции, а чтение идёт через
+  те же методы MTS4X. Они оставлены, чтобы это было видно в отчёте.
+*/
+
+#include <Arduino.h>
+#include <Wire.h>
+#include "MTS4x.h"
+#include "MTS4xVariant.h"
+
+#ifndef MTS4X_SIZE_CONFIG
+#define MTS4X_SIZE_CONFIG 0
+#endif
+
+#if defined(ESP8266)
+  #define I2C_SDA_PIN D2
+  #define I2C_SCL_PIN D1
+#elif defined(ESP32)
+  #define I2C_SDA_PIN 21
+  #define I2C_SCL_PIN 22
+#else
+  #define I2C_SDA_PIN -1   // пины Wire по умолчанию
+  #define I2C_SCL_PIN -1
+#endif
+
+#if MTS4X_SIZE_CONFIG == 0 || MTS4X_SIZE_CONFIG == 4
+  #define USE_FULL_DRIVER 1
+  MTS4X mts;
+#elif MTS4X_SIZE_CONFIG == 1
+  MTS4XSensor<MTS4xVariantMTS4P> mts;
+#elif MTS4X_SIZE_CONFIG == 2
+  MTS4XSensor<MTS4xVariantMTS4P, MTS4X_FEAT_CRC> mts;
+#elif MTS4X_SIZE_CONFIG == 3
+  MTS4XSensor<MTS4xVariantMTS4P, 0> mts;
+#elif MTS4X_SIZE_CONFIG == 5
+  MTS4XSensor<MTS4xVariantMTS4P, MTS4X_FEAT_CRC | MTS4X_FEAT_ALERT | MTS4X_FEAT_HEATER> mts;
+#else
+  #error "MTS4X_SIZE_CONFIG: 0..5"
+#endif
+
+#define WITH_ALERT (MTS4X_SIZE_CONFIG == 4 || MTS4X_SIZE_CONFIG == 5)
+
+static bool readMilli(int32_t &mC) {
+#ifdef USE_FULL_DRIVER
+  return mts.readTemperatureMilli(mC);
+#else
+  return mts.readMilli(mC);
+#endif
+}
+
+void setup() {
+  Serial.begin(115200);
+  bool ok = mts.begin(I2C_SDA_PIN, I2C_SCL_PIN) &&
+            mts.setConfig(MPS_1Hz, AVG_8, false);
+#if WITH_ALERT
+  // Пороги 5..40 °C, аварийный выход вне окна; короткий прогрев нагревателем
+  ok = ok && mts.setLimitsRaw(mts4x_milli_to_raw(40000), mts4x_milli_to_raw(5000)) &&
+       mts.setAlertMode(true, ALERT_MODE_HIGH_TH_LOW_ALARM) &&
+       mts.heaterOn() && mts.heaterOff();
+#endif
+#ifdef USE_FULL_DRIVER
+  ok = ok && mts.setMode(MEASURE_CONTINUOUS, false);
+#else
+  ok = ok && mts.setMode(MEASURE_CONTINUOUS);
+#endif
+  if (!ok) {
+    Serial.print("MTS4x init error ");
+    Serial.println(mts.lastError());
+  }
+}
+
+void loop() {
+  int32_t mC = 0;
+  if (readMilli(mC)) {
+    Serial.println(mC);
+  }
+  delay(1000);
+}
@@ -0,0 +1,34 @@
+// MTS4x Arduino driver - minimal check helpers for the host tests
+// Author: Denis (FedunovDenis)
+
+#ifndef __MTS4X_HOST_TEST_H__
+#define __MTS4X_HOST_TEST_H__
+
+#include <stdio.h>
+
+static int host_failures = 0;
+
+#define CHECK(cond) do {                                                    \
+        if (!(cond)) {                                                      \
+            printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+            ++host_failures;                                                \
+        }                                                                   \
+    } while (0)
+
+#define CHECK_EQ(a, b) do {                                                 \
+        long long a_ = (long long)(a);                                      \
+        long long b_ = (long long)(b);                                      \
+        if (a_ != b_) {                                                     \
+            printf("%s:%d: CHECK_EQ(%s, %s) failed: %lld != %lld\n",        \
+                   __FILE__, __LINE__, #a, #b, a_, b_);                     \
+            ++host_failures;                                                \
+        }                                                                   \
+    } while (0)
+
+// Last line of every test binary, its exit code
+static inline int host_test_result(const char *name) {
+    printf("%s: %s\n", name, host_failures ? "FAIL" : "PASS");
+    return host_failures ? 1 : 0;
+}
+
+#endif // __MTS4X_HOST_TEST_H__
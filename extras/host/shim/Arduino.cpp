@@ -0,0 +1,120 @@
+#include <Arduino.h>
+#include <Wire.h>
+#include <stdio.h>
+#include <time.h>
+
+// -----------------------------------------------------------------------------
+// Time
+// -----------------------------------------------------------------------------
+
+static uint64_t host_skipped_us = 0;
+
+static uint64_t host_now_us() {
+    static struct timespec start;
+    static bool            started = false;
+    struct timespec        ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    if (!started) {
+        start   = ts;
+        started = true;
+    }
+    return (uint64_t)(ts.tv_sec - start.tv_sec) * 1000000ULL +
+           (uint64_t)((ts.tv_nsec - start.tv_nsec) / 1000) + host_skipped_us;
+}
+
+void host_advance_ms(unsigned long ms) {
+    host_skipped_us += (uint64_t)ms * 1000ULL;
+}
+
+unsigned long millis() {
+    return (unsigned long)(host_now_us() / 1000ULL);
+}
+
+unsigned long micros() {
+    return (unsigned long)host_now_us();
+}
+
+void delay(unsigned long ms) {
+    struct timespec ts;
+    ts.tv_sec  = (time_t)(ms / 1000UL);
+    ts.tv_nsec = (long)(ms % 1000UL) * 1000000L;
+    nanosleep(&ts, NULL);
+}
+
+void delayMicroseconds(unsigned int us) {
+    struct timespec ts;
+    ts.tv_sec  = (time_t)(us / 1000000U);
+    ts.tv_nsec = (long)(us % 1000000U) * 1000L;
+    nanosleep(&ts, NULL);
+}
+
+void yield() {
+}
+
+// -----------------------------------------------------------------------------
+// Pins and interrupts
+// -----------------------------------------------------------------------------
+
+void pinMode(uint8_t pin, uint8_t mode) {
+    (void)pin;
+    (void)mode;
+}
+
+void digitalWrite(uint8_t pin, uint8_t value) {
+    (void)pin;
+    (void)value;
+}
+
+int digitalRead(uint8_t pin) {
+    (void)pin;
+    return HIGH;
+}
+
+void noInterrupts() {
+}
+
+void interrupts() {
+}
+
+// -----------------------------------------------------------------------------
+// Serial and Wire
+// -----------------------------------------------------------------------------
+
+size_t HostSerial::print(const char *s) {
+    return (size_t)printf("%s", s);
+}
+
+size_t HostSerial::print(const __FlashStringHelper *s) {
+    return print(reinterpret_cast<const char *>(s));
+}
+
+size_t HostSerial::print(char c) {
+    return (size_t)printf("%c", c);
+}
+
+size_t HostSerial::print(int v) {
+    return (size_t)printf("%d", v);
+}
+
+size_t HostSerial::print(unsigned int v) {
+    return (size_t)printf("%u", v);
+}
+
+size_t HostSerial::print(long v) {
+    return (size_t)printf("%ld", v);
+}
+
+size_t HostSerial::print(unsigned long v) {
+    return (size_t)printf("%lu", v);
+}
+
+size_t HostSerial::print(double v, int decimals) {
+    return (size_t)printf("%.*f", decimals, v);
+}
+
+size_t HostSerial::println() {
+    return (size_t)printf("\n");
+}
+
+HostSerial Serial;
+TwoWire    Wire;
@@ -0,0 +1,92 @@
+// MTS4x Arduino driver - minimal Arduino API for host builds
+// Author: Denis (FedunovDenis)
+//
+// Only what the library, its host tests and the MeteoStation example use:
+// monotonic time, no-op pins (inputs read HIGH), flash-string macros as
+// plain pointers and a Serial that prints to stdout. Not a general Arduino
+// emulation.
+
+#ifndef __MTS4X_HOST_ARDUINO_H__
+#define __MTS4X_HOST_ARDUINO_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#define HIGH         1
+#define LOW          0
+#define INPUT        0
+#define OUTPUT       1
+#define INPUT_PULLUP 2
+
+#define SDA 4
+#define SCL 5
+
+#if defined(ESP8266)
+  #define D1 5
+  #define D2 4
+#endif
+
+// Time since start of the process
+unsigned long millis();
+unsigned long micros();
+void          delay(unsigned long ms);
+void          delayMicroseconds(unsigned int us);
+void          yield();
+
+// Host only: moves millis()/micros() forward without sleeping, so a test
+// can run minutes of a sketch's loop() in a moment
+void          host_advance_ms(unsigned long ms);
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+int  digitalRead(uint8_t pin);
+
+void noInterrupts();
+void interrupts();
+
+// Flash strings are ordinary strings on the host
+class __FlashStringHelper;
+typedef const char *PGM_P;
+#define PROGMEM
+#define PSTR(s)           (s)
+#define F(s)              (reinterpret_cast<const __FlashStringHelper *>(s))
+#define pgm_read_byte(p)  (*(const uint8_t *)(p))
+#define pgm_read_word(p)  (*(const uint16_t *)(p))
+#define memcpy_P          memcpy
+#define strlen_P          strlen
+
+class HostSerial;
+
+// Objects that know how to print themselves (IPAddress)
+class Printable {
+  public:
+    virtual ~Printable() {}
+    virtual size_t printTo(HostSerial &out) const = 0;
+};
+
+class HostSerial {
+  public:
+    void begin(unsigned long baud) { (void)baud; }
+    operator bool() const { return true; }
+
+    size_t print(const char *s);
+    size_t print(const __FlashStringHelper *s);
+    size_t print(char c);
+    size_t print(int v);
+    size_t print(unsigned int v);
+    size_t print(long v);
+    size_t print(unsigned long v);
+    size_t print(double v, int decimals = 2);
+    size_t print(const Printable &p) { return p.printTo(*this); }
+
+    size_t println();
+    template <class T> size_t println(T v) { size_t n = print(v); return n + println(); }
+    size_t println(double v, int decimals) { size_t n = print(v, decimals); return n + println(); }
+};
+
+extern HostSerial Serial;
+
+#endif // __MTS4X_HOST_ARDUINO_H__
@@ -0,0 +1,450 @@
+#include <Arduino.h>
+#include <ESP8266WebServer.h>
+#include <ESP8266WiFi.h>
+#include <FS.h>
+#include <LittleFS.h>
+#include <arpa/inet.h>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/sockios.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <stdio.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// -----------------------------------------------------------------------------
+// WiFi
+// -----------------------------------------------------------------------------
+
+size_t IPAddress::printTo(HostSerial &out) const {
+    size_t n = 0;
+    for (uint8_t i = 0; i < 4; ++i) {
+        if (i) n += out.print('.');
+        n += out.print((unsigned int)_b[i]);
+    }
+    return n;
+}
+
+void WiFiClass::macAddress(uint8_t *mac) {
+    static const uint8_t host[6] = { 0x02, 0x00, 0x00, 0x4D, 0x54, 0x53 };
+    memcpy(mac, host, sizeof(host));
+}
+
+int WiFiClass::hostByName(const char *host, IPAddress &ip) {
+    if (!strcmp(host, "localhost")) {
+        host = "127.0.0.1";
+    }
+    struct in_addr a;
+    if (inet_pton(AF_INET, host, &a) != 1) {
+        return 0;
+    }
+    const uint8_t *b = (const uint8_t *)&a.s_addr;
+    ip = IPAddress(b[0], b[1], b[2], b[3]);
+    return 1;
+}
+
+WiFiClass WiFi;
+
+// -----------------------------------------------------------------------------
+// WiFiClient
+// -----------------------------------------------------------------------------
+
+static bool waitFd(int fd, short events, unsigned long ms) {
+    struct pollfd p = { fd, events, 0 };
+    return poll(&p, 1, (int)ms) == 1 && (p.revents & (events | POLLERR | POLLHUP));
+}
+
+WiFiClient::Socket::~Socket() {
+    if (fd >= 0) {
+        ::close(fd);
+    }
+}
+
+// The kernel buffer is kept well above HOST_TCP_SND_BUF (it also counts
+// per-packet overhead): availableForWrite() is what enforces the limit
+WiFiClient::WiFiClient(int fd) : _timeoutMs(1000) {
+    int buf = 64 * HOST_TCP_SND_BUF;
+    setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &buf, sizeof(buf));
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    _sock = std::make_shared<Socket>(fd);
+}
+
+int WiFiClient::connect(IPAddress ip, uint16_t port) {
+    stop();
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return 0;
+    }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    struct sockaddr_in sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sin_family = AF_INET;
+    sa.sin_port   = htons(port);
+    uint8_t *b    = (uint8_t *)&sa.sin_addr.s_addr;
+    for (uint8_t i = 0; i < 4; ++i) {
+        b[i] = ip[i];
+    }
+    int rc = ::connect(fd, (struct sockaddr *)&sa, sizeof(sa));
+    if (rc < 0 && errno == EINPROGRESS && waitFd(fd, POLLOUT, _timeoutMs)) {
+        int       err = 0;
+        socklen_t len = sizeof(err);
+        getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &len);
+        rc = err ? -1 : 0;
+    }
+    if (rc < 0) {
+        ::close(fd);
+        return 0;
+    }
+    _sock = std::make_shared<Socket>(fd);
+    return 1;
+}
+
+int WiFiClient::connect(const char *host, uint16_t port) {
+    IPAddress ip;
+    return WiFi.hostByName(host, ip) ? connect(ip, port) : 0;
+}
+
+void WiFiClient::setNoDelay(bool on) {
+    int v = on ? 1 : 0;
+    if (fd() >= 0) {
+        setsockopt(fd(), IPPROTO_TCP, TCP_NODELAY, &v, sizeof(v));
+    }
+}
+
+size_t WiFiClient::write(const uint8_t *buf, size_t len) {
+    size_t done = 0;
+    while (fd() >= 0 && done < len) {
+        ssize_t n = send(fd(), buf + done, len - done, MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (n > 0) {
+            done += (size_t)n;
+        } else if (n < 0 && errno == EAGAIN) {
+            if (!waitFd(fd(), POLLOUT, _timeoutMs)) {
+                break;
+            }
+        } else {
+            break;
+        }
+    }
+    return done;
+}
+
+// Room in the capped send buffer: bytes the peer has not acknowledged
+// count against it, as in lwIP
+size_t WiFiClient::availableForWrite() {
+    int queued = 0;
+    if (fd() < 0 || ioctl(fd(), SIOCOUTQ, &queued) < 0) {
+        return 0;
+    }
+    return queued < HOST_TCP_SND_BUF ? (size_t)(HOST_TCP_SND_BUF - queued) : 0;
+}
+
+int WiFiClient::available() {
+    int n = 0;
+    if (fd() < 0 || ioctl(fd(), FIONREAD, &n) < 0) {
+        return 0;
+    }
+    return n;
+}
+
+int WiFiClient::read() {
+    uint8_t b;
+    return read(&b, 1) == 1 ? b : -1;
+}
+
+int WiFiClient::read(uint8_t *buf, size_t len) {
+    if (fd() < 0) {
+        return -1;
+    }
+    ssize_t n = recv(fd(), buf, len, MSG_DONTWAIT);
+    return n > 0 ? (int)n : -1;
+}
+
+// Open while data is left to read or the peer has not closed its side
+uint8_t WiFiClient::connected() {
+    if (fd() < 0) {
+        return 0;
+    }
+    if (available() > 0) {
+        return 1;
+    }
+    uint8_t b;
+    ssize_t n = recv(fd(), &b, 1, MSG_PEEK | MSG_DONTWAIT);
+    return n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+}
+
+// Closes the connection for every copy
+void WiFiClient::stop() {
+    if (_sock && _sock->fd >= 0) {
+        ::close(_sock->fd);
+        _sock->fd = -1;
+    }
+    _sock.reset();
+}
+
+// -----------------------------------------------------------------------------
+// ESP8266WebServer
+// -----------------------------------------------------------------------------
+
+static const char *reasonPhrase(int code) {
+    switch (code) {
+        case 200: return "OK";
+        case 400: return "Bad Request";
+        case 404: return "Not Found";
+        case 503: return "Service Unavailable";
+        default:  return "";
+    }
+}
+
+ESP8266WebServer::ESP8266WebServer(uint16_t port)
+: _port(0), _listenFd(-1), _notFound(NULL), _contentLength(CONTENT_LENGTH_NOT_SET), _chunked(false) {
+    (void)port;
+}
+
+ESP8266WebServer::~ESP8266WebServer() {
+    close();
+}
+
+void ESP8266WebServer::begin() {
+    close();
+    _listenFd = socket(AF_INET, SOCK_STREAM, 0);
+    int on = 1;
+    setsockopt(_listenFd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    struct sockaddr_in sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sin_family      = AF_INET;
+    sa.sin_port        = 0;
+    sa.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t len      = sizeof(sa);
+    if (bind(_listenFd, (struct sockaddr *)&sa, sizeof(sa)) < 0 || listen(_listenFd, 8) < 0 ||
+        getsockname(_listenFd, (struct sockaddr *)&sa, &len) < 0) {
+        perror("ESP8266WebServer::begin");
+        close();
+        return;
+    }
+    fcntl(_listenFd, F_SETFL, fcntl(_listenFd, F_GETFL) | O_NONBLOCK);
+    _port = ntohs(sa.sin_port);
+}
+
+void ESP8266WebServer::close() {
+    if (_listenFd >= 0) {
+        ::close(_listenFd);
+        _listenFd = -1;
+    }
+}
+
+void ESP8266WebServer::on(const char *uri, THandlerFunction fn) {
+    Route r = { uri, fn };
+    _routes.push_back(r);
+}
+
+void ESP8266WebServer::handleClient() {
+    if (_listenFd < 0) {
+        return;
+    }
+    int fd = accept(_listenFd, NULL, NULL);
+    if (fd < 0) {
+        return;
+    }
+    _current       = WiFiClient(fd);
+    _contentLength = CONTENT_LENGTH_NOT_SET;
+    _chunked       = false;
+    if (!readRequest()) {
+        send(400, "text/plain", "Bad Request");
+    } else {
+        THandlerFunction fn = _notFound;
+        for (size_t i = 0; i < _routes.size(); ++i) {
+            if (_routes[i].uri == _uri) {
+                fn = _routes[i].fn;
+                break;
+            }
+        }
+        if (fn) {
+            fn();
+        } else {
+            send(404, "text/plain", "Not Found");
+        }
+    }
+    _current = WiFiClient();
+}
+
+// "GET /path?a=1&b=2 HTTP/1.1" and headers up to the blank line
+bool ESP8266WebServer::readRequest() {
+    std::string head;
+    uint16_t    idle = 0;
+    while (head.find("\r\n\r\n") == std::string::npos) {
+        if (head.size() > 4096) {
+            return false;
+        }
+        int c = _current.read();
+        if (c < 0) {
+            // Half a second for the rest of the request, like HTTP_MAX_DATA_WAIT
+            if (!_current.connected() || ++idle > 5000) {
+                return false;
+            }
+            delayMicroseconds(100);
+            continue;
+        }
+        head += (char)c;
+    }
+    size_t sp1 = head.find(' ');
+    size_t sp2 = head.find(' ', sp1 + 1);
+    if (sp1 == std::string::npos || sp2 == std::string::npos) {
+        return false;
+    }
+    std::string target = head.substr(sp1 + 1, sp2 - sp1 - 1);
+    size_t      q      = target.find('?');
+    _uri               = target.substr(0, q);
+    _args.clear();
+    while (q != std::string::npos) {
+        size_t      next = target.find('&', q + 1);
+        std::string kv   = target.substr(q + 1, next == std::string::npos ? std::string::npos
+                                                                          : next - q - 1);
+        size_t      eq   = kv.find('=');
+        _args.push_back(std::make_pair(kv.substr(0, eq),
+                                       eq == std::string::npos ? "" : kv.substr(eq + 1)));
+        q = next;
+    }
+    return true;
+}
+
+bool ESP8266WebServer::hasArg(const char *name) const {
+    for (size_t i = 0; i < _args.size(); ++i) {
+        if (_args[i].first == name) return true;
+    }
+    return false;
+}
+
+std::string ESP8266WebServer::arg(const char *name) const {
+    for (size_t i = 0; i < _args.size(); ++i) {
+        if (_args[i].first == name) return _args[i].second;
+    }
+    return std::string();
+}
+
+void ESP8266WebServer::sendHeader(int code, const char *contentType, size_t len) {
+    char head[256];
+    int  n = snprintf(head, sizeof(head), "HTTP/1.1 %d %s\r\nContent-Type: %s\r\n", code,
+                      reasonPhrase(code), contentType);
+    if (len == CONTENT_LENGTH_UNKNOWN) {
+        n += snprintf(head + n, sizeof(head) - n, "Transfer-Encoding: chunked\r\n");
+    } else {
+        n += snprintf(head + n, sizeof(head) - n, "Content-Length: %zu\r\n", len);
+    }
+    n += snprintf(head + n, sizeof(head) - n, "Connection: close\r\n\r\n");
+    _current.write((const uint8_t *)head, (size_t)n);
+}
+
+void ESP8266WebServer::send(int code, const char *contentType, const char *content) {
+    size_t len = _contentLength == CONTENT_LENGTH_NOT_SET ? strlen(content) : _contentLength;
+    _chunked = len == CONTENT_LENGTH_UNKNOWN;
+    sendHeader(code, contentType, len);
+    if (!_chunked) {
+        _current.write((const uint8_t *)content, strlen(content));
+    } else if (*content) {
+        sendContent(content);
+    }
+    _contentLength = CONTENT_LENGTH_NOT_SET;
+}
+
+// In chunked mode an empty piece ends the response
+void ESP8266WebServer::sendContent(const char *data, size_t len) {
+    if (!_chunked) {
+        _current.write((const uint8_t *)data, len);
+        return;
+    }
+    char size[12];
+    int  n = snprintf(size, sizeof(size), "%zx\r\n", len);
+    _current.write((const uint8_t *)size, (size_t)n);
+    _current.write((const uint8_t *)data, len);
+    _current.write((const uint8_t *)"\r\n", 2);
+    if (!len) {
+        _chunked = false;
+    }
+}
+
+// -----------------------------------------------------------------------------
+// File system
+// -----------------------------------------------------------------------------
+
+namespace fs {
+
+File::File(FILE *f) : _f(f, fclose) {}
+
+size_t File::write(const uint8_t *buf, size_t len) {
+    return _f ? fwrite(buf, 1, len, _f.get()) : 0;
+}
+
+size_t File::read(uint8_t *buf, size_t len) {
+    return _f ? fread(buf, 1, len, _f.get()) : 0;
+}
+
+int File::read() {
+    uint8_t b;
+    return read(&b, 1) == 1 ? b : -1;
+}
+
+int File::available() {
+    if (!_f) return 0;
+    long pos = ftell(_f.get());
+    return (int)(size() - (size_t)pos);
+}
+
+size_t File::size() {
+    if (!_f) return 0;
+    long pos = ftell(_f.get());
+    fseek(_f.get(), 0, SEEK_END);
+    long end = ftell(_f.get());
+    fseek(_f.get(), pos, SEEK_SET);
+    return (size_t)end;
+}
+
+bool FS::begin() {
+    struct stat st;
+    return mkdir(_root.c_str(), 0700) == 0 || (stat(_root.c_str(), &st) == 0 && S_ISDIR(st.st_mode));
+}
+
+bool FS::format() {
+    if (!begin()) return false;
+    DIR *d = opendir(_root.c_str());
+    if (!d) return false;
+    while (struct dirent *e = readdir(d)) {
+        if (e->d_name[0] != '.') {
+            ::remove((_root + "/" + e->d_name).c_str());
+        }
+    }
+    closedir(d);
+    return true;
+}
+
+File FS::open(const char *path, const char *mode) {
+    const char *m = *mode == 'w' ? "wb" : *mode == 'a' ? "ab" : "rb";
+    FILE       *f = fopen(hostPath(path).c_str(), m);
+    return f ? File(f) : File();
+}
+
+bool FS::exists(const char *path) {
+    struct stat st;
+    return stat(hostPath(path).c_str(), &st) == 0;
+}
+
+bool FS::remove(const char *path) {
+    return ::remove(hostPath(path).c_str()) == 0;
+}
+
+bool FS::rename(const char *from, const char *to) {
+    return ::rename(hostPath(from).c_str(), hostPath(to).c_str()) == 0;
+}
+
+} // namespace fs
+
+static std::string littleFsRoot() {
+    const char *tmp = getenv("TMPDIR");
+    return std::string(tmp && *tmp ? tmp : "/tmp") + "/mts4x-littlefs";
+}
+
+fs::FS LittleFS(littleFsRoot().c_str());
@@ -0,0 +1,75 @@
+// MTS4x Arduino driver - ESP8266WebServer for host builds
+// Author: Denis (FedunovDenis)
+//
+// A loopback HTTP/1.1 server with the subset of the ESP8266 API the
+// MeteoStation example uses. handleClient() serves at most one waiting
+// connection per call: request line and headers, then the handler. The
+// server drops its copy of the client afterwards without stop(), so a
+// handler that kept a copy (EventStream) keeps the connection open.
+// Responses are "Connection: close"; CONTENT_LENGTH_UNKNOWN means chunked,
+// a length set before send() is sent as is and the body follows in
+// sendContent(), as on the ESP8266.
+// The port asked for is ignored: the server listens on a free loopback
+// port (no privileges, no clash between tests), see port().
+
+#ifndef __MTS4X_HOST_ESP8266WEBSERVER_H__
+#define __MTS4X_HOST_ESP8266WEBSERVER_H__
+
+#include <Arduino.h>
+#include <ESP8266WiFi.h>
+#include <string>
+#include <vector>
+
+#define CONTENT_LENGTH_UNKNOWN ((size_t)-1)
+#define CONTENT_LENGTH_NOT_SET ((size_t)-2)
+
+class ESP8266WebServer {
+  public:
+    typedef void (*THandlerFunction)();
+
+    explicit ESP8266WebServer(uint16_t port = 80);
+    ~ESP8266WebServer();
+
+    void begin();
+    void close();
+    void handleClient();
+
+    void on(const char *uri, THandlerFunction fn);
+    void onNotFound(THandlerFunction fn) { _notFound = fn; }
+
+    void send(int code, const char *contentType, const char *content);
+    void setContentLength(size_t len) { _contentLength = len; }
+    void sendContent(const char *data, size_t len);
+    void sendContent(const char *data) { sendContent(data, strlen(data)); }
+
+    // String on the ESP8266; only c_str() is used
+    bool        hasArg(const char *name) const;
+    std::string arg(const char *name) const;
+    const std::string &uri() const { return _uri; }
+
+    WiFiClient &client() { return _current; }
+
+    // Host only: the port listened on, after begin()
+    uint16_t port() const { return _port; }
+
+  private:
+    struct Route {
+        std::string      uri;
+        THandlerFunction fn;
+    };
+
+    uint16_t           _port;
+    int                _listenFd;
+    std::vector<Route> _routes;
+    THandlerFunction   _notFound;
+    WiFiClient         _current;
+    std::string        _uri;
+    std::vector<std::pair<std::string, std::string> > _args;
+    size_t             _contentLength;
+    bool               _chunked;
+
+    bool readRequest();
+    void sendHeader(int code, const char *contentType, size_t len);
+};
+
+#endif // __MTS4X_HOST_ESP8266WEBSERVER_H__
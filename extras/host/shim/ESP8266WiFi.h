@@ -0,0 +1,101 @@
+// MTS4x Arduino driver - ESP8266WiFi for host builds
+// Author: Denis (FedunovDenis)
+//
+// Enough for the MeteoStation example on Linux. WiFi is always connected
+// at 127.0.0.1 and resolves only numeric addresses and "localhost" (no DNS
+// on the host). WiFiClient is a real TCP socket: copies share it like on
+// the ESP8266 and the last copy closes it, the send buffer is capped at
+// the lwIP default so availableForWrite() runs out like on the chip.
+
+#ifndef __MTS4X_HOST_ESP8266WIFI_H__
+#define __MTS4X_HOST_ESP8266WIFI_H__
+
+#include <Arduino.h>
+#include <memory>
+
+#define WL_CONNECTED 3
+#define WIFI_STA     1
+
+// lwIP on the ESP8266: TCP_SND_BUF = 2 * TCP_MSS
+#define HOST_TCP_SND_BUF 2920
+
+class IPAddress : public Printable {
+  public:
+    IPAddress() { memset(_b, 0, sizeof(_b)); }
+    IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) {
+        _b[0] = a;
+        _b[1] = b;
+        _b[2] = c;
+        _b[3] = d;
+    }
+
+    uint8_t  operator[](int i) const { return _b[i]; }
+    uint8_t &operator[](int i) { return _b[i]; }
+
+    size_t printTo(HostSerial &out) const override;
+
+  private:
+    uint8_t _b[4];
+};
+
+class WiFiClass {
+  public:
+    int       status() { return WL_CONNECTED; }
+    void      begin(const char *ssid, const char *pass) { (void)ssid; (void)pass; }
+    void      mode(int m) { (void)m; }
+    void      persistent(bool on) { (void)on; }
+    void      disconnect(bool off = false) { (void)off; }
+    void      hostname(const char *name) { (void)name; }
+    void      setSleep(bool on) { (void)on; }
+    void      setAutoReconnect(bool on) { (void)on; }
+    int32_t   RSSI() { return -60; }
+    IPAddress localIP() { return IPAddress(127, 0, 0, 1); }
+    void      macAddress(uint8_t *mac);
+    int       hostByName(const char *host, IPAddress &ip);
+};
+
+extern WiFiClass WiFi;
+
+class WiFiClient {
+  public:
+    WiFiClient() : _timeoutMs(1000) {}
+    explicit WiFiClient(int fd);   // accepted by the web server
+
+    int     connect(IPAddress ip, uint16_t port);
+    int     connect(const char *host, uint16_t port);
+    void    setTimeout(unsigned long ms) { _timeoutMs = ms; }
+    void    setNoDelay(bool on);
+
+    // Blocks up to the timeout like the ESP8266 core; bytes taken
+    size_t  write(const uint8_t *buf, size_t len);
+    size_t  write(uint8_t b) { return write(&b, 1); }
+    size_t  availableForWrite();
+
+    int     available();
+    int     read();
+    int     read(uint8_t *buf, size_t len);
+
+    uint8_t connected();
+    void    stop();
+
+  private:
+    struct Socket {
+        explicit Socket(int f) : fd(f) {}
+        ~Socket();
+        int fd;
+    };
+
+    std::shared_ptr<Socket> _sock;
+    unsigned long           _timeoutMs;
+
+    int fd() const { return _sock ? _sock->fd : -1; }
+};
+
+// Time is set by the test, not by NTP
+inline void configTime(int tz, int dst, const char *server) {
+    (void)tz;
+    (void)dst;
+    (void)server;
+}
+
+#endif // __MTS4X_HOST_ESP8266WIFI_H__
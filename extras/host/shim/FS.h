@@ -0,0 +1,60 @@
+// MTS4x Arduino driver - FS for host builds
+// Author: Denis (FedunovDenis)
+//
+// fs::FS over a directory of the host file system. Paths are flat
+// ("/history.bin"), files are shared by copies of a File like on the
+// ESP8266 and closed by the last one.
+
+#ifndef __MTS4X_HOST_FS_H__
+#define __MTS4X_HOST_FS_H__
+
+#include <Arduino.h>
+#include <stdio.h>
+#include <memory>
+#include <string>
+
+namespace fs {
+
+class File {
+  public:
+    File() {}
+    explicit File(FILE *f);
+
+    explicit operator bool() const { return (bool)_f; }
+
+    size_t write(const uint8_t *buf, size_t len);
+    size_t read(uint8_t *buf, size_t len);
+    int    read();
+    int    available();
+    size_t size();
+    void   close() { _f.reset(); }
+
+  private:
+    std::shared_ptr<FILE> _f;
+};
+
+class FS {
+  public:
+    explicit FS(const char *root) : _root(root) {}
+
+    bool begin();
+    bool begin(bool formatOnFail) { (void)formatOnFail; return begin(); }
+    void end() {}
+    bool format();   // removes every file
+
+    File open(const char *path, const char *mode);
+    bool exists(const char *path);
+    bool remove(const char *path);
+    bool rename(const char *from, const char *to);
+
+  private:
+    std::string _root;
+
+    std::string hostPath(const char *path) const { return _root + path; }
+};
+
+} // namespace fs
+
+using fs::File;
+
+#endif // __MTS4X_HOST_FS_H__
@@ -0,0 +1,14 @@
+// MTS4x Arduino driver - LittleFS for host builds
+// Author: Denis (FedunovDenis)
+//
+// The directory mts4x-littlefs in $TMPDIR (or /tmp), see FS.h. Tests that
+// need a clean file system call LittleFS.format() first.
+
+#ifndef __MTS4X_HOST_LITTLEFS_H__
+#define __MTS4X_HOST_LITTLEFS_H__
+
+#include <FS.h>
+
+extern fs::FS LittleFS;
+
+#endif // __MTS4X_HOST_LITTLEFS_H__
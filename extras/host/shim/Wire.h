@@ -0,0 +1,28 @@
+// MTS4x Arduino driver - TwoWire for host builds
+// Author: Denis (FedunovDenis)
+//
+// An empty bus: every address NAKs. Host tests put the driver on
+// MTS4xSimDevice (MTS4xBus) instead; this only lets MTS4xWireBus link.
+
+#ifndef __MTS4X_HOST_WIRE_H__
+#define __MTS4X_HOST_WIRE_H__
+
+#include <Arduino.h>
+
+class TwoWire {
+  public:
+    void    begin() {}
+    void    begin(int sda, int scl) { (void)sda; (void)scl; }
+    void    end() {}
+    void    setClock(uint32_t hz) { (void)hz; }
+    void    beginTransmission(uint8_t addr) { (void)addr; }
+    size_t  write(uint8_t data) { (void)data; return 1; }
+    uint8_t endTransmission(bool sendStop = true) { (void)sendStop; return 2; }
+    uint8_t requestFrom(int addr, int len) { (void)addr; (void)len; return 0; }
+    int     read() { return -1; }
+    int     available() { return 0; }
+};
+
+extern TwoWire Wire;
+
+#endif // __MTS4X_HOST_WIRE_H__
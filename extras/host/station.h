@@ -0,0 +1,109 @@
+// MTS4x Arduino driver - the MeteoStation example built for host tests
+// Author: Denis (FedunovDenis)
+//
+// Include once, from the test that drives the sketch. ESP8266 is defined
+// for the sketch only (the library sources are built without it); the
+// sketch's MTS4X sits on station_sim and its virtual clock, the web
+// server on a free loopback port (server.port()). station_cycle() runs
+// loop() across one UI interval without waiting for it; the station_*
+// client helpers talk plain HTTP to the server over loopback.
+
+#ifndef __MTS4X_HOST_STATION_H__
+#define __MTS4X_HOST_STATION_H__
+
+#define ESP8266 1
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <string>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// Every header the sketch takes MTS4X from, before MTS4X is renamed
+#include "MTS4x.h"
+#include "MTS4xAggregator.h"
+#include "MTS4xCalibration.h"
+#include "MTS4xHistory.h"
+#include "MTS4xOversampler.h"
+#include "MTS4xSim.h"
+
+static MTS4xSimDevice station_sim;
+
+class MTS4XOnStationSim : public MTS4X {
+  public:
+    MTS4XOnStationSim() : MTS4X(station_sim) {}
+};
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-variable"   // datasheet constants
+#define MTS4X MTS4XOnStationSim
+#include "../../examples/MTS4x_MeteoStation/MTS4x_MeteoStation.ino"
+#undef MTS4X
+#pragma GCC diagnostic pop
+
+static inline void station_cycle() {
+    host_advance_ms(UI_UPDATE_INTERVAL_MS);
+    loop();
+}
+
+// Connects and sends "GET path"; the next loop() serves it. rcvBuf > 0
+// shrinks the receive buffer first (a reader that falls behind).
+static inline int station_request(const char *path, int rcvBuf = 0) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (rcvBuf > 0) {
+        setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvBuf, sizeof(rcvBuf));
+    }
+    struct sockaddr_in sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sin_family      = AF_INET;
+    sa.sin_port        = htons(server.port());
+    sa.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (connect(fd, (struct sockaddr *)&sa, sizeof(sa)) < 0) {
+        close(fd);
+        return -1;
+    }
+    std::string req = std::string("GET ") + path + " HTTP/1.1\r\nHost: station\r\n\r\n";
+    if (send(fd, req.data(), req.size(), MSG_NOSIGNAL) != (ssize_t)req.size()) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// Bytes readable right now (appended to out); -1 once the server has
+// closed and everything was read
+static inline long station_drain(int fd, std::string *out = NULL) {
+    char buf[4096];
+    long total = 0;
+    for (;;) {
+        ssize_t n = recv(fd, buf, sizeof(buf), MSG_DONTWAIT);
+        if (n > 0) {
+            if (out) out->append(buf, (size_t)n);
+            total += n;
+        } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return total;
+        } else {
+            return total ? total : -1;
+        }
+    }
+}
+
+// Whole response to a request the server closes after (not /events)
+static inline std::string station_get(const char *path) {
+    std::string resp;
+    int fd = station_request(path);
+    if (fd < 0) {
+        return resp;
+    }
+    loop();
+    char buf[4096];
+    ssize_t n;
+    while ((n = recv(fd, buf, sizeof(buf), 0)) > 0) {
+        resp.append(buf, (size_t)n);
+    }
+    close(fd);
+    return resp;
+}
+
+#endif // __MTS4X_HOST_STATION_H__
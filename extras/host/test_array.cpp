@@ -0,0 +1,204 @@
+// MTS4XArray on a rack of simulated chips behind a TCA9548A-style mux, one
+// chip per segment on a shared bus and clock: every round delivers the
+// right sample per sensor with timestamps in completion order, a dead
+// sensor is reported without holding up the others, a round costs about
+// one conversion time plus N reads, and aggregate samples/s against
+// reading the same sensors one single shot after another as N grows
+
+#include "MTS4x.h"
+#include "MTS4xArray.h"
+#include "MTS4xSim.h"
+#include "host_test.h"
+#include <vector>
+
+#define HZ  400000UL
+#define AVG AVG_8
+
+// One bus, one clock, up to MTS4X_ARRAY_MAX_SENSORS chips at the same
+// address on separate mux channels. Each chip's virtual clock is brought
+// up to the bus clock before it sees traffic.
+class Rack : public MTS4xBus {
+  public:
+    Rack() : channel(0), selects(0), _now(0), _hz(100000UL) {}
+
+    bool begin(int32_t sda, int32_t scl) override { return cur().begin(sda, scl); }
+    void setClock(uint32_t hz) override {
+        _hz = hz;
+        for (uint8_t i = 0; i < MTS4X_ARRAY_MAX_SENSORS; ++i) chips[i].setClock(hz);
+    }
+    bool writeRegs(uint8_t addr, uint8_t reg, const uint8_t *data, size_t len) override {
+        bool ok = cur().writeRegs(addr, reg, data, len);
+        _now    = chips[channel].nowUs();
+        return ok;
+    }
+    bool readRegs(uint8_t addr, uint8_t reg, uint8_t *data, size_t len) override {
+        bool ok = cur().readRegs(addr, reg, data, len);
+        _now    = chips[channel].nowUs();
+        return ok;
+    }
+    uint32_t millis() override { return micros() / 1000UL; }
+    uint32_t micros() override {
+        uint32_t t = cur().micros();
+        _now       = chips[channel].nowUs();
+        return t;
+    }
+    void delay(uint32_t ms) override {
+        cur().delay(ms);
+        _now = chips[channel].nowUs();
+    }
+
+    // Mux channel register write: address and one data byte
+    bool select(uint8_t ch) {
+        _now   += 2 * 9 * 1000000ULL / _hz + 10;
+        channel = ch;
+        ++selects;
+        return ch < MTS4X_ARRAY_MAX_SENSORS;
+    }
+
+    uint64_t nowUs() const { return _now; }
+    uint32_t transactions() const {
+        uint32_t n = 0;
+        for (uint8_t i = 0; i < MTS4X_ARRAY_MAX_SENSORS; ++i) n += chips[i].transactions();
+        return n;
+    }
+
+    MTS4xSimDevice chips[MTS4X_ARRAY_MAX_SENSORS];
+    uint8_t        channel;
+    uint32_t       selects;
+
+  private:
+    uint64_t _now;
+    uint32_t _hz;
+
+    MTS4xSimDevice &cur() {
+        MTS4xSimDevice &c = chips[channel];
+        if (c.nowUs() < _now) c.advanceUs((uint32_t)(_now - c.nowUs()));
+        return c;
+    }
+};
+
+static bool selectChannel(uint8_t ch, void *ctx) {
+    return static_cast<Rack *>(ctx)->select(ch);
+}
+
+static int32_t chipMilli(uint8_t i) {
+    return 20000L + 250L * i;
+}
+
+struct Setup {
+    Rack                 rack;
+    std::vector<MTS4X *> sensors;
+    MTS4XArray           array;
+
+    explicit Setup(uint8_t n) {
+        for (uint8_t i = 0; i < n; ++i) {
+            rack.chips[i].setTemperatureMilli(chipMilli(i));
+            MTS4X *m = new MTS4X(rack);
+            rack.select(i);
+            CHECK(m->begin(0, 0));
+            m->setBusClock(HZ);
+            CHECK(m->setConfig(MPS_1Hz, AVG, true));
+            CHECK_EQ(array.add(*m, selectChannel, &rack, i), i);
+            sensors.push_back(m);
+        }
+    }
+    ~Setup() {
+        for (size_t i = 0; i < sensors.size(); ++i) delete sensors[i];
+    }
+};
+
+// Every sensor once, one single shot after the other
+static bool sequentialRound(Setup &s) {
+    bool ok = true;
+    for (uint8_t i = 0; i < s.sensors.size(); ++i) {
+        int32_t mC = 0;
+        s.rack.select(i);
+        ok = s.sensors[i]->singleShotMilli(mC) && mC == chipMilli(i) && ok;
+    }
+    return ok;
+}
+
+static void checkRound(Setup &s) {
+    uint8_t n = (uint8_t)s.sensors.size();
+    CHECK_EQ(s.array.completed(), n);
+    uint32_t prev = 0;
+    for (uint8_t k = 0; k < n; ++k) {
+        uint8_t                 i = s.array.completionOrder(k);
+        const MTS4xArraySample &r = s.array.sample(i);
+        CHECK(r.valid);
+        CHECK_EQ(r.error, MTS4X_ERR_OK);
+        CHECK_EQ(mts4x_raw_to_milli(r.raw), chipMilli(i));
+        CHECK(k == 0 || (int32_t)(r.timestampUs - prev) >= 0);
+        prev = r.timestampUs;
+    }
+}
+
+// A sensor that does not answer: its own error, the rest of the round intact
+static void testDeadSensor() {
+    Setup s(6);
+    s.rack.chips[3].injectNak(100000UL);
+    CHECK(!s.array.sampleAll());
+    CHECK_EQ(s.array.completed(), 6);
+    for (uint8_t i = 0; i < 6; ++i) {
+        const MTS4xArraySample &r = s.array.sample(i);
+        if (i == 3) {
+            CHECK(!r.valid);
+            CHECK(r.error != MTS4X_ERR_OK);
+        } else {
+            CHECK(r.valid);
+            CHECK_EQ(mts4x_raw_to_milli(r.raw), chipMilli(i));
+        }
+    }
+    s.rack.chips[3].injectNak(0);
+    CHECK(s.array.sampleAll());
+    checkRound(s);
+}
+
+// Samples per second of virtual time over a number of rounds
+static double rate(Setup &s, bool array, uint16_t rounds, uint32_t *worstRoundUs) {
+    uint64_t t0 = s.rack.nowUs();
+    for (uint16_t r = 0; r < rounds; ++r) {
+        if (array) {
+            CHECK(s.array.sampleAll());
+            checkRound(s);
+            if (s.array.roundTimeUs() > *worstRoundUs) *worstRoundUs = s.array.roundTimeUs();
+        } else {
+            CHECK(sequentialRound(s));
+        }
+    }
+    return rounds * s.sensors.size() * 1e6 / (double)(s.rack.nowUs() - t0);
+}
+
+static void benchmark() {
+    const uint16_t rounds = 20;
+    const uint32_t conv   = mts4x_avg_time_us(AVG);
+    // Per sensor: trigger and fused read (4-byte frames at most), a mux
+    // write before each, a few polls that find the chip still busy
+    const uint32_t perSensorUs = 2 * (8 * 9 * 1000000UL / HZ + 50) + 2 * (2 * 9 * 1000000UL / HZ + 10);
+
+    printf("  sensors  sequential/s    array/s   round us  bound us\n");
+    double prevArray = 0;
+    static const uint8_t counts[] = { 1, 2, 4, 8, 16 };
+    for (uint8_t c = 0; c < sizeof(counts); ++c) {
+        uint8_t  n     = counts[c];
+        uint32_t worst = 0;
+        Setup    seq(n);
+        Setup    arr(n);
+        double   sRate = rate(seq, false, rounds, &worst);
+        double   aRate = rate(arr, true, rounds, &worst);
+        uint32_t bound = conv + conv / 10 + n * perSensorUs;
+        printf("  %5u  %12.0f  %10.0f  %9lu  %8lu\n", n, sRate, aRate,
+               (unsigned long)worst, (unsigned long)bound);
+        CHECK(worst <= bound);
+        CHECK(aRate >= sRate * 0.95);
+        CHECK(aRate > prevArray);
+        if (n >= 8) CHECK(aRate > 4 * sRate);
+        prevArray = aRate;
+    }
+}
+
+int main() {
+    testDeadSensor();
+    benchmark();
+    return host_test_result("test_array");
+}
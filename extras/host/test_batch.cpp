@@ -0,0 +1,328 @@
+// Batch kernels of the backend selected by MTS4X_BATCH_SIMD against the
+// per-sample scalar code: every int16 code, every length 0..70 at every
+// misalignment of input and output, the int16 extremes (saturation, the
+// limits at -32768/32767, a long reduce of min/max codes) and reduce
+// merged over uneven spans. Built once per backend.
+
+#include "MTS4x.h"
+#include "MTS4xBatch.h"
+#include "host_test.h"
+#include <string.h>
+#include <vector>
+
+// -----------------------------------------------------------------------------
+// Per-sample references
+// -----------------------------------------------------------------------------
+
+static int16_t refScale(int16_t r, int16_t gainQ14, int16_t offsetRaw) {
+    int32_t p = (((int32_t)r * gainQ14 + 8192) >> 14) + offsetRaw;
+    if (p > 32767)  p = 32767;
+    if (p < -32768) p = -32768;
+    return (int16_t)p;
+}
+
+static bool refOutside(int16_t r, int16_t thRaw, int16_t tlRaw) {
+    return r > thRaw || r < tlRaw;
+}
+
+// Gains and offsets of the checks: unity, the gateway's 1.002 / +0.1 °C,
+// negative, the largest and smallest Q14 values, offsets at both extremes
+struct ScaleCase {
+    int16_t gain;
+    int16_t offset;
+};
+
+static const ScaleCase SCALES[] = {
+    { 16384, 0 }, { 16417, 26 }, { -16384, -5 }, { 32767, 32767 },
+    { -32768, -32768 }, { 0, 1000 }, { 1, -1 },
+};
+
+static const size_t NSCALES = sizeof(SCALES) / sizeof(SCALES[0]);
+
+// Thresholds: the gateway's 5..40 °C, the whole range (nothing outside),
+// an empty window (everything outside) and TH/TL on the same code
+struct LimitCase {
+    int16_t th;
+    int16_t tl;
+};
+
+static const LimitCase LIMITS[] = {
+    { 3840, -5120 }, { 32767, -32768 }, { -32768, 32767 }, { 0, 0 },
+};
+
+static const size_t NLIMITS = sizeof(LIMITS) / sizeof(LIMITS[0]);
+
+static bool sameFloat(float a, float b) {
+    return memcmp(&a, &b, sizeof(a)) == 0;
+}
+
+// -----------------------------------------------------------------------------
+// All 65536 codes in one span (not a multiple of any vector width)
+// -----------------------------------------------------------------------------
+
+static void testAllCodes() {
+    std::vector<int16_t> raw(65536 + 3), out(raw.size());
+    std::vector<int32_t> milli(raw.size());
+    std::vector<uint8_t> mask((raw.size() + 7) / 8);
+    for (size_t i = 0; i < raw.size(); ++i) {
+        raw[i] = (int16_t)(int32_t)(i - 32768);   // wraps for the last 3
+    }
+    const size_t n = raw.size();
+
+    uint32_t bad = 0;
+#ifndef MTS4X_NO_FLOAT
+    std::vector<float> c(n);
+    mts4x_batch_to_celsius(&raw[0], &c[0], n);
+    for (size_t i = 0; i < n; ++i) {
+        bad += !sameFloat(c[i], MTS4X_RAW_TO_CELSIUS(raw[i]));
+    }
+    CHECK_EQ(bad, 0);
+#endif
+
+    bad = 0;
+    mts4x_batch_to_milli(&raw[0], &milli[0], n);
+    for (size_t i = 0; i < n; ++i) {
+        bad += milli[i] != mts4x_raw_to_milli(raw[i]);
+    }
+    CHECK_EQ(bad, 0);
+
+    for (size_t s = 0; s < NSCALES; ++s) {
+        bad = 0;
+        mts4x_batch_scale_offset(&raw[0], &out[0], n, SCALES[s].gain, SCALES[s].offset);
+        for (size_t i = 0; i < n; ++i) {
+            bad += out[i] != refScale(raw[i], SCALES[s].gain, SCALES[s].offset);
+        }
+        if (bad) {
+            printf("  scale_offset gain %d offset %d: %lu wrong\n", SCALES[s].gain,
+                   SCALES[s].offset, (unsigned long)bad);
+        }
+        CHECK_EQ(bad, 0);
+    }
+
+    for (size_t l = 0; l < NLIMITS; ++l) {
+        bad = 0;
+        size_t want = 0;
+        size_t got  = mts4x_batch_threshold(&raw[0], n, LIMITS[l].th, LIMITS[l].tl, &mask[0]);
+        for (size_t i = 0; i < n; ++i) {
+            bool o = refOutside(raw[i], LIMITS[l].th, LIMITS[l].tl);
+            want += o;
+            bad  += ((mask[i >> 3] >> (i & 7)) & 1) != (o ? 1 : 0);
+        }
+        CHECK_EQ(got, want);
+        CHECK_EQ(bad, 0);
+        // Without a mask only the count
+        CHECK_EQ(mts4x_batch_threshold(&raw[0], n, LIMITS[l].th, LIMITS[l].tl, NULL), want);
+    }
+
+    MTS4xBatchSummary sum;
+    mts4x_batch_reduce(&raw[0], 65536, sum);
+    CHECK_EQ(sum.count, 65536);
+    CHECK_EQ(sum.minRaw, -32768);
+    CHECK_EQ(sum.maxRaw, 32767);
+    CHECK_EQ(sum.sumRaw, -32768);
+    CHECK_EQ(sum.meanRaw(), -1);      // -0.5 rounds away from zero
+    CHECK_EQ(sum.meanMilli(), 24998);
+}
+
+// -----------------------------------------------------------------------------
+// Lengths 0..70 at every misalignment; nothing written past the span
+// -----------------------------------------------------------------------------
+
+static const int16_t CANARY16 = 0x5A5A;
+static const int32_t CANARY32 = 0x5A5A5A5A;
+static const uint8_t CANARY8  = 0xA5;
+
+static void testLengthsAndAlignment() {
+    const size_t MAXN = 70, PAD = 40;
+    // 64-byte aligned backing store, then offsets of 0..15 samples: every
+    // position relative to an AVX2 vector
+    static int16_t rawBuf[MAXN + PAD] __attribute__((aligned(64)));
+    static int16_t outBuf[MAXN + PAD] __attribute__((aligned(64)));
+    static int32_t milBuf[MAXN + PAD] __attribute__((aligned(64)));
+#ifndef MTS4X_NO_FLOAT
+    static float   celBuf[MAXN + PAD] __attribute__((aligned(64)));
+#endif
+    static uint8_t maskBuf[MAXN / 8 + PAD] __attribute__((aligned(64)));
+
+    uint32_t x = 20240501UL;
+    for (size_t i = 0; i < MAXN + PAD; ++i) {
+        x         = x * 1103515245UL + 12345UL;
+        rawBuf[i] = (int16_t)(x >> 16);
+    }
+    rawBuf[3]  = 32767;
+    rawBuf[4]  = -32768;
+    rawBuf[17] = -32768;
+    rawBuf[18] = 32767;
+
+    uint32_t bad = 0, overrun = 0, cases = 0;
+    for (size_t inOff = 0; inOff < 16; ++inOff) {
+        for (size_t outOff = 0; outOff < 16; outOff += 3) {
+            for (size_t n = 0; n <= MAXN; ++n) {
+                const int16_t *raw = rawBuf + inOff;
+                ++cases;
+
+#ifndef MTS4X_NO_FLOAT
+                float *cel = celBuf + outOff;
+                for (size_t i = 0; i < MAXN + PAD - outOff; ++i) cel[i] = -1.0f;
+                mts4x_batch_to_celsius(raw, cel, n);
+                for (size_t i = 0; i < n; ++i) bad += !sameFloat(cel[i], MTS4X_RAW_TO_CELSIUS(raw[i]));
+                for (size_t i = n; i < n + 16; ++i) overrun += cel[i] != -1.0f;
+#endif
+
+                int32_t *mil = milBuf + outOff;
+                for (size_t i = 0; i < MAXN + PAD - outOff; ++i) mil[i] = CANARY32;
+                mts4x_batch_to_milli(raw, mil, n);
+                for (size_t i = 0; i < n; ++i) bad += mil[i] != mts4x_raw_to_milli(raw[i]);
+                for (size_t i = n; i < n + 16; ++i) overrun += mil[i] != CANARY32;
+
+                int16_t *out = outBuf + outOff;
+                for (size_t s = 0; s < NSCALES; ++s) {
+                    for (size_t i = 0; i < MAXN + PAD - outOff; ++i) out[i] = CANARY16;
+                    mts4x_batch_scale_offset(raw, out, n, SCALES[s].gain, SCALES[s].offset);
+                    for (size_t i = 0; i < n; ++i) {
+                        bad += out[i] != refScale(raw[i], SCALES[s].gain, SCALES[s].offset);
+                    }
+                    for (size_t i = n; i < n + 16; ++i) overrun += out[i] != CANARY16;
+                }
+
+                uint8_t *mask = maskBuf + (outOff & 7);
+                for (size_t l = 0; l < NLIMITS; ++l) {
+                    memset(maskBuf, CANARY8, sizeof(maskBuf));
+                    size_t got  = mts4x_batch_threshold(raw, n, LIMITS[l].th, LIMITS[l].tl, mask);
+                    size_t want = 0;
+                    for (size_t i = 0; i < n; ++i) {
+                        bool o = refOutside(raw[i], LIMITS[l].th, LIMITS[l].tl);
+                        want += o;
+                        bad  += ((mask[i >> 3] >> (i & 7)) & 1) != (o ? 1 : 0);
+                    }
+                    // Padding bits of the last byte are clear
+                    if (n & 7) bad += (mask[n >> 3] >> (n & 7)) != 0;
+                    bad += got != want;
+                    for (size_t i = (n + 7) / 8; i < (n + 7) / 8 + 4; ++i) overrun += mask[i] != CANARY8;
+                }
+
+                MTS4xBatchSummary sum;
+                mts4x_batch_reduce(raw, n, sum);
+                int16_t mn = 32767, mx = -32768;
+                int64_t s  = 0;
+                for (size_t i = 0; i < n; ++i) {
+                    if (raw[i] < mn) mn = raw[i];
+                    if (raw[i] > mx) mx = raw[i];
+                    s += raw[i];
+                }
+                bad += sum.count != n || sum.minRaw != mn || sum.maxRaw != mx || sum.sumRaw != s;
+            }
+        }
+    }
+    // In place (out == raw) at every misalignment
+    for (size_t off = 0; off < 16; ++off) {
+        for (size_t n = 0; n <= MAXN; ++n) {
+            memcpy(outBuf, rawBuf, sizeof(outBuf));
+            mts4x_batch_scale_offset(outBuf + off, outBuf + off, n, 16417, 26);
+            for (size_t i = 0; i < n; ++i) bad += outBuf[off + i] != refScale(rawBuf[off + i], 16417, 26);
+            for (size_t i = off + n; i < MAXN + PAD; ++i) overrun += outBuf[i] != rawBuf[i];
+        }
+    }
+    printf("  %lu length/alignment cases, %lu wrong, %lu writes past the span\n",
+           (unsigned long)cases, (unsigned long)bad, (unsigned long)overrun);
+    CHECK_EQ(bad, 0);
+    CHECK_EQ(overrun, 0);
+}
+
+// -----------------------------------------------------------------------------
+// int16 extremes
+// -----------------------------------------------------------------------------
+
+static void testExtremes() {
+    const size_t n = 300007;   // > 2^15 per lane group: the partial sums flush
+    std::vector<int16_t> raw(n), out(n);
+
+    // All max, all min, alternating: the exact sum on every path
+    static const int16_t FILL[][2] = { { 32767, 32767 }, { -32768, -32768 }, { 32767, -32768 } };
+    for (size_t f = 0; f < 3; ++f) {
+        int64_t want = 0;
+        for (size_t i = 0; i < n; ++i) {
+            raw[i] = FILL[f][i & 1];
+            want  += raw[i];
+        }
+        MTS4xBatchSummary sum;
+        mts4x_batch_reduce(&raw[0], n, sum);
+        CHECK_EQ(sum.count, n);
+        CHECK_EQ(sum.sumRaw, want);
+        CHECK_EQ(sum.minRaw, f == 0 ? 32767 : -32768);
+        CHECK_EQ(sum.maxRaw, f == 1 ? -32768 : 32767);
+        CHECK_EQ(sum.meanRaw(), f == 0 ? 32767 : f == 1 ? -32768 : 0);
+    }
+
+    // Saturation at both ends, in place
+    int16_t sat[19];
+    for (size_t i = 0; i < 19; ++i) sat[i] = (i & 1) ? -32768 : 32767;
+    sat[2] = 32000;
+    mts4x_batch_scale_offset(sat, sat, 19, 32767, 1000);
+    uint32_t bad = 0;
+    for (size_t i = 0; i < 19; ++i) bad += sat[i] != ((i & 1) ? -32768 : 32767);
+    CHECK_EQ(bad, 0);
+    for (size_t i = 0; i < 19; ++i) sat[i] = (i & 1) ? -32768 : 32767;
+    mts4x_batch_scale_offset(sat, sat, 19, -32768, -32768);
+    bad = 0;
+    for (size_t i = 0; i < 19; ++i) bad += sat[i] != ((i & 1) ? 32767 : -32768);
+    CHECK_EQ(bad, 0);
+
+    // Limits on the extreme codes: TH = 32767 and TL = -32768 never trip
+    std::vector<uint8_t> mask((n + 7) / 8);
+    for (size_t i = 0; i < n; ++i) raw[i] = (i % 3 == 0) ? -32768 : (i % 3 == 1) ? 32767 : 0;
+    CHECK_EQ(mts4x_batch_threshold(&raw[0], n, 32767, -32768, &mask[0]), 0);
+    CHECK_EQ(mts4x_batch_threshold(&raw[0], n, 32766, -32768, &mask[0]), n / 3);
+    CHECK_EQ(mts4x_batch_threshold(&raw[0], n, 32767, -32767, &mask[0]), (n + 2) / 3);
+    CHECK_EQ(mts4x_batch_threshold(&raw[0], n, 32766, -32767, NULL), n - n / 3);
+}
+
+// -----------------------------------------------------------------------------
+// Reduce merged over uneven spans equals one span
+// -----------------------------------------------------------------------------
+
+static void testMerge() {
+    const size_t n = 100003;
+    std::vector<int16_t> raw(n);
+    uint32_t x = 7;
+    for (size_t i = 0; i < n; ++i) {
+        x      = x * 1103515245UL + 12345UL;
+        raw[i] = (int16_t)(x >> 16);
+    }
+    MTS4xBatchSummary whole, parts;
+    mts4x_batch_reduce(&raw[0], n, whole);
+    size_t pos = 0, step = 1;
+    while (pos < n) {
+        size_t len = (step < n - pos) ? step : n - pos;
+        mts4x_batch_reduce(&raw[pos], len, parts);
+        pos  += len;
+        step  = step * 3 + 1;   // 1, 4, 13, 40, ... odd splits
+    }
+    mts4x_batch_reduce(&raw[0], 0, parts);   // empty span changes nothing
+    CHECK_EQ(parts.count, whole.count);
+    CHECK_EQ(parts.sumRaw, whole.sumRaw);
+    CHECK_EQ(parts.minRaw, whole.minRaw);
+    CHECK_EQ(parts.maxRaw, whole.maxRaw);
+    CHECK_EQ(parts.meanMilli(), whole.meanMilli());
+
+    MTS4xBatchSummary empty;
+    CHECK_EQ(empty.meanRaw(), 0);
+    CHECK_EQ(empty.meanMilli(), 0);
+}
+
+int main() {
+    char name[32];
+    snprintf(name, sizeof(name), "test_batch_%s", mts4x_batch_impl());
+    printf("  MTS4X_BATCH_SIMD: %s\n", mts4x_batch_impl());
+#if MTS4X_BATCH_SIMD == MTS4X_BATCH_AVX2 && defined(__GNUC__)
+    if (!__builtin_cpu_supports("avx2")) {
+        printf("  no AVX2 on this CPU, skipped\n");
+        return host_test_result(name);
+    }
+#endif
+    testAllCodes();
+    testLengthsAndAlignment();
+    testExtremes();
+    testMerge();
+    return host_test_result(name);
+}
@@ -0,0 +1,274 @@
+// Bus cost of every public MTS4X method on the simulated chip at 100 and
+// 400 kHz (transactions, bytes on the wire, status polls, bus and virtual
+// wall time), and of a sample at every MPS x AVG in single-shot and
+// continuous mode. The counts are compared with extras/bench_baseline.csv:
+// any count above its baseline, or a row without one, fails the test.
+//
+//   make -C extras/host test_bench      check
+//   make -C extras/host bench-update    rewrite the baseline from this build
+
+#include "MTS4x.h"
+#include "MTS4xSim.h"
+#include "host_test.h"
+#include <map>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+#ifndef MTS4X_BENCH_BASELINE
+#error "test_bench is built with -DMTS4X_BENCH_BASELINE=\"<path of bench_baseline.csv>\""
+#endif
+
+static MTS4xSimDevice sim;
+static MTS4X          mts(sim);
+
+// -----------------------------------------------------------------------------
+// Calls under test
+// -----------------------------------------------------------------------------
+
+static bool bSetConfig()      { return mts.setConfig(MPS_1Hz, AVG_8, true); }
+static bool bSetMode()        { return mts.setMode(MEASURE_STOP, false); }
+static bool bSingleShot()     { float t; return mts.singleShot(t); }
+static bool bSingleMilli()    { int32_t m; return mts.singleShotMilli(m); }
+static bool bReadCrc()        { float t; bool c; return mts.readTemperatureCrc(t, c, true); }
+static bool bReadRawNoWait()  { int16_t r; return mts.readTemperatureRaw(r, false); }
+static bool bAsync() {
+    if (!mts.startConversion()) return false;
+    MTS4xPollResult r;
+    while ((r = mts.poll()) == MTS4X_POLL_PENDING) {
+        sim.advanceUs(250);   // the rest of loop()
+    }
+    return r == MTS4X_POLL_READY;
+}
+static bool bReadStatus()     { uint8_t s; return mts.readStatus(s); }
+static bool bHeaterOn()       { return mts.heaterOn(); }
+static bool bHeaterOff()      { return mts.heaterOff(); }
+static bool bIsHeaterOn()     { bool on; return mts.isHeaterOn(on); }
+static bool bSetAlertMode()   { return mts.setAlertMode(true, ALERT_MODE_HIGH_TH_LOW_ALARM); }
+static bool bGetAlertMode()   { bool e; MTS4xAlertMode m; return mts.getAlertMode(e, m); }
+static bool bSetHighLimit()   { return mts.setHighLimitMilli(40000); }
+static bool bGetHighLimit()   { int32_t m; return mts.getHighLimitMilli(m); }
+static bool bSetLimitsRaw()   { return mts.setLimitsRaw(3840, -1280); }
+static bool bReadDeviceId()   { uint16_t id; return mts.readDeviceId(id); }
+static bool bReadRomCode()    { uint8_t rom[5]; return mts.readRomCode(rom); }
+static bool bReadUser()       { uint8_t v; return mts.readUserRegister(0, v); }
+static bool bWriteUser()      { return mts.writeUserRegister(0, 0x12); }
+static bool bReadScratch()    { uint8_t s[8]; bool c; return mts.readScratch(s, c); }
+static bool bReadScratchExt() { uint8_t s[10]; bool c; return mts.readScratchExt(s, c); }
+static bool bEepromCopy()     { return mts.eepromCopyPage(true, 50); }
+static bool bEepromRecall()   { return mts.eepromRecallPage(true, 50); }
+static bool bSoftReset()      { return mts.softReset(true, 50); }
+static bool bParasitic()      { return mts.setParasiticPower(false); }
+
+struct BenchItem {
+    const char *name;
+    bool (*fn)();
+};
+
+static const BenchItem ITEMS[] = {
+    { "setConfig",            bSetConfig      },
+    { "setMode",              bSetMode        },
+    { "singleShot",           bSingleShot     },
+    { "singleShotMilli",      bSingleMilli    },
+    { "readTemperatureCrc",   bReadCrc        },
+    { "readTemperatureRaw",   bReadRawNoWait  },
+    { "startConversion+poll", bAsync          },
+    { "readStatus",           bReadStatus     },
+    { "heaterOn",             bHeaterOn       },
+    { "heaterOff",            bHeaterOff      },
+    { "isHeaterOn",           bIsHeaterOn     },
+    { "setAlertMode",         bSetAlertMode   },
+    { "getAlertMode",         bGetAlertMode   },
+    { "setHighLimitMilli",    bSetHighLimit   },
+    { "getHighLimitMilli",    bGetHighLimit   },
+    { "setLimitsRaw",         bSetLimitsRaw   },
+    { "readDeviceId",         bReadDeviceId   },
+    { "readRomCode",          bReadRomCode    },
+    { "readUserRegister",     bReadUser       },
+    { "writeUserRegister",    bWriteUser      },
+    { "readScratch",          bReadScratch    },
+    { "readScratchExt",       bReadScratchExt },
+    { "eepromCopyPage",       bEepromCopy     },
+    { "eepromRecallPage",     bEepromRecall   },
+    { "softReset",            bSoftReset      },
+    { "setParasiticPower",    bParasitic      },
+};
+
+// -----------------------------------------------------------------------------
+// Measurement
+// -----------------------------------------------------------------------------
+
+// Counts that must not grow: transactions, bytes, status polls
+struct Counts {
+    uint32_t transactions;
+    uint32_t bytes;
+    uint32_t statusReads;
+};
+
+struct Row {
+    std::string key;   // "BENCH,<method>,<hz>" or "SWEEP,<mode>,<mps>,<avg>"
+    Counts      counts;
+};
+
+static std::vector<Row> s_rows;
+
+// Runs fn from fresh counters and prints its CSV line:
+//   <key>,<transactions>,<bytes>,<status_reads>,<bus_us>,<wall_us>
+static void measure(const std::string &key, bool (*fn)()) {
+    sim.resetCounters();
+    uint64_t t0   = sim.nowUs();
+    bool     ok   = fn();
+    uint64_t wall = sim.nowUs() - t0;
+    Row      r    = { key, { sim.transactions(), sim.bytesOnWire(), sim.statusReads() } };
+    printf("  %s,%lu,%lu,%lu,%lu,%lu\n", key.c_str(), (unsigned long)r.counts.transactions,
+           (unsigned long)r.counts.bytes, (unsigned long)r.counts.statusReads,
+           (unsigned long)sim.busTimeUs(), (unsigned long)wall);
+    if (!ok) {
+        printf("  %s failed: error %d\n", key.c_str(), mts.lastError());
+        CHECK(ok);
+    }
+    s_rows.push_back(r);
+}
+
+static void runAll(uint32_t hz) {
+    sim.powerOn();
+    mts.setBusClock(hz);
+    CHECK(mts.setConfig(MPS_1Hz, AVG_8, true));
+    for (size_t i = 0; i < sizeof(ITEMS) / sizeof(ITEMS[0]); ++i) {
+        char key[64];
+        snprintf(key, sizeof(key), "BENCH,%s,%lu", ITEMS[i].name, (unsigned long)hz);
+        measure(key, ITEMS[i].fn);
+    }
+}
+
+static uint8_t s_sweepMode;   // 0: singleShot(), 1: readTemperatureCrc(wait) while running
+
+static bool sweepSample() {
+    float t;
+    bool  crc = false;
+    return s_sweepMode == 0 ? mts.singleShot(t) : mts.readTemperatureCrc(t, crc, true);
+}
+
+// Continuous mode is read at an arbitrary phase of the chip's own cycle:
+// 1 ms into the first conversion
+static void runSweep() {
+    static const char *MPS[] = { "8Hz", "4Hz", "2Hz", "1Hz", "0.5Hz", "0.25Hz", "0.125Hz", "0.0625Hz" };
+    static const char *AVG[] = { "1", "8", "16", "32" };
+    mts.setBusClock(400000UL);
+    for (s_sweepMode = 0; s_sweepMode < 2; ++s_sweepMode) {
+        for (uint8_t m = 0; m < 8; ++m) {
+            for (uint8_t a = 0; a < 4; ++a) {
+                sim.powerOn();
+                CHECK(mts.setConfig((TempCfgMPS)(m << 5), (TempCfgAVG)(a << 3), s_sweepMode == 0));
+                if (s_sweepMode == 1) {
+                    CHECK(mts.setMode(MEASURE_CONTINUOUS, false));
+                    sim.advanceUs(1000);
+                }
+                char key[64];
+                snprintf(key, sizeof(key), "SWEEP,%s,%s,%s",
+                         s_sweepMode == 0 ? "single" : "continuous", MPS[m], AVG[a]);
+                measure(key, sweepSample);
+            }
+        }
+    }
+}
+
+// -----------------------------------------------------------------------------
+// Baseline
+// -----------------------------------------------------------------------------
+
+// Lines "<key>,<transactions>,<bytes>,<status_reads>"; '#' starts a comment
+static bool loadBaseline(std::map<std::string, Counts> &out) {
+    FILE *f = fopen(MTS4X_BENCH_BASELINE, "r");
+    if (!f) {
+        return false;
+    }
+    char line[256];
+    while (fgets(line, sizeof(line), f)) {
+        if (line[0] == '#' || line[0] == '\n') continue;
+        std::string   s(line);
+        unsigned long tx, bytes, polls;
+        size_t        cut = s.size();
+        for (uint8_t i = 0; i < 3 && cut != std::string::npos && cut > 0; ++i) {
+            cut = s.rfind(',', cut - 1);
+        }
+        if (cut == std::string::npos ||
+            sscanf(s.c_str() + cut, ",%lu,%lu,%lu", &tx, &bytes, &polls) != 3) {
+            continue;
+        }
+        Counts c = { (uint32_t)tx, (uint32_t)bytes, (uint32_t)polls };
+        out[s.substr(0, cut)] = c;
+    }
+    fclose(f);
+    return true;
+}
+
+static bool writeBaseline() {
+    FILE *f = fopen(MTS4X_BENCH_BASELINE, "w");
+    if (!f) {
+        return false;
+    }
+    fprintf(f, "# MTS4x bus cost baseline, written by make -C extras/host bench-update\n");
+    fprintf(f, "# key,transactions,bytes,status_reads (a higher count fails test_bench)\n");
+    for (size_t i = 0; i < s_rows.size(); ++i) {
+        const Counts &c = s_rows[i].counts;
+        fprintf(f, "%s,%lu,%lu,%lu\n", s_rows[i].key.c_str(), (unsigned long)c.transactions,
+                (unsigned long)c.bytes, (unsigned long)c.statusReads);
+    }
+    fclose(f);
+    return true;
+}
+
+static void checkBaseline() {
+    std::map<std::string, Counts> base;
+    if (!loadBaseline(base)) {
+        printf("  no baseline at %s (make bench-update writes it)\n", MTS4X_BENCH_BASELINE);
+        CHECK(false);
+        return;
+    }
+    uint32_t worse = 0, better = 0;
+    for (size_t i = 0; i < s_rows.size(); ++i) {
+        const Row &r = s_rows[i];
+        std::map<std::string, Counts>::const_iterator b = base.find(r.key);
+        if (b == base.end()) {
+            printf("  %s: no baseline row\n", r.key.c_str());
+            ++worse;
+            continue;
+        }
+        const Counts &was = b->second, &now = r.counts;
+        if (now.transactions > was.transactions || now.bytes > was.bytes ||
+            now.statusReads > was.statusReads) {
+            printf("  %s: %lu/%lu/%lu transactions/bytes/polls, baseline %lu/%lu/%lu\n",
+                   r.key.c_str(), (unsigned long)now.transactions, (unsigned long)now.bytes,
+                   (unsigned long)now.statusReads, (unsigned long)was.transactions,
+                   (unsigned long)was.bytes, (unsigned long)was.statusReads);
+            ++worse;
+        } else if (now.transactions < was.transactions || now.bytes < was.bytes ||
+                   now.statusReads < was.statusReads) {
+            ++better;
+        }
+    }
+    printf("  %lu rows against the baseline: %lu above it, %lu below it%s\n",
+           (unsigned long)s_rows.size(), (unsigned long)worse, (unsigned long)better,
+           better ? " (make bench-update to tighten)" : "");
+    CHECK_EQ(worse, 0);
+}
+
+int main() {
+    CHECK(mts.begin(0, 0));
+    sim.setTemperatureMilli(21500);
+
+    printf("  key,transactions,bytes,status_reads,bus_us,wall_us\n");
+    runAll(100000UL);
+    runAll(400000UL);
+    runSweep();
+
+    const char *update = getenv("MTS4X_BENCH_UPDATE");
+    if (update && *update && *update != '0') {
+        CHECK(writeBaseline());
+        printf("  baseline written to %s\n", MTS4X_BENCH_BASELINE);
+    } else {
+        checkBaseline();
+    }
+    return host_test_result("test_bench");
+}
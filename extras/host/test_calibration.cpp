@@ -0,0 +1,420 @@
+// MTS4xCalibration: encode/decode round trip over random knot sets and
+// every valid register layout, rejection of erased and corrupted
+// registers, apply() against exact interpolation on all 65536 raw codes,
+// a bench sensor with a curved error corrected with 1..4 knots, store/load
+// through the simulated chip and its EEPROM, and the table footprint and
+// cycles per corrected sample
+
+#include "MTS4x.h"
+#include "MTS4xCalibration.h"
+#include "MTS4xSim.h"
+#include "host_test.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// Knots as stored: °C - 25 and correction in MTS4X_CAL_STEP_RAW units
+struct Knots {
+    uint8_t count;
+    int8_t  t[MTS4X_CAL_MAX_POINTS];
+    int8_t  c[MTS4X_CAL_MAX_POINTS];
+};
+
+// Random valid knots: strictly ascending, corrections -127..127
+static Knots randomKnots() {
+    Knots k;
+    k.count = (uint8_t)(1 + rand() % MTS4X_CAL_MAX_POINTS);
+    for (;;) {
+        bool ok = true;
+        for (uint8_t i = 0; i < k.count; ++i) {
+            k.t[i] = (int8_t)(rand() % 256 - 128);
+            k.c[i] = (int8_t)(rand() % 255 - 127);
+            ok     = ok && (i == 0 || k.t[i] > k.t[i - 1]);
+        }
+        if (ok) return k;
+    }
+}
+
+static void layout(const Knots &k, uint8_t user[10]) {
+    memset(user, 0, 10);
+    user[0] = (uint8_t)(MTS4X_CAL_MAGIC | k.count);
+    for (uint8_t i = 0; i < k.count; ++i) {
+        user[1 + 2 * i] = (uint8_t)k.t[i];
+        user[2 + 2 * i] = (uint8_t)k.c[i];
+    }
+    user[9] = MTS4xCrc8::compute(user, 9);
+}
+
+// The correction the knots define at raw, in raw codes, exactly
+static double exactCorrection(const Knots &k, int32_t raw) {
+    double x0 = k.t[0] * 256.0, y0 = k.c[0] * (double)MTS4X_CAL_STEP_RAW;
+    if (raw <= x0) return y0;
+    for (uint8_t i = 1; i < k.count; ++i) {
+        double x1 = k.t[i] * 256.0, y1 = k.c[i] * (double)MTS4X_CAL_STEP_RAW;
+        if (raw < x1) return y0 + (y1 - y0) * (raw - x0) / (x1 - x0);
+        x0 = x1;
+        y0 = y1;
+    }
+    return y0;
+}
+
+// -----------------------------------------------------------------------------
+// Round trip
+// -----------------------------------------------------------------------------
+
+// setPoints -> encode -> decode -> encode: the same bytes, the knots read
+// back within their quantisation (whole °C, 7.8 m°C)
+static void testRoundTrip() {
+    uint32_t badBytes = 0, badKnot = 0, badDecode = 0;
+    int32_t  worstCorr = 0;
+    for (uint32_t n = 0; n < 20000; ++n) {
+        uint8_t count = (uint8_t)(1 + rand() % MTS4X_CAL_MAX_POINTS);
+        int32_t t[MTS4X_CAL_MAX_POINTS], c[MTS4X_CAL_MAX_POINTS];
+        int32_t at = -100000L + rand() % 50000;
+        for (uint8_t i = 0; i < count; ++i) {
+            t[i] = at;
+            c[i] = rand() % 1985 - 992;
+            at  += 1500 + rand() % 60000;
+        }
+        MTS4xCalibration a;
+        if (!a.setPoints(t, c, count)) continue;   // ran past +152 °C
+
+        uint8_t user[10], again[10];
+        a.encode(user);
+        MTS4xCalibration b;
+        if (!b.decode(user)) {
+            ++badDecode;
+            continue;
+        }
+        b.encode(again);
+        if (memcmp(user, again, sizeof(user))) ++badBytes;
+        if (b.points() != count) ++badKnot;
+        for (uint8_t i = 0; i < b.points(); ++i) {
+            int32_t tm = 0, cm = 0;
+            b.point(i, tm, cm);
+            if (labs(tm - t[i]) > 500) ++badKnot;
+            if (labs(cm - c[i]) > worstCorr) worstCorr = labs(cm - c[i]);
+        }
+        for (int32_t raw = -32768; raw <= 32767; raw += 997) {
+            if (a.apply((int16_t)raw) != b.apply((int16_t)raw)) ++badBytes;
+        }
+    }
+    CHECK_EQ(badDecode, 0);
+    CHECK_EQ(badBytes, 0);
+    CHECK_EQ(badKnot, 0);
+    // Half a correction step, 3.9 m°C, plus the m°C rounding of point()
+    CHECK(worstCorr <= 5);
+
+    // Every valid layout decodes and encodes back to itself
+    uint32_t badLayout = 0;
+    for (uint32_t n = 0; n < 20000; ++n) {
+        Knots   k = randomKnots();
+        uint8_t user[10], again[10];
+        layout(k, user);
+        MTS4xCalibration cal;
+        if (!cal.decode(user)) {
+            ++badLayout;
+            continue;
+        }
+        cal.encode(again);
+        if (memcmp(user, again, sizeof(user))) ++badLayout;
+    }
+    CHECK_EQ(badLayout, 0);
+
+    // No calibration encodes as erased registers, which do not decode
+    MTS4xCalibration none;
+    uint8_t          user[10], zero[10] = { 0 };
+    none.encode(user);
+    CHECK(!memcmp(user, zero, sizeof(user)));
+    CHECK(!none.decode(user));
+    CHECK_EQ(none.apply(1234), 1234);
+}
+
+// Erased, corrupted and malformed registers are refused and leave the
+// calibration as it was
+static void testRejected() {
+    MTS4xCalibration cal;
+    int32_t          t[] = { 0, 40000 }, c[] = { 200, -100 };
+    CHECK(cal.setPoints(t, c, 2));
+    uint8_t good[10];
+    cal.encode(good);
+
+    uint8_t user[10];
+    memset(user, 0xFF, sizeof(user));
+    CHECK(!cal.decode(user));
+
+    // The CRC catches every single flipped bit
+    uint32_t accepted = 0;
+    for (uint8_t bit = 0; bit < 80; ++bit) {
+        memcpy(user, good, sizeof(user));
+        user[bit / 8] ^= (uint8_t)(1 << (bit % 8));
+        if (cal.decode(user)) ++accepted;
+    }
+    CHECK_EQ(accepted, 0);
+
+    // Valid CRC, invalid layout
+    Knots k = { 2, { 10, 10 }, { 0, 0 } };   // not ascending
+    layout(k, user);
+    CHECK(!cal.decode(user));
+    k.t[1] = 20;
+    k.c[0] = -128;                           // outside -127..127
+    layout(k, user);
+    CHECK(!cal.decode(user));
+    k.c[0]  = 0;
+    layout(k, user);
+    user[0] = MTS4X_CAL_MAGIC | 5;           // too many knots
+    user[9] = MTS4xCrc8::compute(user, 9);
+    CHECK(!cal.decode(user));
+    user[0] = MTS4X_CAL_MAGIC;               // none
+    user[9] = MTS4xCrc8::compute(user, 9);
+    CHECK(!cal.decode(user));
+
+    uint8_t now[10];
+    cal.encode(now);
+    CHECK(!memcmp(now, good, sizeof(now)));
+
+    // setPoints() refuses what the layout cannot hold
+    int32_t hot[]  = { 160000 }, big[] = { 1000 };
+    int32_t same[] = { 20000, 20400 }, two[] = { 0, 0 };
+    CHECK(!cal.setPoints(hot, c, 1));
+    CHECK(!cal.setPoints(t, big, 1));
+    CHECK(!cal.setPoints(same, two, 2));     // one °C after rounding
+    CHECK(!cal.setPoints(t, c, 0));
+    cal.encode(now);
+    CHECK(!memcmp(now, good, sizeof(now)));
+}
+
+// -----------------------------------------------------------------------------
+// Accuracy
+// -----------------------------------------------------------------------------
+
+// apply() on every raw code against the exact piecewise-linear correction:
+// within half a LSB plus the Q22 slope rounding, saturated at the ends
+static void testExactness() {
+    double   worst  = 0;
+    uint32_t badSat = 0;
+    for (uint32_t n = 0; n < 400; ++n) {
+        Knots   k = randomKnots();
+        uint8_t user[10];
+        layout(k, user);
+        MTS4xCalibration cal;
+        CHECK(cal.decode(user));
+        for (int32_t raw = -32768; raw <= 32767; ++raw) {
+            double  want = raw + exactCorrection(k, raw);
+            int16_t got  = cal.apply((int16_t)raw);
+            if (want > 32767 || want < -32768) {
+                if (got != (want > 0 ? 32767 : -32768)) ++badSat;
+                continue;
+            }
+            double err = fabs(got - want);
+            if (err > worst) worst = err;
+        }
+    }
+    printf("  apply() vs exact interpolation, 400 tables x 65536 codes: "
+           "worst %.4f LSB (%.2f m°C)\n", worst, worst * 1000.0 / 256.0);
+    CHECK(worst <= 0.5 + 1.0 / 64);
+    CHECK_EQ(badSat, 0);
+}
+
+// Sensor reading of a reference temperature: 150 m°C low at 20 °C
+// rising to 150 m°C high at -10 and 50 °C (a curved error no offset fits)
+static int32_t sensorMilli(double refC) {
+    double e = 0.150 * (((refC - 20.0) / 30.0) * ((refC - 20.0) / 30.0)) * 2.0 - 0.150;
+    return (int32_t)lround((refC + e) * 1000.0);
+}
+
+// Bench calibration at 1..4 reference points over -10..50 °C: worst error
+// of the corrected reading across the range, every 10 m°C
+static void testBench() {
+    static const double refs[MTS4X_CAL_MAX_POINTS][MTS4X_CAL_MAX_POINTS] = {
+        { 20.0 },
+        { -10.0, 50.0 },
+        { -10.0, 20.0, 50.0 },
+        { -10.0, 10.0, 30.0, 50.0 },
+    };
+    printf("  bench, -10..50 °C  knots  worst error m°C\n");
+    double prev = 1e9;
+    for (uint8_t n = 0; n <= MTS4X_CAL_MAX_POINTS; ++n) {
+        MTS4xCalibration cal;
+        if (n) {
+            int32_t t[MTS4X_CAL_MAX_POINTS], c[MTS4X_CAL_MAX_POINTS];
+            for (uint8_t i = 0; i < n; ++i) {
+                // Knots sit at whole °C of the sensor: the bench reads the
+                // reference there
+                t[i] = sensorMilli(refs[n - 1][i]);
+                t[i] = (int32_t)lround(t[i] / 1000.0) * 1000;
+                double lo = refs[n - 1][i] - 1.0, hi = refs[n - 1][i] + 1.0;
+                for (int it = 0; it < 60; ++it) {
+                    double mid = (lo + hi) / 2;
+                    (sensorMilli(mid) < t[i] ? lo : hi) = mid;
+                }
+                c[i] = (int32_t)lround(lo * 1000.0) - t[i];
+            }
+            CHECK(cal.setPoints(t, c, n));
+        }
+        double worst = 0;
+        for (int32_t ref = -10000; ref <= 50000; ref += 10) {
+            int16_t raw = mts4x_milli_to_raw(sensorMilli(ref / 1000.0));
+            double  err = fabs((double)mts4x_raw_to_milli(cal.apply(raw)) - ref);
+            if (err > worst) worst = err;
+        }
+        printf("  %17s  %5u  %15.1f\n", n ? "corrected" : "raw sensor", n, worst);
+        if (n >= 3) CHECK(worst < prev);
+        prev = worst;
+        // Chord of the curve over 20 °C segments (33 m°C), plus half a
+        // correction step, half a LSB of the reading and the m°C rounding
+        if (n == MTS4X_CAL_MAX_POINTS) CHECK(worst <= 33.4 + 3.9 + 2.0 + 1.0);
+    }
+}
+
+// -----------------------------------------------------------------------------
+// Sensor
+// -----------------------------------------------------------------------------
+
+// store() writes the user registers and the EEPROM page, keeps the rest
+// of the configuration, and writes nothing when nothing changed; the
+// calibration comes back from EEPROM after the registers are lost
+static void testSensor() {
+    MTS4xSimDevice sim;
+    MTS4X          mts(sim);
+    CHECK(mts.begin(0, 0));
+    CHECK(mts.setConfig(MPS_4Hz, AVG_16, true));
+    MTS4xProfile before;
+    CHECK(mts.readProfile(before));
+
+    MTS4xCalibration cal;
+    int32_t          t[] = { -5000, 25000, 70000 }, c[] = { 180, -20, -420 };
+    CHECK(cal.setPoints(t, c, 3));
+    CHECK(cal.store(mts));
+    CHECK_EQ(sim.eepromWrites(), 1);
+
+    uint8_t user[10];
+    cal.encode(user);
+    CHECK(!memcmp(sim.eeprom() + (0x0C - 0x04), user, sizeof(user)));
+    MTS4xProfile after;
+    CHECK(mts.readProfile(after));
+    CHECK(!memcmp(after.scratch, before.scratch, sizeof(after.scratch)));
+
+    CHECK(cal.store(mts));
+    CHECK_EQ(sim.eepromWrites(), 1);
+
+    // Registers cleared behind the driver's back, then recalled
+    for (uint8_t r = 0x0C; r <= 0x15; ++r) sim.poke(r, 0);
+    MTS4xCalibration lost;
+    CHECK(!lost.load(mts));
+    CHECK(mts.eepromRecallPage());
+    MTS4xCalibration back;
+    CHECK(back.load(mts));
+    uint8_t again[10];
+    back.encode(again);
+    CHECK(!memcmp(again, user, sizeof(user)));
+
+    // A chip that does not answer is not a calibration
+    sim.injectNak(1000);
+    MTS4xCalibration dead;
+    CHECK(!dead.load(mts));
+    sim.injectNak(0);
+}
+
+// -----------------------------------------------------------------------------
+// Footprint and speed
+// -----------------------------------------------------------------------------
+
+static uint64_t ticks() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+#endif
+}
+
+static volatile int32_t s_sink;   // keeps the timed calls
+
+// The same knots evaluated in float at run time, as a straightforward
+// correction would: find the segment, divide, add
+struct FloatCorrection {
+    uint8_t count;
+    float   t[MTS4X_CAL_MAX_POINTS];
+    float   c[MTS4X_CAL_MAX_POINTS];
+
+    float apply(float tC) const {
+        if (tC <= t[0]) return tC + c[0];
+        for (uint8_t i = 1; i < count; ++i) {
+            if (tC < t[i]) {
+                return tC + c[i - 1] + (c[i] - c[i - 1]) * (tC - t[i - 1]) / (t[i] - t[i - 1]);
+            }
+        }
+        return tC + c[count - 1];
+    }
+};
+
+template <class F>
+static double perSample(F f) {
+    double best = 0;
+    for (uint8_t pass = 0; pass < 9; ++pass) {
+        uint64_t t0  = ticks();
+        int32_t  sum = 0;
+        for (int32_t raw = -32768; raw <= 32767; ++raw) sum += f((int16_t)raw);
+        s_sink   = sum;
+        double d = (double)(ticks() - t0) / 65536.0;
+        if (!pass || d < best) best = d;
+    }
+    return best;
+}
+
+static MTS4xCalibration s_cal;
+static FloatCorrection  s_float;
+
+static int32_t fixedPath(int16_t raw) {
+    return mts4x_raw_to_milli(s_cal.apply(raw));
+}
+
+static int32_t floatPath(int16_t raw) {
+    return (int32_t)(s_float.apply(MTS4X_RAW_TO_CELSIUS(raw)) * 1000.0f);
+}
+
+static void testFootprint() {
+    // _count, 2 x 4 int16 knots, 3 int32 slopes: 29 bytes packed (AVR),
+    // 32 with the alignment of a 32-bit target
+    const size_t packed = sizeof(uint8_t) + 2 * MTS4X_CAL_MAX_POINTS * sizeof(int16_t) +
+                          (MTS4X_CAL_MAX_POINTS - 1) * sizeof(int32_t);
+    CHECK_EQ(packed, 29);
+    CHECK(sizeof(MTS4xCalibration) <= 32);
+
+    Knots   k = { 4, { -35, -15, 5, 25 }, { 23, -3, -5, -54 } };
+    uint8_t user[10];
+    layout(k, user);
+    CHECK(s_cal.decode(user));
+    s_float.count = 4;
+    for (uint8_t i = 0; i < 4; ++i) {
+        s_float.t[i] = 25.0f + k.t[i];
+        s_float.c[i] = k.c[i] * MTS4X_CAL_STEP_RAW / 256.0f;
+    }
+    double fixed = perSample(fixedPath);
+    double flt   = perSample(floatPath);
+#if defined(__x86_64__) || defined(__i386__)
+    const char *unit = "cycles";
+#else
+    const char *unit = "ns";
+#endif
+    printf("  table %u bytes (%u packed, stored in 10 user registers); apply() %.1f %s/sample, "
+           "float interpolation %.1f\n", (unsigned)sizeof(MTS4xCalibration), (unsigned)packed,
+           fixed, unit, flt);
+}
+
+int main() {
+    srand(23);
+    testRoundTrip();
+    testRejected();
+    testExactness();
+    testBench();
+    testSensor();
+    testFootprint();
+    return host_test_result("test_calibration");
+}
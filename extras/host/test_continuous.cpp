@@ -0,0 +1,149 @@
+// MTS4XContinuousReader on the simulated chip with a detuned oscillator:
+// 480 locked periods per case at -2% and +1.5%, the reader polled only
+// when nextReadInUs() says a read is due. Checks the bus cost per sample,
+// the learned drift, that no sample is delivered twice, and that a 3.4-period
+// stall counts the lost conversions and relocks once.
+
+#include "MTS4x.h"
+#include "MTS4xContinuousReader.h"
+#include "MTS4xSim.h"
+#include "host_test.h"
+
+#define PERIODS 480   // conversions per case once locked
+
+static uint32_t nominalUs(TempCfgMPS mps) {
+    return 125000UL << (mps >> 5);
+}
+
+struct Case {
+    const char *name;
+    TempCfgMPS  mps;
+    TempCfgAVG  avg;
+    int32_t     ppm;
+};
+
+struct Outcome {
+    uint32_t samples;
+    uint32_t stale;        // delivered without a new conversion since the last one
+    uint32_t transactions;
+    MTS4xLockStats st;
+};
+
+// Sleeps until the next due read, polls; stallUs skips the reads once
+// right after the first sample past stallAtUs, as a busy main loop would
+static Outcome run(MTS4xSimDevice &sim, MTS4XContinuousReader &rd, uint64_t untilUs,
+                   uint64_t stallAtUs = 0, uint32_t stallUs = 0) {
+    Outcome  o        = {};
+    uint32_t lastConv = 0xFFFFFFFFUL;
+    uint64_t end      = sim.nowUs() + untilUs;
+    bool     stalled  = false;
+    while (sim.nowUs() < end) {
+        int16_t raw;
+        if (rd.poll(raw)) {
+            ++o.samples;
+            o.stale += sim.conversions() == lastConv;
+            lastConv = sim.conversions();
+            if (!stalled && stallUs && sim.nowUs() >= stallAtUs) {
+                sim.advanceUs(stallUs);
+                stalled = true;
+            }
+        }
+        uint32_t wait = rd.nextReadInUs();
+        sim.advanceUs(wait ? wait : 1);
+    }
+    o.transactions = sim.transactions();
+    rd.lockStats(o.st);
+    return o;
+}
+
+// Polls until the reader locks, at most 100 s
+static bool acquire(MTS4xSimDevice &sim, MTS4XContinuousReader &rd) {
+    uint64_t end = sim.nowUs() + 100000000ULL;
+    while (!rd.locked() && sim.nowUs() < end) {
+        int16_t  raw;
+        rd.poll(raw);
+        uint32_t wait = rd.nextReadInUs();
+        sim.advanceUs(wait ? wait : 1);
+    }
+    return rd.locked();
+}
+
+static void testDrift() {
+    static const Case CASES[] = {
+        { "8Hz AVG_1 -2%",        MPS_8Hz,      AVG_1,  -20000 },
+        { "8Hz AVG_1 +1.5%",      MPS_8Hz,      AVG_1,   15000 },
+        { "1Hz AVG_32 -2%",       MPS_1Hz,      AVG_32, -20000 },
+        { "0.125Hz AVG_32 +1.5%", MPS_0_125Hz,  AVG_32,  15000 },
+    };
+    printf("  config                tx/sample  age avg   age max   early  missed  drift est\n");
+    for (size_t i = 0; i < sizeof(CASES) / sizeof(CASES[0]); ++i) {
+        const Case    &c = CASES[i];
+        MTS4xSimDevice sim;
+        MTS4X          mts(sim);
+        sim.setTemperatureMilli(22000);
+        sim.setNoise(8);
+        sim.setOscillatorPpm(c.ppm);
+        CHECK(mts.begin(0, 0));
+        mts.setBusClock(400000UL);
+        MTS4XContinuousReader rd(mts);
+        CHECK(rd.begin(c.mps, c.avg));
+        CHECK(acquire(sim, rd));
+        sim.resetCounters();
+        rd.resetStats();
+
+        Outcome o = run(sim, rd, (uint64_t)PERIODS * nominalUs(c.mps));
+        uint32_t perMille = o.samples ? (uint32_t)(1000ULL * o.transactions / o.samples) : 0;
+        printf("  %-21s %lu.%03lu      %4lu.%02lu ms %4lu.%02lu ms %5lu  %6lu  %+ld ppm\n", c.name,
+               (unsigned long)(perMille / 1000), (unsigned long)(perMille % 1000),
+               (unsigned long)(o.st.ageAvgUs / 1000), (unsigned long)(o.st.ageAvgUs % 1000 / 10),
+               (unsigned long)(o.st.ageMaxUs / 1000), (unsigned long)(o.st.ageMaxUs % 1000 / 10),
+               (unsigned long)o.st.earlyReads, (unsigned long)o.st.missed, (long)o.st.driftPpm);
+
+        CHECK(rd.locked());
+        CHECK(o.samples > 0);
+        CHECK_EQ(o.stale, 0);
+        CHECK_EQ(o.st.missed, 0);
+        CHECK_EQ(o.st.relocks, 0);
+        // Every conversion of the run delivered once, none read twice
+        CHECK(o.samples + 1 >= sim.conversions());
+        // One read per sample plus about 1/(K+1) = 1/16 early reads
+        CHECK(perMille >= 1060 && perMille <= 1100);
+        CHECK(o.st.driftPpm >= c.ppm - 20 && o.st.driftPpm <= c.ppm + 20);
+    }
+}
+
+// Locked at 8Hz/AVG_8, then the loop is away for 3.4 periods: the two
+// overwritten conversions are counted, the newest one is delivered, and
+// the phase is found again with one relock
+static void testStall() {
+    MTS4xSimDevice sim;
+    MTS4X          mts(sim);
+    sim.setTemperatureMilli(22000);
+    sim.setOscillatorPpm(-20000);
+    CHECK(mts.begin(0, 0));
+    mts.setBusClock(400000UL);
+    MTS4XContinuousReader rd(mts);
+    CHECK(rd.begin(MPS_8Hz, AVG_8));
+
+    run(sim, rd, 5000000ULL);
+    CHECK(rd.locked());
+    MTS4xLockStats st;
+    rd.lockStats(st);
+    uint32_t periodUs = st.periodUs;
+    rd.resetStats();
+
+    Outcome o = run(sim, rd, 10000000ULL, sim.nowUs() + 1000000ULL, periodUs * 34 / 10);
+    printf("  stall 3.4 x %lu us: %lu missed, %lu relocks, %lu stale, %lu samples\n",
+           (unsigned long)periodUs, (unsigned long)o.st.missed, (unsigned long)o.st.relocks,
+           (unsigned long)o.stale, (unsigned long)o.samples);
+    CHECK_EQ(o.st.missed, 2);
+    CHECK_EQ(o.st.relocks, 1);
+    CHECK_EQ(o.stale, 0);
+    CHECK(rd.locked());
+}
+
+int main() {
+    testDrift();
+    testStall();
+    return host_test_result("test_continuous");
+}
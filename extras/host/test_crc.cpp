@@ -0,0 +1,136 @@
+// CRC8 backend selected by MTS4X_CRC_IMPL against the bitwise loop the
+// driver used before: exhaustive equivalence, incremental update() over
+// every split, and cycles per byte of both. Built once per backend.
+
+#include "MTS4x.h"
+#include "host_test.h"
+#include <stdlib.h>
+#include <time.h>
+#include <vector>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// The driver's mts4x_crc8 before the selectable backends
+static uint8_t refCrc8(const uint8_t *data, size_t len) {
+    uint8_t crc = 0x00;
+    while (len--) {
+        uint8_t in = *data++;
+        for (uint8_t i = 0; i < 8; ++i) {
+            uint8_t mix = (crc ^ in) & 0x01;
+            crc >>= 1;
+            if (mix) {
+                crc ^= 0x8C;
+            }
+            in >>= 1;
+        }
+    }
+    return crc;
+}
+
+static const char *backendName() {
+    switch (MTS4X_CRC_IMPL) {
+        case MTS4X_CRC_TABLE:  return "table";
+        case MTS4X_CRC_NIBBLE: return "nibble";
+        default:               return "bitwise";
+    }
+}
+
+// The first byte reaches every CRC state (the step from 0 is a bijection),
+// so all two-byte inputs cover the step for every (state, byte) pair: any
+// longer input then agrees too
+static void testExhaustive() {
+    uint32_t bad = 0;
+    for (uint32_t v = 0; v < 0x10000UL; ++v) {
+        uint8_t buf[2] = { (uint8_t)v, (uint8_t)(v >> 8) };
+        uint8_t want   = refCrc8(buf, 2);
+        if (MTS4xCrc8::compute(buf, 2) != want || MTS4xCrc8::compute(buf, 1) != refCrc8(buf, 1)) {
+            ++bad;
+        }
+        MTS4xCrc8 inc;
+        inc.update(buf[0]);
+        inc.update(buf[1]);
+        if (inc.value() != want) {
+            ++bad;
+        }
+    }
+    CHECK_EQ(bad, 0);
+
+    // CRC-8/MAXIM check value, and the datasheet's empty input
+    CHECK_EQ(MTS4xCrc8::compute((const uint8_t *)"123456789", 9), 0xA1);
+    CHECK_EQ(MTS4xCrc8::compute(NULL, 0), 0x00);
+}
+
+// Streaming: any split of a buffer into update() calls, reset() reuses
+static void testIncremental() {
+    uint8_t buf[64];
+    srand(5);
+    for (uint16_t round = 0; round < 200; ++round) {
+        size_t len = 1 + rand() % sizeof(buf);
+        for (size_t i = 0; i < len; ++i) {
+            buf[i] = (uint8_t)rand();
+        }
+        uint8_t   want = refCrc8(buf, len);
+        MTS4xCrc8 crc;
+        for (size_t cut = 0; cut <= len; ++cut) {
+            crc.reset();
+            crc.update(buf, cut);
+            crc.update(buf + cut, len - cut);
+            if (crc.value() != want) {
+                CHECK_EQ(crc.value(), want);
+                return;
+            }
+        }
+    }
+}
+
+static uint64_t ticks() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+#endif
+}
+
+static volatile uint8_t s_sink;   // keeps the timed calls
+
+// Best of several passes over 64 KiB, per byte
+template <class F>
+static double perByte(F crc, const std::vector<uint8_t> &buf) {
+    double best = 0;
+    for (uint8_t pass = 0; pass < 9; ++pass) {
+        uint64_t t0 = ticks();
+        s_sink = crc(&buf[0], buf.size());
+        double d = (double)(ticks() - t0) / buf.size();
+        if (!pass || d < best) best = d;
+    }
+    return best;
+}
+
+static void benchmark() {
+    std::vector<uint8_t> buf(65536);
+    for (size_t i = 0; i < buf.size(); ++i) {
+        buf[i] = (uint8_t)(i * 131 + (i >> 7));
+    }
+    double old = perByte(refCrc8, buf);
+    double now = perByte(MTS4xCrc8::compute, buf);
+    CHECK_EQ(MTS4xCrc8::compute(&buf[0], buf.size()), refCrc8(&buf[0], buf.size()));
+#if defined(__x86_64__) || defined(__i386__)
+    const char *unit = "cycles";
+#else
+    const char *unit = "ns";
+#endif
+    printf("  %-7s %5.2f %s/byte, old bitwise loop %5.2f (%.1fx)\n", backendName(), now,
+           unit, old, old / now);
+}
+
+int main() {
+    testExhaustive();
+    testIncremental();
+    benchmark();
+    char name[32];
+    snprintf(name, sizeof(name), "test_crc (%s)", backendName());
+    return host_test_result(name);
+}
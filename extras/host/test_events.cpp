@@ -0,0 +1,152 @@
+// MeteoStation live updates (EventStream) over loopback HTTP: bytes and
+// CPU per client per minute against reloading the whole page every 5 s,
+// a full house answered 503, and the two ways a subscriber goes away
+// counted apart: a closed connection is "closed", a reader that falls
+// behind is "evicted" without holding up the measurement loop
+
+#include "station.h"
+#include "host_test.h"
+#include <time.h>
+
+static double cpuUs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec * 1e-3;
+}
+
+static double wallUs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec * 1e-3;
+}
+
+// One simulated minute of loop(): CPU spent, bytes each client read
+static double runMinute(const int *fds, uint8_t n, long *bytes) {
+    double cpu = 0;
+    for (uint8_t i = 0; i < n; ++i) bytes[i] = 0;
+    for (uint16_t c = 0; c < 60000UL / UI_UPDATE_INTERVAL_MS; ++c) {
+        double t0 = cpuUs();
+        station_cycle();
+        cpu += cpuUs() - t0;
+        for (uint8_t i = 0; i < n; ++i) {
+            long got = station_drain(fds[i]);
+            if (got > 0) bytes[i] += got;
+        }
+    }
+    return cpu;
+}
+
+// Quietest of a few minutes: an upload attempt or a preempted run lands
+// in one of them, not in all
+static double quietMinute(const int *fds, uint8_t n, long *bytes) {
+    double best = 0;
+    for (uint8_t m = 0; m < 3; ++m) {
+        double cpu = runMinute(fds, n, bytes);
+        if (!m || cpu < best) best = cpu;
+    }
+    return best;
+}
+
+static bool subscribe(int *fd, int rcvBuf = 0) {
+    *fd = station_request("/events", rcvBuf);
+    loop();
+    std::string head;
+    station_drain(*fd, &head);
+    return head.compare(0, 15, "HTTP/1.1 200 OK") == 0 &&
+           head.find("text/event-stream") != std::string::npos &&
+           head.find("data: ") != std::string::npos;   // snapshot right away
+}
+
+int main() {
+    LittleFS.format();
+    station_sim.setTemperatureMilli(21500);
+    station_sim.setNoise(8);
+    station_sim.setSeed(1);
+    setup();
+    for (uint8_t i = 0; i < 10; ++i) {
+        station_cycle();   // filters settle
+    }
+
+    // Before: the page reloaded itself every 5 s
+    const uint8_t reloads = 12;
+    long   pageBytes = 0;
+    double pageCpu   = 0;
+    for (uint8_t i = 0; i < reloads; ++i) {
+        double t0 = cpuUs();
+        std::string page = station_get("/");
+        pageCpu += cpuUs() - t0;
+        CHECK(page.compare(0, 15, "HTTP/1.1 200 OK") == 0);
+        pageBytes += (long)page.size();
+    }
+
+    // After: the measurement loop alone, then every slot subscribed
+    const uint8_t n = EVENTS_MAX_CLIENTS;
+    int  fds[n] = {};
+    long bytes[n];
+    double idleCpu = quietMinute(fds, 0, bytes);
+    for (uint8_t i = 0; i < n; ++i) {
+        CHECK(subscribe(&fds[i]));
+    }
+    CHECK_EQ(g_events.subscribers(), n);
+    std::string full = station_get("/events");
+    CHECK(full.compare(0, 12, "HTTP/1.1 503") == 0);
+
+    double liveCpu  = quietMinute(fds, n, bytes);
+    long   minBytes = bytes[0];
+    for (uint8_t i = 1; i < n; ++i) {
+        if (bytes[i] < minBytes) minBytes = bytes[i];
+    }
+    double perClient = liveCpu > idleCpu ? (liveCpu - idleCpu) / n : 0;
+    printf("  per client per minute   bytes    CPU us\n");
+    printf("  page reload every 5 s  %6ld  %8.0f\n", pageBytes, pageCpu);
+    printf("  /events, %u clients     %6ld  %8.0f  (loop() %.0f us/min, %.0f without clients)\n",
+           n, bytes[0], perClient, liveCpu, idleCpu);
+    CHECK(minBytes > 0);
+    CHECK(bytes[0] * 4 < pageBytes);
+    CHECK(perClient < pageCpu);
+    CHECK_EQ(g_events.evicted(), 0);
+    CHECK_EQ(g_events.closed(), 0);
+
+    // The browser goes away: closed, not evicted
+    close(fds[0]);
+    loop();
+    CHECK_EQ(g_events.subscribers(), n - 1);
+    CHECK_EQ(g_events.closed(), 1);
+    CHECK_EQ(g_events.evicted(), 0);
+
+    // A reader that stops taking data: evicted once its buffers are full,
+    // while the loop never waits on it and the others keep receiving
+    int slow;
+    CHECK(subscribe(&slow, 1));
+    double   worstUs = 0;
+    uint16_t cycles  = 0;
+    while (g_events.subscribers() == n && cycles < 2000) {
+        double t0 = wallUs();
+        station_cycle();
+        double d = wallUs() - t0;
+        if (d > worstUs) worstUs = d;
+        ++cycles;
+        for (uint8_t i = 1; i < n; ++i) {
+            station_drain(fds[i]);
+        }
+    }
+    printf("  slow reader evicted after %u cycles, worst loop() %.0f us\n", cycles, worstUs);
+    CHECK_EQ(g_events.subscribers(), n - 1);
+    CHECK_EQ(g_events.evicted(), 1);
+    CHECK_EQ(g_events.closed(), 1);
+    CHECK(worstUs < 200000);
+    station_cycle();
+    for (uint8_t i = 1; i < n; ++i) {
+        CHECK(station_drain(fds[i]) > 0);
+    }
+
+    // Both counters reach the JSON page
+    std::string json = station_get("/json");
+    CHECK(json.find("\"evicted\":1,\"closed\":1") != std::string::npos);
+
+    close(slow);
+    for (uint8_t i = 1; i < n; ++i) {
+        close(fds[i]);
+    }
+    return host_test_result("test_events");
+}
@@ -0,0 +1,134 @@
+// MTS4xHistory: lossless and quantised round trips (including both ends of
+// the int16 range), time range reads, spill of the oldest block, and the
+// compression ratio on a synthetic diurnal trace
+
+#include "MTS4xHistory.h"
+#include "host_test.h"
+#include <math.h>
+#include <stdlib.h>
+#include <vector>
+
+struct Sample {
+    uint32_t t;
+    int16_t  raw;
+};
+
+static bool collect(uint32_t t, int16_t raw, void *ctx) {
+    Sample s = { t, raw };
+    ((std::vector<Sample> *)ctx)->push_back(s);
+    return true;
+}
+
+static void testLossless() {
+    static uint8_t buf[4096];
+    MTS4xHistory h;
+    CHECK(h.begin(buf, sizeof(buf), 256));
+
+    std::vector<Sample> in;
+    uint32_t t   = 1000;
+    int32_t  raw = -1200;
+    srand(3);
+    for (uint16_t i = 0; i < 600; ++i) {
+        t   += 2 + (rand() % 7 == 0 ? rand() % 40 : 0);   // mostly steady
+        raw += rand() % 9 - 4;
+        if (i == 300) raw = 32767;                          // big jumps too
+        if (i == 301) raw = -32768;
+        if (i == 302) raw = 0;
+        Sample s = { t, (int16_t)raw };
+        in.push_back(s);
+        CHECK(h.append(s.t, s.raw));
+    }
+    CHECK(!h.append(t - 1, 0));   // backwards
+
+    std::vector<Sample> out;
+    CHECK_EQ(h.read(0, 0xFFFFFFFFUL, collect, &out), in.size());
+    CHECK_EQ(out.size(), in.size());
+    for (size_t i = 0; i < out.size() && i < in.size(); ++i) {
+        CHECK_EQ(out[i].t, in[i].t);
+        CHECK_EQ(out[i].raw, in[i].raw);
+    }
+
+    // A time window delivers exactly the samples inside it
+    out.clear();
+    size_t n = h.read(in[100].t, in[199].t, collect, &out);
+    CHECK_EQ(n, 100);
+    CHECK(!out.empty() && out.front().t == in[100].t && out.back().t == in[199].t);
+}
+
+// Quantised values come back within half a step and never wrap around
+static void testQuantisedEnds() {
+    static const int16_t ends[] = { 32767, 32766, 32760, 32700, -32768, -32767, -32760, 0 };
+    for (uint8_t shift = 1; shift <= 8; ++shift) {
+        static uint8_t buf[1024];
+        MTS4xHistory h;
+        CHECK(h.begin(buf, sizeof(buf), 256, shift));
+        for (uint8_t i = 0; i < sizeof(ends) / sizeof(ends[0]); ++i) {
+            CHECK(h.append(i, ends[i]));
+        }
+        std::vector<Sample> out;
+        h.read(0, 100, collect, &out);
+        CHECK_EQ(out.size(), sizeof(ends) / sizeof(ends[0]));
+        for (size_t i = 0; i < out.size(); ++i) {
+            int32_t err = (int32_t)out[i].raw - ends[i];
+            CHECK(err <= (1L << (shift - 1)) && -err <= (1L << (shift - 1)));
+            CHECK((out[i].raw < 0) == (ends[i] < 0));
+        }
+    }
+}
+
+static size_t s_spilled;
+
+static void spill(const uint8_t *block, size_t len, void *) {
+    std::vector<Sample> out;
+    s_spilled += MTS4xHistory::decodeBlock(block, len, 0, 0xFFFFFFFFUL, collect, &out);
+}
+
+static void testSpill() {
+    static uint8_t buf[1024];
+    MTS4xHistory h;
+    CHECK(h.begin(buf, sizeof(buf), 128));
+    h.onSpill(spill);
+    s_spilled = 0;
+    int32_t raw = 0;
+    for (uint32_t t = 0; t < 5000; ++t) {
+        raw += (int32_t)(t % 5) - 2;
+        CHECK(h.append(t, (int16_t)raw));
+    }
+    std::vector<Sample> out;
+    size_t inRam = h.read(0, 0xFFFFFFFFUL, collect, &out);
+    CHECK_EQ(s_spilled + inRam, 5000);
+    CHECK(h.blocks() == sizeof(buf) / 128);
+}
+
+// 24 h at 1 Hz: 8 °C day/night swing, slow weather drift, sensor noise
+static void testDiurnal() {
+    const uint32_t n = 86400;
+    std::vector<uint8_t> buf(512 * 1024);
+    static const uint8_t shifts[] = { 0, 2 };
+    for (uint8_t k = 0; k < 2; ++k) {
+        MTS4xHistory h;
+        CHECK(h.begin(&buf[0], buf.size(), 256, shifts[k]));
+        srand(11);
+        for (uint32_t t = 0; t < n; ++t) {
+            double c = 15.0 + 4.0 * sin(2 * M_PI * (t / 86400.0 - 0.3)) +
+                       0.7 * sin(2 * M_PI * t / 20000.0);
+            double noise = ((rand() % 1000) + (rand() % 1000) - 999) / 999.0 * 2.0;
+            int32_t raw = (int32_t)lround((c - 25.0) * 256.0 + noise);
+            CHECK(h.append(1700000000UL + t, (int16_t)raw));
+        }
+        CHECK_EQ(h.samples(), n);
+        double bytes = (double)h.bytesUsed();
+        printf("  diurnal 24 h @ 1 Hz, shift %u: %lu bytes, %.2f bits/sample, "
+               "%.1fx vs 6-byte records\n", shifts[k], (unsigned long)h.bytesUsed(),
+               bytes * 8 / n, n * 6.0 / bytes);
+        CHECK(bytes * 8 / n < 8.0);
+    }
+}
+
+int main() {
+    testLossless();
+    testQuantisedEnds();
+    testSpill();
+    testDiurnal();
+    return host_test_result("test_history");
+}
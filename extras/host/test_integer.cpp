@@ -0,0 +1,173 @@
+// Integer temperature path against the float one over the whole int16
+// range: m°C, Q8.8, limits in m°C and the integer formatter, plus the
+// driver's Milli reads and limit setters on the simulated chip. Built with
+// MTS4X_NO_FLOAT, so the library has to compile without any float API;
+// the float references are computed here.
+
+#include "MTS4x.h"
+#include "MTS4xSim.h"
+#include "host_test.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef MTS4X_NO_FLOAT
+#error "test_integer is built with -DMTS4X_NO_FLOAT"
+#endif
+
+// Half away from zero, as mts4x_raw_to_milli and lroundf
+static int64_t roundHalfAway(double v) {
+    return (int64_t)(v < 0 ? -floor(-v + 0.5) : floor(v + 0.5));
+}
+
+// The driver's float limit conversion (mts4x_c_to_raw)
+static int16_t floatCToRaw(float tC) {
+    float rawF = (tC - 25.0f) * 256.0f;
+    if (rawF > 32767.0f) rawF = 32767.0f;
+    if (rawF < -32768.0f) rawF = -32768.0f;
+    return (int16_t)lroundf(rawF);
+}
+
+// 25 + raw/256 exactly, as a decimal with d places (half away from zero):
+// (6400 + raw) * 390625 is the value in units of 1e-8 °C
+static void exactDecimal(char *buf, size_t size, int16_t raw, uint8_t d) {
+    int64_t  v   = (6400 + (int64_t)raw) * 390625;
+    bool     neg = v < 0;
+    uint64_t mag = (uint64_t)(neg ? -v : v);
+    uint64_t div = 1;
+    for (uint8_t i = d; i < 8; ++i) div *= 10;
+    mag = (mag + div / 2) / div;
+    uint64_t scale = 1;
+    for (uint8_t i = 0; i < d; ++i) scale *= 10;
+    if (d) {
+        snprintf(buf, size, "%s%llu.%0*llu", neg && mag ? "-" : "",
+                 (unsigned long long)(mag / scale), d, (unsigned long long)(mag % scale));
+    } else {
+        snprintf(buf, size, "%s%llu", neg && mag ? "-" : "", (unsigned long long)mag);
+    }
+}
+
+// m°C with d places, rounded from the m°C value the way the formatter does
+static void milliDecimal(char *buf, size_t size, int32_t mC, uint8_t d) {
+    int64_t div = d == 0 ? 1000 : d == 1 ? 100 : d == 2 ? 10 : 1;
+    int64_t mag = mC < 0 ? -(int64_t)mC : mC;
+    mag = (mag + div / 2) / div;
+    int64_t scale = 1000 / div;
+    if (d) {
+        snprintf(buf, size, "%s%lld.%0*lld", mC < 0 && mag ? "-" : "",
+                 (long long)(mag / scale), d, (long long)(mag % scale));
+    } else {
+        snprintf(buf, size, "%s%lld", mC < 0 && mag ? "-" : "", (long long)mag);
+    }
+}
+
+static void testConversions() {
+    uint32_t badMilli = 0, badQ = 0, badBack = 0, badFloatBack = 0;
+    uint32_t badFmt[4] = { 0, 0, 0, 0 };
+    uint32_t coarser   = 0;   // 1-2 places off the exact value by double rounding
+    for (int32_t r = -32768; r <= 32767; ++r) {
+        int16_t raw = (int16_t)r;
+        float   tC  = MTS4X_RAW_TO_CELSIUS(raw);   // exact: 16-bit raw, 24-bit mantissa
+
+        int32_t mC = mts4x_raw_to_milli(raw);
+        if (mC != roundHalfAway((double)tC * 1000.0)) ++badMilli;
+        if (mts4x_raw_to_q8_8(raw) != (int32_t)((double)tC * 256.0)) ++badQ;
+
+        // Back to raw: the integer and the float limit conversion agree
+        int16_t back = mts4x_milli_to_raw(mC);
+        if (mC >= -110000L && mC <= 160000L && back != raw) ++badBack;
+        if (back != floatCToRaw(mC / 1000.0f)) ++badFloatBack;
+
+        char got[24], want[24];
+        for (uint8_t d = 0; d <= 3; ++d) {
+            mts4x_format_milli(got, sizeof(got), mC, d);
+            milliDecimal(want, sizeof(want), mC, d);
+            if (strcmp(got, want)) ++badFmt[d];
+        }
+        mts4x_format_milli(got, sizeof(got), mC, 2);
+        exactDecimal(want, sizeof(want), raw, 2);
+        if (strcmp(got, want)) ++coarser;
+        mts4x_format_milli(got, sizeof(got), mC, 3);
+        exactDecimal(want, sizeof(want), raw, 3);
+        if (strcmp(got, want)) ++badFmt[3];
+    }
+    CHECK_EQ(badMilli, 0);
+    CHECK_EQ(badQ, 0);
+    CHECK_EQ(badBack, 0);
+    CHECK_EQ(badFloatBack, 0);
+    for (uint8_t d = 0; d <= 3; ++d) {
+        CHECK_EQ(badFmt[d], 0);
+    }
+    printf("  65536 raw codes: m°C, Q8.8, m°C->raw and 3-place text exact; "
+           "2-place text of the m°C value differs from the exact value in %lu\n",
+           (unsigned long)coarser);
+}
+
+// Every m°C a limit setter can take: the integer conversion and the float
+// one on the same value, and the exact rational (mC - 25000) * 256 / 1000
+static void testLimitConversion() {
+    uint32_t badExact = 0, badFloat = 0;
+    for (int32_t mC = -110000L; mC <= 160000L; ++mC) {
+        int16_t raw = mts4x_milli_to_raw(mC);
+        int64_t want = roundHalfAway((mC - 25000.0) * 256.0 / 1000.0);
+        if (want > 32767) want = 32767;
+        if (want < -32768) want = -32768;
+        if (raw != want) ++badExact;
+        if (raw != floatCToRaw(mC / 1000.0f)) ++badFloat;
+    }
+    CHECK_EQ(badExact, 0);
+    CHECK_EQ(badFloat, 0);
+
+    // Out of range saturates instead of wrapping
+    CHECK_EQ(mts4x_milli_to_raw(1000000L), 32767);
+    CHECK_EQ(mts4x_milli_to_raw(-1000000L), -32768);
+    CHECK_EQ(mts4x_milli_to_raw(INT32_MAX), 32767);
+    CHECK_EQ(mts4x_milli_to_raw(INT32_MIN), -32768);
+
+    // Formatter edge cases
+    char buf[16];
+    CHECK_EQ(mts4x_format_milli(buf, sizeof(buf), INT32_MIN, 3), strlen("-2147483.648"));
+    CHECK(!strcmp(buf, "-2147483.648"));
+    mts4x_format_milli(buf, sizeof(buf), -4, 2);
+    CHECK(!strcmp(buf, "0.00"));
+    CHECK_EQ(mts4x_format_milli(buf, 5, -12345, 3), 0);   // does not fit
+    CHECK(!strcmp(buf, ""));
+}
+
+// The same through the driver: Milli reads of every raw the chip can
+// return, and limits written in m°C read back from the registers
+static void testDriver() {
+    MTS4xSimDevice sim;
+    MTS4X          mts(sim);
+    CHECK(mts.begin(0, 0));
+    CHECK(mts.setConfig(MPS_1Hz, AVG_1, true));
+
+    uint32_t bad = 0;
+    for (int32_t r = -32768; r <= 32767; r += 7) {
+        sim.setTemperatureRaw(r);
+        int32_t mC = 0;
+        if (!mts.singleShotMilli(mC) ||
+            mC != roundHalfAway((double)MTS4X_RAW_TO_CELSIUS((int16_t)r) * 1000.0)) {
+            ++bad;
+        }
+    }
+    CHECK_EQ(bad, 0);
+
+    static const int32_t limits[] = { -40000L, -1L, 0L, 24999L, 25000L, 85000L, 125500L };
+    for (uint8_t i = 0; i < sizeof(limits) / sizeof(limits[0]); ++i) {
+        int32_t hi = 0, lo = 0;
+        CHECK(mts.setHighLimitMilli(limits[i]));
+        CHECK(mts.setLowLimitMilli(limits[i] - 10000L));
+        CHECK(mts.getHighLimitMilli(hi));
+        CHECK(mts.getLowLimitMilli(lo));
+        CHECK_EQ(hi, mts4x_raw_to_milli(floatCToRaw(limits[i] / 1000.0f)));
+        CHECK_EQ(lo, mts4x_raw_to_milli(floatCToRaw((limits[i] - 10000L) / 1000.0f)));
+    }
+}
+
+int main() {
+    testConversions();
+    testLimitConversion();
+    testDriver();
+    return host_test_result("test_integer");
+}
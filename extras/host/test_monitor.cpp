@@ -0,0 +1,114 @@
+// MTS4XChangeMonitor driven by the ALERT pin only (no status polling): the
+// pin is modelled as one notifyAlert() per rising edge of the chip's alert
+// bits. A failed read or a failed window write must not lose the event:
+// in alarm mode the pin stays asserted, so no second edge ever comes.
+
+#include "MTS4x.h"
+#include "MTS4xChangeMonitor.h"
+#include "MTS4xSim.h"
+#include "host_test.h"
+
+// Fails the next failWrites register writes, reads go through
+class FlakyWriteSim : public MTS4xSimDevice {
+  public:
+    FlakyWriteSim() : failWrites(0) {}
+
+    bool writeRegs(uint8_t addr, uint8_t reg, const uint8_t *data, size_t len) override {
+        if (failWrites) {
+            --failWrites;
+            return false;
+        }
+        return MTS4xSimDevice::writeRegs(addr, reg, data, len);
+    }
+
+    uint32_t failWrites;
+};
+
+// ALERT pin: one edge when the alert bits go from clear to set
+struct AlertPin {
+    bool level;
+
+    AlertPin() : level(false) {}
+
+    void sample(FlakyWriteSim &sim, MTS4XChangeMonitor &mon) {
+        bool now = (sim.peek(MTS4X_STATUS) & (MTS4X_STATUS_ALERT_HIGH | MTS4X_STATUS_ALERT_LOW)) != 0;
+        if (now && !level) {
+            mon.notifyAlert();
+        }
+        level = now;
+    }
+};
+
+// Up to 2 s of 10 ms loop passes; true when poll() reported a change
+static bool runUntilEvent(FlakyWriteSim &sim, MTS4XChangeMonitor &mon, AlertPin &pin,
+                          int16_t &raw) {
+    for (uint16_t i = 0; i < 200; ++i) {
+        sim.advanceUs(10000);
+        pin.sample(sim, mon);
+        if (mon.poll(raw)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void testFailureKeepsEvent(bool failRead) {
+    FlakyWriteSim sim;
+    MTS4X         mts(sim);
+    sim.setTemperatureMilli(20000);
+    CHECK(mts.begin(0, 0));
+
+    MTS4XChangeMonitor mon(mts);
+    CHECK(mon.beginMilli(500, MPS_4Hz, AVG_1));
+    mon.useStatusPolling(false);
+    AlertPin pin;
+
+    // Stable: nothing on the bus
+    int16_t raw = 0;
+    sim.resetCounters();
+    CHECK(!runUntilEvent(sim, mon, pin, raw));
+    CHECK_EQ(sim.transactions(), 0);
+
+    // A step out of the window; the first attempt fails on the read or
+    // on the window write, the pin gives no second edge
+    sim.setTemperatureMilli(21000);
+    if (failRead) {
+        sim.injectNak(1);
+    } else {
+        sim.failWrites = 1;
+    }
+    bool tripped = false;
+    for (uint16_t i = 0; i < 100 && !tripped; ++i) {
+        sim.advanceUs(10000);
+        pin.sample(sim, mon);
+        tripped = mon.poll(raw);
+        if (!tripped && (failRead ? sim.transactions() : sim.failWrites == 0)) {
+            break;   // the failed attempt happened
+        }
+    }
+    CHECK(!tripped);
+    CHECK(pin.level);
+
+    // Retried by the next poll without a new edge
+    CHECK(runUntilEvent(sim, mon, pin, raw));
+    CHECK_EQ(mts4x_raw_to_milli(raw), 21000);
+    CHECK_EQ(mon.events(), 1);
+    int16_t th = (int16_t)((sim.peek(MTS4X_TH_MSB) << 8) | sim.peek(MTS4X_TH_LSB));
+    CHECK_EQ(th, raw + 128);
+    CHECK_EQ(mon.lastRaw(), raw);
+
+    // The re-centred window releases the pin, the next step trips again
+    sim.advanceUs(300000);
+    pin.sample(sim, mon);
+    CHECK(!pin.level);
+    sim.setTemperatureMilli(19500);
+    CHECK(runUntilEvent(sim, mon, pin, raw));
+    CHECK_EQ(mts4x_raw_to_milli(raw), 19500);
+    CHECK_EQ(mon.events(), 2);
+}
+
+int main() {
+    testFailureKeepsEvent(true);
+    testFailureKeepsEvent(false);
+    return host_test_result("test_monitor");
+}
@@ -0,0 +1,510 @@
+// NarodMonUploader over the shim's real sockets against a local TCP stand-in
+// for narodmon.ru: how long loop() is held per step against the old
+// blocking sendToNarodMon() for every way the server can answer, the
+// result each one reports, and delivery - batches in order, nothing lost
+// or sent twice across failures, the queue across a reboot, overflow and
+// readings without a clock
+
+#include "MTS4x.h"
+#include "host_test.h"
+#include <arpa/inet.h>
+#include <atomic>
+#include <mutex>
+#include <netinet/in.h>
+#include <poll.h>
+#include <pthread.h>
+#include <string>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+#include <vector>
+
+// The uploader takes WiFi from ESP8266WiFi.h like the sketch (station.h)
+#define ESP8266 1
+#include <LittleFS.h>
+#include "../../examples/MTS4x_MeteoStation/NarodMonUploader.h"
+
+typedef NarodMonUploader<WiFiClient> Uploader;
+
+#define DEVICE_ID    "AA-BB-CC-DD-EE-FF"
+#define QUEUE_FILE   "/nm_test.bin"
+#define RETRY_MIN_MS 1000UL
+#define RETRY_MAX_MS 4000UL
+#define T0           1760680800UL   // unixtime of the first reading
+
+static uint64_t wallUs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+static void sleepMs(uint32_t ms) {
+    struct timespec ts = { (time_t)(ms / 1000), (long)(ms % 1000) * 1000000L };
+    nanosleep(&ts, 0);
+}
+
+// -----------------------------------------------------------------------------
+// Stand-in server
+// -----------------------------------------------------------------------------
+
+enum Reply {
+    REPLY_OK,       // "OK" after delayMs
+    REPLY_ERROR,    // "#Error: ..." right away
+    REPLY_CLOSE,    // closes without a word
+    REPLY_SILENT    // keeps the connection open, never answers
+};
+
+// One connection at a time on a free loopback port: reads the request up
+// to "##\n" (or the client closing), keeps it, answers as told
+class StandIn {
+  public:
+    StandIn() : reply(REPLY_OK), delayMs(0), _stop(false) {
+        _fd = socket(AF_INET, SOCK_STREAM, 0);
+        int on = 1;
+        setsockopt(_fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+        struct sockaddr_in sa;
+        memset(&sa, 0, sizeof(sa));
+        sa.sin_family      = AF_INET;
+        sa.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t len      = sizeof(sa);
+        CHECK(bind(_fd, (struct sockaddr *)&sa, sizeof(sa)) == 0);
+        CHECK(listen(_fd, 4) == 0);
+        getsockname(_fd, (struct sockaddr *)&sa, &len);
+        _port = ntohs(sa.sin_port);
+        CHECK(pthread_create(&_thread, 0, run, this) == 0);
+    }
+    ~StandIn() {
+        _stop = true;
+        pthread_join(_thread, 0);
+        close(_fd);
+    }
+
+    uint16_t port() const { return _port; }
+
+    std::vector<std::string> requests() {
+        std::lock_guard<std::mutex> l(_lock);
+        return _requests;
+    }
+    void clear() {
+        std::lock_guard<std::mutex> l(_lock);
+        _requests.clear();
+    }
+
+    std::atomic<int>      reply;
+    std::atomic<uint32_t> delayMs;
+
+  private:
+    int                      _fd;
+    uint16_t                 _port;
+    pthread_t                _thread;
+    std::atomic<bool>        _stop;
+    std::mutex               _lock;
+    std::vector<std::string> _requests;
+
+    static bool readable(int fd, int ms) {
+        struct pollfd p = { fd, POLLIN, 0 };
+        return poll(&p, 1, ms) == 1;
+    }
+
+    static void *run(void *arg) {
+        static_cast<StandIn *>(arg)->serve();
+        return 0;
+    }
+
+    void serve() {
+        while (!_stop) {
+            if (!readable(_fd, 20)) continue;
+            int c = accept(_fd, 0, 0);
+            if (c < 0) continue;
+
+            std::string req;
+            char        buf[512];
+            while (req.find("##\n") == std::string::npos && !_stop) {
+                if (!readable(c, 20)) continue;
+                ssize_t n = recv(c, buf, sizeof(buf), 0);
+                if (n <= 0) break;
+                req.append(buf, (size_t)n);
+            }
+            {
+                std::lock_guard<std::mutex> l(_lock);
+                _requests.push_back(req);
+            }
+
+            const char *answer = 0;
+            switch (reply) {
+                case REPLY_OK:
+                    sleepMs(delayMs);
+                    answer = "OK\n";
+                    break;
+                case REPLY_ERROR:
+                    answer = "#Error: unknown device\n";
+                    break;
+                case REPLY_SILENT:
+                    // Until the client gives up and closes
+                    while (!_stop) {
+                        if (readable(c, 20) && recv(c, buf, sizeof(buf), 0) <= 0) break;
+                    }
+                    break;
+                default:
+                    break;
+            }
+            if (answer) send(c, answer, strlen(answer), MSG_NOSIGNAL);
+            close(c);
+        }
+    }
+};
+
+// A loopback port nobody listens on: connect() is refused
+static uint16_t closedPort() {
+    int                fd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sin_family      = AF_INET;
+    sa.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t len      = sizeof(sa);
+    bind(fd, (struct sockaddr *)&sa, sizeof(sa));
+    getsockname(fd, (struct sockaddr *)&sa, &len);
+    close(fd);
+    return ntohs(sa.sin_port);
+}
+
+// -----------------------------------------------------------------------------
+// Helpers
+// -----------------------------------------------------------------------------
+
+// sendToNarodMon() before the uploader, on the same socket shim: connect,
+// print, spin up to 2 s for any reply. A timeout counted as sent.
+static bool oldSend(uint16_t port, float avgTempC) {
+    WiFiClient client;
+    client.setTimeout(5000);
+    if (!client.connect(IPAddress(127, 0, 0, 1), port)) {
+        return false;
+    }
+    char payload[64];
+    snprintf(payload, sizeof(payload), "#%s\n#T1#%.2f\n##\n", DEVICE_ID, avgTempC);
+    client.write((const uint8_t *)payload, strlen(payload));
+    unsigned long timeout = millis();
+    while (client.available() == 0) {
+        if (millis() - timeout > 2000) {
+            client.stop();
+            return true;
+        }
+    }
+    client.stop();
+    return true;
+}
+
+struct Attempt {
+    NarodMonResult result;
+    uint32_t       steps;
+    uint32_t       worstStepUs;
+};
+
+// loop() once a millisecond like the sketch's loop() until the attempt
+// ends; skipMs moves millis() on between calls, so a reply timeout passes
+// without waiting for it
+static Attempt attempt(Uploader &nm, uint32_t skipMs = 0) {
+    Attempt a = { NM_RESULT_NONE, 0, 0 };
+    for (;;) {
+        uint64_t t    = wallUs();
+        bool     done = nm.loop(millis());
+        uint32_t d    = (uint32_t)(wallUs() - t);
+        if (d > a.worstStepUs) a.worstStepUs = d;
+        ++a.steps;
+        if (done) break;
+        if (a.steps > 20000) {   // never started or never ended
+            CHECK(false);
+            break;
+        }
+        host_advance_ms(skipMs);
+        sleepMs(1);
+    }
+    a.result = nm.lastResult();
+    return a;
+}
+
+// Past any retry pause
+static void due() {
+    host_advance_ms(RETRY_MAX_MS + 1);
+}
+
+static int32_t readingMilli(uint32_t i) {
+    return 21000L + 10L * (int32_t)i;
+}
+
+static void enqueueReadings(Uploader &nm, uint32_t from, uint32_t count) {
+    for (uint32_t i = from; i < from + count; ++i) {
+        nm.enqueue(T0 + 300UL * i, readingMilli(i));
+    }
+}
+
+// The request a batch of readings first..first+count-1 has to produce
+static std::string expected(uint32_t first, uint32_t count) {
+    std::string s = "#" DEVICE_ID "\n";
+    for (uint32_t i = first; i < first + count; ++i) {
+        char val[16], line[48];
+        mts4x_format_milli(val, sizeof(val), readingMilli(i), 2);
+        snprintf(line, sizeof(line), "#T1#%s#%lu\n", val, (unsigned long)(T0 + 300UL * i));
+        s += line;
+    }
+    return s + "##\n";
+}
+
+static uint32_t s_worstStepUs = 0;   // over every attempt of the test
+
+static void track(const Attempt &a) {
+    if (a.worstStepUs > s_worstStepUs) s_worstStepUs = a.worstStepUs;
+}
+
+// -----------------------------------------------------------------------------
+// Tests
+// -----------------------------------------------------------------------------
+
+// Every way the server can answer: how long loop() is held and what is
+// reported, old blocking send against the uploader
+static void testOutcomes(StandIn &srv) {
+    struct Case {
+        const char    *name;
+        int            reply;
+        uint32_t       delayMs;
+        bool           refused;
+        NarodMonResult want;
+    };
+    static const Case cases[] = {
+        { "ok",            REPLY_OK,     0,   false, NM_RESULT_OK },
+        { "ok in 300 ms",  REPLY_OK,     300, false, NM_RESULT_OK },
+        { "#Error",        REPLY_ERROR,  0,   false, NM_RESULT_REJECTED },
+        { "closes",        REPLY_CLOSE,  0,   false, NM_RESULT_CLOSED },
+        { "silent",        REPLY_SILENT, 0,   false, NM_RESULT_TIMEOUT },
+        { "refused",       REPLY_OK,     0,   true,  NM_RESULT_CONNECT },
+    };
+
+    printf("  server         old: sent  blocks ms | new: result   worst step us  attempt ms\n");
+    for (uint8_t i = 0; i < sizeof(cases) / sizeof(cases[0]); ++i) {
+        const Case &c    = cases[i];
+        uint16_t    port = c.refused ? closedPort() : srv.port();
+        srv.reply        = c.reply;
+        srv.delayMs      = c.delayMs;
+
+        uint64_t t   = wallUs();
+        bool     old = oldSend(port, 21.5f);
+        uint32_t oldMs = (uint32_t)((wallUs() - t) / 1000);
+
+        Uploader nm;
+        nm.begin("127.0.0.1", port, DEVICE_ID, NULL, NULL, RETRY_MIN_MS, RETRY_MAX_MS);
+        nm.enqueue(T0, 21500);
+        Attempt a = attempt(nm, c.reply == REPLY_SILENT ? 50 : 0);
+        track(a);
+        printf("  %-13s  %9s  %9lu | %-9s  %13lu  %10lu\n", c.name, old ? "yes" : "no",
+               (unsigned long)oldMs, Uploader::resultName(a.result),
+               (unsigned long)a.worstStepUs, (unsigned long)nm.lastLatencyMs());
+
+        CHECK_EQ(a.result, c.want);
+        CHECK_EQ(nm.pending(), c.want == NM_RESULT_OK ? 0 : 1);
+        CHECK_EQ(nm.sentOk() + nm.sentFail(), 1);
+        // The reply text is kept only when it is the reason for a failure
+        CHECK(!strcmp(nm.lastReply(),
+                      c.want == NM_RESULT_REJECTED ? "#Error: unknown device" : ""));
+        if (c.want == NM_RESULT_OK) {
+            CHECK(nm.lastLatencyMs() >= c.delayMs);
+            CHECK(nm.lastLatencyMs() < c.delayMs + 200);
+        }
+        if (c.want == NM_RESULT_TIMEOUT) {
+            CHECK(nm.lastLatencyMs() >= NARODMON_REPLY_TIMEOUT_MS);
+        }
+        // The old send held loop() for the whole exchange and called
+        // everything but a refused connection a success
+        CHECK_EQ(old, !c.refused);
+        if (c.delayMs) CHECK(oldMs >= c.delayMs);
+        if (c.reply == REPLY_SILENT || c.reply == REPLY_CLOSE) CHECK(oldMs >= 2000);
+    }
+}
+
+// 20 readings through failures of every kind: nothing leaves the queue
+// before "OK", then two connections carry 12 + 8 in order, each once
+static void testDelivery(StandIn &srv) {
+    Uploader nm;
+    nm.begin("127.0.0.1", srv.port(), DEVICE_ID, NULL, NULL, RETRY_MIN_MS, RETRY_MAX_MS);
+    enqueueReadings(nm, 0, 20);
+    CHECK_EQ(nm.pending(), 20);
+
+    static const int fails[] = { REPLY_ERROR, REPLY_CLOSE, REPLY_SILENT };
+    for (uint8_t i = 0; i < sizeof(fails) / sizeof(fails[0]); ++i) {
+        srv.reply = fails[i];
+        due();
+        track(attempt(nm, fails[i] == REPLY_SILENT ? 50 : 0));
+        CHECK(!nm.lastOk());
+        CHECK_EQ(nm.pending(), 20);
+    }
+    CHECK_EQ(nm.sentFail(), 3);
+
+    // Each failure retried after a pause twice as long as the one before
+    // (the last one capped at RETRY_MAX_MS): not a step sooner
+    host_advance_ms(RETRY_MAX_MS - 200);
+    CHECK(!nm.loop(millis()));
+    CHECK(!nm.busy());
+
+    srv.clear();
+    srv.reply   = REPLY_OK;
+    srv.delayMs = 0;
+    host_advance_ms(201);
+    track(attempt(nm));
+    CHECK(nm.lastOk());
+    CHECK_EQ(nm.lastBatch(), NARODMON_BATCH);
+    CHECK_EQ(nm.pending(), 20 - NARODMON_BATCH);
+
+    // The rest waits RETRY_MIN_MS, then goes in the next connection
+    CHECK(!nm.loop(millis()));
+    CHECK(!nm.busy());
+    host_advance_ms(RETRY_MIN_MS);
+    track(attempt(nm));
+    CHECK(nm.lastOk());
+    CHECK_EQ(nm.pending(), 0);
+    CHECK_EQ(nm.sentOk(), 2);
+    CHECK_EQ(nm.dropped(), 0);
+
+    std::vector<std::string> got = srv.requests();
+    CHECK_EQ(got.size(), 2);
+    if (got.size() == 2) {
+        CHECK(got[0] == expected(0, NARODMON_BATCH));
+        CHECK(got[1] == expected(NARODMON_BATCH, 20 - NARODMON_BATCH));
+    }
+
+    // Nothing queued: loop() does not connect
+    host_advance_ms(RETRY_MAX_MS);
+    CHECK(!nm.loop(millis()));
+    CHECK(!nm.busy());
+    CHECK_EQ(srv.requests().size(), 2);
+}
+
+// Retry pauses: RETRY_MIN_MS, doubling up to RETRY_MAX_MS, back to
+// RETRY_MIN_MS after a delivery
+static void testBackoff(StandIn &srv) {
+    Uploader nm;
+    nm.begin("127.0.0.1", closedPort(), DEVICE_ID, NULL, NULL, RETRY_MIN_MS, RETRY_MAX_MS);
+    enqueueReadings(nm, 0, 1);
+    track(attempt(nm));
+    CHECK_EQ(nm.lastResult(), NM_RESULT_CONNECT);
+
+    static const uint32_t pauses[] = { 1000, 2000, 4000, 4000 };
+    for (uint8_t i = 0; i < sizeof(pauses) / sizeof(pauses[0]); ++i) {
+        host_advance_ms(pauses[i] - 100);
+        CHECK(!nm.loop(millis()));
+        CHECK(!nm.busy());
+        host_advance_ms(100);
+        track(attempt(nm));
+        CHECK_EQ(nm.lastResult(), NM_RESULT_CONNECT);
+    }
+    CHECK_EQ(nm.sentFail(), 5);
+    CHECK_EQ(nm.pending(), 1);
+
+    // A delivery brings the pause back to RETRY_MIN_MS, for the next
+    // reading and for the next failure
+    Uploader up;
+    up.begin("127.0.0.1", srv.port(), DEVICE_ID, NULL, NULL, RETRY_MIN_MS, RETRY_MAX_MS);
+    enqueueReadings(up, 0, 1);
+    srv.reply = REPLY_CLOSE;
+    track(attempt(up));
+    host_advance_ms(RETRY_MIN_MS);
+    track(attempt(up));
+    CHECK_EQ(up.sentFail(), 2);
+    srv.reply   = REPLY_OK;
+    srv.delayMs = 0;
+    host_advance_ms(2 * RETRY_MIN_MS);
+    track(attempt(up));
+    CHECK(up.lastOk());
+
+    static const int next[] = { REPLY_CLOSE, REPLY_OK };
+    for (uint8_t i = 0; i < sizeof(next) / sizeof(next[0]); ++i) {
+        enqueueReadings(up, 1 + i, 1);
+        srv.reply = next[i];
+        host_advance_ms(RETRY_MIN_MS - 100);
+        CHECK(!up.loop(millis()));
+        CHECK(!up.busy());
+        host_advance_ms(100);
+        track(attempt(up));
+    }
+    CHECK(up.lastOk());
+    CHECK_EQ(up.sentOk(), 2);
+    CHECK_EQ(up.sentFail(), 3);
+}
+
+// The queue file outlives the uploader; readings without a clock do not
+static void testReboot(StandIn &srv) {
+    CHECK(LittleFS.begin());
+    LittleFS.remove(QUEUE_FILE);
+    {
+        Uploader nm;
+        nm.begin("127.0.0.1", closedPort(), DEVICE_ID, &LittleFS, QUEUE_FILE,
+                 RETRY_MIN_MS, RETRY_MAX_MS);
+        enqueueReadings(nm, 0, 5);
+        track(attempt(nm));
+        CHECK_EQ(nm.lastResult(), NM_RESULT_CONNECT);
+        nm.enqueue(0, 19000);   // clock lost: kept until the reboot only
+        CHECK_EQ(nm.pending(), 6);
+    }
+
+    srv.clear();
+    srv.reply   = REPLY_OK;
+    srv.delayMs = 0;
+    Uploader nm;
+    nm.begin("127.0.0.1", srv.port(), DEVICE_ID, &LittleFS, QUEUE_FILE,
+             RETRY_MIN_MS, RETRY_MAX_MS);
+    CHECK_EQ(nm.pending(), 5);
+    track(attempt(nm));
+    CHECK(nm.lastOk());
+    CHECK_EQ(nm.pending(), 0);
+    std::vector<std::string> got = srv.requests();
+    CHECK_EQ(got.size(), 1);
+    if (got.size() == 1) CHECK(got[0] == expected(0, 5));
+
+    // Delivered entries are gone from the file too
+    Uploader again;
+    again.begin("127.0.0.1", srv.port(), DEVICE_ID, &LittleFS, QUEUE_FILE);
+    CHECK_EQ(again.pending(), 0);
+    LittleFS.remove(QUEUE_FILE);
+}
+
+// A full queue drops the oldest; without a clock only the latest reading
+// is kept and it goes without a timestamp
+static void testOverflowAndNoClock(StandIn &srv) {
+    srv.clear();
+    srv.reply = REPLY_OK;
+    Uploader nm;
+    nm.begin("127.0.0.1", srv.port(), DEVICE_ID, NULL, NULL, RETRY_MIN_MS, RETRY_MAX_MS);
+    enqueueReadings(nm, 0, NARODMON_QUEUE_LEN + 3);
+    CHECK_EQ(nm.pending(), NARODMON_QUEUE_LEN);
+    CHECK_EQ(nm.dropped(), 3);
+    track(attempt(nm));
+    CHECK(nm.lastOk());
+    std::vector<std::string> got = srv.requests();
+    CHECK_EQ(got.size(), 1);
+    if (got.size() == 1) CHECK(got[0] == expected(3, NARODMON_BATCH));
+
+    srv.clear();
+    Uploader nc;
+    nc.begin("127.0.0.1", srv.port(), DEVICE_ID, NULL, NULL, RETRY_MIN_MS, RETRY_MAX_MS);
+    nc.enqueue(0, 20000);
+    nc.enqueue(0, 20125);
+    CHECK_EQ(nc.pending(), 1);
+    track(attempt(nc));
+    CHECK(nc.lastOk());
+    got = srv.requests();
+    CHECK_EQ(got.size(), 1);
+    if (got.size() == 1) CHECK(got[0] == "#" DEVICE_ID "\n#T1#20.13\n##\n");
+}
+
+int main() {
+    StandIn srv;
+    testOutcomes(srv);
+    testDelivery(srv);
+    testBackoff(srv);
+    testReboot(srv);
+    testOverflowAndNoClock(srv);
+
+    // One step of the uploader stays far below the old send's blocking,
+    // whatever the server does
+    printf("  longest loop() step over all attempts: %lu us\n", (unsigned long)s_worstStepUs);
+    CHECK(s_worstStepUs < 20000);
+    return host_test_result("test_narodmon");
+}
@@ -0,0 +1,34 @@
+// Build without bus fault recovery (MTS4X_BUS_RECOVERY=0, the AVR
+// default): the library compiles without MTS4xWireBus::recover(), and a
+// failed transaction fails at once with no bus clear or replay, whatever
+// the deadline says
+
+#include "MTS4x.h"
+#include "MTS4xSim.h"
+#include "host_test.h"
+
+#if MTS4X_BUS_RECOVERY
+#error "test_norecovery is built with -DMTS4X_BUS_RECOVERY=0"
+#endif
+
+int main() {
+    MTS4xSimDevice sim;
+    MTS4X          mts(sim);
+    CHECK(mts.begin(0, 0));
+    mts.setRecoveryDeadline(100000UL);
+    sim.setTemperatureMilli(19000);
+
+    sim.resetCounters();
+    sim.injectNak(3);
+    int32_t mC = 0;
+    CHECK(!mts.readTemperatureMilli(mC));
+    CHECK_EQ(mts.lastError(), MTS4X_ERR_WIRE);
+    CHECK_EQ(sim.transactions(), 1);
+    CHECK_EQ(sim.busClears(), 0);
+
+    sim.injectNak(0);
+    CHECK(mts.singleShotMilli(mC));
+    CHECK_EQ(mC, 19000);
+    CHECK_EQ(mts.transactionCount(), sim.transactions());
+    return host_test_result("test_norecovery");
+}
@@ -0,0 +1,83 @@
+// MTS4XOversampler against a noisy simulated chip: the noise estimate
+// converges, the plan meets the target within the budget, and the spread
+// of the reading means matches the standard error the plan promised.
+// Also the shared rounded square root it relies on.
+
+#include "MTS4xOversampler.h"
+#include "MTS4xSim.h"
+#include "host_test.h"
+#include <math.h>
+
+static void testIsqrt() {
+    for (uint64_t x = 0; x < 2000000; ++x) {
+        uint32_t r = mts4x_isqrt64(x);
+        // Nearest integer: (r - 1/2)^2 <= x < (r + 1/2)^2
+        uint64_t lo = r ? (uint64_t)r * r - r + 1 : 0;
+        if (x < lo || x >= (uint64_t)r * r + r + 1) {
+            CHECK(false);
+            printf("  isqrt(%llu) = %lu\n", (unsigned long long)x, (unsigned long)r);
+            break;
+        }
+    }
+    CHECK_EQ(mts4x_isqrt64(0xFFFFFFFFFFFFFFFFULL), 0xFFFFFFFFUL);   // would round to 2^32: saturates
+    CHECK_EQ(mts4x_isqrt64(0xFFFFFFFE00000001ULL), 0xFFFFFFFFUL);   // exact square
+}
+
+// sigma of one AVG_1 conversion in m°C, quantisation included
+static double trueNoiseMilli(uint16_t sigmaRaw) {
+    return sqrt(sigmaRaw * sigmaRaw + 1.0 / 12) * 1000.0 / 256.0;
+}
+
+static void testPlan(uint16_t sigmaRaw, uint16_t targetMilli, uint32_t budgetUs) {
+    MTS4xSimDevice   sim;
+    MTS4X            mts(sim);
+    MTS4XOversampler os(mts);
+    sim.setSeed(1234 + sigmaRaw);
+    sim.setNoise(sigmaRaw);
+    sim.setTemperatureMilli(20000);
+    CHECK(mts.begin(0, 0));
+    CHECK(os.begin(targetMilli, budgetUs));
+
+    MTS4xMoments m;
+    for (uint8_t i = 0; i < 40; ++i) {
+        CHECK(os.read(m));
+    }
+    double noise = trueNoiseMilli(sigmaRaw);
+    CHECK(os.hasEstimate());
+    CHECK(fabs(os.noiseMilli() - noise) <= 0.3 * noise + 1);
+
+    const MTS4xOversamplePlan &p = os.plan();
+    CHECK(p.costUs <= budgetUs);
+
+    // Spread of the reading means vs the promised standard error
+    const uint16_t runs = 300;
+    double sum = 0, sumSq = 0;
+    for (uint16_t i = 0; i < runs; ++i) {
+        CHECK(os.read(m));
+        double v = m.meanMilli();
+        sum   += v;
+        sumSq += v * v;
+    }
+    double mean = sum / runs;
+    double se   = sqrt((sumSq - sum * mean) / (runs - 1));
+    printf("  noise %5.1f m°C, target %2u m°C: AVG_%-2u x %2u, %6lu us, "
+           "promised %3lu m°C, measured %5.1f m°C%s\n",
+           noise, targetMilli, 1U << (p.avg ? (p.avg >> 3) + 2 : 0), p.samples,
+           (unsigned long)p.costUs, (unsigned long)p.seMilli, se,
+           p.targetMet ? "" : " (best effort)");
+    CHECK(fabs(mean - 20000) < 3 * se + 4);
+    CHECK(se <= 1.4 * p.seMilli + 2);
+    CHECK(se >= 0.6 * p.seMilli - 2);
+    if (p.targetMet) {
+        CHECK(se <= 1.4 * targetMilli + 2);
+    }
+}
+
+int main() {
+    testIsqrt();
+    testPlan(2, 10, 200000);
+    testPlan(8, 10, 200000);
+    testPlan(24, 10, 200000);
+    testPlan(24, 5, 50000);      // budget too small: best effort
+    return host_test_result("test_oversampler");
+}
@@ -0,0 +1,122 @@
+// Non-blocking conversion (startConversion/poll/result) in a main loop on
+// the virtual clock: no bus traffic before the expected conversion time,
+// at most one transaction per poll(), loop latency bounded by one
+// transaction for every AVG setting where the blocking call holds the
+// loop for the whole conversion, and CRC retries spread over polls
+
+#include "MTS4x.h"
+#include "MTS4xSim.h"
+#include "host_test.h"
+
+#define WORK_US 200   // everything else the loop does per pass
+
+// Longest possible poll(): one 4-byte read at the given clock, with
+// address, register and repeated start
+static uint32_t oneReadUs(uint32_t hz) {
+    return (uint32_t)(8 * 9 * 1000000ULL / hz) + 50;
+}
+
+static void testLatency(TempCfgAVG avg, uint32_t hz) {
+    MTS4xSimDevice sim;
+    MTS4X          mts(sim);
+    sim.setTemperatureMilli(23000);
+    CHECK(mts.begin(0, 0));
+    mts.setBusClock(hz);
+    CHECK(mts.setConfig(MPS_1Hz, avg, true));
+
+    // Blocking: the loop waits for the whole conversion
+    uint64_t t0 = sim.nowUs();
+    int32_t  mC = 0;
+    CHECK(mts.singleShotMilli(mC));
+    uint32_t blockingUs = (uint32_t)(sim.nowUs() - t0);
+
+    // Polled: the loop keeps running while the chip converts
+    sim.resetCounters();
+    CHECK(mts.startConversion());
+    uint64_t start    = sim.nowUs();
+    uint64_t firstBus = 0;
+    uint32_t worstUs  = 0;
+    uint32_t passes   = 0;
+    MTS4xPollResult r;
+    do {
+        sim.advanceUs(WORK_US);
+        uint32_t tx = sim.transactions();
+        uint64_t t  = sim.nowUs();
+        r = mts.poll();
+        uint32_t d = (uint32_t)(sim.nowUs() - t);
+        if (d > worstUs) worstUs = d;
+        CHECK(sim.transactions() - tx <= 1);
+        if (!firstBus && sim.transactions() > 1) firstBus = t;
+        ++passes;
+    } while (r == MTS4X_POLL_PENDING && passes < 1000);
+    CHECK(r == MTS4X_POLL_READY);
+    int16_t raw   = 0;
+    bool    crcOk = false;
+    CHECK(mts.result(raw, crcOk));
+    CHECK(crcOk);
+    CHECK_EQ(mts4x_raw_to_milli(raw), 23000);
+
+    // Nothing but the trigger write until the chip can be done
+    CHECK(firstBus - start >= mts4x_avg_time_us(avg));
+    CHECK(worstUs <= oneReadUs(hz));
+    CHECK(blockingUs >= mts4x_avg_time_us(avg));
+    printf("  AVG_%-2u %3lu kHz: blocking %6lu us, poll() worst %4lu us over %3lu passes, "
+           "%lu transactions\n", 1U << (avg ? (avg >> 3) + 2 : 0), (unsigned long)(hz / 1000),
+           (unsigned long)blockingUs, (unsigned long)worstUs, (unsigned long)passes,
+           (unsigned long)sim.transactions());
+}
+
+// Hands out frames with a broken CRC byte
+class BadCrcSim : public MTS4xSimDevice {
+  public:
+    BadCrcSim() : badFrames(0) {}
+    bool readRegs(uint8_t addr, uint8_t reg, uint8_t *data, size_t len) override {
+        bool ok = MTS4xSimDevice::readRegs(addr, reg, data, len);
+        if (ok && badFrames && reg <= MTS4X_CRC_TEMP && reg + len > MTS4X_CRC_TEMP) {
+            data[MTS4X_CRC_TEMP - reg] ^= 0x5A;
+            --badFrames;
+        }
+        return ok;
+    }
+    uint8_t badFrames;
+};
+
+// A bad CRC costs one more poll(), not a delay()
+static void testCrcRetry() {
+    BadCrcSim sim;
+    MTS4X     mts(sim);
+    CHECK(mts.begin(0, 0));
+    CHECK(mts.setConfig(MPS_1Hz, AVG_8, true));
+    CHECK(mts.startConversion());
+    sim.advanceUs(mts4x_avg_time_us(AVG_8) + 100);
+
+    sim.badFrames = 2;
+    uint64_t t = sim.nowUs();
+    CHECK(mts.poll() == MTS4X_POLL_PENDING);
+    CHECK(mts.poll() == MTS4X_POLL_PENDING);
+    CHECK(sim.nowUs() - t <= 2 * oneReadUs(400000));
+    CHECK(mts.poll() == MTS4X_POLL_READY);
+
+    // Three bad frames in a row end it
+    CHECK(mts.startConversion());
+    sim.advanceUs(mts4x_avg_time_us(AVG_8) + 100);
+    sim.badFrames = 3;
+    MTS4xPollResult r;
+    uint8_t polls = 0;
+    while ((r = mts.poll()) == MTS4X_POLL_PENDING && polls < 10) {
+        ++polls;
+    }
+    CHECK(r == MTS4X_POLL_ERROR);
+    CHECK_EQ(polls, 2);
+    CHECK_EQ(mts.lastError(), MTS4X_ERR_CRC);
+}
+
+int main() {
+    static const TempCfgAVG avgs[] = { AVG_1, AVG_8, AVG_16, AVG_32 };
+    for (uint8_t i = 0; i < 4; ++i) {
+        testLatency(avgs[i], 100000UL);
+        testLatency(avgs[i], 400000UL);
+    }
+    testCrcRetry();
+    return host_test_result("test_poll");
+}
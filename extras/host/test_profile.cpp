@@ -0,0 +1,78 @@
+// applyProfile() against the simulated MTS4: diff-only writes, EEPROM
+// commit only on a change, continuous-readback Temp_Cmd and verify errors
+
+#include "MTS4x.h"
+#include "MTS4xSim.h"
+#include "host_test.h"
+
+// TH_Lsb bit 0 stuck low: every profile write reads back different
+class StuckBitSim : public MTS4xSimDevice {
+  public:
+    bool writeRegs(uint8_t addr, uint8_t reg,
+                   const uint8_t *data, size_t len) override {
+        bool ok = MTS4xSimDevice::writeRegs(addr, reg, data, len);
+        poke(MTS4X_TH_LSB, (uint8_t)(peek(MTS4X_TH_LSB) & 0xFE));
+        return ok;
+    }
+};
+
+static MTS4xProfile profile(MeasurementMode mode) {
+    MTS4xProfile p;
+    p.setConfig(MPS_1Hz, AVG_8, false);
+    p.setMode(mode, false);
+    p.setLimitsRaw(0x0C81, 0x0380);
+    p.setUser(0, 0x5A);
+    return p;
+}
+
+static void testApplyOnce(MeasurementMode mode) {
+    MTS4xSimDevice sim;
+    MTS4X          mts(sim);
+    CHECK(mts.begin(0, 0));
+    MTS4xProfile p = profile(mode);
+
+    bool ee = false;
+    CHECK(mts.applyProfile(p, true, ee));
+    CHECK_EQ(mts.lastError(), MTS4X_ERR_OK);
+    CHECK(ee);
+    CHECK_EQ(sim.eepromWrites(), 1);
+    CHECK_EQ(sim.eeprom()[MTS4X_TH_LSB - MTS4X_TEMP_CMD], 0x81);
+    CHECK_EQ(sim.eeprom()[MTS4X_USER_DEFINE_0 - MTS4X_TEMP_CMD], 0x5A);
+
+    // Same profile again: verified equal, nothing written
+    CHECK(mts.applyProfile(p, true, ee));
+    CHECK(!ee);
+    CHECK_EQ(sim.eepromWrites(), 1);
+
+    // And against the chip after a power cycle (EEPROM recalled)
+    sim.powerOn();
+    MTS4xProfile have;
+    CHECK(mts.readProfile(have));
+    CHECK(have.matches(p));
+}
+
+static void testVerifyError() {
+    StuckBitSim sim;
+    MTS4X       mts(sim);
+    CHECK(mts.begin(0, 0));
+    bool ee = true;
+    CHECK(!mts.applyProfile(profile(MEASURE_STOP), true, ee));
+    CHECK_EQ(mts.lastError(), MTS4X_ERR_VERIFY);
+    CHECK(!ee);
+    CHECK_EQ(sim.eepromWrites(), 0);
+#if MTS4X_ENABLE_STATS
+    MTS4xDriverStats st;
+    CHECK(mts.stats(st));
+    CHECK_EQ(st.errVerify, 1);
+    CHECK_EQ(st.errWire, 0);
+#endif
+}
+
+int main() {
+    testApplyOnce(MEASURE_STOP);
+    testApplyOnce(MEASURE_SINGLE);
+    testApplyOnce(MEASURE_CONTINUOUS);
+    testApplyOnce(MEASURE_CONTINUOUS_READBACK);
+    testVerifyError();
+    return host_test_result("test_profile");
+}
@@ -0,0 +1,174 @@
+// Bus fault recovery (setRecoveryDeadline) against injected faults:
+// replays succeed within the deadline, recovery time percentiles over
+// random NAK bursts and stuck-SDA lengths, EEPROM commands are never
+// replayed, and the bus lock is free while a recovery backs off
+
+#include "MTS4x.h"
+#include "MTS4xSim.h"
+#include "host_test.h"
+#include <algorithm>
+#include <pthread.h>
+#include <stdlib.h>
+#include <time.h>
+#include <vector>
+
+#define DEADLINE_US 100000UL
+
+static void testReplay() {
+    MTS4xSimDevice sim;
+    MTS4X          mts(sim);
+    CHECK(mts.begin(0, 0));
+    mts.setRecoveryDeadline(DEADLINE_US);
+    sim.setTemperatureMilli(19000);
+
+    int32_t mC = 0;
+    sim.injectNak(3);
+    CHECK(mts.singleShotMilli(mC));
+    CHECK_EQ(mC, 19000);
+
+    sim.injectStuckSda(20);   // three bus clears
+    CHECK(mts.singleShotMilli(mC));
+    CHECK(!sim.sdaStuck());
+
+    // A fault outlasting the deadline fails, in bounded time
+    sim.injectNak(1000000);
+    uint64_t t0 = sim.nowUs();
+    CHECK(!mts.readTemperatureMilli(mC));
+    CHECK_EQ(mts.lastError(), MTS4X_ERR_WIRE);
+    uint64_t took = sim.nowUs() - t0;
+    CHECK(took >= DEADLINE_US && took < DEADLINE_US + 2 * 1000UL * MTS4X_RECOVERY_BACKOFF_MS);
+
+    // Backoff: far fewer attempts than a busy loop would make
+    CHECK(sim.transactions() < 100);
+}
+
+// A failed write to E2PROM_Cmd may already have run: no second copy/reset
+static void testNoCommandReplay() {
+    MTS4xSimDevice sim;
+    MTS4X          mts(sim);
+    CHECK(mts.begin(0, 0));
+    mts.setRecoveryDeadline(DEADLINE_US);
+
+    sim.resetCounters();
+    sim.injectNak(1);
+    CHECK(!mts.softReset());
+    CHECK_EQ(mts.lastError(), MTS4X_ERR_WIRE);
+    CHECK_EQ(sim.transactions(), 1);
+    CHECK_EQ(sim.busClears(), 1);   // bus left clean for the next call
+
+    sim.resetCounters();
+    sim.injectNak(1);
+    CHECK(!mts.eepromCopyPage(true, 50));
+    CHECK_EQ(sim.eepromWrites(), 0);
+    CHECK_EQ(sim.transactions(), 1);
+
+    // Plain register writes are replayed
+    MTS4xSimDevice ref;
+    MTS4X          clean(ref);
+    CHECK(clean.begin(0, 0));
+    CHECK(clean.setConfig(MPS_2Hz, AVG_16, true));
+    sim.injectNak(2);
+    CHECK(mts.setConfig(MPS_2Hz, AVG_16, true));
+    CHECK_EQ(sim.peek(MTS4X_TEMP_CFG), ref.peek(MTS4X_TEMP_CFG));
+}
+
+static uint32_t percentile(std::vector<uint32_t> &v, uint8_t p) {
+    return v[(v.size() - 1) * p / 100];
+}
+
+// Recovery time on the virtual clock: first failure to the good replay
+static void testPercentiles() {
+    std::vector<uint32_t> nak, stuck;
+    srand(7);
+    for (uint16_t i = 0; i < 1000; ++i) {
+        MTS4xSimDevice sim;
+        MTS4X          mts(sim);
+        mts.begin(0, 0);
+        mts.setRecoveryDeadline(DEADLINE_US);
+        bool isNak = (i & 1) != 0;
+        if (isNak) {
+            sim.injectNak(1 + rand() % 8);
+        } else {
+            sim.injectStuckSda((uint16_t)(1 + rand() % 60));
+        }
+        int32_t  mC;
+        uint64_t t0 = sim.nowUs();
+        CHECK(mts.readTemperatureMilli(mC));
+        (isNak ? nak : stuck).push_back((uint32_t)(sim.nowUs() - t0));
+    }
+    std::sort(nak.begin(), nak.end());
+    std::sort(stuck.begin(), stuck.end());
+    printf("  recovery us       p50    p90    p99    max\n");
+    printf("  NAK 1..8       %6lu %6lu %6lu %6lu\n",
+           (unsigned long)percentile(nak, 50), (unsigned long)percentile(nak, 90),
+           (unsigned long)percentile(nak, 99), (unsigned long)nak.back());
+    printf("  stuck 1..60    %6lu %6lu %6lu %6lu\n",
+           (unsigned long)percentile(stuck, 50), (unsigned long)percentile(stuck, 90),
+           (unsigned long)percentile(stuck, 99), (unsigned long)stuck.back());
+    CHECK(nak.back() < DEADLINE_US);
+    CHECK(stuck.back() < DEADLINE_US);
+}
+
+// Two simulated chips behind one bus lock; backoff sleeps in real time
+static int s_sharedBus;
+
+class SharedBusSim : public MTS4xSimDevice {
+  public:
+    const void *lockKey() const override { return &s_sharedBus; }
+    void delay(uint32_t ms) override {
+        struct timespec ts = { 0, (long)ms * 1000000L };
+        nanosleep(&ts, 0);
+        MTS4xSimDevice::delay(ms);
+    }
+};
+
+static double nowSec() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void *failingReader(void *arg) {
+    MTS4X  *mts = (MTS4X *)arg;
+    int32_t mC;
+    mts->readTemperatureMilli(mC);   // fails after the whole deadline
+    return 0;
+}
+
+static void testLockReleased() {
+    SharedBusSim simA, simB;
+    MTS4X        a(simA), b(simB);
+    CHECK(a.begin(0, 0));
+    CHECK(b.begin(0, 0));
+    a.setRecoveryDeadline(50000);
+    simA.injectNak(1000000);
+
+    double t0 = nowSec();
+    pthread_t th;
+    CHECK(pthread_create(&th, 0, failingReader, &a) == 0);
+    double worst = 0;
+    while (true) {
+        double s = nowSec();
+        int32_t mC;
+        CHECK(b.readTemperatureMilli(mC));
+        double d = nowSec() - s;
+        if (d > worst) worst = d;
+        if (s - t0 > 0.08) {
+            break;
+        }
+        struct timespec ts = { 0, 200000L };
+        nanosleep(&ts, 0);
+    }
+    pthread_join(th, 0);
+    printf("  other device on the bus: worst read %.2f ms during a 50 ms recovery\n",
+           worst * 1e3);
+    CHECK(worst < 0.02);
+}
+
+int main() {
+    testReplay();
+    testNoCommandReplay();
+    testPercentiles();
+    testLockReleased();
+    return host_test_result("test_recovery");
+}
@@ -0,0 +1,498 @@
+// MeteoStation responses: the PROGMEM templates streamed by ResponseWriter
+// against building the same page and JSON in a String, the way handleRoot()
+// and handleJson() did before. Both produce the same bytes; heap use per
+// request (operator new counted), socket writes, and requests/s rendered
+// into a sink and served over loopback.
+
+#include "station.h"
+#include "host_test.h"
+#include <new>
+#include <stdlib.h>
+#include <time.h>
+
+// -----------------------------------------------------------------------------
+// Heap accounting: every operator new in the process, live and peak bytes
+// -----------------------------------------------------------------------------
+
+static size_t   s_live;
+static size_t   s_peak;
+static uint32_t s_allocs;
+
+void *operator new(size_t n) {
+    size_t *p = (size_t *)malloc(n + 16);
+    if (!p) throw std::bad_alloc();
+    p[0] = n;
+    s_live += n;
+    if (s_live > s_peak) s_peak = s_live;
+    ++s_allocs;
+    return (char *)p + 16;
+}
+
+void operator delete(void *q) noexcept {
+    if (!q) return;
+    size_t *p = (size_t *)((char *)q - 16);
+    s_live -= p[0];
+    free(p);
+}
+
+void operator delete(void *q, size_t) noexcept {
+    operator delete(q);
+}
+
+struct HeapUse {
+    size_t   peak;     // above what was live before
+    uint32_t allocs;
+};
+
+template <class F>
+static HeapUse heapOf(F fn) {
+    size_t   base   = s_live;
+    uint32_t allocs = s_allocs;
+    s_peak          = s_live;
+    fn();
+    HeapUse h = { s_peak - base, s_allocs - allocs };
+    return h;
+}
+
+// -----------------------------------------------------------------------------
+// Arduino String as the old handlers used it: grows to the exact length
+// needed (a new block and a copy), temporaries for every number
+// -----------------------------------------------------------------------------
+
+class String {
+  public:
+    String() : _buf(NULL), _len(0), _cap(0) {}
+    String(const char *s) : _buf(NULL), _len(0), _cap(0) { *this += s; }
+    String(const __FlashStringHelper *s) : _buf(NULL), _len(0), _cap(0) { *this += s; }
+    String(const String &s) : _buf(NULL), _len(0), _cap(0) { *this += s; }
+    String(long v) : _buf(NULL), _len(0), _cap(0) { number("%ld", v); }
+    String(int v) : _buf(NULL), _len(0), _cap(0) { number("%ld", (long)v); }
+    String(unsigned long v) : _buf(NULL), _len(0), _cap(0) { number("%lu", v); }
+    String(unsigned int v) : _buf(NULL), _len(0), _cap(0) { number("%lu", (unsigned long)v); }
+    // dtostrf(): rounded to the given places
+    String(float v, unsigned char decimals) : _buf(NULL), _len(0), _cap(0) {
+        uint32_t scale = 1;
+        for (uint8_t i = 0; i < decimals; ++i) scale *= 10;
+        uint32_t n = (uint32_t)lroundf((v < 0 ? -v : v) * scale);
+        char     tmp[24];
+        snprintf(tmp, sizeof(tmp), "%s%lu.%0*lu", v < 0 && n ? "-" : "", (unsigned long)(n / scale),
+                 decimals, (unsigned long)(n % scale));
+        *this += tmp;
+    }
+    ~String() { delete[] _buf; }
+
+    String &operator=(const String &s) {
+        if (this != &s) {
+            _len = 0;
+            *this += s;
+        }
+        return *this;
+    }
+
+    bool reserve(size_t n) {
+        if (n <= _cap) return true;
+        char *b = new char[n + 1];
+        if (_len) memcpy(b, _buf, _len);
+        b[_len] = '\0';
+        delete[] _buf;
+        _buf = b;
+        _cap = n;
+        return true;
+    }
+
+    String &operator+=(const char *s) { return append(s, strlen(s)); }
+    String &operator+=(const __FlashStringHelper *s) { return *this += (const char *)s; }
+    String &operator+=(const String &s) { return append(s.c_str(), s._len); }
+
+    const char *c_str() const { return _buf ? _buf : ""; }
+    size_t      length() const { return _len; }
+
+  private:
+    char  *_buf;
+    size_t _len;
+    size_t _cap;
+
+    String &append(const char *s, size_t n) {
+        reserve(_len + n);
+        memcpy(_buf + _len, s, n);
+        _len += n;
+        _buf[_len] = '\0';
+        return *this;
+    }
+    template <class T>
+    void number(const char *fmt, T v) {
+        char tmp[24];
+        snprintf(tmp, sizeof(tmp), fmt, v);
+        *this += tmp;
+    }
+};
+
+static String operator+(const String &a, const char *b) {
+    String s(a);
+    s += b;
+    return s;
+}
+
+static String operator+(const String &a, const String &b) {
+    String s(a);
+    s += b;
+    return s;
+}
+
+// -----------------------------------------------------------------------------
+// The handlers before ResponseWriter, extended to today's page and JSON
+// -----------------------------------------------------------------------------
+
+static String milliString(int32_t mC) {
+    char tmp[16];
+    mts4x_format_milli(tmp, sizeof(tmp), mC, 3);
+    return String(tmp);
+}
+
+static void spanOpen(String &page, const char *id) {
+    page += F("<span id='");
+    page += id;
+    page += F("'>");
+}
+
+template <class Server>
+static void oldRoot(Server &srv) {
+    String page;
+    page.reserve(2048);
+
+    page += F("<!DOCTYPE html><html lang='ru'><head><meta charset='UTF-8'>");
+    page += F("<title>MTS4P+T4 Station</title>");
+    page += F("<meta name='viewport' content='width=device-width,initial-scale=1'>");
+    page += F("<style>"
+              "body{font-family:-apple-system,BlinkMacSystemFont,'Segoe UI',sans-serif;"
+              "background:#111;color:#eee;margin:0;padding:12px;}"
+              ".card{background:#1e1e1e;border-radius:10px;padding:10px 12px;margin-bottom:10px;}"
+              ".temp{font-size:2.6rem;font-weight:600;margin:0.4rem 0;}"
+              ".ok{color:#4caf50;}.fail{color:#ff5252;}.warn{color:#ff9800;}"
+              ".label{font-size:0.85rem;color:#aaa;margin-bottom:0.2rem;}"
+              ".small{font-size:0.78rem;color:#888;}"
+              ".value{font-family:monospace;font-size:0.9rem;}"
+              "</style></head><body>");
+    page += F("<h1>MTS4P+T4 Station</h1>");
+
+    page += F("<div class='card'>");
+    page += F("<div class='label'>Текущая температура</div><div class='temp'>");
+    spanOpen(page, "TEMP");
+    page += isnan(g_lastTempC) ? String("--.-") : String(g_lastTempC, 3);
+    page += F("</span> &deg;C</div><div class='small'>CRC: ");
+    spanOpen(page, "CRC");
+    page += g_lastTempCrcOk ? F("<span class='ok'>OK</span>") : F("<span class='fail'>ERR</span>");
+    page += F("</span> | Всего OK/Fail: ");
+    spanOpen(page, "CRC_OK");
+    page += String(g_crcOkTotal) + "</span> / ";
+    spanOpen(page, "CRC_FAIL");
+    page += String(g_crcFailTotal) + "</span>";
+    page += F("<br>EMA: ");
+    spanOpen(page, "EMA");
+    int32_t emaMilli = 0;
+    if (g_agg.emaMilli(emaMilli)) {
+        page += milliString(emaMilli);
+        page += F(" &deg;C");
+    } else {
+        page += F("--");
+    }
+    page += F("</span> | &sigma;: ");
+    spanOpen(page, "SIGMA");
+    page += isnan(g_lastStdDevC) ? String("--") : String(g_lastStdDevC, 3);
+    page += F("</span> | Выбросы: ");
+    spanOpen(page, "OUTLIERS");
+    page += String(g_agg.rejected()) + "</span>";
+    page += F("<br>AVG_");
+    spanOpen(page, "OS_AVG");
+    page += String((uint32_t)avgCount(g_os.plan().avg)) + "</span> x ";
+    spanOpen(page, "OS_N");
+    page += String((uint32_t)g_os.plan().samples) + "</span>";
+    page += F(", шум ");
+    spanOpen(page, "OS_NOISE");
+    page += String(g_os.noiseMilli()) + "</span>";
+    page += F(" m&deg;C, ошибка среднего ");
+    spanOpen(page, "OS_SE");
+    page += String(g_os.achievedSeMilli()) + "</span>";
+    page += F(" m&deg;C</div></div>");
+
+    page += F("<div class='card'>");
+    page += F("<div class='label'>Wi-Fi Status</div><div class='value'>SSID: ");
+    spanOpen(page, "SSID");
+    page += (WiFi.status() == WL_CONNECTED) ? WIFI_SSID : "Disconnected";
+    page += F("</span><br>IP: ");
+    spanOpen(page, "IP");
+    IPAddress ip = WiFi.localIP();
+    page += String((uint32_t)ip[0]) + "." + String((uint32_t)ip[1]) + "." +
+            String((uint32_t)ip[2]) + "." + String((uint32_t)ip[3]);
+    page += F("</span><br>RSSI: ");
+    spanOpen(page, "RSSI");
+    page += String(g_lastRssiDbm) + "</span> dBm (";
+    spanOpen(page, "WIFI_Q");
+    page += String(wifiQuality(g_lastRssiDbm)) + "</span>%)";
+    spanOpen(page, "WEAK");
+    if (g_lastRssiDbm < -85 && g_lastRssiDbm > -100) {
+        page += F(" <span class='warn'>Weak!</span>");
+    }
+    page += F("</span></div></div>");
+
+    page += F("<div class='card'>");
+    page += F("<div class='label'>NarodMon.ru</div><div class='small'>Queue: ");
+    spanOpen(page, "NM_COUNT");
+    page += String(g_nmWindow.count()) + "</span> samples";
+    spanOpen(page, "NM_RANGE");
+    if (g_nmWindow.count() > 1) {
+        page += F(" (min/max ");
+        page += milliString(mts4x_raw_to_milli(g_nmWindow.minRaw()));
+        page += F(" / ");
+        page += milliString(mts4x_raw_to_milli(g_nmWindow.maxRaw()));
+        page += F(")");
+    }
+    page += F("</span><br>Last Avg: ");
+    spanOpen(page, "NM_LAST");
+    if (!isnan(g_nmLastAvg)) {
+        page += String(g_nmLastAvg, 3);
+        page += F(" &deg;C (");
+        if (g_nm.lastResult() == NM_RESULT_NONE || g_nm.busy()) {
+            page += F("Pending");
+        } else if (g_nm.lastOk()) {
+            page += F("<span class='ok'>Sent</span>");
+        } else {
+            page += String("<span class='fail'>Fail: ") +
+                    NarodMonUploader<WiFiClient>::resultName(g_nm.lastResult()) + "</span>";
+        }
+        page += F(")");
+    } else {
+        page += F("Wait...");
+    }
+    page += F("</span><br>Unsent: ");
+    spanOpen(page, "NM_PENDING");
+    page += String((uint32_t)g_nm.pending()) + "</span> | Sent/Fail: ";
+    spanOpen(page, "NM_SENT");
+    page += String(g_nm.sentOk()) + "</span> / ";
+    spanOpen(page, "NM_FAIL");
+    page += String(g_nm.sentFail()) + "</span>";
+    page += F("</div></div>");
+
+    page += F("<div class='small'>JSON API: <a href='/json' style='color:#fff'>/json</a>"
+              " | История: <a href='/history' style='color:#fff'>/history</a> (");
+    spanOpen(page, "HIST_N");
+    page += String(g_history.samples()) + "</span> точек, ";
+    spanOpen(page, "HIST_BYTES");
+    page += String((uint32_t)g_history.bytesUsed()) + "</span> байт)</div>";
+    page += F("<script>if(window.EventSource)new EventSource('/events').onmessage=function(e){"
+              "var d=JSON.parse(e.data);for(var k in d){var el=document.getElementById(k);"
+              "if(el)el.innerHTML=d[k];}};</script>");
+    page += F("</body></html>");
+
+    srv.send(200, "text/html; charset=utf-8", page.c_str());
+}
+
+template <class Server>
+static void oldJson(Server &srv) {
+    String json;
+    json.reserve(512);
+
+    json += F("{\"temperature_c\":");
+    if (isnan(g_lastTempC)) json += F("null,");
+    else { json += String(g_lastTempC, 3); json += F(","); }
+
+    json += F("\"crc_ok\":");
+    json += g_lastTempCrcOk ? F("true,") : F("false,");
+
+    json += F("\"stddev_c\":");
+    if (isnan(g_lastStdDevC)) json += F("null,");
+    else { json += String(g_lastStdDevC, 4); json += F(","); }
+
+    json += F("\"ema_c\":");
+    int32_t emaMilli = 0;
+    if (g_agg.emaMilli(emaMilli)) { json += milliString(emaMilli); json += F(","); }
+    else json += F("null,");
+
+    json += F("\"outliers\":");
+    json += String(g_agg.rejected()) + ",";
+
+    json += F("\"oversampling\":{\"avg\":");
+    json += String((uint32_t)avgCount(g_os.plan().avg)) + ",\"samples\":";
+    json += String((uint32_t)g_os.plan().samples) + ",\"noise_mc\":";
+    json += String(g_os.noiseMilli()) + ",\"se_mc\":";
+    json += String(g_os.achievedSeMilli()) + ",\"target_met\":";
+    json += g_os.plan().targetMet ? F("true},") : F("false},");
+
+    json += F("\"narodmon_last_send_ok\":");
+    if (g_nm.lastResult() == NM_RESULT_NONE) json += F("null,");
+    else json += g_nm.lastOk() ? F("true,") : F("false,");
+    json += F("\"narodmon_pending\":");
+    json += String((uint32_t)g_nm.pending()) + ",";
+
+    json += F("\"events\":{\"clients\":");
+    json += String((uint32_t)g_events.subscribers()) + ",\"frames\":";
+    json += String(g_events.framesSent()) + ",\"bytes\":";
+    json += String(g_events.bytesSent()) + ",\"evicted\":";
+    json += String(g_events.evicted()) + ",\"closed\":";
+    json += String(g_events.closed()) + "},";
+
+    json += F("\"wifi_rssi\":");
+    json += String(g_lastRssiDbm);
+    json += F("}");
+    srv.send(200, "application/json", json.c_str());
+}
+
+// -----------------------------------------------------------------------------
+// A web server that keeps the body in a fixed buffer (no heap of its own)
+// and counts the socket writes the ESP8266 server would make: headers,
+// the content given to send(), and per sendContent() one write, three
+// when chunked (size line, data, CRLF)
+// -----------------------------------------------------------------------------
+
+class SinkServer {
+  public:
+    SinkServer() : writes(0), _len(0), _chunked(false) {}
+
+    void setContentLength(size_t len) { _chunked = len == CONTENT_LENGTH_UNKNOWN; }
+    void send(int, const char *, const char *content) {
+        _len   = 0;
+        writes = 1;
+        if (*content) {
+            bool chunked = _chunked;
+            sendContent(content, strlen(content));
+            _chunked = chunked;
+        }
+    }
+    void sendContent(const char *data, size_t len) {
+        writes += _chunked ? 3 : 1;
+        if (!len) _chunked = false;
+        if (len > sizeof(_body) - _len) len = sizeof(_body) - _len;
+        memcpy(_body + _len, data, len);
+        _len += len;
+    }
+    void sendContent(const char *data) { sendContent(data, strlen(data)); }
+
+    std::string body() const { return std::string(_body, _len); }
+
+    uint32_t writes;
+
+  private:
+    char   _body[8192];
+    size_t _len;
+    bool   _chunked;
+};
+
+static SinkServer s_sink;
+
+// handleRoot() and handleJson() on the sink
+static void newRoot() {
+    ResponseWriter<SinkServer> out(s_sink);
+    out.send(200, "text/html; charset=utf-8", PAGE_ROOT, fillPage, &g_htmlCtx);
+}
+
+static void newJson() {
+    ResponseWriter<SinkServer> out(s_sink);
+    out.send(200, "application/json", PAGE_JSON, fillField, NULL);
+}
+
+static void oldRootSink() { oldRoot(s_sink); }
+static void oldJsonSink() { oldJson(s_sink); }
+static void oldRootServer() { oldRoot(server); }
+static void oldJsonServer() { oldJson(server); }
+
+static double wallSec() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static double cpuSec() {
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Renders per second of CPU, both builds taking turns; best run of each
+static void renderRates(void (*oldFn)(), void (*newFn)(), double *ro, double *rn) {
+    const uint32_t n = 5000;
+    *ro = *rn = 0;
+    for (uint8_t pass = 0; pass < 8; ++pass) {
+        for (uint8_t which = 0; which < 2; ++which) {
+            void (*fn)() = which ? newFn : oldFn;
+            double t0    = cpuSec();
+            for (uint32_t i = 0; i < n; ++i) fn();
+            double r     = n / (cpuSec() - t0);
+            double *best = which ? rn : ro;
+            if (r > *best) *best = r;
+        }
+    }
+}
+
+// Whole requests over loopback (connect, parse, handler, close)
+static double serveRate(const char *path) {
+    const uint32_t n  = 300;
+    double         t0 = wallSec();
+    for (uint32_t i = 0; i < n; ++i) {
+        CHECK(station_get(path).compare(0, 15, "HTTP/1.1 200 OK") == 0);
+    }
+    return n / (wallSec() - t0);
+}
+
+static void compare(const char *name, void (*oldFn)(), void (*newFn)(), const char *oldPath,
+                    const char *newPath) {
+    oldFn();
+    std::string before = s_sink.body();
+    uint32_t    wo     = s_sink.writes;
+    newFn();
+    CHECK(s_sink.body() == before);
+    CHECK(before.size() > 200);
+    uint32_t wn = s_sink.writes;
+
+    HeapUse ho = heapOf(oldFn);
+    HeapUse hn = heapOf(newFn);
+    double  ro, rn;
+    renderRates(oldFn, newFn, &ro, &rn);
+    double  so = serveRate(oldPath);
+    double  sn = serveRate(newPath);
+    printf("  %-4s %4zu B  String: %4zu B peak, %2lu allocs, %2lu writes, %7.0f renders/s, %5.0f req/s\n"
+           "                 stream: %4zu B peak, %2lu allocs, %2lu writes, %7.0f renders/s, %5.0f req/s\n",
+           name, before.size(), ho.peak, (unsigned long)ho.allocs, (unsigned long)wo, ro, so,
+           hn.peak, (unsigned long)hn.allocs, (unsigned long)wn, rn, sn);
+    CHECK_EQ(hn.peak, 0);
+    CHECK_EQ(hn.allocs, 0);
+    CHECK(ho.peak > before.size());
+    // One write per RESPONSE_CHUNK_SIZE of body after the headers
+    CHECK(wn <= 1 + (before.size() + RESPONSE_CHUNK_SIZE - 1) / RESPONSE_CHUNK_SIZE);
+    if (before.size() <= RESPONSE_CHUNK_SIZE) {
+        CHECK(rn > ro);        // one pass
+    } else {
+        CHECK(rn * 2 > ro);    // length first, then the body
+    }
+}
+
+// Both pages over loopback: Content-Length and the body, not chunked
+static void testServed() {
+    static const char *const paths[] = { "/", "/json" };
+    for (uint8_t i = 0; i < 2; ++i) {
+        std::string resp = station_get(paths[i]);
+        size_t      head = resp.find("\r\n\r\n");
+        CHECK(head != std::string::npos);
+        CHECK(resp.find("Transfer-Encoding") == std::string::npos);
+        char want[48];
+        snprintf(want, sizeof(want), "Content-Length: %zu\r\n", resp.size() - head - 4);
+        CHECK(resp.find(want) < head);
+    }
+}
+
+int main() {
+    LittleFS.format();
+    station_sim.setTemperatureMilli(21500);
+    station_sim.setNoise(8);
+    station_sim.setSeed(3);
+    setup();
+    server.on("/old", oldRootServer);
+    server.on("/old.json", oldJsonServer);
+    for (uint8_t i = 0; i < 20; ++i) {
+        station_cycle();
+    }
+
+    testServed();
+    compare("/", oldRootSink, newRoot, "/old", "/");
+    compare("json", oldJsonSink, newJson, "/old.json", "/json");
+    return host_test_result("test_render");
+}
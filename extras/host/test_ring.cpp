@@ -0,0 +1,143 @@
+// MTS4xSampleRing: lap detection past any index width, and a two-thread
+// stress run per policy checking order, payload integrity, loss accounting
+// and throughput
+
+#include "MTS4xRing.h"
+#include "host_test.h"
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+
+#define STRESS_SAMPLES 2000000UL
+#define STRESS_RING    64
+
+// Every field derived from the sequence number, so a torn copy shows
+static MTS4xSample sample(uint32_t seq) {
+    MTS4xSample s;
+    s.timestampUs = seq;
+    s.raw         = (int16_t)(seq * 7);
+    s.status      = (uint8_t)(seq >> 3);
+    s.crcOk       = (seq & 1) != 0;
+    return s;
+}
+
+static bool intact(const MTS4xSample &s) {
+    MTS4xSample w = sample(s.timestampUs);
+    return s.raw == w.raw && s.status == w.status && s.crcOk == w.crcOk;
+}
+
+static double nowSec() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Single thread: a consumer lapped by far more than 256 pushes keeps the
+// newest N-1 in order and counts every lost one
+static void testLapped() {
+    MTS4xSampleRing<8> ring(MTS4X_RING_OVERWRITE_OLDEST);
+    const uint32_t pushes = 70000;   // past 8- and 16-bit index wrap
+    for (uint32_t i = 0; i < pushes; ++i) {
+        CHECK(ring.push(sample(i)));
+    }
+    MTS4xSample out[8];
+    size_t n = ring.popBatch(out, 8);
+    CHECK_EQ(n, 7);
+    for (size_t i = 0; i < n; ++i) {
+        CHECK_EQ(out[i].timestampUs, pushes - 7 + i);
+    }
+    CHECK_EQ(ring.overwritten(), pushes - 7);
+    CHECK_EQ(ring.size(), 0);
+
+    MTS4xSampleRing<8> keep(MTS4X_RING_DROP_NEWEST);
+    for (uint32_t i = 0; i < 300; ++i) {
+        keep.push(sample(i));
+    }
+    CHECK_EQ(keep.size(), 8);
+    CHECK_EQ(keep.dropped(), 292);
+    CHECK_EQ(keep.popBatch(out, 8), 8);
+    CHECK_EQ(out[0].timestampUs, 0);
+    CHECK_EQ(out[7].timestampUs, 7);
+}
+
+struct Stress {
+    MTS4xSampleRing<STRESS_RING> *ring;
+    bool                          paced;     // producer never overfills
+    volatile bool                 done;
+};
+
+static void *producer(void *arg) {
+    Stress *st = (Stress *)arg;
+    for (uint32_t i = 0; i < STRESS_SAMPLES; ++i) {
+        while (st->paced && st->ring->size() >= STRESS_RING - 1) {
+            sched_yield();
+        }
+        st->ring->push(sample(i));
+        if (!st->paced && (i & 4095) == 0) {
+            sched_yield();   // let a consumer on the same core run
+        }
+    }
+    __atomic_store_n(&st->done, true, __ATOMIC_RELEASE);
+    return 0;
+}
+
+static void stress(MTS4xRingPolicy policy, bool paced) {
+    MTS4xSampleRing<STRESS_RING> ring(policy);
+    Stress st = { &ring, paced, false };
+
+    double t0 = nowSec();
+    pthread_t th;
+    CHECK(pthread_create(&th, 0, producer, &st) == 0);
+
+    MTS4xSample batch[16];
+    uint32_t received = 0;
+    uint32_t gaps     = 0;
+    uint32_t torn     = 0;
+    int64_t  last     = -1;
+    for (;;) {
+        bool finished = __atomic_load_n(&st.done, __ATOMIC_ACQUIRE);
+        size_t n = ring.popBatch(batch, 16);
+        for (size_t i = 0; i < n; ++i) {
+            int64_t seq = batch[i].timestampUs;
+            if (!intact(batch[i])) {
+                ++torn;
+            }
+            CHECK(seq > last);
+            gaps += (uint32_t)(seq - last - 1);
+            last = seq;
+        }
+        received += (uint32_t)n;
+        if (finished && !n) {
+            break;
+        }
+        if (!n) {
+            sched_yield();
+        }
+    }
+    pthread_join(th, 0);
+    double dt = nowSec() - t0;
+
+    uint32_t lost = ring.dropped() + ring.overwritten();
+    CHECK_EQ(torn, 0);
+    CHECK_EQ(received + lost, STRESS_SAMPLES);
+    CHECK_EQ(gaps + (STRESS_SAMPLES - 1 - last), lost);
+    if (policy == MTS4X_RING_OVERWRITE_OLDEST) {
+        CHECK_EQ(last, STRESS_SAMPLES - 1);   // the newest always survives
+    }
+    if (paced) {
+        CHECK_EQ(lost, 0);
+    }
+    printf("  %-16s %s: %7.2f Msamples/s, received %lu, lost %lu\n",
+           policy == MTS4X_RING_DROP_NEWEST ? "drop-newest" : "overwrite-oldest",
+           paced ? "paced " : "flood ", STRESS_SAMPLES / dt / 1e6,
+           (unsigned long)received, (unsigned long)lost);
+}
+
+int main() {
+    testLapped();
+    stress(MTS4X_RING_DROP_NEWEST, true);
+    stress(MTS4X_RING_OVERWRITE_OLDEST, true);
+    stress(MTS4X_RING_DROP_NEWEST, false);
+    stress(MTS4X_RING_OVERWRITE_OLDEST, false);
+    return host_test_result("test_ring");
+}
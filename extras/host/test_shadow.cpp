@@ -0,0 +1,125 @@
+// Register shadow with deferred writes: bursts on flush, a command flushes
+// first, nothing lost on a reset or recall, conversion time back to worst
+// case afterwards, and the change monitor's window live on the chip
+
+#include "MTS4x.h"
+#include "MTS4xChangeMonitor.h"
+#include "MTS4xSim.h"
+#include "host_test.h"
+
+static void testDeferredFlush() {
+    MTS4xSimDevice sim;
+    MTS4X          mts(sim);
+    CHECK(mts.begin(0, 0));
+    CHECK(mts.setShadowCache(true, true));
+
+    sim.resetCounters();
+    CHECK(mts.setLimitsRaw(0x0C80, 0x0380));
+    CHECK(mts.writeUserRegister(0, 0x11));
+    CHECK(mts.writeUserRegister(1, 0x22));
+    CHECK_EQ(sim.transactions(), 0);
+    CHECK(sim.peek(MTS4X_TH_LSB) != 0x80);
+
+    CHECK(mts.flushShadow());
+    CHECK_EQ(sim.transactions(), 2);   // 0x07..0x0A and 0x0C..0x0D
+    CHECK_EQ(sim.peek(MTS4X_TH_LSB), 0x80);
+    CHECK_EQ(sim.peek(MTS4X_USER_DEFINE_0 + 1), 0x22);
+}
+
+static uint8_t cfgByte(TempCfgMPS mps, TempCfgAVG avg, bool sleep) {
+    return (uint8_t)((uint8_t)mps | (uint8_t)avg | (sleep ? 0x01 : 0x00));
+}
+
+// A deferred setConfig() already sets the wait of the next conversion: the
+// single-shot command must start it with that config on the chip
+static void testCommandFlushes() {
+    MTS4xSimDevice sim;
+    MTS4X          mts(sim);
+    CHECK(mts.begin(0, 0));
+    CHECK(mts.setConfig(MPS_1Hz, AVG_1, true));
+    CHECK(mts.setShadowCache(true, true));
+
+    CHECK(mts.setConfig(MPS_1Hz, AVG_32, true));
+    CHECK(mts.setHighLimitRaw(0x0C80));
+    CHECK_EQ(sim.peek(MTS4X_TEMP_CFG), cfgByte(MPS_1Hz, AVG_1, true));
+    CHECK_EQ(mts.conversionTimeUs(), 15300);
+
+    sim.resetCounters();
+    uint64_t t0 = sim.nowUs();
+    int32_t  mC;
+    CHECK(mts.singleShotMilli(mC));
+    CHECK_EQ(sim.peek(MTS4X_TEMP_CFG), cfgByte(MPS_1Hz, AVG_32, true));
+    CHECK_EQ(sim.peek(MTS4X_TH_LSB), 0x80);
+    CHECK_EQ(sim.conversions(), 1);
+    CHECK(sim.lastConversionUs() - t0 >= 15000);   // AVG_32, not AVG_1
+    CHECK(mts.flushShadow());
+    CHECK_EQ(sim.transactions(), 4);   // Temp_Cfg, TH, command, frame
+
+    // Heater and mode changes are commands too
+    CHECK(mts.setConfig(MPS_1Hz, AVG_8, false));
+    CHECK(mts.setMode(MEASURE_CONTINUOUS, false));
+    CHECK_EQ(sim.peek(MTS4X_TEMP_CFG), cfgByte(MPS_1Hz, AVG_8, false));
+}
+
+static void testResetKeepsDirty(bool recall) {
+    MTS4xSimDevice sim;
+    MTS4X          mts(sim);
+    CHECK(mts.begin(0, 0));
+    CHECK(mts.setConfig(MPS_1Hz, AVG_1, true));
+    CHECK(mts.conversionTimeUs() < 15300);
+    CHECK(mts.setShadowCache(true, true));
+
+    // PPM_Cfg is not part of the EEPROM image: only a flush saves it
+    CHECK(mts.setParasiticPower(true));
+    CHECK(mts.setLimitsRaw(0x0C80, 0x0380));
+    CHECK(recall ? mts.eepromRecallPage(true, 50) : mts.softReset(true, 50));
+    CHECK_EQ(sim.peek(MTS4X_PPM_CFG), 0x0A);
+
+    // Scratch is what the EEPROM held, and reads come from the chip again
+    CHECK_EQ(sim.peek(MTS4X_TH_LSB), sim.eeprom()[MTS4X_TH_LSB - MTS4X_TEMP_CMD]);
+    int16_t th = 0;
+    CHECK(mts.getHighLimitRaw(th));
+    CHECK_EQ((uint8_t)th, sim.peek(MTS4X_TH_LSB));
+
+    // The config in use is unknown until set again: worst-case wait
+    CHECK_EQ(mts.conversionTimeUs(), 15300);
+    int32_t mC;
+    CHECK(mts.singleShotMilli(mC));
+}
+
+static void testMonitorDeferred() {
+    MTS4xSimDevice sim;
+    MTS4X          mts(sim);
+    sim.setTemperatureMilli(20000);
+    CHECK(mts.begin(0, 0));
+    CHECK(mts.setShadowCache(true, true));
+
+    MTS4XChangeMonitor mon(mts);
+    CHECK(mon.beginMilli(500, MPS_4Hz, AVG_1));
+    int16_t raw = mon.lastRaw();
+    int16_t th  = (int16_t)((sim.peek(MTS4X_TH_MSB) << 8) | sim.peek(MTS4X_TH_LSB));
+    int16_t tl  = (int16_t)((sim.peek(MTS4X_TL_MSB) << 8) | sim.peek(MTS4X_TL_LSB));
+    CHECK_EQ(th, raw + 128);
+    CHECK_EQ(tl, raw - 128);
+
+    // A step outside the window trips it and re-centres it on the chip
+    sim.setTemperatureMilli(21000);
+    bool tripped = false;
+    for (uint16_t i = 0; i < 100 && !tripped; ++i) {
+        sim.advanceUs(10000);
+        tripped = mon.poll(raw);
+    }
+    CHECK(tripped);
+    CHECK_EQ(mts4x_raw_to_milli(raw), 21000);
+    th = (int16_t)((sim.peek(MTS4X_TH_MSB) << 8) | sim.peek(MTS4X_TH_LSB));
+    CHECK_EQ(th, raw + 128);
+}
+
+int main() {
+    testDeferredFlush();
+    testCommandFlushes();
+    testResetKeepsDirty(false);
+    testResetKeepsDirty(true);
+    testMonitorDeferred();
+    return host_test_result("test_shadow");
+}
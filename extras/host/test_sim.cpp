@@ -0,0 +1,154 @@
+// Driver against the simulated MTS4: readings, conversion timing (also
+// with a clock that stands still between calls), alert logic, EEPROM
+// persistence and error reporting, all on the virtual clock
+
+#include "MTS4x.h"
+#include "MTS4xSim.h"
+#include "host_test.h"
+
+static void testSingleShot() {
+    MTS4xSimDevice sim;
+    MTS4X          mts(sim);
+    sim.setTemperatureMilli(21500);
+    CHECK(mts.begin(0, 0));
+    CHECK(mts.setConfig(MPS_1Hz, AVG_8, true));
+
+    int32_t mC = 0;
+    CHECK(mts.singleShotMilli(mC));
+    CHECK_EQ(mC, 21500);
+    CHECK_EQ(mts.lastError(), MTS4X_ERR_OK);
+    CHECK(sim.conversions() == 1);
+
+    sim.setTemperatureMilli(-40000);
+    CHECK(mts.singleShotMilli(mC));
+    CHECK_EQ(mC, -40000);
+}
+
+// Conversion takes the datasheet time for each AVG setting
+static void testConversionTime() {
+    static const TempCfgAVG avgs[] = { AVG_1, AVG_8, AVG_16, AVG_32 };
+    for (uint8_t i = 0; i < 4; ++i) {
+        MTS4xSimDevice sim;
+        MTS4X          mts(sim);
+        mts.begin(0, 0);
+        mts.setConfig(MPS_1Hz, avgs[i], true);
+        CHECK(mts.startConversion());
+        uint64_t start = sim.nowUs();
+        MTS4xPollResult r;
+        while ((r = mts.poll()) == MTS4X_POLL_PENDING) {
+            sim.advanceUs(100);
+        }
+        CHECK(r == MTS4X_POLL_READY);
+        uint64_t took = sim.lastConversionUs() - start;
+        uint32_t want = mts4x_avg_time_us(avgs[i]);
+        CHECK(took + 100 >= want && took <= want + 100);
+    }
+}
+
+// A time base that only moves in delay(): the blocking wait must not spin
+// forever on the sub-ms rest of the conversion time
+static void testFrozenMicros() {
+    MTS4xSimDevice sim;
+    MTS4X          mts(sim);
+    sim.setTemperatureMilli(21500);
+    CHECK(mts.begin(0, 0));
+    CHECK(mts.setConfig(MPS_1Hz, AVG_8, true));   // 5.2 ms: 200 us after delay(5)
+    sim.setCallCostUs(0);
+    int32_t mC = 0;
+    CHECK(mts.singleShotMilli(mC));
+    CHECK_EQ(mC, 21500);
+}
+
+// Continuous mode converts once per MPS period
+static void testContinuousPeriod() {
+    MTS4xSimDevice sim;
+    MTS4X          mts(sim);
+    mts.begin(0, 0);
+    mts.setConfig(MPS_4Hz, AVG_1, false);
+    mts.setMode(MEASURE_CONTINUOUS, false);
+    sim.resetCounters();
+    for (uint16_t i = 0; i < 200; ++i) {
+        sim.advanceUs(10000);   // unobserved stretches would be skipped
+    }
+    uint32_t n = sim.conversions();
+    CHECK(n >= 7 && n <= 9);
+}
+
+static void testAlert() {
+    MTS4xSimDevice sim;
+    MTS4X          mts(sim);
+    mts.begin(0, 0);
+    sim.setTemperatureMilli(20000);
+    CHECK(mts.setHighLimitMilli(25000));
+    CHECK(mts.setLowLimitMilli(15000));
+    CHECK(mts.setAlertMode(true, ALERT_MODE_HIGH_TH_LOW_ALARM));
+
+    int32_t mC;
+    uint8_t st = 0;
+    CHECK(mts.singleShotMilli(mC));
+    CHECK(mts.readStatus(st));
+    CHECK(!(st & (MTS4X_STATUS_ALERT_HIGH | MTS4X_STATUS_ALERT_LOW)));
+
+    sim.setTemperatureMilli(30000);
+    CHECK(mts.singleShotMilli(mC));
+    CHECK(mts.readStatus(st));
+    CHECK(st & MTS4X_STATUS_ALERT_HIGH);
+
+    sim.setTemperatureMilli(10000);
+    CHECK(mts.singleShotMilli(mC));
+    CHECK(mts.readStatus(st));
+    CHECK(st & MTS4X_STATUS_ALERT_LOW);
+}
+
+// User register survives copy + soft reset, not a plain soft reset
+static void testEeprom() {
+    MTS4xSimDevice sim;
+    MTS4X          mts(sim);
+    mts.begin(0, 0);
+    uint8_t v = 0;
+    CHECK(mts.writeUserRegister(3, 0x5A));
+    CHECK(mts.softReset());
+    CHECK(mts.readUserRegister(3, v));
+    CHECK_EQ(v, 0x00);
+
+    CHECK(mts.writeUserRegister(3, 0x5A));
+    CHECK(mts.eepromCopyPage());
+    CHECK_EQ(sim.eepromWrites(), 1);
+    CHECK(mts.writeUserRegister(3, 0x11));
+    CHECK(mts.softReset());
+    CHECK(mts.readUserRegister(3, v));
+    CHECK_EQ(v, 0x5A);
+
+    uint8_t ext[10];
+    bool    crcOk = false;
+    CHECK(mts.readScratchExt(ext, crcOk));
+    CHECK(crcOk);
+    CHECK_EQ(ext[3], 0x5A);
+}
+
+static void testErrors() {
+    MTS4xSimDevice sim;
+    MTS4X          mts(sim);
+    mts.begin(0, 0);
+    uint8_t st;
+    sim.injectNak(1);
+    CHECK(!mts.readStatus(st));
+    CHECK_EQ(mts.lastError(), MTS4X_ERR_WIRE);
+    CHECK(mts.readStatus(st));
+    CHECK_EQ(mts.lastError(), MTS4X_ERR_OK);
+
+    MTS4X other(sim, 0x44);   // nobody at this address
+    CHECK(!other.readStatus(st));
+    CHECK_EQ(other.lastError(), MTS4X_ERR_WIRE);
+}
+
+int main() {
+    testSingleShot();
+    testConversionTime();
+    testFrozenMicros();
+    testContinuousPeriod();
+    testAlert();
+    testEeprom();
+    testErrors();
+    return host_test_result("test_sim");
+}
@@ -0,0 +1,317 @@
+// MTS4X_THREAD_SAFE under pthreads on one simulated chip whose bus runs in
+// real time: an acquisition thread, a diagnostics thread and a thread
+// provoking errors share the bus. No two transactions overlap, no frame
+// is torn, lastError() is per thread, and once the acquisition thread has
+// asked for the bus, at most one diagnostic transaction gets it first
+// (the lock is first come, first served). Fairness is counted in
+// transactions, not timed, so a loaded or single-CPU machine passes too;
+// the latencies are printed only.
+
+#include "MTS4x.h"
+#include "MTS4xSim.h"
+#include "host_test.h"
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <pthread.h>
+#include <sys/resource.h>
+#include <time.h>
+#include <vector>
+
+#if !MTS4X_THREAD_SAFE
+#error "test_threads is built with -DMTS4X_THREAD_SAFE=1"
+#endif
+
+#define HZ 100000UL
+
+static uint64_t realUs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+static void sleepUntil(uint64_t us) {
+    for (uint64_t now = realUs(); now < us; now = realUs()) {
+        struct timespec ts = { 0, (long)(us - now) * 1000L };
+        nanosleep(&ts, 0);
+    }
+}
+
+enum Role { ROLE_OTHER, ROLE_ACQ, ROLE_DIAG };
+
+static thread_local Role t_role = ROLE_OTHER;
+
+// Involuntary context switches of the calling thread so far
+static long preemptions() {
+    struct rusage ru;
+    getrusage(RUSAGE_THREAD, &ru);
+    return ru.ru_nivcsw;
+}
+
+// Diagnostic transactions that got the bus after the acquisition thread
+// had asked for it, per acquisition transaction
+struct Overtakes {
+    uint32_t frames[3];   // 0, 1, 2 or more
+    uint32_t worst;
+    uint32_t preempted;   // left out: preempted between asking and queueing
+};
+
+// The simulated chip on a clock that follows real time: every transaction
+// takes its bus time for real, delay() sleeps. Transactions that run at
+// the same time are counted instead of serialized by the bus itself.
+//
+// The driver calls lockKey() right before it takes the bus lock for a
+// transaction, so an acquisition thread calling it marks its request;
+// its next transaction counts the diagnostic ones that started since.
+// A thread preempted in between may find more of them ahead without any
+// unfairness of the lock: such frames are counted apart.
+class RealTimeBus : public MTS4xBus {
+  public:
+    RealTimeBus() : overlaps(0), _t0(realUs()), _busy(0), _diagSeq(0) {
+        sim.setClock(HZ);
+        memset(&overtakes, 0, sizeof(overtakes));
+    }
+
+    bool begin(int32_t, int32_t) override { return true; }
+    void setClock(uint32_t hz) override {
+        std::lock_guard<std::mutex> l(_simLock);
+        sim.setClock(hz);
+    }
+    bool writeRegs(uint8_t addr, uint8_t reg, const uint8_t *data, size_t len) override {
+        enter();
+        uint64_t end;
+        bool     ok;
+        {
+            std::lock_guard<std::mutex> l(_simLock);
+            sync();
+            ok  = sim.writeRegs(addr, reg, data, len);
+            end = sim.nowUs();
+        }
+        sleepUntil(_t0 + end);
+        leave();
+        return ok;
+    }
+    bool readRegs(uint8_t addr, uint8_t reg, uint8_t *data, size_t len) override {
+        enter();
+        uint64_t end;
+        bool     ok;
+        {
+            std::lock_guard<std::mutex> l(_simLock);
+            sync();
+            ok  = sim.readRegs(addr, reg, data, len);
+            end = sim.nowUs();
+        }
+        sleepUntil(_t0 + end);
+        leave();
+        return ok;
+    }
+    uint32_t micros() override { return (uint32_t)(realUs() - _t0); }
+    uint32_t millis() override { return micros() / 1000UL; }
+    void     delay(uint32_t ms) override { sleepUntil(realUs() + ms * 1000ULL); }
+
+    const void *lockKey() const override {
+        if (t_role == ROLE_ACQ) {
+            t_asked     = true;
+            t_askSeq    = _diagSeq;
+            t_askSwitch = preemptions();
+        }
+        return this;
+    }
+
+    MTS4xSimDevice        sim;
+    std::atomic<uint32_t> overlaps;
+    Overtakes             overtakes;   // written by the acquisition thread only
+
+  private:
+    uint64_t                      _t0;
+    std::atomic<int>              _busy;
+    std::mutex                    _simLock;
+    mutable std::atomic<uint32_t> _diagSeq;
+
+    static thread_local bool     t_asked;
+    static thread_local uint32_t t_askSeq;
+    static thread_local long     t_askSwitch;
+
+    void sync() {
+        uint64_t now = realUs() - _t0;
+        if (sim.nowUs() < now) sim.advanceUs((uint32_t)(now - sim.nowUs()));
+    }
+    void enter() {
+        if (_busy.fetch_add(1) != 0) ++overlaps;
+        if (t_role == ROLE_DIAG) {
+            ++_diagSeq;
+        } else if (t_role == ROLE_ACQ && t_asked) {
+            t_asked = false;
+            if (preemptions() != t_askSwitch) {
+                ++overtakes.preempted;
+                return;
+            }
+            uint32_t n = _diagSeq - t_askSeq;
+            ++overtakes.frames[n < 2 ? n : 2];
+            if (n > overtakes.worst) overtakes.worst = n;
+        }
+    }
+    void leave() { _busy.fetch_sub(1); }
+};
+
+thread_local bool     RealTimeBus::t_asked     = false;
+thread_local uint32_t RealTimeBus::t_askSeq    = 0;
+thread_local long     RealTimeBus::t_askSwitch = 0;
+
+static MTS4X            *s_acq;    // acquisition and error threads
+static MTS4X            *s_diag;   // diagnostics, own object on the same bus
+static std::atomic<bool> s_stop;
+static std::atomic<uint32_t> s_frames;   // acquisition frames so far
+static std::atomic<uint32_t> s_rounds;   // diagnostic rounds so far
+
+struct AcqStats {
+    uint32_t              samples;
+    uint32_t              failures;
+    uint32_t              wrongError;
+    std::vector<uint32_t> latencyUs;   // per readTemperatureFrame()
+};
+
+// Polls a running conversion like an acquisition task: one fused frame
+// per pass, checked against the chip's temperature
+static void *acquisition(void *arg) {
+    AcqStats *st = (AcqStats *)arg;
+    t_role       = ROLE_ACQ;
+    while (!s_stop) {
+        int16_t  raw;
+        bool     crcOk;
+        uint8_t  status;
+        uint64_t t0 = realUs();
+        bool     ok = s_acq->readTemperatureFrame(raw, crcOk, status);
+        st->latencyUs.push_back((uint32_t)(realUs() - t0));
+        if (!ok || !crcOk || mts4x_raw_to_milli(raw) != 21500) {
+            ++st->failures;
+        } else if (s_acq->lastError() != MTS4X_ERR_OK) {
+            ++st->wrongError;
+        } else {
+            ++st->samples;
+        }
+        ++s_frames;
+        sleepUntil(t0 + 2000);
+    }
+    return 0;
+}
+
+struct DiagStats {
+    uint32_t reads;
+    uint32_t bad;
+    uint32_t longestUs;
+};
+
+// Back-to-back scratch reads and user register round trips, no pause
+static void *diagnostics(void *arg) {
+    DiagStats *st = (DiagStats *)arg;
+    uint8_t    v  = 0;
+    t_role        = ROLE_DIAG;
+    while (!s_stop) {
+        uint8_t  ext[10];
+        bool     crcOk = false;
+        uint64_t t0    = realUs();
+        if (!s_diag->readScratchExt(ext, crcOk) || !crcOk) ++st->bad;
+        uint32_t d = (uint32_t)(realUs() - t0);
+        if (d > st->longestUs) st->longestUs = d;
+
+        uint8_t back = 0;
+        ++v;
+        if (!s_diag->writeUserRegister(1, v) || !s_diag->readUserRegister(1, back) || back != v) {
+            ++st->bad;
+        }
+        ++st->reads;
+        ++s_rounds;
+    }
+    return 0;
+}
+
+// Calls on the acquisition thread's object that fail, from another thread
+static void *errors(void *arg) {
+    uint32_t *wrong = (uint32_t *)arg;
+    while (!s_stop) {
+        uint8_t v;
+        if (s_acq->readUserRegister(200, v) || s_acq->lastError() != MTS4X_ERR_PARAM) {
+            ++*wrong;
+        }
+        struct timespec ts = { 0, 100000L };
+        nanosleep(&ts, 0);
+    }
+    return 0;
+}
+
+int main() {
+    RealTimeBus bus;
+    MTS4X       acq(bus), diag(bus);
+    s_acq  = &acq;
+    s_diag = &diag;
+    bus.sim.setTemperatureMilli(21500);
+    CHECK(acq.begin(0, 0));
+    CHECK(diag.begin(0, 0));
+    acq.setBusClock(HZ);
+    CHECK(acq.setConfig(MPS_8Hz, AVG_1, false));
+    CHECK(acq.setMode(MEASURE_CONTINUOUS, false));
+    sleepUntil(realUs() + 20000ULL);
+
+    // Acquisition alone, then with the other two threads hammering the bus
+    AcqStats  alone = { 0, 0, 0, std::vector<uint32_t>() };
+    AcqStats  busy  = { 0, 0, 0, std::vector<uint32_t>() };
+    DiagStats ds    = { 0, 0, 0 };
+    uint32_t  wrong = 0;
+    pthread_t ta, td, te;
+
+    s_stop = false;
+    CHECK(pthread_create(&ta, 0, acquisition, &alone) == 0);
+    sleepUntil(realUs() + 300000ULL);
+    s_stop = true;
+    pthread_join(ta, 0);
+
+    // Until both threads have done enough work, however slow the machine;
+    // the time limit only catches starvation
+    memset(&bus.overtakes, 0, sizeof(bus.overtakes));
+    s_stop   = false;
+    s_frames = 0;
+    s_rounds = 0;
+    CHECK(pthread_create(&td, 0, diagnostics, &ds) == 0);
+    CHECK(pthread_create(&te, 0, errors, &wrong) == 0);
+    CHECK(pthread_create(&ta, 0, acquisition, &busy) == 0);
+    uint64_t limit = realUs() + 60000000ULL;
+    while ((s_frames < 500 || s_rounds < 500) && realUs() < limit) {
+        sleepUntil(realUs() + 10000ULL);
+    }
+    s_stop = true;
+    pthread_join(ta, 0);
+    pthread_join(td, 0);
+    pthread_join(te, 0);
+
+    std::sort(alone.latencyUs.begin(), alone.latencyUs.end());
+    std::sort(busy.latencyUs.begin(), busy.latencyUs.end());
+    uint32_t p99 = busy.latencyUs[busy.latencyUs.size() * 99 / 100];
+    const Overtakes &ot = bus.overtakes;
+    printf("  acquisition frame alone: median %lu us, worst %lu us\n",
+           (unsigned long)alone.latencyUs[alone.latencyUs.size() / 2],
+           (unsigned long)alone.latencyUs.back());
+    printf("  with diagnostics:        median %lu us, p99 %lu us, worst %lu us "
+           "(%lu samples; %lu diagnostic rounds, scratch_ext read %lu us)\n",
+           (unsigned long)busy.latencyUs[busy.latencyUs.size() / 2], (unsigned long)p99,
+           (unsigned long)busy.latencyUs.back(), (unsigned long)busy.samples,
+           (unsigned long)ds.reads, (unsigned long)ds.longestUs);
+    printf("  diagnostic transactions ahead of a frame: 0 x%lu, 1 x%lu, 2+ x%lu "
+           "(worst %lu; %lu frames preempted before queueing)\n",
+           (unsigned long)ot.frames[0], (unsigned long)ot.frames[1],
+           (unsigned long)ot.frames[2], (unsigned long)ot.worst,
+           (unsigned long)ot.preempted);
+
+    CHECK_EQ(bus.overlaps.load(), 0);
+    CHECK_EQ(alone.failures + busy.failures, 0);
+    CHECK_EQ(alone.wrongError + busy.wrongError, 0);
+    CHECK_EQ(wrong, 0);
+    CHECK_EQ(ds.bad, 0);
+    CHECK(s_frames >= 500 && s_rounds >= 500);
+    // First come, first served: a frame waits for the diagnostic
+    // transaction holding the bus when it asked, never for one that
+    // asked after it
+    CHECK(ot.worst <= 1);
+    CHECK(busy.samples > busy.latencyUs.size() * 9 / 10);
+    return host_test_result("test_threads");
+}
@@ -0,0 +1,134 @@
+// Transaction counter against the simulated bus: transactionCount() agrees
+// with what the device saw over a mixed workload (faults and replays
+// included), a ready sample is one fused read, and the per-sample cost
+// next to the old status-poll-then-read pattern replayed on the same bus
+
+#include "MTS4x.h"
+#include "MTS4xSim.h"
+#include "host_test.h"
+
+static void testCounterMatchesBus() {
+    MTS4xSimDevice sim;
+    MTS4X          mts(sim);
+    CHECK(mts.begin(0, 0));
+    mts.setRecoveryDeadline(20000);
+    sim.resetCounters();
+    mts.resetTransactionCount();
+    CHECK_EQ(mts.transactionCount(), 0);
+
+    int32_t mC;
+    uint8_t st;
+    CHECK(mts.setConfig(MPS_2Hz, AVG_16, true));
+    for (uint8_t i = 0; i < 10; ++i) {
+        CHECK(mts.singleShotMilli(mC));
+    }
+    CHECK(mts.readStatus(st));
+    CHECK(mts.writeUserRegister(1, 0x42));
+    CHECK(mts.eepromCopyPage(true, 50));
+    sim.injectNak(3);   // three failed attempts, then a good replay
+    CHECK(mts.singleShotMilli(mC));
+    CHECK(mts.startConversion());
+    while (mts.poll() == MTS4X_POLL_PENDING) {
+        sim.advanceUs(500);
+    }
+    CHECK_EQ(mts.transactionCount(), sim.transactions());
+
+    mts.resetTransactionCount();
+    CHECK_EQ(mts.transactionCount(), 0);
+}
+
+// Status, temperature and CRC of a finished conversion in one frame
+static void testReadySample() {
+    MTS4xSimDevice sim;
+    MTS4X          mts(sim);
+    sim.setTemperatureMilli(-12500);
+    CHECK(mts.begin(0, 0));
+    CHECK(mts.setConfig(MPS_1Hz, AVG_8, true));
+    CHECK(mts.startConversion());
+    sim.advanceUs(mts4x_avg_time_us(AVG_8) + 200);
+
+    sim.resetCounters();
+    mts.resetTransactionCount();
+    CHECK(mts.poll() == MTS4X_POLL_READY);
+    CHECK_EQ(mts.transactionCount(), 1);
+    CHECK_EQ(sim.transactions(), 1);
+    CHECK_EQ(sim.statusReads(), 1);
+    CHECK_EQ(sim.bytesOnWire(), 3 + 4);   // address, register, address, 4 data
+    int16_t raw;
+    bool    crcOk;
+    CHECK(mts.result(raw, crcOk));
+    CHECK(crcOk);
+    CHECK_EQ(mts4x_raw_to_milli(raw), -12500);
+}
+
+struct Cost {
+    uint32_t transactions;
+    uint64_t busUs;
+    uint64_t latencyUs;   // trigger to sample in hand
+};
+
+// The driver before the fused read: Status every 1 ms until BUSY clears,
+// then Temp_Lsb..Crc_temp in a second transaction
+static Cost oldPattern(MTS4xSimDevice &sim, MTS4X &mts, uint16_t samples) {
+    sim.resetCounters();
+    uint64_t latency = 0;
+    for (uint16_t i = 0; i < samples; ++i) {
+        uint64_t t0 = sim.nowUs();
+        CHECK(mts.startSingleMessurement());
+        uint8_t st = MTS4X_STATUS_BUSY;
+        while (st & MTS4X_STATUS_BUSY) {
+            CHECK(sim.readRegs(MTS4X_ADDRESS, MTS4X_STATUS, &st, 1));
+            if (st & MTS4X_STATUS_BUSY) sim.delay(1);
+        }
+        uint8_t buf[3];
+        CHECK(sim.readRegs(MTS4X_ADDRESS, MTS4X_TEMP_LSB, buf, 3));
+        latency += sim.nowUs() - t0;
+    }
+    Cost c = { sim.transactions(), sim.busTimeUs(), latency };
+    return c;
+}
+
+static Cost fusedPattern(MTS4xSimDevice &sim, MTS4X &mts, uint16_t samples) {
+    sim.resetCounters();
+    uint64_t latency = 0;
+    for (uint16_t i = 0; i < samples; ++i) {
+        uint64_t t0 = sim.nowUs();
+        int32_t  mC;
+        CHECK(mts.singleShotMilli(mC));
+        latency += sim.nowUs() - t0;
+    }
+    Cost c = { sim.transactions(), sim.busTimeUs(), latency };
+    return c;
+}
+
+static void testPerSample(TempCfgAVG avg, uint32_t hz) {
+    const uint16_t samples = 200;
+    MTS4xSimDevice sim;
+    MTS4X          mts(sim);
+    CHECK(mts.begin(0, 0));
+    mts.setBusClock(hz);
+    CHECK(mts.setConfig(MPS_1Hz, avg, true));
+
+    Cost o = oldPattern(sim, mts, samples);
+    Cost f = fusedPattern(sim, mts, samples);
+    printf("  AVG_%-2u %3lu kHz  per sample: transactions %5.2f -> %5.2f, "
+           "bus %4.0f -> %4.0f us, latency %5.0f -> %5.0f us\n",
+           1U << (avg ? (avg >> 3) + 2 : 0), (unsigned long)(hz / 1000),
+           (double)o.transactions / samples, (double)f.transactions / samples,
+           (double)o.busUs / samples, (double)f.busUs / samples,
+           (double)o.latencyUs / samples, (double)f.latencyUs / samples);
+    CHECK(f.transactions < o.transactions);
+    CHECK(f.busUs < o.busUs);
+    CHECK(f.latencyUs <= o.latencyUs);
+}
+
+int main() {
+    testCounterMatchesBus();
+    testReadySample();
+    static const TempCfgAVG avgs[] = { AVG_1, AVG_8, AVG_32 };
+    for (uint8_t i = 0; i < 3; ++i) {
+        testPerSample(avgs[i], 100000UL);
+        testPerSample(avgs[i], 400000UL);
+    }
+    return host_test_result("test_transactions");
+}
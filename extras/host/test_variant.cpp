@@ -0,0 +1,69 @@
+// MTS4XSensor front end on the simulated chip: the variant window in raw
+// codes, reads and single shots through the driver's own paths (the
+// conversion time of the config is waited, not polled through), and the
+// driver's error codes on a NAK
+
+#include "MTS4x.h"
+#include "MTS4xSim.h"
+#include "MTS4xVariant.h"
+#include "host_test.h"
+
+typedef MTS4XSensor<MTS4xVariantMTS4P, MTS4X_FEAT_CRC> SensorP;
+typedef MTS4XSensor<MTS4xVariantMTS4P, 0>              SensorNoCrc;
+
+static void testWindow() {
+    // -25..25 °C, rounded inwards
+    CHECK_EQ(SensorP::windowLowRaw(), -12800);
+    CHECK_EQ(SensorP::windowHighRaw(), 0);
+    CHECK(SensorP::inWindow(0));
+    CHECK(!SensorP::inWindow(1));
+    CHECK(SensorP::inWindowMilli(-25000));
+    CHECK(!SensorP::inWindowMilli(25001));
+    CHECK_EQ(SensorP::accuracyMilli(0), 100);
+    CHECK_EQ(SensorP::accuracyMilli(30000), 1000);
+    CHECK_EQ(MTS4XSensorMTS4B::accuracyMilli(120000), 500);
+    CHECK(SensorP::hasCrc);
+    CHECK(!SensorNoCrc::hasCrc);
+}
+
+template <class Sensor>
+static void testReads() {
+    MTS4xSimDevice sim;
+    Sensor         mts(sim);
+    sim.setTemperatureMilli(21500);
+    CHECK(mts.begin(0, 0));
+    CHECK(mts.setConfig(MPS_1Hz, AVG_32, true));
+
+    // Single shot: one command, the AVG_32 wait, one frame
+    sim.resetCounters();
+    uint64_t t0 = sim.nowUs();
+    int32_t  mC = 0;
+    CHECK(mts.singleShotMilli(mC));
+    CHECK_EQ(mC, 21500);
+    CHECK(sim.lastConversionUs() - t0 >= 15000);
+    CHECK_EQ(sim.transactions(), 2);
+    CHECK_EQ(mts.lastError(), MTS4X_ERR_OK);
+
+    // Continuous: BUSY polled until the first sample lands
+    CHECK(mts.setMode(MEASURE_CONTINUOUS));
+    int16_t raw = 0;
+    CHECK(mts.readRaw(raw));
+    CHECK_EQ(mts4x_raw_to_milli(raw), 21500);
+#ifndef MTS4X_NO_FLOAT
+    CHECK(mts.readTemperature() > 21.49f);
+#endif
+
+    // Errors come from the driver unchanged
+    sim.injectNak(100);
+    CHECK(!mts.readMilli(mC));
+    CHECK_EQ(mts.lastError(), MTS4X_ERR_WIRE);
+    sim.injectNak(0);
+    CHECK(mts.readMilli(mC, false));
+}
+
+int main() {
+    testWindow();
+    testReads<SensorP>();
+    testReads<SensorNoCrc>();
+    return host_test_result("test_variant");
+}
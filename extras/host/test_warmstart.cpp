@@ -0,0 +1,101 @@
+// warmBegin() after a host deep sleep: a chip that kept its power costs
+// one read and no writes in every continuous mode, a power-cycled one is
+// restored; the state survives a captureState/warmBegin round trip
+
+#include "MTS4x.h"
+#include "MTS4xSim.h"
+#include "MTS4xWarmStart.h"
+#include "host_test.h"
+#include <string.h>
+
+// Counts register writes on top of the simulated chip
+class WriteCountSim : public MTS4xSimDevice {
+  public:
+    WriteCountSim() : writes(0) {}
+    bool writeRegs(uint8_t addr, uint8_t reg,
+                   const uint8_t *data, size_t len) override {
+        ++writes;
+        return MTS4xSimDevice::writeRegs(addr, reg, data, len);
+    }
+    uint32_t writes;
+};
+
+static void coldStart(MTS4X &mts, MeasurementMode mode) {
+    CHECK(mts.begin(0, 0));
+    CHECK(mts.setShadowCache(true));
+    CHECK(mts.setConfig(MPS_4Hz, AVG_8, false));
+    CHECK(mts.setLimitsRaw(0x0C80, 0x0380));
+    CHECK(mts.setAlertMode(true, ALERT_MODE_HIGH_TH_LOW_ALARM));
+    CHECK(mts.setMode(mode, false));
+}
+
+// Let the chip finish a few conversions, as during the host's sleep
+static void sleepMs(MTS4xSimDevice &sim, uint32_t ms) {
+    for (uint32_t t = 0; t < ms; t += 10) {
+        sim.advanceUs(10000);
+    }
+}
+
+static void testKept(MeasurementMode mode) {
+    WriteCountSim sim;
+    sim.setTemperatureMilli(23250);
+    MTS4xSnapshot snap;
+    {
+        MTS4X mts(sim);
+        coldStart(mts, mode);
+        CHECK(mts.captureState(snap.driver));
+        CHECK(mts4x_snapshot_save(snap));
+    }
+    sleepMs(sim, 1100);   // between conversions: not BUSY
+
+    MTS4xSnapshot back;
+    CHECK(mts4x_snapshot_load(back));
+    MTS4X mts(sim);
+    sim.writes = 0;
+    int16_t raw   = 0;
+    bool    fresh = false;
+    CHECK(mts.warmBegin(0, 0, back.driver, raw, fresh));
+    CHECK(fresh);
+    CHECK_EQ(mts4x_raw_to_milli(raw), 23250);
+    CHECK_EQ(sim.writes, 0);
+
+    // Round trip: the state comes back from the shadow unchanged, and the
+    // user registers were primed with it
+    sim.resetCounters();
+    MTS4xDriverState again;
+    CHECK(mts.captureState(again));
+    CHECK_EQ(sim.transactions(), 0);
+    CHECK(memcmp(again.config, snap.driver.config, sizeof(again.config)) == 0);
+    CHECK(memcmp(again.user, snap.driver.user, sizeof(again.user)) == 0);
+}
+
+static void testPowerLost(MeasurementMode mode) {
+    MTS4xSimDevice sim;
+    MTS4xDriverState state;
+    {
+        MTS4X mts(sim);
+        coldStart(mts, mode);
+        CHECK(mts.captureState(state));
+    }
+    sim.powerOn();
+
+    MTS4X   mts(sim);
+    int16_t raw   = 0;
+    bool    fresh = true;
+    CHECK(mts.warmBegin(0, 0, state, raw, fresh));
+    CHECK(!fresh);
+    CHECK_EQ(sim.peek(MTS4X_TEMP_CFG), state.config[1]);
+    CHECK_EQ(sim.peek(MTS4X_TH_LSB), 0x80);
+    CHECK_EQ(sim.peek(MTS4X_TEMP_CMD) >> 6, MEASURE_CONTINUOUS);
+    sim.resetCounters();
+    sleepMs(sim, 1000);
+    CHECK(sim.conversions() >= 3);
+}
+
+int main() {
+    testKept(MEASURE_CONTINUOUS);
+    testKept(MEASURE_CONTINUOUS_READBACK);
+    testPowerLost(MEASURE_CONTINUOUS);
+    testPowerLost(MEASURE_CONTINUOUS_READBACK);
+    return host_test_result("test_warmstart");
+}
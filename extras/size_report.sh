@@ -0,0 +1,108 @@
+#!/bin/sh
+# MTS4x Arduino driver - flash/RAM size report per driver configuration
+# Author: Denis (FedunovDenis)
+#
+# Builds examples/MTS4x_SizeCheck once per MTS4X_SIZE_CONFIG and board with
+# arduino-cli and prints CSV:  SIZE,<fqbn>,<config>,<flash>,<ram>
+# Every row is compared against the baseline file; the script exits 1 when
+# flash or RAM grew by more than MTS4X_SIZE_SLACK bytes, when a row has no
+# baseline entry or when there is no baseline at all (--update writes or
+# refreshes the rows of this build).
+#
+# --host builds the same sketch with the host compiler against the shims
+# in extras/host (-Os, unused sections dropped) as "host:<compiler>" rows.
+# Absolute sizes say nothing about a board, but growth between two
+# commits shows up the same way, without any board toolchain.
+#
+#   extras/size_report.sh                    report + check extras/size_baseline.csv
+#   extras/size_report.sh --update           write this build's rows to the baseline
+#   extras/size_report.sh --host             host build, as run in CI
+#   FQBNS="arduino:avr:uno" extras/size_report.sh
+
+set -eu
+
+ROOT=$(cd "$(dirname "$0")/.." && pwd)
+SKETCH="$ROOT/examples/MTS4x_SizeCheck"
+BASELINE="${MTS4X_SIZE_BASELINE:-$ROOT/extras/size_baseline.csv}"
+SLACK="${MTS4X_SIZE_SLACK:-0}"
+FQBNS="${FQBNS:-arduino:avr:uno esp8266:esp8266:d1_mini esp32:esp32:esp32}"
+CONFIGS="${CONFIGS:-0 1 2 3 4 5}"
+
+UPDATE=0
+HOST=0
+for arg in "$@"; do
+  case "$arg" in
+    --update) UPDATE=1 ;;
+    --host)   HOST=1 ;;
+    *) echo "usage: $0 [--host] [--update]" >&2; exit 2 ;;
+  esac
+done
+
+OUT=$(mktemp)
+trap 'rm -f "$OUT" "$OUT.log" "$OUT.bin" "$OUT.main.cpp"' EXIT
+
+if [ "$HOST" -eq 1 ]; then
+  CXX="${CXX:-g++}"
+  ver=$("$CXX" -dumpfullversion 2>/dev/null || "$CXX" -dumpversion)
+  fqbn="host:$("$CXX" -dumpmachine)-$(basename "$CXX" | sed 's/-[0-9.]*$//')-$ver"
+  printf 'void setup();\nvoid loop();\nint main() { setup(); loop(); return 0; }\n' \
+    > "$OUT.main.cpp"
+  for cfg in $CONFIGS; do
+    if ! "$CXX" -std=gnu++11 -Os -ffunction-sections -fdata-sections \
+         -Wl,--gc-sections -DMTS4X_SIZE_CONFIG="$cfg" \
+         -I"$ROOT/extras/host/shim" -I"$ROOT" \
+         -x c++ "$SKETCH/MTS4x_SizeCheck.ino" -x none "$OUT.main.cpp" \
+         "$ROOT"/*.cpp "$ROOT/extras/host/shim/Arduino.cpp" \
+         -o "$OUT.bin" > "$OUT.log" 2>&1; then
+      echo "BUILD,$fqbn,$cfg,FAIL" >&2
+      cat "$OUT.log" >&2
+      exit 2
+    fi
+    # Same split as the Arduino report: flash = text + data, RAM = data + bss
+    set -- $(size "$OUT.bin" | tail -1)
+    echo "SIZE,$fqbn,$cfg,$(($1 + $2)),$(($2 + $3))" | tee -a "$OUT"
+  done
+else
+  for fqbn in $FQBNS; do
+    for cfg in $CONFIGS; do
+      if ! arduino-cli compile --fqbn "$fqbn" --library "$ROOT" \
+           --build-property "compiler.cpp.extra_flags=-DMTS4X_SIZE_CONFIG=$cfg" \
+           "$SKETCH" > "$OUT.log" 2>&1; then
+        echo "BUILD,$fqbn,$cfg,FAIL" >&2
+        cat "$OUT.log" >&2
+        exit 2
+      fi
+      flash=$(sed -n 's/^Sketch uses \([0-9]*\) bytes.*/\1/p' "$OUT.log")
+      ram=$(sed -n 's/^Global variables use \([0-9]*\) bytes.*/\1/p' "$OUT.log")
+      echo "SIZE,$fqbn,$cfg,${flash:-0},${ram:-0}" | tee -a "$OUT"
+    done
+  done
+fi
+
+if [ "$UPDATE" -eq 1 ]; then
+  # Replace this build's rows, keep those of other boards
+  if [ -f "$BASELINE" ]; then
+    awk -F, 'NR == FNR { k[$2 "," $3] = 1; next } !(($2 "," $3) in k)' \
+      "$OUT" "$BASELINE" > "$OUT.log"
+  else
+    : > "$OUT.log"
+  fi
+  sort -t, -k2,2 -k3,3n "$OUT.log" "$OUT" > "$BASELINE"
+  echo "baseline written: $BASELINE"
+  exit 0
+fi
+[ -f "$BASELINE" ] || { echo "no baseline ($BASELINE): run with --update"; exit 1; }
+
+# Join on fqbn+config; a row missing from the baseline fails as well
+awk -F, -v slack="$SLACK" '
+  NR == FNR { f[$2 "," $3] = $4; r[$2 "," $3] = $5; next }
+  {
+    k = $2 "," $3
+    if (!(k in f)) { print "NEW," k ",FAIL (run with --update)"; bad = 1; next }
+    df = $4 - f[k]; dr = $5 - r[k]
+    st = (df > slack || dr > slack) ? "FAIL" : "OK"
+    if (st == "FAIL") bad = 1
+    printf "CHECK,%s,%+d,%+d,%s\n", k, df, dr, st
+  }
+  END { print (bad ? "RESULT,FAIL" : "RESULT,PASS"); exit bad }
+' "$BASELINE" "$OUT"